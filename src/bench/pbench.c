@@ -0,0 +1,371 @@
+/*
+Copyright (c) 2015, Patrick Weltevrede
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "psrsalsa.h"
+typedef struct {
+  char name[100];
+  long iterations;
+  double seconds, bytes;
+}benchresult_definition;
+#define MaxNrBenchResults 100
+int nrbenchresults;
+benchresult_definition benchresults[MaxNrBenchResults];
+double internal_bench_clock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+void internal_bench_report(char *name, long iterations, double seconds, double bytes)
+{
+  printf("  %-28s %6ld iterations %10.6f s/iteration", name, iterations, seconds/(double)iterations);
+  if(bytes > 0)
+    printf(" %10.2f MB/s", bytes*iterations/(seconds*1024.0*1024.0));
+  printf("\n");
+  fflush(stdout);
+  if(nrbenchresults < MaxNrBenchResults) {
+    strncpy(benchresults[nrbenchresults].name, name, 99);
+    benchresults[nrbenchresults].name[99] = 0;
+    benchresults[nrbenchresults].iterations = iterations;
+    benchresults[nrbenchresults].seconds = seconds;
+    benchresults[nrbenchresults].bytes = bytes;
+    nrbenchresults++;
+  }
+}
+int internal_bench_readpulses(char *filename, int format, char *name, long iterations, verbose_definition verbose)
+{
+  datafile_definition fin;
+  long it, n, f, p;
+  float *pulse;
+  double t0;
+  cleanPSRData(&fin, verbose);
+  if(!openPSRData(&fin, filename, format, 0, 0, 0, verbose))
+    return 0;
+  if(!readHeaderPSRData(&fin, 0, 0, verbose)) {
+    closePSRData(&fin, 0, verbose);
+    return 0;
+  }
+  pulse = (float *)malloc(fin.NrBins*sizeof(float));
+  if(pulse == NULL) {
+    printerror(verbose.debug, "ERROR pbench: Memory allocation error");
+    closePSRData(&fin, 0, verbose);
+    return 0;
+  }
+  t0 = internal_bench_clock();
+  for(it = 0; it < iterations; it++) {
+    for(n = 0; n < fin.NrSubints; n++) {
+      for(f = 0; f < fin.NrFreqChan; f++) {
+ for(p = 0; p < fin.NrPols; p++) {
+   if(readPulsePSRData(&fin, n, p, f, 0, fin.NrBins, pulse, verbose) != 1) {
+     printerror(verbose.debug, "ERROR pbench: Reading pulse %ld from %s failed", n, filename);
+     free(pulse);
+     closePSRData(&fin, 0, verbose);
+     return 0;
+   }
+ }
+      }
+    }
+  }
+  internal_bench_report(name, iterations, internal_bench_clock()-t0, fin.NrSubints*fin.NrFreqChan*fin.NrPols*fin.NrBins*sizeof(float));
+  free(pulse);
+  closePSRData(&fin, 0, verbose);
+  return 1;
+}
+void internal_bench_freebuffers(float *lrfs, float *twodfs, float *map, float *phase_track, double *alignshifts, pulselongitude_regions_definition *onpulse, datafile_definition *fin, verbose_definition verbose)
+{
+  if(lrfs != NULL)
+    free(lrfs);
+  if(twodfs != NULL)
+    free(twodfs);
+  if(map != NULL)
+    free(map);
+  if(phase_track != NULL)
+    free(phase_track);
+  if(alignshifts != NULL)
+    free(alignshifts);
+  freePulselongitudeRegion(onpulse);
+  closePSRData(fin, 0, verbose);
+}
+int main(int argc, char **argv)
+{
+  psrsalsaApplication application;
+  synthetic_definition params, params4;
+  datafile_definition fin;
+  pulselongitude_regions_definition onpulse;
+  char dirname[MaxFilenameLength], jsonname[MaxFilenameLength], filename[MaxFilenameLength], txt[MaxStringLength];
+  long i, it, iterations, fft_size;
+  int bin, width, runppolfit;
+  float snr, E, var_rms, *lrfs, *twodfs, *map, *phase_track;
+  double t0, freq_ref, *alignshifts;
+  FILE *fjson;
+  templatealign_definition alignengine;
+  initApplication(&application, "pbench", "[options]");
+  application.switch_verbose = 1;
+  application.switch_debug = 1;
+  initSyntheticParams(&params);
+  params.NrSubints = 256;
+  params.NrBins = 512;
+  params.NrFreqChan = 16;
+  iterations = 3;
+  runppolfit = 1;
+  sprintf(dirname, ".");
+  jsonname[0] = 0;
+  nrbenchresults = 0;
+  for(i = 1; i < argc; i++) {
+    int index;
+    index = i;
+    if(processCommandLine(&application, argc, argv, &index)) {
+      i = index;
+    }else if(strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-help") == 0) {
+      printf("Program to benchmark the hot paths of the PSRSALSA library on synthetic data.\nThe results are printed to the terminal and optionally written as JSON. Usage:\n\n");
+      printApplicationHelp(&application);
+      printf("Benchmark options:\n");
+      printf("  -nsub n    Number of subints of the synthetic data [def=%ld]\n", params.NrSubints);
+      printf("  -nbin n    Number of bins of the synthetic data [def=%ld]\n", params.NrBins);
+      printf("  -nchan n   Number of frequency channels of the synthetic data [def=%ld]\n", params.NrFreqChan);
+      printf("  -iter n    Number of iterations of each benchmark [def=%ld]\n", iterations);
+      printf("  -dir dir   Directory for the temporary synthetic files [def=%s]\n", dirname);
+      printf("  -json file Write the results in JSON format to this file\n");
+      printf("  -noppolfit Do not time the ppolFit grid search\n");
+      printf("\n");
+      printCitationInfo();
+      terminateApplication(&application);
+      return 0;
+    }else if(strcmp(argv[i], "-nsub") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%ld", &params.NrSubints, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR pbench: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-nbin") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%ld", &params.NrBins, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR pbench: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-nchan") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%ld", &params.NrFreqChan, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR pbench: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-iter") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%ld", &iterations, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR pbench: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-dir") == 0) {
+      strcpy(dirname, argv[++i]);
+    }else if(strcmp(argv[i], "-json") == 0) {
+      strcpy(jsonname, argv[++i]);
+    }else if(strcmp(argv[i], "-noppolfit") == 0) {
+      runppolfit = 0;
+    }else {
+      printerror(application.verbose_state.debug, "ERROR pbench: Unknown option: %s\n\nRun pbench -h to show help", argv[i]);
+      terminateApplication(&application);
+      return 0;
+    }
+  }
+  if(params.NrSubints < 16 || params.NrBins < 16 || params.NrFreqChan < 1 || iterations < 1) {
+    printerror(application.verbose_state.debug, "ERROR pbench: Invalid benchmark dimensions.");
+    return 0;
+  }
+  params.NrPols = 1;
+  params4 = params;
+  params4.NrPols = 4;
+  printf("Benchmarking with %ld subints, %ld bins and %ld channels (%ld iterations)\n", params.NrSubints, params.NrBins, params.NrFreqChan, iterations);
+  int formats[3] = {PSRSALSA_BINARY_format, PUMA_format, FITS_format};
+  char *formatnames[3] = {"psrsalsa", "puma", "psrfits"};
+  for(i = 0; i < 3; i++) {
+    sprintf(filename, "%s/pbench_%s.dat", dirname, formatnames[i]);
+    t0 = internal_bench_clock();
+    if(writeSyntheticPSRData(filename, formats[i], params, argc, argv, application.verbose_state) == 0) {
+      printerror(application.verbose_state.debug, "ERROR pbench: Cannot generate %s", filename);
+      return 0;
+    }
+    sprintf(txt, "write_%s", formatnames[i]);
+    internal_bench_report(txt, 1, internal_bench_clock()-t0, params.NrSubints*params.NrFreqChan*params.NrBins*sizeof(float));
+    sprintf(txt, "readPulsePSRData_%s", formatnames[i]);
+    if(internal_bench_readpulses(filename, formats[i], txt, iterations, application.verbose_state) == 0)
+      return 0;
+  }
+  sprintf(filename, "%s/pbench_psrfits.dat", dirname);
+  t0 = internal_bench_clock();
+  for(it = 0; it < iterations; it++) {
+    cleanPSRData(&fin, application.verbose_state);
+    if(!openPSRData(&fin, filename, FITS_format, 0, 1, 0, application.verbose_state))
+      return 0;
+    closePSRData(&fin, 0, application.verbose_state);
+  }
+  internal_bench_report("readFITSfile", iterations, internal_bench_clock()-t0, params.NrSubints*params.NrFreqChan*params.NrBins*sizeof(float));
+  sprintf(filename, "%s/pbench_psrsalsa.dat", dirname);
+  cleanPSRData(&fin, application.verbose_state);
+  if(!openPSRData(&fin, filename, PSRSALSA_BINARY_format, 0, 1, 0, application.verbose_state))
+    return 0;
+  freq_ref = fin.freq_ref;
+  t0 = internal_bench_clock();
+  for(it = 0; it < iterations; it++) {
+    fin.isDeDisp = 0;
+    if(preprocess_dedisperse(&fin, 0, freq_ref, application.verbose_state) == 0) {
+      closePSRData(&fin, 0, application.verbose_state);
+      return 0;
+    }
+  }
+  internal_bench_report("preprocess_dedisperse", iterations, internal_bench_clock()-t0, fin.NrSubints*fin.NrFreqChan*fin.NrBins*sizeof(float));
+  closePSRData(&fin, 0, application.verbose_state);
+  sprintf(filename, "%s/pbench_stokes.dat", dirname);
+  if(writeSyntheticPSRData(filename, PSRSALSA_BINARY_format, params4, argc, argv, application.verbose_state) == 0)
+    return 0;
+  cleanPSRData(&fin, application.verbose_state);
+  if(!openPSRData(&fin, filename, PSRSALSA_BINARY_format, 0, 1, 0, application.verbose_state))
+    return 0;
+  freq_ref = fin.freq_ref;
+  t0 = internal_bench_clock();
+  for(it = 0; it < iterations; it++) {
+    fin.isDeFarad = 0;
+    if(preprocess_deFaraday(&fin, 0, 0, freq_ref, NULL, application.verbose_state) == 0) {
+      closePSRData(&fin, 0, application.verbose_state);
+      return 0;
+    }
+  }
+  internal_bench_report("preprocess_deFaraday", iterations, internal_bench_clock()-t0, fin.NrSubints*fin.NrFreqChan*fin.NrPols*fin.NrBins*sizeof(float));
+  closePSRData(&fin, 0, application.verbose_state);
+  remove(filename);
+  params.NrFreqChan = 1;
+  sprintf(filename, "%s/pbench_stack.dat", dirname);
+  if(writeSyntheticPSRData(filename, PSRSALSA_BINARY_format, params, argc, argv, application.verbose_state) == 0)
+    return 0;
+  cleanPSRData(&fin, application.verbose_state);
+  if(!openPSRData(&fin, filename, PSRSALSA_BINARY_format, 0, 1, 0, application.verbose_state))
+    return 0;
+  remove(filename);
+  initPulselongitudeRegion(&onpulse, application.verbose_state);
+  onpulse.nrRegions = 1;
+  onpulse.bins_defined[0] = 1;
+  onpulse.left_bin[0] = fin.NrBins/2 - 3*params.width*fin.NrBins;
+  onpulse.right_bin[0] = fin.NrBins/2 + 3*params.width*fin.NrBins;
+  fft_size = 1;
+  while(2*fft_size <= fin.NrSubints && fft_size < 256)
+    fft_size *= 2;
+  lrfs = (float *)malloc((fft_size/2+1)*fin.NrBins*sizeof(float));
+  twodfs = (float *)malloc((fft_size/2+1)*(onpulse.right_bin[0]-onpulse.left_bin[0]+1)*sizeof(float));
+  map = (float *)malloc(20*fin.NrBins*sizeof(float));
+  phase_track = (float *)malloc(fin.NrBins*sizeof(float));
+  alignshifts = NULL;
+  if(lrfs == NULL || twodfs == NULL || map == NULL || phase_track == NULL) {
+    printerror(application.verbose_state.debug, "ERROR pbench: Memory allocation error");
+    internal_bench_freebuffers(lrfs, twodfs, map, phase_track, alignshifts, &onpulse, &fin, application.verbose_state);
+    return 0;
+  }
+  t0 = internal_bench_clock();
+  for(it = 0; it < iterations; it++) {
+    if(calcLRFS(fin.data, fin.NrSubints, fin.NrBins, fft_size, lrfs, 1, phase_track, NULL, 0, 0, 0, 0, NULL, 0, 0, 0, &onpulse, &var_rms, 0, NULL, application.verbose_state) == 0) {
+      internal_bench_freebuffers(lrfs, twodfs, map, phase_track, alignshifts, &onpulse, &fin, application.verbose_state);
+      return 0;
+    }
+  }
+  internal_bench_report("calcLRFS", iterations, internal_bench_clock()-t0, fin.NrSubints*fin.NrBins*sizeof(float));
+  t0 = internal_bench_clock();
+  for(it = 0; it < iterations; it++) {
+    if(calc2DFS(fin.data, fin.NrSubints, fin.NrBins, fft_size, twodfs, &onpulse, 0, application.verbose_state) == 0) {
+      internal_bench_freebuffers(lrfs, twodfs, map, phase_track, alignshifts, &onpulse, &fin, application.verbose_state);
+      return 0;
+    }
+  }
+  internal_bench_report("calc2DFS", iterations, internal_bench_clock()-t0, fin.NrSubints*fin.NrBins*sizeof(float));
+  t0 = internal_bench_clock();
+  for(it = 0; it < iterations; it++) {
+    if(foldP3(fin.data, fin.NrSubints, fin.NrBins, map, 20, params.p3, 1, 1, 0, -1, 0, 0, &onpulse, application.verbose_state) == 0) {
+      internal_bench_freebuffers(lrfs, twodfs, map, phase_track, alignshifts, &onpulse, &fin, application.verbose_state);
+      return 0;
+    }
+  }
+  internal_bench_report("foldP3", iterations, internal_bench_clock()-t0, fin.NrSubints*fin.NrBins*sizeof(float));
+  t0 = internal_bench_clock();
+  for(it = 0; it < iterations; it++) {
+    for(i = 0; i < fin.NrSubints; i++) {
+      boxcarFindpeak(&fin.data[i*fin.NrBins], fin.NrBins, &onpulse, &bin, &width, &snr, &E, 0, 0, 0, 0, fin.NrBins/4, 0, 0, application.verbose_state);
+    }
+  }
+  internal_bench_report("boxcarFindpeak", iterations, internal_bench_clock()-t0, fin.NrSubints*fin.NrBins*sizeof(float));
+  memset(map, 0, fin.NrBins*sizeof(float));
+  for(i = 0; i < fin.NrSubints; i++) {
+    for(bin = 0; bin < fin.NrBins; bin++)
+      map[bin] += fin.data[i*fin.NrBins+bin];
+  }
+  alignshifts = (double *)malloc(2*fin.NrSubints*sizeof(double));
+  if(alignshifts == NULL || initTemplateAlignment(&alignengine, map, fin.NrBins, application.verbose_state) == 0) {
+    printerror(application.verbose_state.debug, "ERROR pbench: Cannot initialise template alignment");
+    internal_bench_freebuffers(lrfs, twodfs, map, phase_track, alignshifts, &onpulse, &fin, application.verbose_state);
+    return 0;
+  }
+  t0 = internal_bench_clock();
+  for(it = 0; it < iterations; it++) {
+    if(templateAlignProfiles(&alignengine, fin.data, fin.NrSubints, alignshifts, alignshifts+fin.NrSubints, NULL, application.verbose_state) == 0) {
+      freeTemplateAlignment(&alignengine);
+      internal_bench_freebuffers(lrfs, twodfs, map, phase_track, alignshifts, &onpulse, &fin, application.verbose_state);
+      return 0;
+    }
+  }
+  internal_bench_report("templateAlignProfiles", iterations, internal_bench_clock()-t0, fin.NrSubints*fin.NrBins*sizeof(float));
+  freeTemplateAlignment(&alignengine);
+  internal_bench_freebuffers(lrfs, twodfs, map, phase_track, alignshifts, &onpulse, &fin, application.verbose_state);
+  if(runppolfit) {
+    if(access("bin/ppolFit", X_OK) == 0) {
+      params.paswing = 1;
+      sprintf(filename, "%s/pbench_paswing.dat", dirname);
+      if(writeSyntheticPSRData(filename, PPOL_format, params, argc, argv, application.verbose_state) == 0)
+ return 0;
+      sprintf(txt, "bin/ppolFit -g \"90 90\" -best -device1 /NULL -device2 /NULL %s > /dev/null", filename);
+      t0 = internal_bench_clock();
+      for(it = 0; it < iterations; it++) {
+ if(system(txt) != 0) {
+   printerror(application.verbose_state.debug, "ERROR pbench: Running '%s' failed", txt);
+   return 0;
+ }
+      }
+      internal_bench_report("ppolFit_grid_90x90", iterations, internal_bench_clock()-t0, 0);
+      remove(filename);
+    }else {
+      printwarning(application.verbose_state.debug, "WARNING pbench: bin/ppolFit is not built, the ppolFit grid search is not timed.");
+    }
+  }
+  for(i = 0; i < 3; i++) {
+    sprintf(filename, "%s/pbench_%s.dat", dirname, formatnames[i]);
+    remove(filename);
+  }
+  if(jsonname[0] != 0) {
+    fjson = fopen(jsonname, "w");
+    if(fjson == NULL) {
+      printerror(application.verbose_state.debug, "ERROR pbench: Cannot open %s", jsonname);
+      return 0;
+    }
+    fprintf(fjson, "{\n  \"nsub\": %ld,\n  \"nbin\": %ld,\n  \"nchan\": %ld,\n  \"iterations\": %ld,\n  \"results\": [\n", params4.NrSubints, params4.NrBins, params4.NrFreqChan, iterations);
+    for(i = 0; i < nrbenchresults; i++) {
+      fprintf(fjson, "    {\"name\": \"%s\", \"iterations\": %ld, \"seconds\": %.9f, \"seconds_per_iteration\": %.9f, \"mb_per_second\": %.3f}%s\n", benchresults[i].name, benchresults[i].iterations, benchresults[i].seconds, benchresults[i].seconds/(double)benchresults[i].iterations, benchresults[i].bytes > 0 ? benchresults[i].bytes*benchresults[i].iterations/(benchresults[i].seconds*1024.0*1024.0) : 0.0, i < nrbenchresults-1 ? "," : "");
+    }
+    fprintf(fjson, "  ]\n}\n");
+    fclose(fjson);
+    printf("Results written to %s\n", jsonname);
+  }
+  terminateApplication(&application);
+  return 0;
+}
@@ -16,32 +16,46 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <stdlib.h>
 #include <math.h>
 #include "psrsalsa.h"
-static int nrparams_internal_psrsalsa_d;
-static int *fixed_internal_psrsalsa_d;
-static double *xstart_internal_psrsalsa_d;
-static double *x_internal_psrsalsa_d;
-static double (*funk_remember_user_function_d)(double []);
-static int algorithm_internal_psrsalsa_d;
-double funk_internal_psrsalsa_d(double x[])
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+typedef struct {
+  int nrparams, algorithm;
+  int *fixed;
+  double *xstart, *x;
+  double (*funk)(double [], void *);
+  void *params;
+}internal_amoeba_d_context;
+typedef struct {
+  double (*funk)(double []);
+}internal_amoeba_d_nocontext;
+double funk_internal_psrsalsa_d(double x[], void *params)
 {
   int i, j;
-  if(algorithm_internal_psrsalsa_d == 1)
+  internal_amoeba_d_context *context;
+  context = (internal_amoeba_d_context *)params;
+  if(context->algorithm == 1)
     j = 1;
   else
     j = 0;
-  for(i = 0; i < nrparams_internal_psrsalsa_d; i++) {
-    if(fixed_internal_psrsalsa_d[i] == 0) {
-      x_internal_psrsalsa_d[i+1] = x[j++];
+  for(i = 0; i < context->nrparams; i++) {
+    if(context->fixed[i] == 0) {
+      context->x[i+1] = x[j++];
     }else {
-      x_internal_psrsalsa_d[i+1] = xstart_internal_psrsalsa_d[i];
+      context->x[i+1] = context->xstart[i];
     }
   }
-  return funk_remember_user_function_d(x_internal_psrsalsa_d+1);
+  return context->funk(context->x+1, context->params);
 }
-int doAmoeba_d(int algorithm, double *xstart, double *dx, int *fixed, double *xfit, double *yfit, int nrparams, double (*funk)(double []), double ftol, int *nfunk, int verbose, int finderrors, double sigma, double *dplus, double *dmin)
+double internal_amoeba_d_nocontext_funk(double x[], void *params)
+{
+  return ((internal_amoeba_d_nocontext *)params)->funk(x);
+}
+int internal_doAmoeba_d(int algorithm, double *xstart, double *dx, int *fixed, double *xfit, double *yfit, int nrparams, double (*funk)(double [], void *), void *params, double ftol, int *nfunk, int verbose, int finderrors, double sigma, double *dplus, double *dmin, int parallel)
 {
-  int i, j, nfitparameters, ret;
-  extern double amoeba_nmsimplex_d(double (*objfunc)(double[]), double start[], double dx[], int n, double EPSILON, int *nritterations, double *reachedEpsilon, int verbose);
+  int i, j, nfitparameters, ret, *rets;
+  internal_amoeba_d_context context;
+  extern double amoeba_nmsimplex_d(double (*objfunc)(double[], void *), void *params, double start[], double dx[], int n, double EPSILON, int *nritterations, double *reachedEpsilon, int verbose);
   if(algorithm < 0 || algorithm > 1) {
     fprintf(stderr, "ERROR doAmoeba_d: Unknown algorithm requested.\n");
     return 4;
@@ -55,17 +69,18 @@ int doAmoeba_d(int algorithm, double *xstart, double *dx, int *fixed, double *xf
     fprintf(stderr, "ERROR doAmoeba_d: Cannot fit for less than 2 parameters (now have %d).\n", nfitparameters);
     return 3;
   }
-  fixed_internal_psrsalsa_d = fixed;
-  xstart_internal_psrsalsa_d = xstart;
-  nrparams_internal_psrsalsa_d = nrparams;
-  funk_remember_user_function_d = funk;
-  algorithm_internal_psrsalsa_d = algorithm;
+  context.fixed = fixed;
+  context.xstart = xstart;
+  context.nrparams = nrparams;
+  context.funk = funk;
+  context.params = params;
+  context.algorithm = algorithm;
   if(algorithm == 0) {
     double reachedEpsilon, *xstart_nmsimplex_d, *dx_nmsimplex_d;
     xstart_nmsimplex_d = malloc(nfitparameters*sizeof(double));
     dx_nmsimplex_d = malloc(nfitparameters*sizeof(double));
-    x_internal_psrsalsa_d = malloc((nrparams+1)*sizeof(double));
-    if(xstart_nmsimplex_d == NULL || dx_nmsimplex_d == NULL || x_internal_psrsalsa_d == NULL) {
+    context.x = malloc((nrparams+1)*sizeof(double));
+    if(xstart_nmsimplex_d == NULL || dx_nmsimplex_d == NULL || context.x == NULL) {
       fprintf(stderr, "ERROR doAmoeba_d: Memory allocation error.\n");
       return 2;
     }
@@ -77,7 +92,7 @@ int doAmoeba_d(int algorithm, double *xstart, double *dx, int *fixed, double *xf
  j++;
       }
     }
-    *yfit = amoeba_nmsimplex_d(funk_internal_psrsalsa_d, xstart_nmsimplex_d, dx_nmsimplex_d, nfitparameters, ftol, nfunk, &reachedEpsilon, 0);
+    *yfit = amoeba_nmsimplex_d(funk_internal_psrsalsa_d, &context, xstart_nmsimplex_d, dx_nmsimplex_d, nfitparameters, ftol, nfunk, &reachedEpsilon, 0);
     j = 0;
     for(i = 0; i < nrparams; i++) {
       if(fixed[i] == 0) {
@@ -89,7 +104,7 @@ int doAmoeba_d(int algorithm, double *xstart, double *dx, int *fixed, double *xf
     }
     free(xstart_nmsimplex_d);
     free(dx_nmsimplex_d);
-    free(x_internal_psrsalsa_d);
+    free(context.x);
     if(reachedEpsilon > ftol)
       return 1;
   }
@@ -103,18 +118,45 @@ int doAmoeba_d(int algorithm, double *xstart, double *dx, int *fixed, double *xf
     if(nfitparameters < 3) {
       fprintf(stderr, "ERROR doAmoeba_d: Cannot estimate errors if the number of fit parameters is less than 3.\n");
     }else {
+      rets = malloc(nrparams*sizeof(int));
+      if(rets == NULL) {
+ fprintf(stderr, "ERROR doAmoeba_d: Memory allocation error.\n");
+ return 2;
+      }
+#pragma omp parallel for schedule(dynamic) if(parallel)
       for(i = 0; i < nrparams; i++) {
- ret = find_errors_amoeba_d(algorithm, dx, fixed, xfit, *yfit, nrparams, funk, ftol, i, &dplus[i], &dmin[i], sigma);
+ rets[i] = find_errors_amoeba_d_ctx(algorithm, dx, fixed, xfit, *yfit, nrparams, funk, params, ftol, i, &dplus[i], &dmin[i], sigma);
+      }
+      for(i = 0; i < nrparams; i++) {
+ ret = rets[i];
  if(ret != 0) {
    fprintf(stderr, "ERROR doAmoeba_d: find_errors_amoeba_d failed with error code %d\n", ret);
+   free(rets);
    return ret;
  }
       }
+      free(rets);
     }
   }
   return 0;
 }
+int doAmoeba_d(int algorithm, double *xstart, double *dx, int *fixed, double *xfit, double *yfit, int nrparams, double (*funk)(double []), double ftol, int *nfunk, int verbose, int finderrors, double sigma, double *dplus, double *dmin)
+{
+  internal_amoeba_d_nocontext nocontext;
+  nocontext.funk = funk;
+  return internal_doAmoeba_d(algorithm, xstart, dx, fixed, xfit, yfit, nrparams, internal_amoeba_d_nocontext_funk, &nocontext, ftol, nfunk, verbose, finderrors, sigma, dplus, dmin, 0);
+}
+int doAmoeba_d_ctx(int algorithm, double *xstart, double *dx, int *fixed, double *xfit, double *yfit, int nrparams, double (*funk)(double [], void *), void *params, double ftol, int *nfunk, int verbose, int finderrors, double sigma, double *dplus, double *dmin)
+{
+  return internal_doAmoeba_d(algorithm, xstart, dx, fixed, xfit, yfit, nrparams, funk, params, ftol, nfunk, verbose, finderrors, sigma, dplus, dmin, 1);
+}
 int find_errors_amoeba_d(int algorithm, double *dx, int *fixed, double *xfit, double yfit, int nrparams, double (*funk)(double []), double ftol, int paramnr, double *dplus, double *dmin, double sigma)
+{
+  internal_amoeba_d_nocontext nocontext;
+  nocontext.funk = funk;
+  return find_errors_amoeba_d_ctx(algorithm, dx, fixed, xfit, yfit, nrparams, internal_amoeba_d_nocontext_funk, &nocontext, ftol, paramnr, dplus, dmin, sigma);
+}
+int find_errors_amoeba_d_ctx(int algorithm, double *dx, int *fixed, double *xfit, double yfit, int nrparams, double (*funk)(double [], void *), void *params, double ftol, int paramnr, double *dplus, double *dmin, double sigma)
 {
   double *xstartnew, *xfitnew, *dxnew, yfitnew, x0, x1, yold, step, fsign;
   int *fixednew, j, nfunknew, ret, sign;
@@ -153,7 +195,7 @@ int find_errors_amoeba_d(int algorithm, double *dx, int *fixed, double *xfit, do
  xstartnew[paramnr] = x1;
  dxnew[paramnr] = step;
  do {
-   ret = doAmoeba_d(algorithm, xstartnew, dxnew, fixednew, xfitnew, &yfitnew, nrparams, funk, ftol, &nfunknew, 0, 0, sigma, NULL, NULL);
+   ret = internal_doAmoeba_d(algorithm, xstartnew, dxnew, fixednew, xfitnew, &yfitnew, nrparams, funk, params, ftol, &nfunknew, 0, 0, sigma, NULL, NULL, 0);
    if(ret == 3) {
      free(fixednew);
      free(xstartnew);
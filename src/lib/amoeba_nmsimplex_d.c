@@ -44,6 +44,7 @@
  * Removed the constrain option
  * Added the reachedEpsilon parameter
  * Changed convergence condition
+ * Added a user data pointer which is passed on to objfunc
  */
 
 /* This is an exact copy of amoeba_nmsimplex.c (float version) to make
@@ -65,7 +66,7 @@
 #define BETA        0.5       /* contraction coefficient */
 #define GAMMA       2.0       /* expansion coefficient */
 
-double amoeba_nmsimplex_d(double (*objfunc)(double[]), double start[], double dx[], int n, double EPSILON, int *nfunc, double *reachedEpsilon, int verbose)
+double amoeba_nmsimplex_d(double (*objfunc)(double[], void *), void *params, double start[], double dx[], int n, double EPSILON, int *nfunc, double *reachedEpsilon, int verbose)
 {
   //  void (*constrain)(double[],int n);
 
@@ -136,7 +137,7 @@ double amoeba_nmsimplex_d(double (*objfunc)(double[]), double start[], double dx
   
   /* find the initial function values */
   for (j=0;j<=n;j++) {
-    f[j] = objfunc(v[j]);
+    f[j] = objfunc(v[j], params);
   }
   
   k = n+1;
@@ -200,7 +201,7 @@ double amoeba_nmsimplex_d(double (*objfunc)(double[]), double start[], double dx
     //		if (constrain != NULL) {
     //      constrain(vr,n);
     //    }
-    fr = objfunc(vr);
+    fr = objfunc(vr, params);
     k++;
     
     if (fr < f[vh] && fr >= f[vs]) {
@@ -219,7 +220,7 @@ double amoeba_nmsimplex_d(double (*objfunc)(double[]), double start[], double dx
       //			if (constrain != NULL) {
       //        constrain(ve,n);
       //      }
-      fe = objfunc(ve);
+      fe = objfunc(ve, params);
       k++;
       
       /* by making fe < fr as opposed to fe < f[vs], 			   
@@ -251,7 +252,7 @@ double amoeba_nmsimplex_d(double (*objfunc)(double[]), double start[], double dx
 	//				if (constrain != NULL) {
 	//          constrain(vc,n);
 	//        }
-	fc = objfunc(vc);
+	fc = objfunc(vc, params);
 	k++;
       }
       else {
@@ -263,7 +264,7 @@ double amoeba_nmsimplex_d(double (*objfunc)(double[]), double start[], double dx
 	//				if (constrain != NULL) {
 	//          constrain(vc,n);
 	//        }
-	fc = objfunc(vc);
+	fc = objfunc(vc, params);
 	k++;
       }
       
@@ -290,12 +291,12 @@ double amoeba_nmsimplex_d(double (*objfunc)(double[]), double start[], double dx
 	//				if (constrain != NULL) {
 	//          constrain(v[vg],n);
 	//        }
-	f[vg] = objfunc(v[vg]);
+	f[vg] = objfunc(v[vg], params);
 	k++;
 	//				if (constrain != NULL) {
 	//          constrain(v[vh],n);
 	//        }
-	f[vh] = objfunc(v[vh]);
+	f[vh] = objfunc(v[vh], params);
 	k++;
 	
 	
@@ -361,7 +362,7 @@ double amoeba_nmsimplex_d(double (*objfunc)(double[]), double start[], double dx
   for (j=0;j<n;j++) {
     start[j] = v[vs][j];
   }
-  min=objfunc(v[vs]);
+  min=objfunc(v[vs], params);
   k++;
   if(verbose) {
     printf("%d Function Evaluations\n",k);
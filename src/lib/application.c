@@ -17,6 +17,14 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "psrsalsa.h"
 int internal_application_cmdline_FilenameList[MaxNrApplicationFilenames];
 int internal_application_cmdline_Nrfilenames;
@@ -26,6 +34,13 @@ long internal_application_filelist_Nrfilenames;
 int internal_application_filelist_fileopen;
 FILE *internal_application_filelist_fptr;
 char *internal_application_filelist_filename;
+int internal_application_job_child;
+long internal_application_job_nrstarted, internal_application_job_nrrunning, internal_application_job_nextprint, internal_application_job_nrfailed, internal_application_job_allocated;
+pid_t *internal_application_job_pid;
+FILE **internal_application_job_log, **internal_application_job_errlog;
+int *internal_application_job_status;
+char **internal_application_job_filename;
+extern int internal_myio_errorprinted;
 void initApplication(psrsalsaApplication *application, char *name, char *genusage)
 {
   verbose_definition verbose;
@@ -35,6 +50,12 @@ void initApplication(psrsalsaApplication *application, char *name, char *genusag
   internal_application_filelist_CurFilename = 0;
   internal_application_filelist_Nrfilenames = 0;
   internal_application_filelist_fileopen = 0;
+  internal_application_job_child = 0;
+  internal_application_job_nrstarted = 0;
+  internal_application_job_nrrunning = 0;
+  internal_application_job_nextprint = 0;
+  internal_application_job_nrfailed = 0;
+  internal_application_job_allocated = 0;
   strcpy(application->progname, name);
   application->genusage = malloc(strlen(genusage)+1);
   if(application->genusage == NULL) {
@@ -80,6 +101,8 @@ void initApplication(psrsalsaApplication *application, char *name, char *genusag
   application->shiftPhase = 0;
   application->switch_filelist = 0;
   application->filelist = 0;
+  application->switch_concat = 0;
+  application->doconcat = 0;
   application->switch_device = 0;
   strcpy(application->pgplotdevice, "?");
   application->switch_tscr = 0;
@@ -159,6 +182,20 @@ void initApplication(psrsalsaApplication *application, char *name, char *genusag
   application->switch_rotateStokes = 0;
   application->nr_rotateStokes = 0;
   application->switch_libversions = 0;
+  application->switch_timing = 1;
+  application->dotiming = 0;
+  application->timingjson[0] = 0;
+  application->switch_statsindex = 0;
+  application->dostatsindex = 0;
+  application->switch_jobs = 0;
+  application->nrjobs = 1;
+  application->jobmemlimit = 0;
+  application->switch_cache = 0;
+  application->cachedir[0] = 0;
+  application->cachesize = defaultPreprocessCacheSizeMB*1048576LL;
+  application->switch_memlimit = 0;
+  application->memlimit = -1;
+  application->switch_numa = 1;
   application->fzapMask = NULL;
   application->doautot = 0;
 }
@@ -167,6 +204,13 @@ void terminateApplication(psrsalsaApplication *application)
   free(application->genusage);
   freePulselongitudeRegion(&(application->onpulse));
   closePSRData(&(application->template_file), 0, application->verbose_state);
+  if(application->dotiming) {
+    printTiming(stdout, &(application->timing));
+    if(application->timingjson[0] != 0) {
+      if(writeTimingJSON(application->timingjson, application->progname, &(application->timing), application->verbose_state))
+ printf("Timing information written to %s\n", application->timingjson);
+    }
+  }
  }
 void printCitationInfo()
 {
@@ -415,13 +459,17 @@ int parse_command_string(verbose_definition verbose, int argc, char **argv, int
 void printApplicationHelp(psrsalsaApplication *application)
 {
   fprintf(stdout, "%s %s\n", application->progname, application->genusage);
-  if(application->switch_iformat || application->switch_oformat || application->switch_formatlist || application->switch_headerlist || application->switch_header || application->switch_filelist || application->switch_noweights || application->switch_useweights || application->switch_uniformweights || application->switch_history_cmd_only || application->switch_ext || application->switch_output
+  if(application->switch_iformat || application->switch_oformat || application->switch_formatlist || application->switch_headerlist || application->switch_header || application->switch_filelist || application->switch_concat || application->switch_noweights || application->switch_useweights || application->switch_uniformweights || application->switch_history_cmd_only || application->switch_ext || application->switch_output
 ) {
     fprintf(stdout, "\nGeneral Input/Output options:\n");
     if(application->switch_filelist) {
       fprintf(stdout, "  -filelist file    Specify file with input file names: only one file name\n");
       fprintf(stdout, "                    per line, and they can be commented out with a #.\n");
     }
+    if(application->switch_concat) {
+      fprintf(stdout, "  -concat           Treat the input files as consecutive parts of a single\n");
+      fprintf(stdout, "                    observation, without combining them on disk first.\n");
+    }
     if(application->switch_ext)
       fprintf(stdout, "  -ext ext          Specify output extension ext\n");
     if(application->switch_output) {
@@ -595,7 +643,7 @@ void printApplicationHelp(psrsalsaApplication *application)
       fprintf(stdout, "  -onpulsegr    Graphically select (additional) onpulse regions\n");
   }
   if(application->switch_verbose || application->switch_debug || application->switch_nocounters || application->switch_macro || application->switch_fixseed || application->switch_libversions
-     ) {
+     || application->switch_timing || application->switch_statsindex || application->switch_jobs || application->switch_cache || application->switch_memlimit || application->switch_numa) {
     fprintf(stdout, "\nOther general options:\n");
     if(application->switch_verbose)
       fprintf(stdout, "  -v            Verbose mode (to get a better idea what is happening)\n");
@@ -610,6 +658,35 @@ void printApplicationHelp(psrsalsaApplication *application)
     if(application->switch_libversions) {
       fprintf(stdout, "  -libversions  Show version information about libraries used by psrsalsa\n");
     }
+    if(application->switch_timing) {
+      fprintf(stdout, "  -timing       Show a breakdown of the time spent in the different stages\n");
+      fprintf(stdout, "                and I/O, FFT and allocation counters when finished\n");
+      fprintf(stdout, "  -timingjson   Like -timing, but also write the breakdown to this JSON file\n");
+    }
+    if(application->switch_statsindex) {
+      fprintf(stdout, "  -statsindex   Store per-profile statistics next to the input file (extension\n");
+      fprintf(stdout, "                .stats) and reuse them next time if they match the data\n");
+    }
+    if(application->switch_jobs) {
+      fprintf(stdout, "  -jobs         Process this number of input files simultaneously. The output\n");
+      fprintf(stdout, "                of each file is shown in the order the files are specified.\n");
+      fprintf(stdout, "  -jobmem       Limit the memory each of the -jobs workers can use (in MB)\n");
+    }
+    if(application->switch_numa) {
+      fprintf(stdout, "  -numa         Initialise large data buffers using all threads, so the memory\n");
+      fprintf(stdout, "                is spread over the NUMA nodes of the threads that use it\n");
+    }
+    if(application->switch_memlimit) {
+      fprintf(stdout, "  -memlimit     Keep the estimated memory use below this amount of MB, by\n");
+      fprintf(stdout, "                streaming the data when it does not fit. Use 0 to take the\n");
+      fprintf(stdout, "                cgroup limit or the physical memory (shared between -jobs).\n");
+    }
+    if(application->switch_cache) {
+      fprintf(stdout, "  -cache        Keep the preprocessed data in this directory and reuse it when\n");
+      fprintf(stdout, "                the same file is preprocessed in the same way again.\n");
+      fprintf(stdout, "  -cachesize    Maximum size of the -cache directory in MB, removing the least\n");
+      fprintf(stdout, "                recently used results first (default is %d).\n", defaultPreprocessCacheSizeMB);
+    }
     if(application->switch_macro) {
       fprintf(stdout, "  -macro        Instead of taking commands from keyboard, read them from\n");
       fprintf(stdout, "                this macro file (put a ^ in front of symbol for the ctrl key)\n");
@@ -668,6 +745,9 @@ int processCommandLine(psrsalsaApplication *application, int argc, char **argv,
     (*index) += 1;
     application->filelist = *index;
     return 1;
+  }else if(strcmp(argv[*index], "-concat") == 0 && application->switch_concat) {
+    application->doconcat = 1;
+    return 1;
   }else if(strcmp(argv[*index], "-nread") == 0 && application->switch_nread) {
     if(parse_command_string(application->verbose_state, argc, argv, ++(*index), 0, -1, "%ld", &(application->nread), NULL) == 0) {
       fflush(stdout);
@@ -895,6 +975,66 @@ int processCommandLine(psrsalsaApplication *application, int argc, char **argv,
   }else if(strcmp(argv[*index], "-shuffle") == 0 && application->switch_shuffle) {
     application->doshuffle = 1;
     return 1;
+  }else if((strcmp(argv[*index], "-timing") == 0 || strcmp(argv[*index], "-timingjson") == 0) && application->switch_timing) {
+    if(strcmp(argv[*index], "-timingjson") == 0)
+      strcpy(application->timingjson, argv[++(*index)]);
+    application->dotiming = 1;
+    initTiming(&(application->timing));
+    application->verbose_state.timing = &(application->timing);
+    return 1;
+  }else if(strcmp(argv[*index], "-statsindex") == 0 && application->switch_statsindex) {
+    application->dostatsindex = 1;
+    return 1;
+  }else if(strcmp(argv[*index], "-jobs") == 0 && application->switch_jobs) {
+    if(parse_command_string(application->verbose_state, argc, argv, ++(*index), 0, -1, "%d", &(application->nrjobs), NULL) == 0) {
+      fflush(stdout);
+      printerror(application->verbose_state.debug, "Cannot parse '%s' option.", argv[(*index)-1]);
+      exit(0);
+    }
+    if(application->nrjobs < 1) {
+      fflush(stdout);
+      printerror(application->verbose_state.debug, "The '%s' option requires a positive number.", argv[(*index)-1]);
+      exit(0);
+    }
+    return 1;
+  }else if(strcmp(argv[*index], "-jobmem") == 0 && application->switch_jobs) {
+    double megabytes;
+    if(parse_command_string(application->verbose_state, argc, argv, ++(*index), 0, -1, "%lf", &megabytes, NULL) == 0) {
+      fflush(stdout);
+      printerror(application->verbose_state.debug, "Cannot parse '%s' option.", argv[(*index)-1]);
+      exit(0);
+    }
+    application->jobmemlimit = megabytes*1048576.0;
+    return 1;
+  }else if(strcmp(argv[*index], "-numa") == 0 && application->switch_numa) {
+    setFirstTouchDataPSRData(1);
+    return 1;
+  }else if(strcmp(argv[*index], "-memlimit") == 0 && application->switch_memlimit) {
+    double megabytes;
+    if(parse_command_string(application->verbose_state, argc, argv, ++(*index), 0, -1, "%lf", &megabytes, NULL) == 0) {
+      fflush(stdout);
+      printerror(application->verbose_state.debug, "Cannot parse '%s' option.", argv[(*index)-1]);
+      exit(0);
+    }
+    if(megabytes < 0) {
+      fflush(stdout);
+      printerror(application->verbose_state.debug, "The '%s' option requires a positive number.", argv[(*index)-1]);
+      exit(0);
+    }
+    application->memlimit = megabytes*1048576.0;
+    return 1;
+  }else if(strcmp(argv[*index], "-cache") == 0 && application->switch_cache) {
+    strcpy(application->cachedir, argv[++(*index)]);
+    return 1;
+  }else if(strcmp(argv[*index], "-cachesize") == 0 && application->switch_cache) {
+    double megabytes;
+    if(parse_command_string(application->verbose_state, argc, argv, ++(*index), 0, -1, "%lf", &megabytes, NULL) == 0) {
+      fflush(stdout);
+      printerror(application->verbose_state.debug, "Cannot parse '%s' option.", argv[(*index)-1]);
+      exit(0);
+    }
+    application->cachesize = megabytes*1048576.0;
+    return 1;
   }else if(strcmp(argv[*index], "-fixseed") == 0 && application->switch_fixseed) {
     application->fixseed = 1;
     return 1;
@@ -992,14 +1132,225 @@ int getOutputName(psrsalsaApplication *application, char *filename, char *output
   }
   return 1;
 }
-int preprocessApplication(psrsalsaApplication *application, datafile_definition *psrdata)
+int preprocessRequestedApplication(psrsalsaApplication *application)
+{
+  if(application->nskip != 0 || application->nread > 0 || application->dostokes || application->docoherence || application->nr_rotateStokes > 0 || application->do_parang_corr > 0 || application->blocksize > 0 || application->fchan_select != -1 || application->polselectnr >= 0 || application->newRefFreq > -2 || application->doFSCR || application->do_dedisperse || application->dofscr || application->do_deFaraday || application->doTSCR || application->dotscr || application->doalign || application->doshiftphase || application->dorebin || application->doonpulsegr || application->dodebase || application->do_norm || application->do_normglobal || application->do_clip || application->doscale || application->doshuffle)
+    return 1;
+  return 0;
+}
+long long internal_application_memoryplan_bytes(long nrsubints, long nrbins, long nrpols, long nrfreqchan)
+{
+  return (long long)nrsubints*nrbins*nrpols*nrfreqchan*sizeof(float);
+}
+void internal_application_memoryplan_clone(long long *current, long long *peak, long long newsize, long long extra)
+{
+  if(*current+newsize+extra > *peak)
+    *peak = *current+newsize+extra;
+  *current = newsize;
+}
+long long memoryEstimateApplication(psrsalsaApplication *application, datafile_definition *datafile, double analysiscopies, verbose_definition verbose)
+{
+  long nsub, nbin, npol, nchan, n;
+  int depar, i;
+  long long current, peak;
+  nsub = datafile->NrSubints;
+  nbin = datafile->NrBins;
+  npol = datafile->NrPols;
+  nchan = datafile->NrFreqChan;
+  depar = (npol == 4 && datafile->isDePar == 0);
+  current = peak = internal_application_memoryplan_bytes(nsub, nbin, npol, nchan);
+  if(application->nskip != 0 || application->nread > 0) {
+    if(application->nread > 0)
+      nsub = application->nread;
+    else
+      nsub -= application->nskip;
+    internal_application_memoryplan_clone(&current, &peak, internal_application_memoryplan_bytes(nsub, nbin, npol, nchan), 0);
+  }
+  if(application->do_parang_corr > 0)
+    depar = 0;
+  if(application->blocksize > 0) {
+    nsub = (nsub/application->blocksize)*application->blocksize;
+    internal_application_memoryplan_clone(&current, &peak, internal_application_memoryplan_bytes(nsub, nbin, npol, nchan), 0);
+  }
+  if(application->fchan_select != -1) {
+    nchan = 1;
+    internal_application_memoryplan_clone(&current, &peak, internal_application_memoryplan_bytes(nsub, nbin, npol, nchan), 0);
+  }
+  if(application->polselectnr >= 0) {
+    npol = 1;
+    depar = 0;
+    internal_application_memoryplan_clone(&current, &peak, internal_application_memoryplan_bytes(nsub, nbin, npol, nchan), 0);
+  }
+  if(application->doFSCR || application->dofscr) {
+    n = application->dofscr;
+    if(application->doFSCR)
+      n = nchan;
+    if(n > 0)
+      nchan /= n;
+    else
+      nchan *= -n;
+    internal_application_memoryplan_clone(&current, &peak, internal_application_memoryplan_bytes(nsub, nbin, npol, nchan), 0);
+  }
+  if(application->doTSCR || application->dotscr) {
+    n = application->dotscr;
+    if(application->doTSCR)
+      n = nsub;
+    if(n > 0) {
+      if(application->tscr_complete == 0 && nsub % n != 0)
+ nsub = nsub/n + 1;
+      else
+ nsub /= n;
+    }else {
+      nsub *= -n;
+    }
+    internal_application_memoryplan_clone(&current, &peak, internal_application_memoryplan_bytes(nsub, nbin, npol, nchan), depar ? current : 0);
+    depar = 0;
+  }
+  if(application->doalign || application->doonpulsegr) {
+    if(current+depar*current+internal_application_memoryplan_bytes(1, nbin, npol, nchan) > peak)
+      peak = current+depar*current+internal_application_memoryplan_bytes(1, nbin, npol, nchan);
+  }
+  if(application->doshiftphase && application->doconshift)
+    internal_application_memoryplan_clone(&current, &peak, current, 0);
+  if(application->dorebin) {
+    nbin = application->rebin;
+    internal_application_memoryplan_clone(&current, &peak, internal_application_memoryplan_bytes(nsub, nbin, npol, nchan), 0);
+  }
+  if(application->doshuffle)
+    internal_application_memoryplan_clone(&current, &peak, current, 0);
+  if(current+analysiscopies*current > peak)
+    peak = current+analysiscopies*current;
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("Estimated memory use: %.1f MB to load the data, %.1f MB after preprocessing and a peak of %.1f MB\n", internal_application_memoryplan_bytes(datafile->NrSubints, datafile->NrBins, datafile->NrPols, datafile->NrFreqChan)/1048576.0, current/1048576.0, peak/1048576.0);
+  }
+  return peak;
+}
+long long internal_application_cgrouplimit(char *mountpoint, char *cgroup, char *limitfile, long long limit)
+{
+  char path[MaxFilenameLength], filename[MaxFilenameLength], txt[100], *slash;
+  long long value;
+  long len;
+  FILE *fin;
+  strncpy(path, cgroup, MaxFilenameLength-1);
+  path[MaxFilenameLength-1] = 0;
+  len = strlen(path);
+  while(len > 0 && path[len-1] == '/')
+    path[--len] = 0;
+  while(1) {
+    snprintf(filename, MaxFilenameLength, "%s%s/%s", mountpoint, path, limitfile);
+    fin = fopen(filename, "r");
+    if(fin != NULL) {
+      if(fscanf(fin, "%99s", txt) == 1 && sscanf(txt, "%lld", &value) == 1) {
+ if(value > 0 && value < limit)
+   limit = value;
+      }
+      fclose(fin);
+    }
+    if(path[0] == 0)
+      break;
+    slash = strrchr(path, '/');
+    if(slash == NULL)
+      slash = path;
+    *slash = 0;
+  }
+  return limit;
+}
+long long internal_application_memorylimit(psrsalsaApplication *application)
+{
+  long long limit;
+  int found;
+  FILE *fin;
+  char line[MaxStringLength], *controllers, *cgroup, *controller, *saveptr;
+  limit = application->memlimit;
+  if(limit == 0) {
+    limit = (long long)sysconf(_SC_PHYS_PAGES)*sysconf(_SC_PAGESIZE);
+    found = 0;
+    fin = fopen("/proc/self/cgroup", "r");
+    if(fin != NULL) {
+      while(fgets(line, MaxStringLength, fin) != NULL) {
+ line[strcspn(line, "\n")] = 0;
+ controllers = strchr(line, ':');
+ if(controllers == NULL)
+   continue;
+ *(controllers++) = 0;
+ cgroup = strchr(controllers, ':');
+ if(cgroup == NULL)
+   continue;
+ *(cgroup++) = 0;
+ if(strcmp(line, "0") == 0 && controllers[0] == 0) {
+   limit = internal_application_cgrouplimit("/sys/fs/cgroup", cgroup, "memory.max", limit);
+   limit = internal_application_cgrouplimit("/sys/fs/cgroup/unified", cgroup, "memory.max", limit);
+   found = 1;
+ }else {
+   for(controller = strtok_r(controllers, ",", &saveptr); controller != NULL; controller = strtok_r(NULL, ",", &saveptr)) {
+     if(strcmp(controller, "memory") == 0) {
+       limit = internal_application_cgrouplimit("/sys/fs/cgroup/memory", cgroup, "memory.limit_in_bytes", limit);
+       found = 1;
+     }
+   }
+ }
+      }
+      fclose(fin);
+    }
+    if(found == 0) {
+      limit = internal_application_cgrouplimit("/sys/fs/cgroup", "", "memory.max", limit);
+      limit = internal_application_cgrouplimit("/sys/fs/cgroup/memory", "", "memory.limit_in_bytes", limit);
+    }
+    if(application->nrjobs > 1)
+      limit /= application->nrjobs;
+  }
+  if(application->jobmemlimit > 0 && application->jobmemlimit < limit)
+    limit = application->jobmemlimit;
+  return limit;
+}
+int memoryPlanApplication(psrsalsaApplication *application, datafile_definition *datafile, double analysiscopies, int canstream, verbose_definition verbose)
+{
+  long long limit, needed;
+  int i;
+  if(application->memlimit < 0)
+    return MEMORYPLAN_INMEMORY;
+  limit = internal_application_memorylimit(application);
+  needed = memoryEstimateApplication(application, datafile, analysiscopies, verbose)+memoryPlanOverheadMB*1048576LL;
+  if(needed <= limit) {
+    if(verbose.verbose) {
+      for(i = 0; i < verbose.indent; i++)
+ printf(" ");
+      printf("Reading data into memory (limit is %.1f MB)\n", limit/1048576.0);
+    }
+    return MEMORYPLAN_INMEMORY;
+  }
+  if(canstream && preprocessRequestedApplication(application) == 0) {
+    if(internal_application_memoryplan_bytes(1, datafile->NrBins, datafile->NrPols, datafile->NrFreqChan)+memoryPlanOverheadMB*1048576LL <= limit) {
+      if(verbose.verbose) {
+ for(i = 0; i < verbose.indent; i++)
+   printf(" ");
+ printf("Streaming data, since it needs more memory than the limit of %.1f MB\n", limit/1048576.0);
+      }
+      return MEMORYPLAN_STREAM;
+    }
+  }
+  fflush(stdout);
+  printerror(verbose.debug, "ERROR memoryPlanApplication: Processing %s needs an estimated %.1f MB of memory, which exceeds the limit of %.1f MB.", datafile->filename, needed/1048576.0, limit/1048576.0);
+  if(canstream) {
+    printerror(verbose.debug, "  Streaming the data is only possible without preprocessing options.");
+  }else {
+    printerror(verbose.debug, "  Consider reducing the data with for instance -nread or -fscr in pmod first.");
+  }
+  return 0;
+}
+int internal_application_preprocess(psrsalsaApplication *application, datafile_definition *psrdata, preprocesscache_definition *cache)
 {
   datafile_definition clone;
   int device, original_gentype, original_poltype, original_isDeDisp, original_isDeFarad, original_isDePar, original_isDebase;
   double original_freq_ref;
+  int packedbits;
   float x;
+  double t0;
   verbose_definition verbose1, verbose2;
   long i;
+  int usecache;
   original_gentype = psrdata->gentype;
   original_poltype = psrdata->poltype;
   original_isDeDisp = psrdata->isDeDisp;
@@ -1014,7 +1365,32 @@ int preprocessApplication(psrsalsaApplication *application, datafile_definition
   copyVerboseState(application->verbose_state, &verbose2);
   verbose1.indent = application->verbose_state.indent + 2;
   verbose2.indent = application->verbose_state.indent + 4;
+  usecache = 0;
+  if(application->cachedir[0] != 0) {
+    usecache = 1;
+    t0 = timingStart(application->verbose_state);
+    i = preprocessCacheLookup(application, psrdata, cache, verbose1);
+    timingStop(application->verbose_state, "preprocess_cache", t0);
+    if(i) {
+      if(verbose1.verbose) {
+ printf("Preprocessing done\n\n");
+      }
+      if(application->verbose_state.debug) {
+ printHeaderPSRData(*psrdata, 1, application->verbose_state);
+      }
+      return 1;
+    }
+  }
+  packedbits = 0;
+  if(psrdata->packedbits) {
+    if(application->nskip != 0 || application->nread > 0 || application->dostokes || application->docoherence || application->nr_rotateStokes > 0 || application->do_parang_corr > 0 || application->blocksize > 0 || application->fchan_select != -1 || application->polselectnr >= 0 || application->newRefFreq > -2 || application->doFSCR || application->do_dedisperse || application->dofscr || application->do_deFaraday || application->doTSCR || application->dotscr || application->doalign || application->doshiftphase || application->dorebin || application->doonpulsegr || application->do_norm || application->do_normglobal || application->do_clip || application->doshuffle) {
+      packedbits = psrdata->packedbits;
+      if(unpackPSRData(psrdata, verbose1) == 0)
+ return 0;
+    }
+  }
   if(application->nskip != 0 || application->nread > 0) {
+    t0 = timingStart(application->verbose_state);
     if(application->nread <= 0)
       application->nread = psrdata->NrSubints-application->nskip;
     if(preprocess_pulsesselect(*psrdata, &clone, application->nskip, application->nread, verbose1) == 0) {
@@ -1023,22 +1399,30 @@ int preprocessApplication(psrsalsaApplication *application, datafile_definition
       return 0;
     }
     swap_orig_clone(psrdata, &clone, application->verbose_state);
+    timingStop(application->verbose_state, "preprocess_pulsesselect", t0);
   }
   if(application->dostokes) {
+    t0 = timingStart(application->verbose_state);
     if(preprocess_stokes(psrdata, verbose1) == 0)
       return 0;
+    timingStop(application->verbose_state, "preprocess_stokes", t0);
   }
   if(application->docoherence) {
+    t0 = timingStart(application->verbose_state);
     if(preprocess_coherency(psrdata, verbose1) == 0)
       return 0;
+    timingStop(application->verbose_state, "preprocess_coherency", t0);
   }
   if(application->nr_rotateStokes > 0) {
+    t0 = timingStart(application->verbose_state);
     for(i = 0; i < application->nr_rotateStokes; i++) {
       if(preprocess_rotateStokes(psrdata, &clone, 1, -1, application->rotateStokesAngle[i], NULL, application->rotateStokes1[i], application->rotateStokes2[i], verbose1) == 0)
  return 0;
     }
+    timingStop(application->verbose_state, "preprocess_rotateStokes", t0);
   }
   if(application->do_parang_corr > 0) {
+    t0 = timingStart(application->verbose_state);
     if(application->do_parang_corr == 2) {
       if(preprocess_corrParAng(psrdata, NULL, 1, verbose1) == 0)
  return 0;
@@ -1046,27 +1430,36 @@ int preprocessApplication(psrsalsaApplication *application, datafile_definition
       if(preprocess_corrParAng(psrdata, NULL, 0, verbose1) == 0)
  return 0;
     }
+    timingStop(application->verbose_state, "preprocess_corrParAng", t0);
   }
   if(application->blocksize > 0) {
+    t0 = timingStart(application->verbose_state);
     if(preprocess_blocksize(*psrdata, &clone, application->blocksize, verbose1) == 0)
       return 0;
     swap_orig_clone(psrdata, &clone, application->verbose_state);
+    timingStop(application->verbose_state, "preprocess_blocksize", t0);
   }
   if(application->fchan_select != -1) {
+    t0 = timingStart(application->verbose_state);
     if(preprocess_channelselect(*psrdata, &clone, application->fchan_select, verbose1) == 0)
       return 0;
     swap_orig_clone(psrdata, &clone, application->verbose_state);
+    timingStop(application->verbose_state, "preprocess_channelselect", t0);
   }
   if(application->polselectnr >= 0) {
+    t0 = timingStart(application->verbose_state);
     if(preprocess_polselect(*psrdata, &clone, application->polselectnr, verbose1) == 0)
       return 0;
     swap_orig_clone(psrdata, &clone, application->verbose_state);
+    timingStop(application->verbose_state, "preprocess_polselect", t0);
   }
   if(application->newRefFreq > -2) {
+    t0 = timingStart(application->verbose_state);
     if(preprocess_changeRefFreq(psrdata, application->newRefFreq, verbose1) == 0) {
       printerror(application->verbose_state.debug, "preprocessApplication: Error changing reference frequency.");
       return 0;
     }
+    timingStop(application->verbose_state, "preprocess_changeRefFreq", t0);
   }
   if(application->doFSCR) {
     application->dofscr = psrdata->NrFreqChan;
@@ -1077,11 +1470,14 @@ int preprocessApplication(psrsalsaApplication *application, datafile_definition
     }
   }
   if(application->do_dedisperse || application->dofscr) {
+    t0 = timingStart(application->verbose_state);
     if(!preprocess_dedisperse(psrdata, 0, 0, verbose1))
       return 0;
+    timingStop(application->verbose_state, "preprocess_dedisperse", t0);
   }
   if(application->do_deFaraday || application->dofscr) {
     int skip;
+    t0 = timingStart(application->verbose_state);
     skip = 0;
     if(psrdata->NrPols != 4) {
       if(application->do_deFaraday == 0) {
@@ -1101,12 +1497,15 @@ int preprocessApplication(psrsalsaApplication *application, datafile_definition
  if(!preprocess_deFaraday(psrdata, 0, 0, 0, NULL, verbose1))
    return 0;
       }
+      timingStop(application->verbose_state, "preprocess_deFaraday", t0);
     }
   }
   if(application->dofscr) {
+    t0 = timingStart(application->verbose_state);
     if(!preprocess_addsuccessiveFreqChans(*psrdata, &clone, application->dofscr, application->fzapMask, verbose1))
       return 0;
     swap_orig_clone(psrdata, &clone, application->verbose_state);
+    timingStop(application->verbose_state, "preprocess_fscrunch", t0);
   }
   if(application->doTSCR) {
     application->dotscr = psrdata->NrSubints;
@@ -1117,11 +1516,14 @@ int preprocessApplication(psrsalsaApplication *application, datafile_definition
     }
   }
   if(application->dotscr) {
+    t0 = timingStart(application->verbose_state);
     if(!preprocess_addsuccessivepulses(*psrdata, &clone, application->dotscr, application->tscr_complete, verbose1))
       return 0;
     swap_orig_clone(psrdata, &clone, application->verbose_state);
+    timingStop(application->verbose_state, "preprocess_tscrunch", t0);
   }
   if(application->doalign) {
+    t0 = timingStart(application->verbose_state);
     if(verbose1.verbose) {
       for(i = 0; i < verbose1.indent; i++)
  printf(" ");
@@ -1143,20 +1545,30 @@ int preprocessApplication(psrsalsaApplication *application, datafile_definition
     datafile_definition clone2;
     if(!preprocess_addsuccessiveFreqChans(clone, &clone2, clone.NrFreqChan, NULL, verbose2))
       return 0;
+    templatealign_definition alignengine;
+    double alignshift, alignerror;
     if(application->template_specified) {
-      x = correlateVonMisesFunction(&(application->vonMises_components), clone2.NrBins, clone2.data, verbose2);
+      if(initTemplateAlignmentVonMises(&alignengine, &(application->vonMises_components), clone2.NrBins, verbose2) == 0)
+ return 0;
     }else {
       if(clone2.NrBins != application->template_file.NrBins) {
  fflush(stdout);
  printerror(application->verbose_state.debug, "preprocessApplication: The template and the data file have a different amount of bins (%ld != %ld).", clone2.NrBins, application->template_file.NrBins);
  return 0;
       }
-      int lag;
-      float correl_max;
-      if(find_peak_correlation(clone2.data, application->template_file.data, clone2.NrBins, 0, 0, 1, &lag, &correl_max, verbose2) == 0) {
+      if(initTemplateAlignment(&alignengine, application->template_file.data, clone2.NrBins, verbose2) == 0)
  return 0;
-      }
-      x = lag/(double)clone2.NrBins;
+    }
+    if(templateAlignProfiles(&alignengine, clone2.data, 1, &alignshift, &alignerror, NULL, verbose2) == 0) {
+      freeTemplateAlignment(&alignengine);
+      return 0;
+    }
+    freeTemplateAlignment(&alignengine);
+    x = alignshift;
+    if(verbose1.verbose) {
+      for(i = 0; i < verbose1.indent; i++)
+ printf(" ");
+      printf("  Found a shift of %f +- %f bins (%f phase) with respect to the template\n", alignshift*clone2.NrBins, alignerror*clone2.NrBins, alignshift);
     }
     closePSRData(&clone2, 0, verbose2);
     closePSRData(&clone, 0, verbose2);
@@ -1171,8 +1583,10 @@ int preprocessApplication(psrsalsaApplication *application, datafile_definition
  printf(" ");
       printf("  done       \n");
     }
+    timingStop(application->verbose_state, "preprocess_align", t0);
   }
   if(application->doshiftphase) {
+    t0 = timingStart(application->verbose_state);
     if(application->doconshift) {
       i = application->shiftPhase*psrdata->NrBins;
      if(i >= psrdata->NrBins)
@@ -1192,11 +1606,14 @@ int preprocessApplication(psrsalsaApplication *application, datafile_definition
       if(preprocess_fftshift(*psrdata, application->shiftPhase, 0, 0, verbose2) == 0)
  return 0;
     }
+    timingStop(application->verbose_state, "preprocess_rotate", t0);
   }
   if(application->dorebin) {
+    t0 = timingStart(application->verbose_state);
     if(!preprocess_rebin(*psrdata, &clone, application->rebin, verbose1))
       return 0;
     swap_orig_clone(psrdata, &clone, application->verbose_state);
+    timingStop(application->verbose_state, "preprocess_rebin", t0);
   }
   if(application->doonpulsegr) {
     if(verbose1.verbose) {
@@ -1232,29 +1649,41 @@ int preprocessApplication(psrsalsaApplication *application, datafile_definition
     free(pgplot_options);
   }
   if(application->dodebase) {
+      t0 = timingStart(application->verbose_state);
       if(!preprocess_debase(psrdata, application->onpulse, verbose1))
  return 0;
+      timingStop(application->verbose_state, "preprocess_debase", t0);
   }
   if(application->do_norm) {
+    t0 = timingStart(application->verbose_state);
     if(preprocess_norm(*psrdata, application->normvalue, &(application->onpulse), 0, verbose1) == 0)
       return 0;
+    timingStop(application->verbose_state, "preprocess_norm", t0);
   }
   if(application->do_normglobal) {
+    t0 = timingStart(application->verbose_state);
     if(preprocess_norm(*psrdata, application->normvalue, &(application->onpulse), 1, verbose1) == 0)
       return 0;
+    timingStop(application->verbose_state, "preprocess_normglobal", t0);
   }
   if(application->do_clip) {
+    t0 = timingStart(application->verbose_state);
     if(preprocess_clip(*psrdata, application->clipvalue, verbose1) == 0)
       return 0;
+    timingStop(application->verbose_state, "preprocess_clip", t0);
   }
   if(application->doscale) {
+    t0 = timingStart(application->verbose_state);
     if(preprocess_scale(*psrdata, application->scale_scale, application->scale_offset, verbose1) == 0)
       return 0;
+    timingStop(application->verbose_state, "preprocess_scale", t0);
   }
   if(application->doshuffle) {
+    t0 = timingStart(application->verbose_state);
     if(preprocess_shuffle(*psrdata, &clone, application->fixseed, verbose1) == 0)
       return 0;
     swap_orig_clone(psrdata, &clone, application->verbose_state);
+    timingStop(application->verbose_state, "preprocess_shuffle", t0);
   }
   if(original_gentype != psrdata->gentype && application->verbose_state.debug) {
     for(i = 0; i < verbose1.indent; i++)
@@ -1327,6 +1756,15 @@ int preprocessApplication(psrsalsaApplication *application, datafile_definition
     free(txt);
     free(txt2);
   }
+  if(usecache) {
+    t0 = timingStart(application->verbose_state);
+    preprocessCacheStore(application, psrdata, cache, verbose1);
+    timingStop(application->verbose_state, "preprocess_cache", t0);
+  }
+  if(packedbits) {
+    if(packPSRData(psrdata, packedbits, verbose1) == 0)
+      return 0;
+  }
   if(verbose1.verbose) {
     printf("Preprocessing done\n\n");
   }
@@ -1335,6 +1773,16 @@ int preprocessApplication(psrsalsaApplication *application, datafile_definition
   }
   return 1;
 }
+int preprocessApplication(psrsalsaApplication *application, datafile_definition *psrdata)
+{
+  int ret;
+  preprocesscache_definition cache;
+  cache.key = NULL;
+  cache.keysize = 0;
+  ret = internal_application_preprocess(application, psrdata, &cache);
+  freePreprocessCache(&cache);
+  return ret;
+}
 int applicationAddFilename(int argi, verbose_definition verbose)
 {
   if(internal_application_cmdline_Nrfilenames < MaxNrApplicationFilenames) {
@@ -1418,7 +1866,7 @@ void rewindFilenameList(psrsalsaApplication *application) {
   if(application->filelist)
     rewind(internal_application_filelist_fptr);
 }
-char *getNextFilenameFromList(psrsalsaApplication *application, char **argv, verbose_definition verbose)
+char *internal_getNextFilenameFromList(psrsalsaApplication *application, char **argv, verbose_definition verbose)
 {
   int i;
   if(application->doautot != 0 && internal_application_cmdline_CurFilename != 0) {
@@ -1455,6 +1903,219 @@ char *getNextFilenameFromList(psrsalsaApplication *application, char **argv, ver
   }
   return NULL;
 }
+int openApplicationConcatData(psrsalsaApplication *application, char **argv, datafile_definition *datafile, int read_in_memory, verbose_definition verbose)
+{
+  int i, nrfiles, ret;
+  char **filenames, *filename_ptr;
+  nrfiles = numberInApplicationFilenameList(application, argv, verbose);
+  if(nrfiles < 1) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR openApplicationConcatData: No files specified.");
+    return 0;
+  }
+  filenames = (char **)malloc(nrfiles*sizeof(char *));
+  if(filenames == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR openApplicationConcatData: Memory allocation error.");
+    return 0;
+  }
+  rewindFilenameList(application);
+  for(i = 0; i < nrfiles; i++) {
+    filename_ptr = getNextFilenameFromList(application, argv, verbose);
+    if(filename_ptr != NULL)
+      filenames[i] = (char *)malloc(strlen(filename_ptr)+1);
+    if(filename_ptr == NULL || filenames[i] == NULL) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR openApplicationConcatData: Cannot obtain file name %d.", i+1);
+      while(--i >= 0)
+ free(filenames[i]);
+      free(filenames);
+      return 0;
+    }
+    strcpy(filenames[i], filename_ptr);
+  }
+  if(application->iformat <= 0)
+    application->iformat = guessPSRData_format(filenames[0], 0, verbose);
+  ret = openConcatPSRData(datafile, filenames, nrfiles, application->iformat, read_in_memory, verbose);
+  for(i = 0; i < nrfiles; i++)
+    free(filenames[i]);
+  free(filenames);
+  return ret;
+}
+void internal_application_job_exit(void)
+{
+  if(internal_myio_errorprinted) {
+    fflush(NULL);
+    _exit(1);
+  }
+}
+void internal_application_job_report(verbose_definition verbose)
+{
+  int c;
+  long jobnr;
+  while(internal_application_job_nextprint < internal_application_job_nrstarted && internal_application_job_pid[internal_application_job_nextprint] == 0) {
+    jobnr = internal_application_job_nextprint;
+    fflush(stdout);
+    rewind(internal_application_job_log[jobnr]);
+    while((c = fgetc(internal_application_job_log[jobnr])) != EOF)
+      fputc(c, stdout);
+    fclose(internal_application_job_log[jobnr]);
+    fflush(stdout);
+    rewind(internal_application_job_errlog[jobnr]);
+    while((c = fgetc(internal_application_job_errlog[jobnr])) != EOF)
+      fputc(c, stderr);
+    fclose(internal_application_job_errlog[jobnr]);
+    fflush(stderr);
+    if(WIFSIGNALED(internal_application_job_status[jobnr])) {
+      printerror(verbose.debug, "ERROR: Processing of '%s' was terminated by signal %d.", internal_application_job_filename[jobnr], WTERMSIG(internal_application_job_status[jobnr]));
+      internal_application_job_nrfailed++;
+    }else if(WIFEXITED(internal_application_job_status[jobnr]) && WEXITSTATUS(internal_application_job_status[jobnr]) != 0) {
+      printerror(verbose.debug, "ERROR: Processing of '%s' failed with exit code %d.", internal_application_job_filename[jobnr], WEXITSTATUS(internal_application_job_status[jobnr]));
+      internal_application_job_nrfailed++;
+    }
+    free(internal_application_job_filename[jobnr]);
+    internal_application_job_nextprint++;
+  }
+}
+int internal_application_job_wait(verbose_definition verbose)
+{
+  int status;
+  long jobnr;
+  pid_t pid;
+  do {
+    pid = waitpid(-1, &status, 0);
+  }while(pid == -1 && errno == EINTR);
+  if(pid == -1) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR internal_application_job_wait: Waiting for worker failed.");
+    return 0;
+  }
+  for(jobnr = internal_application_job_nextprint; jobnr < internal_application_job_nrstarted; jobnr++) {
+    if(internal_application_job_pid[jobnr] == pid) {
+      internal_application_job_pid[jobnr] = 0;
+      internal_application_job_status[jobnr] = status;
+      internal_application_job_nrrunning--;
+      break;
+    }
+  }
+  internal_application_job_report(verbose);
+  return 1;
+}
+int internal_application_job_start(psrsalsaApplication *application, char *filename, verbose_definition verbose)
+{
+  long jobnr;
+  pid_t pid;
+  FILE *log, *errlog;
+  while(internal_application_job_nrrunning >= application->nrjobs || (internal_application_job_nrrunning > 0 && internal_application_job_nrstarted-internal_application_job_nextprint >= maxNrPendingJobLogs)) {
+    if(internal_application_job_wait(verbose) == 0)
+      return -1;
+  }
+  if(internal_application_job_nrstarted == internal_application_job_allocated) {
+    internal_application_job_allocated += 256;
+    internal_application_job_pid = (pid_t *)realloc(internal_application_job_pid, internal_application_job_allocated*sizeof(pid_t));
+    internal_application_job_log = (FILE **)realloc(internal_application_job_log, internal_application_job_allocated*sizeof(FILE *));
+    internal_application_job_errlog = (FILE **)realloc(internal_application_job_errlog, internal_application_job_allocated*sizeof(FILE *));
+    internal_application_job_status = (int *)realloc(internal_application_job_status, internal_application_job_allocated*sizeof(int));
+    internal_application_job_filename = (char **)realloc(internal_application_job_filename, internal_application_job_allocated*sizeof(char *));
+    if(internal_application_job_pid == NULL || internal_application_job_log == NULL || internal_application_job_errlog == NULL || internal_application_job_status == NULL || internal_application_job_filename == NULL) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR internal_application_job_start: Memory allocation error.");
+      return -1;
+    }
+  }
+  jobnr = internal_application_job_nrstarted;
+  log = tmpfile();
+  errlog = tmpfile();
+  internal_application_job_filename[jobnr] = (char *)malloc(strlen(filename)+1);
+  if(log == NULL || errlog == NULL || internal_application_job_filename[jobnr] == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR internal_application_job_start: Cannot create log for '%s'.", filename);
+    if(log != NULL)
+      fclose(log);
+    if(errlog != NULL)
+      fclose(errlog);
+    if(internal_application_job_filename[jobnr] != NULL)
+      free(internal_application_job_filename[jobnr]);
+    return -1;
+  }
+  strcpy(internal_application_job_filename[jobnr], filename);
+  fflush(stdout);
+  fflush(stderr);
+  pid = fork();
+  if(pid == -1) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR internal_application_job_start: Cannot start worker for '%s'.", filename);
+    fclose(log);
+    fclose(errlog);
+    free(internal_application_job_filename[jobnr]);
+    return -1;
+  }
+  if(pid == 0) {
+    internal_application_job_child = 1;
+    dup2(fileno(log), STDOUT_FILENO);
+    dup2(fileno(errlog), STDERR_FILENO);
+    fclose(log);
+    fclose(errlog);
+    internal_myio_errorprinted = 0;
+    atexit(internal_application_job_exit);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    if(application->jobmemlimit > 0) {
+      struct rlimit limit;
+      limit.rlim_cur = application->jobmemlimit;
+      limit.rlim_max = application->jobmemlimit;
+      if(setrlimit(RLIMIT_AS, &limit) != 0) {
+ printwarning(verbose.debug, "WARNING: Cannot limit memory of worker to %lld bytes.", application->jobmemlimit);
+      }
+    }
+#ifdef _OPENMP
+    if(omp_get_max_threads() > application->nrjobs)
+      omp_set_num_threads(omp_get_max_threads()/application->nrjobs);
+    else
+      omp_set_num_threads(1);
+#endif
+    return 1;
+  }
+  internal_application_job_pid[jobnr] = pid;
+  internal_application_job_log[jobnr] = log;
+  internal_application_job_errlog[jobnr] = errlog;
+  internal_application_job_nrstarted++;
+  internal_application_job_nrrunning++;
+  return 0;
+}
+char *getNextFilenameFromList(psrsalsaApplication *application, char **argv, verbose_definition verbose)
+{
+  int ret;
+  char *filename;
+  if(application->nrjobs <= 1)
+    return internal_getNextFilenameFromList(application, argv, verbose);
+  if(internal_application_job_child) {
+    internal_application_job_exit();
+    return NULL;
+  }
+  while((filename = internal_getNextFilenameFromList(application, argv, verbose)) != NULL) {
+    ret = internal_application_job_start(application, filename, verbose);
+    if(ret == 1)
+      return filename;
+    if(ret == -1) {
+      while(internal_application_job_nrrunning > 0) {
+ if(internal_application_job_wait(verbose) == 0)
+   break;
+      }
+      return filename;
+    }
+  }
+  while(internal_application_job_nrrunning > 0) {
+    if(internal_application_job_wait(verbose) == 0)
+      break;
+  }
+  if(verbose.verbose && internal_application_job_nrstarted > 0) {
+    printf("%ld files processed with %d simultaneous jobs", internal_application_job_nrstarted, application->nrjobs);
+    if(internal_application_job_nrfailed)
+      printf(", %ld failed", internal_application_job_nrfailed);
+    printf("\n");
+  }
+  return NULL;
+}
 void showlibraryversioninformation(FILE *stream)
 {
   fprintf(stream, "cfitsio version: ");
@@ -17,6 +17,9 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <complex.h>
 #include <fftw3.h>
 #include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "psrsalsa.h"
 void print_fftw_version_used(FILE *stream)
 {
@@ -37,6 +40,8 @@ int rotateSinglepulse(float *data, int npts, float epsilon, verbose_definition v
   }
   plan1 = fftwf_plan_dft_r2c_1d(npts, data, dataFFT, FFTW_ESTIMATE);
   plan2 = fftwf_plan_dft_c2r_1d(npts, dataFFT, data, FFTW_ESTIMATE);
+  timingCount(verbose, TIMING_FFTPLANS, 2);
+  timingCount(verbose, TIMING_FFTEXECS, 2);
   fftwf_execute(plan1);
   fac = 1.0/(float)npts;
   dtheta = -2.0*M_PI*epsilon/(float)npts;
@@ -66,6 +71,8 @@ int crosscorrelation_fft(float *data1, float *data2, int ndata, float *cc, verbo
   plan1 = fftwf_plan_dft_r2c_1d(ndata, data1, dataFFT1, FFTW_ESTIMATE);
   plan2 = fftwf_plan_dft_r2c_1d(ndata, data2, dataFFT2, FFTW_ESTIMATE);
   plan3 = fftwf_plan_dft_c2r_1d(ndata, dataFFT1, cc, FFTW_ESTIMATE);
+  timingCount(verbose, TIMING_FFTPLANS, 3);
+  timingCount(verbose, TIMING_FFTEXECS, 3);
   fftwf_execute(plan1);
   fftwf_execute(plan2);
   fac = 1.0/(float)ndata;
@@ -143,3 +150,229 @@ int crosscorrelation_fft_padding(float *data1, float *data2, int ndata, int extr
   }
   return 1;
 }
+int internal_initTemplateAlignment(templatealign_definition *engine, long nrbins, float **buffer, verbose_definition verbose)
+{
+  long nrfreq;
+  engine->nrbins = nrbins;
+  engine->nrharmonics = (nrbins-1)/2;
+  engine->templatespec = NULL;
+  engine->plan_forward = NULL;
+  engine->plan_backward = NULL;
+  if(engine->nrharmonics < 2) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR initTemplateAlignment: At least 5 bins are required to align profiles (%ld specified).", nrbins);
+    return 0;
+  }
+  nrfreq = nrbins/2+1;
+  *buffer = (float *)fftwf_malloc(nrbins*sizeof(float));
+  engine->templatespec = (float *)fftwf_malloc(nrfreq*sizeof(fftwf_complex));
+  if(*buffer == NULL || engine->templatespec == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR initTemplateAlignment: fftwf_malloc failed.");
+    return 0;
+  }
+  engine->plan_forward = (void *)fftwf_plan_dft_r2c_1d(nrbins, *buffer, (fftwf_complex *)engine->templatespec, FFTW_ESTIMATE);
+  engine->plan_backward = (void *)fftwf_plan_dft_c2r_1d(nrbins, (fftwf_complex *)engine->templatespec, *buffer, FFTW_ESTIMATE);
+  timingCount(verbose, TIMING_FFTPLANS, 2);
+  return 1;
+}
+int internal_initTemplateAlignment_power(templatealign_definition *engine, verbose_definition verbose)
+{
+  long k;
+  fftwf_complex *spec;
+  spec = (fftwf_complex *)engine->templatespec;
+  engine->templatepower = 0;
+  for(k = 1; k <= engine->nrharmonics; k++)
+    engine->templatepower += crealf(spec[k])*crealf(spec[k]) + cimagf(spec[k])*cimagf(spec[k]);
+  if(engine->templatepower <= 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR initTemplateAlignment: The template has no structure to align on.");
+    freeTemplateAlignment(engine);
+    return 0;
+  }
+  if(verbose.verbose) {
+    for(k = 0; k < verbose.indent; k++)
+      printf(" ");
+    printf("Template alignment engine initialised for %ld bins (%ld harmonics)\n", engine->nrbins, engine->nrharmonics);
+  }
+  return 1;
+}
+int initTemplateAlignment(templatealign_definition *engine, float *template, long nrbins, verbose_definition verbose)
+{
+  float *buffer;
+  if(internal_initTemplateAlignment(engine, nrbins, &buffer, verbose) == 0)
+    return 0;
+  memcpy(buffer, template, nrbins*sizeof(float));
+  fftwf_execute_dft_r2c((fftwf_plan)engine->plan_forward, buffer, (fftwf_complex *)engine->templatespec);
+  timingCount(verbose, TIMING_FFTEXECS, 1);
+  fftwf_free(buffer);
+  return internal_initTemplateAlignment_power(engine, verbose);
+}
+int initTemplateAlignmentVonMises(templatealign_definition *engine, vonMises_collection_definition *components, long nrbins, verbose_definition verbose)
+{
+  float *buffer;
+  if(internal_initTemplateAlignment(engine, nrbins, &buffer, verbose) == 0)
+    return 0;
+  fftwf_free(buffer);
+  if(calcVonMisesSpectrum(components, nrbins, nrbins/2, 0, engine->templatespec, verbose) == 0) {
+    freeTemplateAlignment(engine);
+    return 0;
+  }
+  return internal_initTemplateAlignment_power(engine, verbose);
+}
+void freeTemplateAlignment(templatealign_definition *engine)
+{
+  if(engine->plan_forward != NULL)
+    fftwf_destroy_plan((fftwf_plan)engine->plan_forward);
+  if(engine->plan_backward != NULL)
+    fftwf_destroy_plan((fftwf_plan)engine->plan_backward);
+  if(engine->templatespec != NULL)
+    fftwf_free(engine->templatespec);
+  engine->plan_forward = NULL;
+  engine->plan_backward = NULL;
+  engine->templatespec = NULL;
+}
+void internal_templateAlignProfile(templatealign_definition *engine, float *profile, float *buffer, fftwf_complex *spec, double complex *cross, double *shift, double *error, double *amplitude)
+{
+  long k, n, nrbins, nrharmonics, lag;
+  int itt;
+  double omega, tau, dtau, g, g1, g2, b, profilepower, residual;
+  double complex rot, z, c;
+  fftwf_complex *templatespec;
+  nrbins = engine->nrbins;
+  nrharmonics = engine->nrharmonics;
+  templatespec = (fftwf_complex *)engine->templatespec;
+  memcpy(buffer, profile, nrbins*sizeof(float));
+  fftwf_execute_dft_r2c((fftwf_plan)engine->plan_forward, buffer, spec);
+  profilepower = 0;
+  for(k = 1; k <= nrharmonics; k++) {
+    cross[k] = (double complex)spec[k]*conj((double complex)templatespec[k]);
+    profilepower += creal(spec[k])*creal(spec[k]) + cimag(spec[k])*cimag(spec[k]);
+  }
+  spec[0] = 0;
+  for(k = 1; k < nrbins/2+1; k++) {
+    if(k <= nrharmonics)
+      spec[k] = cross[k];
+    else
+      spec[k] = 0;
+  }
+  fftwf_execute_dft_c2r((fftwf_plan)engine->plan_backward, spec, buffer);
+  lag = 0;
+  for(n = 1; n < nrbins; n++) {
+    if(buffer[n] > buffer[lag])
+      lag = n;
+  }
+  if(lag >= nrbins/2)
+    lag -= nrbins;
+  omega = 2.0*M_PI/(double)nrbins;
+  tau = lag;
+  for(itt = 0; itt < 20; itt++) {
+    rot = cexp(I*omega*tau);
+    z = 1;
+    g = g1 = g2 = 0;
+    for(k = 1; k <= nrharmonics; k++) {
+      z *= rot;
+      c = cross[k]*z;
+      g += creal(c);
+      g1 -= omega*k*cimag(c);
+      g2 -= omega*omega*k*k*creal(c);
+    }
+    if(g2 < 0)
+      dtau = -g1/g2;
+    else
+      dtau = (g1 > 0 ? 0.5 : -0.5);
+    if(dtau > 0.5)
+      dtau = 0.5;
+    else if(dtau < -0.5)
+      dtau = -0.5;
+    tau += dtau;
+    if(fabs(dtau) < 1e-6)
+      break;
+  }
+  while(tau >= 0.5*nrbins)
+    tau -= nrbins;
+  while(tau < -0.5*nrbins)
+    tau += nrbins;
+  b = g/engine->templatepower;
+  *shift = tau/(double)nrbins;
+  if(amplitude != NULL)
+    amplitude[0] = b;
+  if(error != NULL) {
+    residual = (profilepower - b*b*engine->templatepower)/(double)(2*nrharmonics-2);
+    if(residual > 0 && b*g2 < 0)
+      error[0] = sqrt(-residual/(b*g2))/(double)nrbins;
+    else
+      error[0] = 0;
+  }
+}
+int templateAlignProfiles(templatealign_definition *engine, float *profiles, long nrprofiles, double *shifts, double *errors, double *amplitudes, verbose_definition verbose)
+{
+  int nrthreads, thread, ok;
+  long i, nrfreq;
+  double t0;
+  float **buffer;
+  fftwf_complex **spec;
+  double complex **cross;
+  if(engine->templatespec == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR templateAlignProfiles: Alignment engine is not initialised.");
+    return 0;
+  }
+  t0 = timingStart(verbose);
+  nrthreads = 1;
+#ifdef _OPENMP
+  if(omp_in_parallel() == 0)
+    nrthreads = omp_get_max_threads();
+#endif
+  if(nrthreads > nrprofiles)
+    nrthreads = nrprofiles;
+  if(nrthreads < 1)
+    nrthreads = 1;
+  nrfreq = engine->nrbins/2+1;
+  buffer = (float **)malloc(nrthreads*sizeof(float *));
+  spec = (fftwf_complex **)malloc(nrthreads*sizeof(fftwf_complex *));
+  cross = (double complex **)malloc(nrthreads*sizeof(double complex *));
+  if(buffer == NULL || spec == NULL || cross == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR templateAlignProfiles: Memory allocation error.");
+    return 0;
+  }
+  ok = 1;
+  for(thread = 0; thread < nrthreads; thread++) {
+    buffer[thread] = (float *)fftwf_malloc(engine->nrbins*sizeof(float));
+    spec[thread] = (fftwf_complex *)fftwf_malloc(nrfreq*sizeof(fftwf_complex));
+    cross[thread] = (double complex *)malloc((engine->nrharmonics+1)*sizeof(double complex));
+    if(buffer[thread] == NULL || spec[thread] == NULL || cross[thread] == NULL)
+      ok = 0;
+  }
+  if(ok == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR templateAlignProfiles: Memory allocation error.");
+    return 0;
+  }
+#pragma omp parallel for schedule(static) num_threads(nrthreads)
+  for(i = 0; i < nrprofiles; i++) {
+    int curthread;
+    curthread = 0;
+#ifdef _OPENMP
+    curthread = omp_get_thread_num();
+#endif
+    internal_templateAlignProfile(engine, profiles+i*engine->nrbins, buffer[curthread], spec[curthread], cross[curthread], &shifts[i], errors == NULL ? NULL : &errors[i], amplitudes == NULL ? NULL : &amplitudes[i]);
+  }
+  for(thread = 0; thread < nrthreads; thread++) {
+    fftwf_free(buffer[thread]);
+    fftwf_free(spec[thread]);
+    free(cross[thread]);
+  }
+  free(buffer);
+  free(spec);
+  free(cross);
+  timingCount(verbose, TIMING_FFTEXECS, 2*nrprofiles);
+  timingStop(verbose, "templateAlignProfiles", t0);
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("Aligned %ld profiles against the template using %d threads\n", nrprofiles, nrthreads);
+  }
+  return 1;
+}
@@ -15,13 +15,133 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 
 #include <math.h>
 #include <string.h>
+#include <complex.h>
+#include <fftw3.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "psrsalsa.h"
 #define carousel_interpolation_limit 0.005
 #define carousel_from_p3fold_smoothing_multiplier 10
-void foldP3_simple(float *data, long nry, long starty, long nrx, float *map, float *nrcounts, int nr_p3_bins, float foldp3, float offset, int noNormalise, int noSmooth, float smoothWidth, float slope, float offset2,
+#define p3fold_smoothing_lut_oversampling 256
+#define p3fold_smoothing_tile_pulses 16
+#define p3fold_smoothing_tile_bins 256
+int internal_foldP3_simple_smooth(float *data, long nry, long starty, long nrx, float *map, float *nrcounts, int nr_p3_bins, float foldp3, float offset, float smoothWidth, float slope, float offset2, int debug)
+{
+  long i, i0, i1, b, b0, b1, lutsize, m;
+  int j, nrthreads, thread;
+  float *lut, x, **threadmap, **threadcounts;
+  double dp3;
+  lutsize = nr_p3_bins*p3fold_smoothing_lut_oversampling;
+  lut = (float *)malloc((lutsize+1)*sizeof(float));
+  if(lut == NULL) {
+    fflush(stdout);
+    printerror(debug, "ERROR foldP3_simple: Memory allocation error");
+    return 0;
+  }
+  for(m = 0; m <= lutsize; m++) {
+    dp3 = m/(double)p3fold_smoothing_lut_oversampling;
+    if(nr_p3_bins - dp3 < dp3)
+      dp3 = nr_p3_bins - dp3;
+    lut[m] = exp(-(dp3*dp3/(smoothWidth*smoothWidth)));
+  }
+  nrthreads = 1;
+#ifdef _OPENMP
+  if(omp_in_parallel() == 0 && nry-starty >= 2*p3fold_smoothing_tile_pulses)
+    nrthreads = omp_get_max_threads();
+#endif
+  threadmap = (float **)calloc(nrthreads, sizeof(float *));
+  threadcounts = (float **)calloc(nrthreads, sizeof(float *));
+  if(threadmap == NULL || threadcounts == NULL) {
+    fflush(stdout);
+    printerror(debug, "ERROR foldP3_simple: Memory allocation error");
+    free(threadmap);
+    free(threadcounts);
+    free(lut);
+    return 0;
+  }
+  threadmap[0] = map;
+  threadcounts[0] = nrcounts;
+  for(thread = 1; thread < nrthreads; thread++) {
+    threadmap[thread] = (float *)calloc(nr_p3_bins*nrx, sizeof(float));
+    threadcounts[thread] = (float *)calloc(nr_p3_bins*nrx, sizeof(float));
+    if(threadmap[thread] == NULL || threadcounts[thread] == NULL) {
+      fflush(stdout);
+      printerror(debug, "ERROR foldP3_simple: Memory allocation error");
+      for(; thread > 0; thread--) {
+ free(threadmap[thread]);
+ free(threadcounts[thread]);
+      }
+      free(threadmap);
+      free(threadcounts);
+      free(lut);
+      return 0;
+    }
+  }
+#pragma omp parallel for schedule(static) num_threads(nrthreads) private(i, i1, b, b0, b1, j, x, m)
+  for(i0 = starty; i0 < nry; i0 += p3fold_smoothing_tile_pulses) {
+    float q[p3fold_smoothing_tile_bins], *tmap, *tcounts;
+    int curthread;
+    curthread = 0;
+#ifdef _OPENMP
+    curthread = omp_get_thread_num();
+#endif
+    tmap = threadmap[curthread];
+    tcounts = threadcounts[curthread];
+    i1 = i0 + p3fold_smoothing_tile_pulses;
+    if(i1 > nry)
+      i1 = nry;
+    for(b0 = 0; b0 < nrx; b0 += p3fold_smoothing_tile_bins) {
+      b1 = b0 + p3fold_smoothing_tile_bins;
+      if(b1 > nrx)
+ b1 = nrx;
+      for(i = i0; i < i1; i++) {
+ for(b = b0; b < b1; b++) {
+   x = derotate_deg(360.0*(float)(i+offset)/foldp3-slope*b + offset2);
+   if(x == 360.0)
+     x = 0;
+   q[b-b0] = x*nr_p3_bins/360.0;
+ }
+ if(debug && b0 == 0) {
+   printf("DEBUG foldP3_simple: pulse=%ld (block=%ld ... %ld) folded at P3=%f P, with an offset=%f P and additional offset2=%f deg: Subpulse phase of pulse longitude bin 0 = %f deg\n", i, starty, nry-1, foldp3, offset, offset2, q[0]*360.0/nr_p3_bins);
+ }
+ for(j = 0; j < nr_p3_bins; j++) {
+#pragma omp simd private(x, m)
+   for(b = b0; b < b1; b++) {
+     float w;
+     x = j - q[b-b0];
+     if(x < 0)
+       x += nr_p3_bins;
+     x *= p3fold_smoothing_lut_oversampling;
+     m = x;
+     if(m >= lutsize)
+       m = lutsize-1;
+     x -= m;
+     w = lut[m] + x*(lut[m+1]-lut[m]);
+     tmap[j*nrx+b] += w*data[i*nrx+b];
+     tcounts[j*nrx+b] += w;
+   }
+ }
+      }
+    }
+  }
+  for(thread = 1; thread < nrthreads; thread++) {
+    for(i = 0; i < nr_p3_bins*nrx; i++) {
+      map[i] += threadmap[thread][i];
+      nrcounts[i] += threadcounts[thread][i];
+    }
+    free(threadmap[thread]);
+    free(threadcounts[thread]);
+  }
+  free(threadmap);
+  free(threadcounts);
+  free(lut);
+  return 1;
+}
+int foldP3_simple(float *data, long nry, long starty, long nrx, float *map, float *nrcounts, int nr_p3_bins, float foldp3, float offset, int noNormalise, int noSmooth, float smoothWidth, float slope, float offset2,
      int debug)
 {
-  float p3, j_frac, weight, weightnext, dp3;
+  float p3, j_frac, weight, weightnext;
   int i, j, b, jnext;
   for(i = 0; i < nr_p3_bins; i++) {
     for(b = 0; b < nrx; b++) {
@@ -29,8 +149,11 @@ void foldP3_simple(float *data, long nry, long starty, long nrx, float *map, flo
       map[i*nrx+b] = 0;
     }
   }
-  for(i = starty; i < nry; i++) {
-    if(smoothWidth <= 0) {
+  if(smoothWidth > 0) {
+    if(internal_foldP3_simple_smooth(data, nry, starty, nrx, map, nrcounts, nr_p3_bins, foldp3, offset, smoothWidth, slope, offset2, debug) == 0)
+      return 0;
+  }else {
+    for(i = starty; i < nry; i++) {
       for(b = 0; b < nrx; b++) {
  p3 = 360.0*(float)(i+offset)/foldp3-slope*b + offset2;
  p3 = derotate_deg(p3);
@@ -59,31 +182,6 @@ void foldP3_simple(float *data, long nry, long starty, long nrx, float *map, flo
    weightnext = j_frac;
    map[jnext*nrx+b] += weightnext*data[i*nrx+b];
    nrcounts[jnext*nrx+b] += weightnext;
- }
-      }
-    }else {
-      for(j = 0; j < nr_p3_bins; j++) {
- for(b = 0; b < nrx; b++) {
-   p3 = 360.0*(float)(i+offset)/foldp3-slope*b + offset2;
-   p3 = derotate_deg(p3);
-   if(p3 == 360.0)
-     p3 = 0;
-   if(b == 0 && j == 0) {
-     if(debug) {
-       printf("DEBUG foldP3_simple: pulse=%d (block=%ld ... %ld) folded at P3=%f P, with an offset=%f P and additional offset2=%f deg: Subpulse phase of pulse longitude bin 0 = %f deg\n", i, starty, nry-1, foldp3, offset, offset2, p3);
-     }
-   }
-   p3 *= nr_p3_bins/360.0;
-   dp3 = fabs(p3-j);
-   if(fabs(p3-j+nr_p3_bins) < dp3) {
-     dp3 = fabs(p3-j+nr_p3_bins);
-   }
-   if(fabs(p3-j-nr_p3_bins) < dp3) {
-     dp3 = fabs(p3-j-nr_p3_bins);
-   }
-   weight = exp(-(dp3*dp3/(smoothWidth*smoothWidth)));
-   map[j*nrx+b] += weight*data[i*nrx+b];
-   nrcounts[j*nrx+b] += weight;
  }
       }
     }
@@ -97,13 +195,97 @@ void foldP3_simple(float *data, long nry, long starty, long nrx, float *map, flo
       }
     }
   }
+  return 1;
+}
+void internal_foldP3_templatespectrum(float *template, long nrx, int nr_p3_bins, fftwf_plan plan_forward, float *power, fftwf_complex *templatespec)
+{
+  long i;
+  for(i = 0; i < nr_p3_bins*nrx; i++)
+    power[i] = template[i]*template[i];
+  fftwf_execute_dft_r2c(plan_forward, power, templatespec);
+}
+int internal_foldP3_alignblock(float *data, long startpulse, long dN, long nrx, int nr_p3_bins, float foldp3, int noSmooth, float smoothWidth, float slope, float subpulse_offset, int *onpulsemask, fftwf_complex *templatespec, fftwf_plan plan_forward, fftwf_plan plan_backward, float *blocksum, float *blockcounts, float *power, fftwf_complex *blockspec, fftwf_complex *ccspec, float *cc, float *map, float *nrcounts, int debug)
+{
+  long i, j, b, nrfreq;
+  int best;
+  float maxcorrel;
+  nrfreq = nr_p3_bins/2+1;
+  if(foldP3_simple(data, startpulse+dN, startpulse, nrx, blocksum, blockcounts, nr_p3_bins, foldp3, 0, 1, noSmooth, smoothWidth, slope, subpulse_offset, debug) == 0)
+    return -1;
+  for(i = 0; i < nr_p3_bins*nrx; i++)
+    power[i] = blocksum[i]*blocksum[i];
+  fftwf_execute_dft_r2c(plan_forward, power, blockspec);
+  for(j = 0; j < nrfreq; j++) {
+    ccspec[j] = 0;
+    for(b = 0; b < nrx; b++) {
+      if(onpulsemask[b])
+ ccspec[j] += templatespec[j*nrx+b]*conjf(blockspec[j*nrx+b]);
+    }
+  }
+  fftwf_execute_dft_c2r(plan_backward, ccspec, cc);
+  best = 0;
+  maxcorrel = cc[0];
+  for(i = 1; i < nr_p3_bins; i++) {
+    if(cc[i] > maxcorrel) {
+      maxcorrel = cc[i];
+      best = i;
+    }
+  }
+  for(j = 0; j < nr_p3_bins; j++) {
+    i = j + best;
+    if(i >= nr_p3_bins)
+      i -= nr_p3_bins;
+    for(b = 0; b < nrx; b++) {
+      if(blockcounts[j*nrx+b] > 0)
+ map[i*nrx+b] += blocksum[j*nrx+b]/blockcounts[j*nrx+b];
+      else
+ map[i*nrx+b] += blocksum[j*nrx+b];
+      nrcounts[i*nrx+b] += blockcounts[j*nrx+b];
+    }
+  }
+  return best;
+}
+void internal_foldP3_freebuffers(int nrthreads, float **blocksum, float **blockcounts, float **power, float **cc, float **threadmap, float **threadcounts, fftwf_complex **blockspec, fftwf_complex **ccspec)
+{
+  int thread;
+  for(thread = 0; thread < nrthreads; thread++) {
+    if(blocksum != NULL)
+      free(blocksum[thread]);
+    if(blockcounts != NULL)
+      free(blockcounts[thread]);
+    if(threadmap != NULL)
+      free(threadmap[thread]);
+    if(threadcounts != NULL)
+      free(threadcounts[thread]);
+    if(power != NULL && power[thread] != NULL)
+      fftwf_free(power[thread]);
+    if(cc != NULL && cc[thread] != NULL)
+      fftwf_free(cc[thread]);
+    if(blockspec != NULL && blockspec[thread] != NULL)
+      fftwf_free(blockspec[thread]);
+    if(ccspec != NULL && ccspec[thread] != NULL)
+      fftwf_free(ccspec[thread]);
+  }
+  free(blocksum);
+  free(blockcounts);
+  free(threadmap);
+  free(threadcounts);
+  free(power);
+  free(cc);
+  free(blockspec);
+  free(ccspec);
 }
 int foldP3(float *data, long nry, long nrx, float *map, int nr_p3_bins, float foldp3, int refine, int cyclesperblock, int noSmooth, float smoothWidth, float slope, float subpulse_offset, pulselongitude_regions_definition *onpulse
 , verbose_definition verbose)
 {
-  float *blockmap, correl, maxcorrel, *template, *nrcounts, *nrcounts_block;
-  int i, b, offset, *bestoffset, itt, ok;
-  long startpulse, pulsesleft, dN, blockcounter;
+  float *template, *nrcounts;
+  int i, b, *bestoffset, itt, nrthreads, thread, *onpulsemask, failed;
+  long pulsesleft, dN, blockcounter, nrblocks, nrfreq;
+  float **blocksum, **blockcounts, **power, **cc, **threadmap, **threadcounts;
+  fftwf_complex *templatespec, **blockspec, **ccspec;
+  fftwf_plan plan_forward, plan_backward;
+  double t0;
+  t0 = timingStart(verbose);
   if(cyclesperblock < 1) {
     fflush(stdout);
     printerror(verbose.debug, "foldP3: cyclesperblock (%d) makes no sense", cyclesperblock);
@@ -124,86 +306,147 @@ int foldP3(float *data, long nry, long nrx, float *map, int nr_p3_bins, float fo
   if(bestoffset == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "foldP3: cannot allocate memory");
+    free(nrcounts);
     return 0;
   }
+  failed = 0;
   if(refine <= 0) {
-    foldP3_simple(data, nry, 0, nrx, map, nrcounts, nr_p3_bins, foldp3, 0, 0, noSmooth, smoothWidth, slope, subpulse_offset,
-    0*verbose.debug);
+    if(foldP3_simple(data, nry, 0, nrx, map, nrcounts, nr_p3_bins, foldp3, 0, 0, noSmooth, smoothWidth, slope, subpulse_offset,
+    0*verbose.debug) == 0)
+      failed = 1;
   }else {
-    blockmap = (float *)malloc(nr_p3_bins*nrx*sizeof(float));
-    if(blockmap == NULL) {
-      fflush(stdout);
-      printerror(verbose.debug, "foldP3: cannot allocate memory");
-      return 0;
+    nrblocks = 0;
+    pulsesleft = nry;
+    while(pulsesleft > foldp3*cyclesperblock) {
+      pulsesleft -= dN;
+      nrblocks++;
     }
-    nrcounts_block = (float *)malloc(nrx*nr_p3_bins*sizeof(float));
-    if(nrcounts_block == NULL) {
+    nrthreads = 1;
+#ifdef _OPENMP
+    nrthreads = omp_get_max_threads();
+#endif
+    if(nrthreads > nrblocks)
+      nrthreads = nrblocks;
+    if(nrthreads < 1)
+      nrthreads = 1;
+    nrfreq = nr_p3_bins/2+1;
+    onpulsemask = (int *)malloc(nrx*sizeof(int));
+    templatespec = (fftwf_complex *)fftwf_malloc(nrfreq*nrx*sizeof(fftwf_complex));
+    blocksum = (float **)calloc(nrthreads, sizeof(float *));
+    blockcounts = (float **)calloc(nrthreads, sizeof(float *));
+    power = (float **)calloc(nrthreads, sizeof(float *));
+    cc = (float **)calloc(nrthreads, sizeof(float *));
+    threadmap = (float **)calloc(nrthreads, sizeof(float *));
+    threadcounts = (float **)calloc(nrthreads, sizeof(float *));
+    blockspec = (fftwf_complex **)calloc(nrthreads, sizeof(fftwf_complex *));
+    ccspec = (fftwf_complex **)calloc(nrthreads, sizeof(fftwf_complex *));
+    if(onpulsemask == NULL || templatespec == NULL || blocksum == NULL || blockcounts == NULL || power == NULL || cc == NULL || threadmap == NULL || threadcounts == NULL || blockspec == NULL || ccspec == NULL) {
       fflush(stdout);
       printerror(verbose.debug, "foldP3: cannot allocate memory");
+      internal_foldP3_freebuffers(0, blocksum, blockcounts, power, cc, threadmap, threadcounts, blockspec, ccspec);
+      free(onpulsemask);
+      if(templatespec != NULL)
+ fftwf_free(templatespec);
+      free(nrcounts);
+      free(bestoffset);
       return 0;
     }
+    for(thread = 0; thread < nrthreads; thread++) {
+      blocksum[thread] = (float *)malloc(nr_p3_bins*nrx*sizeof(float));
+      blockcounts[thread] = (float *)malloc(nr_p3_bins*nrx*sizeof(float));
+      threadmap[thread] = (float *)malloc(nr_p3_bins*nrx*sizeof(float));
+      threadcounts[thread] = (float *)malloc(nr_p3_bins*nrx*sizeof(float));
+      power[thread] = (float *)fftwf_malloc(nr_p3_bins*nrx*sizeof(float));
+      cc[thread] = (float *)fftwf_malloc(nr_p3_bins*sizeof(float));
+      blockspec[thread] = (fftwf_complex *)fftwf_malloc(nrfreq*nrx*sizeof(fftwf_complex));
+      ccspec[thread] = (fftwf_complex *)fftwf_malloc(nrfreq*sizeof(fftwf_complex));
+      if(blocksum[thread] == NULL || blockcounts[thread] == NULL || threadmap[thread] == NULL || threadcounts[thread] == NULL || power[thread] == NULL || cc[thread] == NULL || blockspec[thread] == NULL || ccspec[thread] == NULL) {
+ fflush(stdout);
+ printerror(verbose.debug, "foldP3: cannot allocate memory");
+ internal_foldP3_freebuffers(nrthreads, blocksum, blockcounts, power, cc, threadmap, threadcounts, blockspec, ccspec);
+ free(onpulsemask);
+ fftwf_free(templatespec);
+ free(nrcounts);
+ free(bestoffset);
+ return 0;
+      }
+    }
+    plan_forward = fftwf_plan_many_dft_r2c(1, &nr_p3_bins, nrx, power[0], NULL, nrx, 1, blockspec[0], NULL, nrx, 1, FFTW_ESTIMATE);
+    plan_backward = fftwf_plan_dft_c2r_1d(nr_p3_bins, ccspec[0], cc[0], FFTW_ESTIMATE);
+    timingCount(verbose, TIMING_FFTPLANS, 2);
+    for(b = 0; b < nrx; b++) {
+      onpulsemask[b] = 1;
+      if(onpulse != NULL) {
+ if(checkRegions(b, onpulse, 0, verbose) == 0)
+   onpulsemask[b] = 0;
+      }
+    }
     if(refine > 1) {
       template = (float *)malloc(nr_p3_bins*nrx*sizeof(float));
       if(template == NULL) {
  fflush(stdout);
  printerror(verbose.debug, "foldP3: cannot allocate memory");
+ fftwf_destroy_plan(plan_forward);
+ fftwf_destroy_plan(plan_backward);
+ internal_foldP3_freebuffers(nrthreads, blocksum, blockcounts, power, cc, threadmap, threadcounts, blockspec, ccspec);
+ free(onpulsemask);
+ fftwf_free(templatespec);
+ free(nrcounts);
+ free(bestoffset);
  return 0;
       }
     }
-    for(itt = 0; itt < refine; itt++) {
+    for(itt = 0; itt < refine && failed == 0; itt++) {
       for(i = 0; i < nr_p3_bins; i++) {
  for(b = 0; b < nrx; b++) {
    nrcounts[i*nrx+b] = 0;
    map[i*nrx+b] = 0;
  }
       }
-      startpulse = 0;
-      pulsesleft = nry;
-      blockcounter = 0;
-      while(pulsesleft > foldp3*cyclesperblock) {
- {
-   maxcorrel = 0;
-   for(offset = 0; offset < nr_p3_bins; offset++) {
-     foldP3_simple(data, startpulse+dN, startpulse, nrx, blockmap, nrcounts_block, nr_p3_bins, foldp3, offset*foldp3/(float)nr_p3_bins, 1, noSmooth, smoothWidth, slope, subpulse_offset,
-0*verbose.debug);
-     correl = 0;
-     for(i = 0; i < nr_p3_bins; i++) {
-       for(b = 0; b < nrx; b++) {
-  ok = 0;
-  if(onpulse == NULL) {
-    ok = 1;
-  }else if(checkRegions(b, onpulse, 0, verbose)) {
-    ok = 1;
-  }
-  if(ok) {
-    if(itt > 0)
-      correl += template[i*nrx+b]*template[i*nrx+b]*blockmap[i*nrx+b]*blockmap[i*nrx+b];
-    else
-      correl += map[i*nrx+b]*map[i*nrx+b]*blockmap[i*nrx+b]*blockmap[i*nrx+b];
-  }
-       }
-     }
-     if(correl > maxcorrel || offset == 0) {
-       maxcorrel = correl;
-       bestoffset[blockcounter] = offset;
-     }
+      if(itt == 0) {
+ for(blockcounter = 0; blockcounter < nrblocks; blockcounter++) {
+   internal_foldP3_templatespectrum(map, nrx, nr_p3_bins, plan_forward, power[0], templatespec);
+   bestoffset[blockcounter] = internal_foldP3_alignblock(data, blockcounter*dN, dN, nrx, nr_p3_bins, foldp3, noSmooth, smoothWidth, slope, subpulse_offset, onpulsemask, templatespec, plan_forward, plan_backward, blocksum[0], blockcounts[0], power[0], blockspec[0], ccspec[0], cc[0], map, nrcounts, verbose.debug);
+   if(bestoffset[blockcounter] < 0) {
+     failed = 1;
+     break;
+   }
+   if(verbose.verbose && verbose.nocounters == 0) {
+     printf("  Itteration %d/%d, pulse %ld/%ld     \r", itt+1, refine, (blockcounter+1)*dN, nry);
+     fflush(stdout);
    }
  }
- foldP3_simple(data, startpulse+dN, startpulse, nrx, blockmap, nrcounts_block, nr_p3_bins, foldp3, bestoffset[blockcounter]*foldp3/(float)nr_p3_bins, 0, noSmooth, smoothWidth, slope, subpulse_offset,
-verbose.debug);
- for(i = 0; i < nr_p3_bins; i++) {
-   for(b = 0; b < nrx; b++) {
-     nrcounts[i*nrx+b] += nrcounts_block[i*nrx+b];
-     map[i*nrx+b] += (float)blockmap[i*nrx+b];
+ timingCount(verbose, TIMING_FFTEXECS, 3*nrblocks);
+      }else {
+ internal_foldP3_templatespectrum(template, nrx, nr_p3_bins, plan_forward, power[0], templatespec);
+ for(thread = 0; thread < nrthreads; thread++) {
+   memset(threadmap[thread], 0, nr_p3_bins*nrx*sizeof(float));
+   memset(threadcounts[thread], 0, nr_p3_bins*nrx*sizeof(float));
+ }
+#pragma omp parallel for schedule(static) num_threads(nrthreads)
+ for(blockcounter = 0; blockcounter < nrblocks; blockcounter++) {
+   int curthread;
+   curthread = 0;
+#ifdef _OPENMP
+   curthread = omp_get_thread_num();
+#endif
+   bestoffset[blockcounter] = internal_foldP3_alignblock(data, blockcounter*dN, dN, nrx, nr_p3_bins, foldp3, noSmooth, smoothWidth, slope, subpulse_offset, onpulsemask, templatespec, plan_forward, plan_backward, blocksum[curthread], blockcounts[curthread], power[curthread], blockspec[curthread], ccspec[curthread], cc[curthread], threadmap[curthread], threadcounts[curthread], verbose.debug);
+   if(bestoffset[blockcounter] < 0) {
+#pragma omp atomic write
+     failed = 1;
+   }
+ }
+ for(thread = 0; thread < nrthreads; thread++) {
+   for(i = 0; i < nr_p3_bins*nrx; i++) {
+     map[i] += threadmap[thread][i];
+     nrcounts[i] += threadcounts[thread][i];
    }
  }
- startpulse += dN;
- pulsesleft -= dN;
+ timingCount(verbose, TIMING_FFTEXECS, 2*nrblocks+1);
  if(verbose.verbose && verbose.nocounters == 0) {
-   printf("  Itteration %d/%d, pulse %ld/%ld     \r", itt+1, refine, startpulse, nry);
+   printf("  Itteration %d/%d, pulse %ld/%ld     \r", itt+1, refine, nrblocks*dN, nry);
    fflush(stdout);
  }
- blockcounter++;
       }
       if(refine > 1) {
  for(i = 0; i < nr_p3_bins; i++) {
@@ -216,15 +459,24 @@ verbose.debug);
     if(verbose.verbose && verbose.nocounters == 0) {
       printf("\n");
     }
-    free(blockmap);
-    free(nrcounts_block);
+    fftwf_destroy_plan(plan_forward);
+    fftwf_destroy_plan(plan_backward);
+    internal_foldP3_freebuffers(nrthreads, blocksum, blockcounts, power, cc, threadmap, threadcounts, blockspec, ccspec);
+    free(onpulsemask);
+    fftwf_free(templatespec);
     if(refine > 1) {
       free(template);
     }
   }
   free(nrcounts);
   free(bestoffset);
+  if(failed) {
+    fflush(stdout);
+    printerror(verbose.debug, "foldP3: folding the data failed");
+    return 0;
+  }
   if(verbose.verbose)
     printf("  Done\n");
+  timingStop(verbose, "foldP3", t0);
   return 1;
 }
@@ -0,0 +1,402 @@
+/*
+Copyright (c) 2015, Patrick Weltevrede
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "psrsalsa.h"
+#define HISTOGRAM_MIN_SAMPLES_PARALLEL 100000
+#define HISTOGRAM_EDGE_TOLERANCE 1e-6
+void internal_histogram_set_axis(double dx, double min_x, int centered_at_zero, double extra_phase, double *inv_dx, double *offset, long *binzero)
+{
+  long step;
+  if(min_x < 0)
+    step = -min_x/dx+10;
+  else
+    step = 0;
+  *offset = step+0.5*centered_at_zero-extra_phase;
+  *binzero = (min_x+(*offset)*dx)/dx;
+  *inv_dx = 1.0/dx;
+}
+long internal_histogram_axis_bin(double x, double dx, double inv_dx, double offset, long binzero)
+{
+  double t, frac;
+  long bin;
+  t = x*inv_dx + offset;
+  bin = t;
+  frac = t - bin;
+  if(frac < HISTOGRAM_EDGE_TOLERANCE || frac > 1.0-HISTOGRAM_EDGE_TOLERANCE)
+    bin = (x+offset*dx)/dx;
+  return bin - binzero;
+}
+int initHistogram(histogram_definition *hist, long nrbinsx, double dx, double min_x, long nrbinsy, double dy, double min_y, int centered_at_zero, double extra_phase, int truncate, verbose_definition verbose)
+{
+  if(nrbinsx <= 0 || nrbinsy <= 0 || dx <= 0 || (nrbinsy > 1 && dy <= 0)) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR initHistogram: Invalid binning specified (%ld x %ld bins, dx=%e dy=%e).", nrbinsx, nrbinsy, dx, dy);
+    return 0;
+  }
+  hist->nrbinsx = nrbinsx;
+  hist->nrbinsy = nrbinsy;
+  hist->dx = dx;
+  hist->min_x = min_x;
+  internal_histogram_set_axis(dx, min_x, centered_at_zero, extra_phase, &(hist->inv_dx), &(hist->offsetx), &(hist->binzerox));
+  if(nrbinsy > 1) {
+    hist->dy = dy;
+    hist->min_y = min_y;
+    internal_histogram_set_axis(dy, min_y, centered_at_zero, extra_phase, &(hist->inv_dy), &(hist->offsety), &(hist->binzeroy));
+  }else {
+    hist->dy = 1;
+    hist->min_y = 0;
+    hist->inv_dy = 1;
+    hist->offsety = 0;
+    hist->binzeroy = 0;
+  }
+  hist->truncate = truncate;
+  hist->nrsamples = 0;
+  hist->nroutside = 0;
+  hist->counts = (long *)calloc(nrbinsx*nrbinsy, sizeof(long));
+  if(hist->counts == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR initHistogram: Memory allocation error.");
+    return 0;
+  }
+  return 1;
+}
+void freeHistogram(histogram_definition *hist)
+{
+  if(hist->counts != NULL)
+    free(hist->counts);
+  hist->counts = NULL;
+}
+long histogramBinNumber(histogram_definition *hist, double x, double y)
+{
+  long binx, biny;
+  binx = internal_histogram_axis_bin(x, hist->dx, hist->inv_dx, hist->offsetx, hist->binzerox);
+  if(binx < 0 || binx >= hist->nrbinsx) {
+    if(hist->truncate == 0)
+      return -1;
+    binx = binx < 0 ? 0 : hist->nrbinsx-1;
+  }
+  if(hist->nrbinsy == 1)
+    return binx;
+  biny = internal_histogram_axis_bin(y, hist->dy, hist->inv_dy, hist->offsety, hist->binzeroy);
+  if(biny < 0 || biny >= hist->nrbinsy) {
+    if(hist->truncate == 0)
+      return -1;
+    biny = biny < 0 ? 0 : hist->nrbinsy-1;
+  }
+  return biny*hist->nrbinsx + binx;
+}
+int fillHistogram(histogram_definition *hist, double *x, double *y, long n, verbose_definition verbose)
+{
+  long i, nrbins, nroutside, *private_counts;
+  int nrthreads;
+  nrbins = hist->nrbinsx*hist->nrbinsy;
+  if(hist->nrbinsy > 1 && y == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR fillHistogram: Two dimensional histogram requires y values.");
+    return 0;
+  }
+  nrthreads = 1;
+#ifdef _OPENMP
+  if(n >= HISTOGRAM_MIN_SAMPLES_PARALLEL)
+    nrthreads = omp_get_max_threads();
+#endif
+  private_counts = NULL;
+  if(nrthreads > 1) {
+    private_counts = (long *)calloc(nrthreads*nrbins, sizeof(long));
+    if(private_counts == NULL) {
+      if(verbose.debug)
+ printf("fillHistogram: Cannot allocate per-thread histograms, binning single threaded.\n");
+      nrthreads = 1;
+    }
+  }
+  nroutside = 0;
+#pragma omp parallel num_threads(nrthreads) reduction(+:nroutside)
+  {
+    long *counts, bin;
+    counts = hist->counts;
+#ifdef _OPENMP
+    if(private_counts != NULL)
+      counts = private_counts + omp_get_thread_num()*nrbins;
+#endif
+#pragma omp for schedule(static)
+    for(i = 0; i < n; i++) {
+      bin = histogramBinNumber(hist, x[i], y == NULL ? 0 : y[i]);
+      if(bin < 0)
+ nroutside++;
+      else
+ counts[bin]++;
+    }
+  }
+  if(private_counts != NULL) {
+#pragma omp parallel for num_threads(nrthreads) schedule(static)
+    for(i = 0; i < nrbins; i++) {
+      int t;
+      for(t = 0; t < nrthreads; t++)
+ hist->counts[i] += private_counts[t*nrbins+i];
+    }
+    free(private_counts);
+  }
+  hist->nrsamples += n - nroutside;
+  hist->nroutside += nroutside;
+  if(nroutside > 0 && verbose.debug) {
+    printf("fillHistogram: %ld values fell outside the histogram range.\n", nroutside);
+  }
+  return 1;
+}
+void cumulativeHistogram(histogram_definition *hist)
+{
+  long i, j;
+  for(j = 0; j < hist->nrbinsy; j++) {
+    for(i = 1; i < hist->nrbinsx; i++) {
+      hist->counts[j*hist->nrbinsx+i] += hist->counts[j*hist->nrbinsx+i-1];
+    }
+  }
+}
+typedef struct {
+  datafile_definition *psrdata;
+  FILE *fin;
+  char *txt;
+  long maxlinelength, linenr;
+  long subint, freq;
+  float *pulse;
+  int colx, coly, twoD, read_log;
+  char skipChar;
+}histogram_stream_internal;
+int internal_histogram_stream_open(histogram_stream_internal *stream, datafile_definition *psrdata, char *filename, int skiplines, char skipChar, int colx, int coly, int twoD, int read_log, verbose_definition verbose)
+{
+  stream->psrdata = psrdata;
+  stream->fin = NULL;
+  stream->txt = NULL;
+  stream->pulse = NULL;
+  stream->colx = colx;
+  stream->coly = coly;
+  stream->twoD = twoD;
+  stream->read_log = read_log;
+  stream->skipChar = skipChar;
+  stream->subint = 0;
+  stream->freq = 0;
+  stream->linenr = 0;
+  stream->maxlinelength = 10240+1;
+  if(psrdata != NULL) {
+    stream->pulse = (float *)malloc(psrdata->NrBins*sizeof(float));
+    if(stream->pulse == NULL) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR internal_histogram_stream_open: Memory allocation error.");
+      return 0;
+    }
+    return 1;
+  }
+  stream->fin = fopen(filename, "r");
+  if(stream->fin == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR internal_histogram_stream_open: Cannot open %s", filename);
+    return 0;
+  }
+  if(skipLinesInFile(stream->fin, skiplines, verbose) == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR internal_histogram_stream_open: Reached EOF while skipping first %d lines", skiplines);
+    fclose(stream->fin);
+    return 0;
+  }
+  stream->txt = malloc(stream->maxlinelength);
+  if(stream->txt == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR internal_histogram_stream_open: Memory allocation error.");
+    fclose(stream->fin);
+    return 0;
+  }
+  return 1;
+}
+void internal_histogram_stream_close(histogram_stream_internal *stream)
+{
+  if(stream->fin != NULL)
+    fclose(stream->fin);
+  if(stream->txt != NULL)
+    free(stream->txt);
+  if(stream->pulse != NULL)
+    free(stream->pulse);
+}
+int internal_histogram_stream_value(histogram_stream_internal *stream, double *value, verbose_definition verbose)
+{
+  if(stream->read_log) {
+    if(*value <= 0) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR internal_histogram_stream_value: Cannot take logarithm of a value <= 0.");
+      return 0;
+    }
+    *value = log10(*value);
+  }
+  return 1;
+}
+int internal_histogram_stream_column(histogram_stream_internal *stream, int colnum, double *value, verbose_definition verbose)
+{
+  char *word_ptr;
+  int nrwords;
+  word_ptr = pickWordFromString(stream->txt, colnum, &nrwords, 1, ' ', verbose);
+  if(word_ptr == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR internal_histogram_stream_column: Cannot find column %d on line %ld", colnum, stream->linenr);
+    return 0;
+  }
+  if(sscanf(word_ptr, "%lf", value) != 1) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR internal_histogram_stream_column: Cannot interpret column %d on line %ld as a double", colnum, stream->linenr);
+    return 0;
+  }
+  return internal_histogram_stream_value(stream, value, verbose);
+}
+long internal_histogram_stream_chunk(histogram_stream_internal *stream, double *x, double *y, long maxn, verbose_definition verbose)
+{
+  long n, b;
+  int ret;
+  n = 0;
+  if(stream->psrdata != NULL) {
+    while(n + stream->psrdata->NrBins <= maxn && stream->subint < stream->psrdata->NrSubints) {
+      if(readPulsePSRData(stream->psrdata, stream->subint, stream->colx, stream->freq, 0, stream->psrdata->NrBins, stream->pulse, verbose) == 0) {
+ fflush(stdout);
+ printerror(verbose.debug, "ERROR internal_histogram_stream_chunk: Read error.");
+ return -1;
+      }
+      for(b = 0; b < stream->psrdata->NrBins; b++) {
+ x[n+b] = stream->pulse[b];
+ if(internal_histogram_stream_value(stream, &x[n+b], verbose) == 0)
+   return -1;
+      }
+      if(stream->twoD) {
+ if(readPulsePSRData(stream->psrdata, stream->subint, stream->coly, stream->freq, 0, stream->psrdata->NrBins, stream->pulse, verbose) == 0) {
+   fflush(stdout);
+   printerror(verbose.debug, "ERROR internal_histogram_stream_chunk: Read error.");
+   return -1;
+ }
+ for(b = 0; b < stream->psrdata->NrBins; b++) {
+   y[n+b] = stream->pulse[b];
+   if(internal_histogram_stream_value(stream, &y[n+b], verbose) == 0)
+     return -1;
+ }
+      }
+      n += stream->psrdata->NrBins;
+      stream->freq++;
+      if(stream->freq == stream->psrdata->NrFreqChan) {
+ stream->freq = 0;
+ stream->subint++;
+      }
+    }
+    return n;
+  }
+  while(n < maxn) {
+    ret = ascii_file_get_next_line(stream->fin, stream->txt, stream->maxlinelength, stream->skipChar, verbose);
+    if(ret == 0)
+      break;
+    stream->linenr += ret;
+    if(internal_histogram_stream_column(stream, stream->colx, &x[n], verbose) == 0)
+      return -1;
+    if(stream->twoD) {
+      if(internal_histogram_stream_column(stream, stream->coly, &y[n], verbose) == 0)
+ return -1;
+    }
+    n++;
+  }
+  return n;
+}
+int internal_histogram_stream_allocate(datafile_definition *psrdata, long *chunksize, double **x, double **y, verbose_definition verbose)
+{
+  if(psrdata != NULL) {
+    if(*chunksize < psrdata->NrBins)
+      *chunksize = psrdata->NrBins;
+  }
+  *x = (double *)malloc((*chunksize)*sizeof(double));
+  *y = (double *)malloc((*chunksize)*sizeof(double));
+  if(*x == NULL || *y == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR internal_histogram_stream_allocate: Memory allocation error.");
+    return 0;
+  }
+  return 1;
+}
+int streamHistogramRange(datafile_definition *psrdata, char *filename, int skiplines, char skipChar, int colx, int coly, int twoD, int read_log, long chunksize, long *ndata, double *min_x, double *max_x, double *min_y, double *max_y, verbose_definition verbose)
+{
+  histogram_stream_internal stream;
+  double *x, *y;
+  long i, n;
+  if(internal_histogram_stream_allocate(psrdata, &chunksize, &x, &y, verbose) == 0)
+    return 0;
+  if(internal_histogram_stream_open(&stream, psrdata, filename, skiplines, skipChar, colx, coly, twoD, read_log, verbose) == 0) {
+    free(x);
+    free(y);
+    return 0;
+  }
+  *ndata = 0;
+  *min_x = *max_x = 0;
+  if(min_y != NULL && max_y != NULL)
+    *min_y = *max_y = 0;
+  while((n = internal_histogram_stream_chunk(&stream, x, y, chunksize, verbose)) > 0) {
+    for(i = 0; i < n; i++) {
+      if(x[i] < *min_x || (*ndata == 0 && i == 0))
+ *min_x = x[i];
+      if(x[i] > *max_x || (*ndata == 0 && i == 0))
+ *max_x = x[i];
+      if(twoD && min_y != NULL && max_y != NULL) {
+ if(y[i] < *min_y || (*ndata == 0 && i == 0))
+   *min_y = y[i];
+ if(y[i] > *max_y || (*ndata == 0 && i == 0))
+   *max_y = y[i];
+      }
+    }
+    *ndata += n;
+  }
+  internal_histogram_stream_close(&stream);
+  free(x);
+  free(y);
+  if(n < 0)
+    return 0;
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("Scanned %ld points with x values between %e and %e\n", *ndata, *min_x, *max_x);
+  }
+  return 1;
+}
+int streamHistogramFill(datafile_definition *psrdata, char *filename, int skiplines, char skipChar, int colx, int coly, int twoD, int read_log, long chunksize, histogram_definition *hist, verbose_definition verbose)
+{
+  histogram_stream_internal stream;
+  double *x, *y;
+  long n;
+  if(internal_histogram_stream_allocate(psrdata, &chunksize, &x, &y, verbose) == 0)
+    return 0;
+  if(internal_histogram_stream_open(&stream, psrdata, filename, skiplines, skipChar, colx, coly, twoD, read_log, verbose) == 0) {
+    free(x);
+    free(y);
+    return 0;
+  }
+  while((n = internal_histogram_stream_chunk(&stream, x, y, chunksize, verbose)) > 0) {
+    if(fillHistogram(hist, x, twoD ? y : NULL, n, verbose) == 0) {
+      n = -1;
+      break;
+    }
+  }
+  internal_histogram_stream_close(&stream);
+  free(x);
+  free(y);
+  if(n < 0)
+    return 0;
+  return 1;
+}
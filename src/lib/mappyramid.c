@@ -0,0 +1,340 @@
+/*
+Copyright (c) 2015, Patrick Weltevrede
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "psrsalsa.h"
+#define MAP_PYRAMID_FACTOR 4
+#define MAP_PYRAMID_MIN_NRY 256
+#define MAP_PYRAMID_MIN_NRX 2048
+#define MAP_PYRAMID_MAGIC "PSRSALSAMAPPYR2"
+void internal_preprocesscache_hash(unsigned long long *hash, void *ptr, size_t nrbytes);
+void internal_map_pyramid_clear(map_pyramid_definition *pyramid)
+{
+  int level;
+  pyramid->cmap = NULL;
+  pyramid->nrx = pyramid->nry = 0;
+  pyramid->nrlevels = 0;
+  for(level = 0; level < maxNrMapPyramidLevels; level++) {
+    pyramid->min[level] = NULL;
+    pyramid->max[level] = NULL;
+    pyramid->mean[level] = NULL;
+  }
+}
+unsigned long long internal_map_pyramid_fingerprint(float *cmap, long nrx, long nry)
+{
+  unsigned long long fingerprint;
+  fingerprint = 14695981039346656037ULL;
+  internal_preprocesscache_hash(&fingerprint, cmap, nrx*nry*sizeof(float));
+  return fingerprint;
+}
+int internal_map_pyramid_allocate(map_pyramid_definition *pyramid, int level, verbose_definition verbose)
+{
+  long n;
+  n = pyramid->levelnrx[level]*pyramid->levelnry[level];
+  pyramid->min[level] = (float *)malloc(n*sizeof(float));
+  pyramid->max[level] = (float *)malloc(n*sizeof(float));
+  pyramid->mean[level] = (float *)malloc(n*sizeof(float));
+  if(pyramid->min[level] == NULL || pyramid->max[level] == NULL || pyramid->mean[level] == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR initMapPyramid: Memory allocation error.");
+    return 0;
+  }
+  return 1;
+}
+int internal_map_pyramid_layout(map_pyramid_definition *pyramid)
+{
+  int level;
+  long fx, fy;
+  pyramid->levelnrx[0] = pyramid->nrx;
+  pyramid->levelnry[0] = pyramid->nry;
+  pyramid->binx[0] = 1;
+  pyramid->biny[0] = 1;
+  for(level = 1; level < maxNrMapPyramidLevels; level++) {
+    fx = 1;
+    fy = 1;
+    if(pyramid->levelnrx[level-1]/MAP_PYRAMID_FACTOR >= MAP_PYRAMID_MIN_NRX)
+      fx = MAP_PYRAMID_FACTOR;
+    if(pyramid->levelnry[level-1]/MAP_PYRAMID_FACTOR >= MAP_PYRAMID_MIN_NRY)
+      fy = MAP_PYRAMID_FACTOR;
+    if(fx == 1 && fy == 1)
+      break;
+    pyramid->binx[level] = pyramid->binx[level-1]*fx;
+    pyramid->biny[level] = pyramid->biny[level-1]*fy;
+    pyramid->levelnrx[level] = (pyramid->nrx + pyramid->binx[level] - 1)/pyramid->binx[level];
+    pyramid->levelnry[level] = (pyramid->nry + pyramid->biny[level] - 1)/pyramid->biny[level];
+  }
+  return level;
+}
+int initMapPyramid(map_pyramid_definition *pyramid, float *cmap, long nrx, long nry, verbose_definition verbose)
+{
+  int level, i;
+  long tx, ty, cx, cy, fx, fy, childx, childy;
+  internal_map_pyramid_clear(pyramid);
+  pyramid->cmap = cmap;
+  pyramid->nrx = nrx;
+  pyramid->nry = nry;
+  pyramid->nrlevels = internal_map_pyramid_layout(pyramid);
+  pyramid->fingerprint = internal_map_pyramid_fingerprint(cmap, nrx, nry);
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("Building map pyramid with %d levels for a %ldx%ld map\n", pyramid->nrlevels, nrx, nry);
+  }
+  for(level = 1; level < pyramid->nrlevels; level++) {
+    if(internal_map_pyramid_allocate(pyramid, level, verbose) == 0) {
+      freeMapPyramid(pyramid);
+      return 0;
+    }
+    fx = pyramid->binx[level]/pyramid->binx[level-1];
+    fy = pyramid->biny[level]/pyramid->biny[level-1];
+#pragma omp parallel for private(tx, cx, cy, childx, childy)
+    for(ty = 0; ty < pyramid->levelnry[level]; ty++) {
+      for(tx = 0; tx < pyramid->levelnrx[level]; tx++) {
+ float vmin, vmax, value;
+ double sum, weight, npix;
+ long c, first;
+ first = 1;
+ vmin = vmax = 0;
+ sum = 0;
+ weight = 0;
+ for(cy = ty*fy; cy < (ty+1)*fy && cy < pyramid->levelnry[level-1]; cy++) {
+   for(cx = tx*fx; cx < (tx+1)*fx && cx < pyramid->levelnrx[level-1]; cx++) {
+     c = cy*pyramid->levelnrx[level-1]+cx;
+     childx = pyramid->nrx - cx*pyramid->binx[level-1];
+     if(childx > pyramid->binx[level-1])
+       childx = pyramid->binx[level-1];
+     childy = pyramid->nry - cy*pyramid->biny[level-1];
+     if(childy > pyramid->biny[level-1])
+       childy = pyramid->biny[level-1];
+     npix = childx*childy;
+     if(level == 1) {
+       value = cmap[c];
+       if(first || value < vmin)
+  vmin = value;
+       if(first || value > vmax)
+  vmax = value;
+     }else {
+       value = pyramid->mean[level-1][c];
+       if(first || pyramid->min[level-1][c] < vmin)
+  vmin = pyramid->min[level-1][c];
+       if(first || pyramid->max[level-1][c] > vmax)
+  vmax = pyramid->max[level-1][c];
+     }
+     first = 0;
+     sum += value*npix;
+     weight += npix;
+   }
+ }
+ pyramid->min[level][ty*pyramid->levelnrx[level]+tx] = vmin;
+ pyramid->max[level][ty*pyramid->levelnrx[level]+tx] = vmax;
+ pyramid->mean[level][ty*pyramid->levelnrx[level]+tx] = sum/weight;
+      }
+    }
+  }
+  return 1;
+}
+void freeMapPyramid(map_pyramid_definition *pyramid)
+{
+  int level;
+  for(level = 0; level < maxNrMapPyramidLevels; level++) {
+    if(pyramid->min[level] != NULL)
+      free(pyramid->min[level]);
+    if(pyramid->max[level] != NULL)
+      free(pyramid->max[level]);
+    if(pyramid->mean[level] != NULL)
+      free(pyramid->mean[level]);
+  }
+  internal_map_pyramid_clear(pyramid);
+}
+int mapPyramidSelectLevel(map_pyramid_definition *pyramid, long subset_nrx, long subset_nry, long npixx, long npixy)
+{
+  int level;
+  for(level = pyramid->nrlevels-1; level > 0; level--) {
+    if(subset_nrx/pyramid->binx[level] >= npixx && subset_nry/pyramid->biny[level] >= npixy)
+      return level;
+  }
+  return 0;
+}
+void internal_map_pyramid_range(map_pyramid_definition *pyramid, int level, long x0, long x1, long y0, long y1, float *min, float *max, int *first)
+{
+  long i, j, tx0, tx1, ty0, ty1, bx, by, ix0, ix1, iy0, iy1;
+  float *vmin, *vmax;
+  if(x0 > x1 || y0 > y1)
+    return;
+  if(level == 0) {
+    for(j = y0; j <= y1; j++) {
+      for(i = x0; i <= x1; i++) {
+ if(*first || pyramid->cmap[j*pyramid->nrx+i] < *min)
+   *min = pyramid->cmap[j*pyramid->nrx+i];
+ if(*first || pyramid->cmap[j*pyramid->nrx+i] > *max)
+   *max = pyramid->cmap[j*pyramid->nrx+i];
+ *first = 0;
+      }
+    }
+    return;
+  }
+  bx = pyramid->binx[level];
+  by = pyramid->biny[level];
+  tx0 = (x0 + bx - 1)/bx;
+  ty0 = (y0 + by - 1)/by;
+  tx1 = (x1 + 1)/bx - 1;
+  if(x1 == pyramid->nrx-1)
+    tx1 = pyramid->levelnrx[level]-1;
+  ty1 = (y1 + 1)/by - 1;
+  if(y1 == pyramid->nry-1)
+    ty1 = pyramid->levelnry[level]-1;
+  if(tx0 > tx1 || ty0 > ty1) {
+    internal_map_pyramid_range(pyramid, level-1, x0, x1, y0, y1, min, max, first);
+    return;
+  }
+  vmin = pyramid->min[level];
+  vmax = pyramid->max[level];
+  for(j = ty0; j <= ty1; j++) {
+    for(i = tx0; i <= tx1; i++) {
+      if(*first || vmin[j*pyramid->levelnrx[level]+i] < *min)
+ *min = vmin[j*pyramid->levelnrx[level]+i];
+      if(*first || vmax[j*pyramid->levelnrx[level]+i] > *max)
+ *max = vmax[j*pyramid->levelnrx[level]+i];
+      *first = 0;
+    }
+  }
+  ix0 = tx0*bx;
+  ix1 = (tx1+1)*bx-1;
+  if(ix1 > x1)
+    ix1 = x1;
+  iy0 = ty0*by;
+  iy1 = (ty1+1)*by-1;
+  if(iy1 > y1)
+    iy1 = y1;
+  internal_map_pyramid_range(pyramid, level-1, x0, x1, y0, iy0-1, min, max, first);
+  internal_map_pyramid_range(pyramid, level-1, x0, x1, iy1+1, y1, min, max, first);
+  internal_map_pyramid_range(pyramid, level-1, x0, ix0-1, iy0, iy1, min, max, first);
+  internal_map_pyramid_range(pyramid, level-1, ix1+1, x1, iy0, iy1, min, max, first);
+}
+int mapPyramidRange(map_pyramid_definition *pyramid, long x0, long x1, long y0, long y1, float *min, float *max)
+{
+  int first;
+  first = 1;
+  *min = *max = 0;
+  if(x0 < 0)
+    x0 = 0;
+  if(y0 < 0)
+    y0 = 0;
+  if(x1 >= pyramid->nrx)
+    x1 = pyramid->nrx-1;
+  if(y1 >= pyramid->nry)
+    y1 = pyramid->nry-1;
+  internal_map_pyramid_range(pyramid, pyramid->nrlevels-1, x0, x1, y0, y1, min, max, &first);
+  if(first)
+    return 0;
+  return 1;
+}
+int writeMapPyramid(map_pyramid_definition *pyramid, char *filename, verbose_definition verbose)
+{
+  FILE *fout;
+  int level, ok;
+  long n;
+  fout = fopen(filename, "wb");
+  if(fout == NULL) {
+    fflush(stdout);
+    printwarning(verbose.debug, "WARNING writeMapPyramid: Cannot open %s, map pyramid is not stored.", filename);
+    return 0;
+  }
+  ok = 1;
+  if(fwrite(MAP_PYRAMID_MAGIC, 1, strlen(MAP_PYRAMID_MAGIC)+1, fout) != strlen(MAP_PYRAMID_MAGIC)+1)
+    ok = 0;
+  if(fwrite(&(pyramid->nrx), sizeof(long), 1, fout) != 1 || fwrite(&(pyramid->nry), sizeof(long), 1, fout) != 1)
+    ok = 0;
+  if(fwrite(&(pyramid->nrlevels), sizeof(int), 1, fout) != 1 || fwrite(&(pyramid->fingerprint), sizeof(unsigned long long), 1, fout) != 1)
+    ok = 0;
+  for(level = 1; level < pyramid->nrlevels && ok; level++) {
+    n = pyramid->levelnrx[level]*pyramid->levelnry[level];
+    if(fwrite(pyramid->min[level], sizeof(float), n, fout) != n)
+      ok = 0;
+    if(fwrite(pyramid->max[level], sizeof(float), n, fout) != n)
+      ok = 0;
+    if(fwrite(pyramid->mean[level], sizeof(float), n, fout) != n)
+      ok = 0;
+  }
+  fclose(fout);
+  if(ok == 0) {
+    fflush(stdout);
+    printwarning(verbose.debug, "WARNING writeMapPyramid: Writing %s failed.", filename);
+    remove(filename);
+    return 0;
+  }
+  if(verbose.verbose) {
+    for(level = 0; level < verbose.indent; level++)
+      printf(" ");
+    printf("Map pyramid stored in %s\n", filename);
+  }
+  return 1;
+}
+int readMapPyramid(map_pyramid_definition *pyramid, float *cmap, long nrx, long nry, char *filename, verbose_definition verbose)
+{
+  FILE *fin;
+  char magic[100];
+  int level, nrlevels;
+  long n, filenrx, filenry;
+  unsigned long long fingerprint;
+  internal_map_pyramid_clear(pyramid);
+  fin = fopen(filename, "rb");
+  if(fin == NULL)
+    return 0;
+  n = strlen(MAP_PYRAMID_MAGIC)+1;
+  if(fread(magic, 1, n, fin) != n || strcmp(magic, MAP_PYRAMID_MAGIC) != 0) {
+    fclose(fin);
+    return 0;
+  }
+  if(fread(&filenrx, sizeof(long), 1, fin) != 1 || fread(&filenry, sizeof(long), 1, fin) != 1 || fread(&nrlevels, sizeof(int), 1, fin) != 1 || fread(&fingerprint, sizeof(unsigned long long), 1, fin) != 1) {
+    fclose(fin);
+    return 0;
+  }
+  pyramid->cmap = cmap;
+  pyramid->nrx = nrx;
+  pyramid->nry = nry;
+  pyramid->nrlevels = internal_map_pyramid_layout(pyramid);
+  pyramid->fingerprint = internal_map_pyramid_fingerprint(cmap, nrx, nry);
+  if(filenrx != nrx || filenry != nry || nrlevels != pyramid->nrlevels || fingerprint != pyramid->fingerprint) {
+    if(verbose.debug)
+      printf("readMapPyramid: %s does not match the data, ignoring it.\n", filename);
+    fclose(fin);
+    internal_map_pyramid_clear(pyramid);
+    return 0;
+  }
+  for(level = 1; level < pyramid->nrlevels; level++) {
+    if(internal_map_pyramid_allocate(pyramid, level, verbose) == 0) {
+      fclose(fin);
+      freeMapPyramid(pyramid);
+      return 0;
+    }
+    n = pyramid->levelnrx[level]*pyramid->levelnry[level];
+    if(fread(pyramid->min[level], sizeof(float), n, fin) != n || fread(pyramid->max[level], sizeof(float), n, fin) != n || fread(pyramid->mean[level], sizeof(float), n, fin) != n) {
+      fclose(fin);
+      freeMapPyramid(pyramid);
+      return 0;
+    }
+  }
+  fclose(fin);
+  if(verbose.verbose) {
+    for(level = 0; level < verbose.indent; level++)
+      printf(" ");
+    printf("Map pyramid loaded from %s\n", filename);
+  }
+  return 1;
+}
@@ -21,15 +21,38 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_min.h>
 #include "gsl/gsl_roots.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "psrsalsa.h"
-int minimize_1D_double_refine_borders(int findroot, double (*funk)(double, void *), void *params, int gridsearch, int investigateLocalMinima, double *x_lower, double *x_upper, int debug_verbose)
+void internal_minimize_1D_double_evaluate(double (*funk)(double, void *), void *params, long nrpoints, double *x, double *y, int parallel)
+{
+  long i;
+#pragma omp parallel for schedule(dynamic) if(parallel && nrpoints > 1)
+  for(i = 0; i < nrpoints; i++)
+    y[i] = funk(x[i], params);
+}
+int minimize_1D_double_refine_borders(int findroot, double (*funk)(double, void *), void *params, int gridsearch, int investigateLocalMinima, double *x_lower, double *x_upper, int debug_verbose, int parallel)
 {
-  double x, y, ymin[3], ymin_new[3], dy[3], ymax, x_lower_new, x_upper_new, sign_old, gridsearch_margin, imin_new[3], i_originalgrid, imin1, imin2;
-  int imin[3], unset[3], i, minima;
+  double x, y, ymin[3], ymin_new[3], dy[3], ymax, x_lower_new, x_upper_new, sign_old, gridsearch_margin, imin_new[3], i_originalgrid, imin1, imin2, *xgrid, *ygrid;
+  int imin[3], unset[3], i, minima, nrgrid;
+  xgrid = malloc((gridsearch > 200 ? gridsearch : 200)*sizeof(double));
+  ygrid = malloc((gridsearch > 200 ? gridsearch : 200)*sizeof(double));
+  if(xgrid == NULL || ygrid == NULL) {
+    fflush(stdout); fprintf(stderr, "minimize_1D_double_refine_borders: Memory allocation error\n");
+    return 4;
+  }
+  for(i = 0; i < gridsearch; i++)
+    xgrid[i] = *x_lower + i*(*x_upper - *x_lower)/(double)(gridsearch-1);
+  if(findroot == 0 || parallel)
+    internal_minimize_1D_double_evaluate(funk, params, gridsearch, xgrid, ygrid, parallel);
   unset[0] = unset[1] = unset[2] = 1;
   for(i = 0; i < gridsearch; i++) {
-    x = *x_lower + i*(*x_upper - *x_lower)/(double)(gridsearch-1);
-    y = funk(x, params);
+    x = xgrid[i];
+    if(findroot && parallel == 0)
+      y = funk(x, params);
+    else
+      y = ygrid[i];
     if(debug_verbose) {
       fflush(stdout); fprintf(stderr, "x=%f y=%f\n", x, y);
     }
@@ -116,8 +139,13 @@ int minimize_1D_double_refine_borders(int findroot, double (*funk)(double, void
  }
  unset[0] = unset[1] = unset[2] = 1;
  for(minima = 0; minima < 3; minima++) {
-   for(x = *x_lower + (imin[minima]-1.5)*(*x_upper - *x_lower)/(double)(gridsearch-1); x < *x_lower + (imin[minima]+1.5)*(*x_upper - *x_lower)/(double)(gridsearch-1); x += 0.09*(*x_upper - *x_lower)/(double)(gridsearch-1)) {
-     y = funk(x, params);
+   nrgrid = 0;
+   for(x = *x_lower + (imin[minima]-1.5)*(*x_upper - *x_lower)/(double)(gridsearch-1); x < *x_lower + (imin[minima]+1.5)*(*x_upper - *x_lower)/(double)(gridsearch-1) && nrgrid < 200; x += 0.09*(*x_upper - *x_lower)/(double)(gridsearch-1))
+     xgrid[nrgrid++] = x;
+   internal_minimize_1D_double_evaluate(funk, params, nrgrid, xgrid, ygrid, parallel);
+   for(i = 0; i < nrgrid; i++) {
+     x = xgrid[i];
+     y = ygrid[i];
      if(debug_verbose) {
        fflush(stdout); fprintf(stderr, "x=%f y=%f\n", x, y);
      }
@@ -157,6 +185,8 @@ int minimize_1D_double_refine_borders(int findroot, double (*funk)(double, void
       }
     }
   }
+  free(xgrid);
+  free(ygrid);
   gridsearch_margin = 0.1*(double)gridsearch;
   if(gridsearch_margin < 1)
     gridsearch_margin = 1;
@@ -176,7 +206,7 @@ int minimize_1D_double_refine_borders(int findroot, double (*funk)(double, void
   }
   return 0;
 }
-int minimize_1D_double(int findroot, double (*funk)(double, void *), void *params, double x_lower, double x_upper, int gridsearch, int investigateLocalMinima, int nested, double *x_minimum, int max_iter, double epsabs, double epsrel, int verbose, int debug_verbose)
+int internal_minimize_1D_double(int findroot, double (*funk)(double, void *), void *params, double x_lower, double x_upper, int gridsearch, int investigateLocalMinima, int nested, double *x_minimum, int max_iter, double epsabs, double epsrel, int verbose, int debug_verbose, int parallel)
 {
   const gsl_min_fminimizer_type *T_minimizer;
   gsl_min_fminimizer *s_minimizer;
@@ -207,7 +237,7 @@ int minimize_1D_double(int findroot, double (*funk)(double, void *), void *param
       printf("  Refining boundaries with a %d point grid search\n", gridsearch);
     }
     for(nest = 0; nest < 1+nested; nest++) {
-      ret = minimize_1D_double_refine_borders(findroot, funk, params, gridsearch, investigateLocalMinima, &x_lower, &x_upper, debug_verbose);
+      ret = minimize_1D_double_refine_borders(findroot, funk, params, gridsearch, investigateLocalMinima, &x_lower, &x_upper, debug_verbose, parallel);
       if(ret != 0) {
  if(ret == 1) {
    if(verbose) {
@@ -292,22 +322,36 @@ int minimize_1D_double(int findroot, double (*funk)(double, void *), void *param
   }
   return status;
 }
-double (*internal_funk_provided_by_user)(double *, void *);
-int internal_paramnr;
-double *internal_xminimum;
-double internal_desired_chi2;
+int minimize_1D_double(int findroot, double (*funk)(double, void *), void *params, double x_lower, double x_upper, int gridsearch, int investigateLocalMinima, int nested, double *x_minimum, int max_iter, double epsabs, double epsrel, int verbose, int debug_verbose)
+{
+  return internal_minimize_1D_double(findroot, funk, params, x_lower, x_upper, gridsearch, investigateLocalMinima, nested, x_minimum, max_iter, epsabs, epsrel, verbose, debug_verbose, 0);
+}
+int minimize_1D_double_ctx(int findroot, double (*funk)(double, void *), void *params, double x_lower, double x_upper, int gridsearch, int investigateLocalMinima, int nested, double *x_minimum, int max_iter, double epsabs, double epsrel, int verbose, int debug_verbose)
+{
+  return internal_minimize_1D_double(findroot, funk, params, x_lower, x_upper, gridsearch, investigateLocalMinima, nested, x_minimum, max_iter, epsabs, epsrel, verbose, debug_verbose, 1);
+}
+typedef struct {
+  double (*funk)(double *, void *);
+  void *params;
+  int paramnr;
+  double *xminimum;
+  double desired_chi2;
+}internal_find_1D_error_context;
 double internal_find_1D_error_funk(double x, void *params)
 {
   double chi2;
-  internal_xminimum[internal_paramnr] = x;
-  chi2 = internal_funk_provided_by_user(internal_xminimum, params);
-  chi2 -= internal_desired_chi2;
+  internal_find_1D_error_context *context;
+  context = (internal_find_1D_error_context *)params;
+  context->xminimum[context->paramnr] = x;
+  chi2 = context->funk(context->xminimum, context->params);
+  chi2 -= context->desired_chi2;
   return chi2;
 }
-int find_1D_error(double (*funk)(double *, void *), double *xminimum, int paramnr, int nrparameters, double dx, double dxmax, void *params, double sigma, double chi2min, int max_itr, double epsabs, double epsrel, double *errorbar, int verbose)
+int internal_find_1D_error(double (*funk)(double *, void *), double *xminimum, int paramnr, int nrparameters, double dx, double dxmax, void *params, double sigma, double chi2min, int max_itr, double epsabs, double epsrel, double *errorbar, int verbose, int parallel)
 {
-  int ittr, i, ret, debug_verbose;
-  double x_lower, x_upper, diff, xval, *xminimum_fiddle;
+  int ittr, i, ret, debug_verbose, batch, j, found;
+  double x_lower, x_upper, diff, xval, *xminimum_fiddle, *xcandidate, *diffcandidate;
+  internal_find_1D_error_context context, *contextcandidate;
   debug_verbose = 0;
   dx = fabs(dx);
   if(verbose) {
@@ -315,66 +359,98 @@ int find_1D_error(double (*funk)(double *, void *), double *xminimum, int paramn
       printf(" ");
     printf("Finding error at value %f with stepsize %f\n", xminimum[paramnr], dx);
   }
-  xminimum_fiddle = malloc(nrparameters*sizeof(double));
-  if(xminimum_fiddle == NULL) {
+  batch = 1;
+#ifdef _OPENMP
+  if(parallel && omp_in_parallel() == 0)
+    batch = omp_get_max_threads();
+#endif
+  xminimum_fiddle = malloc((batch+1)*nrparameters*sizeof(double));
+  xcandidate = malloc(batch*sizeof(double));
+  diffcandidate = malloc(batch*sizeof(double));
+  contextcandidate = malloc(batch*sizeof(internal_find_1D_error_context));
+  if(xminimum_fiddle == NULL || xcandidate == NULL || diffcandidate == NULL || contextcandidate == NULL) {
     fflush(stdout);
     fprintf(stderr, "ERROR find_1D_error: Memory allocation error\n");
     return 4;
   }
-  memcpy(xminimum_fiddle, xminimum, nrparameters*sizeof(double));
-  internal_paramnr = paramnr;
-  internal_xminimum = xminimum_fiddle;
-  internal_funk_provided_by_user = funk;
-  internal_desired_chi2 = chi2min*(1+fabs(sigma));
+  for(j = 0; j <= batch; j++)
+    memcpy(xminimum_fiddle+j*nrparameters, xminimum, nrparameters*sizeof(double));
+  context.paramnr = paramnr;
+  context.xminimum = xminimum_fiddle;
+  context.funk = funk;
+  context.params = params;
+  context.desired_chi2 = chi2min*(1+fabs(sigma));
+  for(j = 0; j < batch; j++) {
+    contextcandidate[j] = context;
+    contextcandidate[j].xminimum = xminimum_fiddle+(j+1)*nrparameters;
+  }
   if(verbose) {
     for(i = 0; i < verbose - 1; i++)
       printf(" ");
-    printf("  Mimimum chi2 = %f, so %f sigma point corresponds to %f\n", chi2min, fabs(sigma), internal_desired_chi2);
+    printf("  Mimimum chi2 = %f, so %f sigma point corresponds to %f\n", chi2min, fabs(sigma), context.desired_chi2);
   }
   x_lower = xminimum[paramnr];
   x_upper = xminimum[paramnr];
   ittr = 0;
-  diff = internal_find_1D_error_funk(x_upper, params);
+  diff = internal_find_1D_error_funk(x_upper, &context);
   if(diff > 0) {
     fflush(stdout);
-    fprintf(stderr, "ERROR find_1D_error: Function called with initial parameters outside specified sigma limit: chi2 = %f higher than sigma border (%f).\n", diff, internal_desired_chi2);
+    fprintf(stderr, "ERROR find_1D_error: Function called with initial parameters outside specified sigma limit: chi2 = %f higher than sigma border (%f).\n", diff, context.desired_chi2);
     exit(0);
   }
+  found = 0;
   do {
-    if(sigma >= 0) {
-      x_upper += dx;
+    for(j = 0; j < batch; j++) {
+      if(sigma >= 0)
+ xcandidate[j] = (j == 0 ? x_upper : xcandidate[j-1]) + dx;
+      else
+ xcandidate[j] = (j == 0 ? x_lower : xcandidate[j-1]) - dx;
+    }
+#pragma omp parallel for schedule(static) if(batch > 1)
+    for(j = 0; j < batch; j++) {
+      if(dxmax < 0 || fabs(xcandidate[j] - xminimum[paramnr]) <= dxmax)
+ diffcandidate[j] = internal_find_1D_error_funk(xcandidate[j], &contextcandidate[j]);
+    }
+    for(j = 0; j < batch; j++) {
+      if(sigma >= 0)
+ x_upper = xcandidate[j];
+      else
+ x_lower = xcandidate[j];
       if(dxmax >= 0) {
- if(fabs(x_upper - xminimum[paramnr]) > dxmax) {
+ if(fabs(xcandidate[j] - xminimum[paramnr]) > dxmax) {
    *errorbar = dxmax;
    free(xminimum_fiddle);
+   free(xcandidate);
+   free(diffcandidate);
+   free(contextcandidate);
    return 0;
  }
       }
-      diff = internal_find_1D_error_funk(x_upper, params);
-    }else {
-      x_lower -= dx;
-      if(dxmax >= 0) {
- if(fabs(x_lower - xminimum[paramnr]) > dxmax) {
-   *errorbar = dxmax;
-   free(xminimum_fiddle);
-   return 0;
- }
+      diff = diffcandidate[j];
+      ittr++;
+      if(ittr == max_itr) {
+ free(xminimum_fiddle);
+ free(xcandidate);
+ free(diffcandidate);
+ free(contextcandidate);
+ return 1;
+      }
+      if(diff >= 0) {
+ found = 1;
+ break;
       }
-      diff = internal_find_1D_error_funk(x_lower, params);
-    }
-    ittr++;
-    if(ittr == max_itr) {
-      free(xminimum_fiddle);
-      return 1;
     }
-  }while(diff < 0);
+  }while(found == 0);
+  free(xcandidate);
+  free(diffcandidate);
+  free(contextcandidate);
   if(verbose) {
     for(i = 0; i < verbose - 1; i++)
       printf(" ");
     printf("  Found brackets: [%f %f]\n", x_lower, x_upper);
     verbose += 2;
   }
-  ret = minimize_1D_double(1, internal_find_1D_error_funk, params, x_lower, x_upper, 0, 0, 0, &xval, max_itr, epsabs, epsrel, verbose, debug_verbose);
+  ret = minimize_1D_double(1, internal_find_1D_error_funk, &context, x_lower, x_upper, 0, 0, 0, &xval, max_itr, epsabs, epsrel, verbose, debug_verbose);
   *errorbar = fabs(xval - xminimum[paramnr]);
   if(verbose) {
     verbose -= 2;
@@ -396,3 +472,11 @@ int find_1D_error(double (*funk)(double *, void *), double *xminimum, int paramn
   free(xminimum_fiddle);
   return ret;
 }
+int find_1D_error(double (*funk)(double *, void *), double *xminimum, int paramnr, int nrparameters, double dx, double dxmax, void *params, double sigma, double chi2min, int max_itr, double epsabs, double epsrel, double *errorbar, int verbose)
+{
+  return internal_find_1D_error(funk, xminimum, paramnr, nrparameters, dx, dxmax, params, sigma, chi2min, max_itr, epsabs, epsrel, errorbar, verbose, 0);
+}
+int find_1D_error_ctx(double (*funk)(double *, void *), double *xminimum, int paramnr, int nrparameters, double dx, double dxmax, void *params, double sigma, double chi2min, int max_itr, double epsabs, double epsrel, double *errorbar, int verbose)
+{
+  return internal_find_1D_error(funk, xminimum, paramnr, nrparameters, dx, dxmax, params, sigma, chi2min, max_itr, epsabs, epsrel, errorbar, verbose, 1);
+}
@@ -27,6 +27,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <fcntl.h>
 #include <errno.h>
 #include <math.h>
+int internal_myio_errorprinted;
 int pgetch(void)
 {
   char ch;
@@ -577,6 +578,96 @@ int read_ascii_column_double(char *fname, int skiplines, char skipChar, int nrCo
     *avdata = sumx/(double)(*nrdatapoints);
   return 1;
 }
+int read_ascii_column_sketch(char *fname, int skiplines, char skipChar, int colnum, double scale, int read_log, quantile_sketch_definition *sketch, verbose_definition verbose, int verbose_stderr)
+{
+  FILE *fin, *verbose_stream;
+  long i, n, maxlinelength, linenr;
+  int nrwords, ret;
+  char *txt, *word_ptr;
+  double value;
+  maxlinelength = 10240+1;
+  if(verbose_stderr) {
+    fflush(stdout);
+    verbose_stream = stderr;
+  }else {
+    verbose_stream = stdout;
+  }
+  fin = fopen(fname, "r");
+  if(fin == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "read_ascii_column_sketch: Cannot open %s", fname);
+    return 0;
+  }else {
+    if(verbose.verbose) {
+      for(i = 0; i < verbose.indent; i++)
+ printf(" ");
+      fflush(stdout);
+      fprintf(verbose_stream, "Opened file '%s'\n", fname);
+    }
+  }
+  if(skipLinesInFile(fin, skiplines, verbose) == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "read_ascii_column_sketch: Reached EOF while skipping first %d lines", skiplines);
+    fclose(fin);
+    return 0;
+  }
+  txt = malloc(maxlinelength);
+  if(txt == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "read_ascii_column_sketch: Cannot allocate temporary memory");
+    fclose(fin);
+    return 0;
+  }
+  n = 0;
+  linenr = 0;
+  do {
+    ret = ascii_file_get_next_line(fin, txt, maxlinelength, skipChar, verbose);
+    if(ret != 0) {
+      linenr += ret;
+      word_ptr = pickWordFromString(txt, colnum, &nrwords, 1, ' ', verbose);
+      if(word_ptr == NULL) {
+ fflush(stdout);
+ printerror(verbose.debug, "read_ascii_column_sketch: Cannot find column %d on line %ld", colnum, linenr);
+ free(txt);
+ fclose(fin);
+ return 0;
+      }
+      if(sscanf(word_ptr, "%lf", &value) != 1) {
+ fflush(stdout);
+ printerror(verbose.debug, "read_ascii_column_sketch: Cannot interpret column %d on line %ld as a double", colnum, linenr);
+ free(txt);
+ fclose(fin);
+ return 0;
+      }
+      value *= scale;
+      if(read_log) {
+ if(value <= 0) {
+   printerror(verbose.debug, "read_ascii_column_sketch: Cannot take logarithm of a value <= 0");
+   free(txt);
+   fclose(fin);
+   return 0;
+ }
+ value = log10(value);
+      }
+      if(add_quantile_sketch(sketch, value, verbose) == 0) {
+ free(txt);
+ fclose(fin);
+ return 0;
+      }
+      n++;
+    }
+  }while(ret != 0);
+  free(txt);
+  fclose(fin);
+  if(verbose.verbose) {
+    fflush(stdout);
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    fflush(stdout);
+    fprintf(verbose_stream, "  %ld points streamed from %s with values between %lf and %lf\n", n, fname, sketch->min, sketch->max);
+  }
+  return 1;
+}
 int read_ascii_column_int(char *fname, int skiplines, char skipChar, int nrColumns, int autoNrColumns, long *nrdatapoints, int colnum, int **data, int *mindata, int *maxdata, double *avdata, verbose_definition verbose, int verbose_stderr)
 {
   FILE *fin, *verbose_stream;
@@ -859,6 +950,8 @@ char *str_replace(char *orig, char *rep, char *with, verbose_definition verbose)
 void fprintf_color(FILE *destination, int color, const char *format, ...)
 {
   va_list args;
+  if(color == 2)
+    internal_myio_errorprinted = 1;
   if(isatty(fileno(destination))) {
     switch(color) {
     case 2: fprintf(destination, "\x1B[31m"); break;
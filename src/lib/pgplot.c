@@ -25,6 +25,7 @@ static double internal_pgplot_ymin = 0;
 static double internal_pgplot_ymax = 1;
 static int internal_pgplot_nrx = 1;
 static int internal_pgplot_nry = 1;
+static map_pyramid_definition *internal_pgplot_pyramid = NULL;
 void print_pgplot_version_used(FILE *stream)
 {
   char version[25];
@@ -86,6 +87,10 @@ void pgplotMapCoordinateBinSize(float *dx, float *dy)
   *dx = (internal_pgplot_xmax-internal_pgplot_xmin)/((double)internal_pgplot_nrx-1.0);
   *dy = (internal_pgplot_ymax-internal_pgplot_ymin)/((double)internal_pgplot_nry-1.0);
 }
+void pgplotMapPyramid(map_pyramid_definition *pyramid)
+{
+  internal_pgplot_pyramid = pyramid;
+}
 void pgplot_setWindowsize(int windowwidth, int windowheight, float aspectratio)
 {
   float x, y;
@@ -1172,8 +1177,15 @@ int pgplotMap(pgplot_options_definition *pgplot, float *cmap, int nrx, int nry,
   float *collapse, x, y, remember2_x1, remember2_x2, remember2_y1, remember2_y2;
   int i, j, deviceID, firstc, lastc, firstpoint;
   float junk_f, lasty;
+  int usepyramid, pyramidlevel;
   pgplot_frame_def_internal pgplot_frame_internal;
   pgplot_options_definition *pgplot_backup;
+  usepyramid = 0;
+  pyramidlevel = 0;
+  if(internal_pgplot_pyramid != NULL && showTwice == 0) {
+    if(internal_pgplot_pyramid->cmap == cmap && internal_pgplot_pyramid->nrx == nrx && internal_pgplot_pyramid->nry == nry)
+      usepyramid = 1;
+  }
   pgplot_backup = (pgplot_options_definition *)malloc(sizeof(pgplot_options_definition));
   if(pgplot_backup == NULL) {
     printerror(verbose.debug, "ERROR pgplotMap: Memory allocation error");
@@ -1233,18 +1245,42 @@ int pgplotMap(pgplot_options_definition *pgplot, float *cmap, int nrx, int nry,
   pgplot_makeframe(&pgplot_frame_internal);
   firstpoint = 1;
   datamin = datamax = 0;
-  for(i = 0; i < nrx; i++) {
-    for(j = 0; j <nry; j++) {
-      pgplotMapCoordinateInverse(&x, &y, i, j);
-      if(x >= xminshow && x <= xmaxshow && y >= yminshow && y <= ymaxshow) {
- if(firstpoint) {
-   datamin = datamax = cmap[j*nrx+i];
-   firstpoint = 0;
- }
- if(cmap[j*nrx+i] > datamax)
-   datamax = cmap[j*nrx+i];
- if(cmap[j*nrx+i] < datamin) {
-   datamin = cmap[j*nrx+i];
+  if(usepyramid) {
+    int range_x0, range_x1, range_y0, range_y1;
+    range_x0 = range_y0 = -1;
+    range_x1 = range_y1 = -2;
+    for(i = 0; i < nrx; i++) {
+      pgplotMapCoordinateInverse(&x, &y, i, 0);
+      if(x >= xminshow && x <= xmaxshow) {
+ if(range_x0 < 0)
+   range_x0 = i;
+ range_x1 = i;
+      }
+    }
+    for(j = 0; j < nry; j++) {
+      pgplotMapCoordinateInverse(&x, &y, 0, j);
+      if(y >= yminshow && y <= ymaxshow) {
+ if(range_y0 < 0)
+   range_y0 = j;
+ range_y1 = j;
+      }
+    }
+    if(range_x0 >= 0 && range_y0 >= 0)
+      mapPyramidRange(internal_pgplot_pyramid, range_x0, range_x1, range_y0, range_y1, &datamin, &datamax);
+  }else {
+    for(i = 0; i < nrx; i++) {
+      for(j = 0; j <nry; j++) {
+ pgplotMapCoordinateInverse(&x, &y, i, j);
+ if(x >= xminshow && x <= xmaxshow && y >= yminshow && y <= ymaxshow) {
+   if(firstpoint) {
+     datamin = datamax = cmap[j*nrx+i];
+     firstpoint = 0;
+   }
+   if(cmap[j*nrx+i] > datamax)
+     datamax = cmap[j*nrx+i];
+   if(cmap[j*nrx+i] < datamin) {
+     datamin = cmap[j*nrx+i];
+   }
  }
       }
     }
@@ -1276,10 +1312,10 @@ int pgplotMap(pgplot_options_definition *pgplot, float *cmap, int nrx, int nry,
     free(pgplot_backup);
     return 0;
   }
-  int subset_nrx, subset_nry, subset_extrabefore, subset_extraafter;
+  int subset_nrx, subset_nry, subset_extrabefore, subset_extraafter, subset_x0, subset_y0;
   float *cmap_subset;
+  subset_x0 = subset_y0 = 0;
   if(plotSubset) {
-    int subset_x0, subset_y0;
     subset_extrabefore = 1;
     subset_extraafter = 1;
     subset_x0 = (nrx-1)*(xminshow - xmin)/(xmax-xmin)-1;
@@ -1308,16 +1344,56 @@ int pgplotMap(pgplot_options_definition *pgplot, float *cmap, int nrx, int nry,
     if(subset_nrx == nrx && subset_nry == nry && subset_y0 == 0 && subset_x0 == 0)
       plotSubset = 0;
     if(verbose.debug && plotSubset) printf("pgplotMap -- changed to: %dX%d points  startx=%d starty=%d\n", subset_nrx, subset_nry, subset_x0, subset_y0);
-    if(plotSubset) {
-      cmap_subset = (float *)malloc(subset_nrx*subset_nry*sizeof(float));
-      if(cmap_subset == NULL) {
- fflush(stdout);
- printwarning(verbose.debug, "WARNING pgplotMap: Cannot allocate memory to plot subset of the map");
- if(verbose.debug) {
-   printwarning(verbose.debug, "Tried to allocate %ld x %ld floating points", subset_nrx, subset_nry);
- }
- plotSubset = 0;
+  }
+  if(plotSubset == 0) {
+    subset_x0 = 0;
+    subset_y0 = 0;
+    subset_nrx = nrx;
+    subset_nry = nry;
+  }
+  if(usepyramid) {
+    float vp_x1, vp_x2, vp_y1, vp_y2;
+    ppgqvp(3, &vp_x1, &vp_x2, &vp_y1, &vp_y2);
+    pyramidlevel = mapPyramidSelectLevel(internal_pgplot_pyramid, subset_nrx, subset_nry, fabs(vp_x2-vp_x1), fabs(vp_y2-vp_y1));
+  }
+  if(pyramidlevel > 0) {
+    long tile_x0, tile_y0, bx, by;
+    bx = internal_pgplot_pyramid->binx[pyramidlevel];
+    by = internal_pgplot_pyramid->biny[pyramidlevel];
+    tile_x0 = subset_x0/bx;
+    tile_y0 = subset_y0/by;
+    subset_nrx = (subset_x0+subset_nrx-1)/bx - tile_x0 + 1;
+    subset_nry = (subset_y0+subset_nry-1)/by - tile_y0 + 1;
+    if(verbose.debug) printf("pgplotMap -- using pyramid level %d: %dX%d points\n", pyramidlevel, subset_nrx, subset_nry);
+    cmap_subset = (float *)malloc(subset_nrx*subset_nry*sizeof(float));
+    if(cmap_subset == NULL) {
+      fflush(stdout);
+      printwarning(verbose.debug, "WARNING pgplotMap: Cannot allocate memory to plot subset of the map");
+      pyramidlevel = 0;
+      subset_nrx = nrx;
+      subset_nry = nry;
+      plotSubset = 0;
+    }else {
+      for(j = 0; j < subset_nry; j++) {
+ memcpy(&cmap_subset[j*subset_nrx], &(internal_pgplot_pyramid->mean[pyramidlevel][(j+tile_y0)*internal_pgplot_pyramid->levelnrx[pyramidlevel]+tile_x0]), subset_nrx*sizeof(float));
       }
+      pgplot_frame_internal.TR[0] += pgplot_frame_internal.TR[1]*(tile_x0*bx - 0.5*(bx-1));
+      pgplot_frame_internal.TR[1] *= bx;
+      pgplot_frame_internal.TR[3] += pgplot_frame_internal.TR[5]*(tile_y0*by - 0.5*(by-1));
+      pgplot_frame_internal.TR[5] *= by;
+      subset_extrabefore = 0;
+      subset_extraafter = 0;
+      plotSubset = 1;
+    }
+  }else if(plotSubset) {
+    cmap_subset = (float *)malloc(subset_nrx*subset_nry*sizeof(float));
+    if(cmap_subset == NULL) {
+      fflush(stdout);
+      printwarning(verbose.debug, "WARNING pgplotMap: Cannot allocate memory to plot subset of the map");
+      if(verbose.debug) {
+ printwarning(verbose.debug, "Tried to allocate %ld x %ld floating points", subset_nrx, subset_nry);
+      }
+      plotSubset = 0;
     }
     if(plotSubset) {
       for(i = 0; i < subset_nrx; i++) {
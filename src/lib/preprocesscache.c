@@ -0,0 +1,479 @@
+/*
+Copyright (c) 2015, Patrick Weltevrede
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "psrsalsa.h"
+#define PREPROCESS_CACHE_VERSION 3
+#define PREPROCESS_CACHE_PREFIX "psrsalsa_"
+#define PREPROCESS_CACHE_EXTENSION ".cache"
+#define PREPROCESS_CACHE_KEY_ID "PPCKEY01"
+#ifndef PSRSALSA_BUILDSTAMP
+#define PSRSALSA_BUILDSTAMP __DATE__ " " __TIME__
+#endif
+int internal_statsindex_filekey(char *filename, long long *size, long long *mtime, unsigned long long *checksum);
+void internal_preprocesscache_hash(unsigned long long *hash, void *ptr, size_t nrbytes)
+{
+  size_t i;
+  unsigned char *bytes;
+  bytes = (unsigned char *)ptr;
+  for(i = 0; i < nrbytes; i++) {
+    *hash ^= bytes[i];
+    *hash *= 1099511628211ULL;
+  }
+}
+void internal_preprocesscache_add(preprocesscache_definition *cache, void *ptr, size_t nrbytes)
+{
+  unsigned char *newkey;
+  if(cache->keysize < 0)
+    return;
+  newkey = (unsigned char *)realloc(cache->key, cache->keysize+nrbytes);
+  if(newkey == NULL) {
+    free(cache->key);
+    cache->key = NULL;
+    cache->keysize = -1;
+    return;
+  }
+  cache->key = newkey;
+  memcpy(cache->key+cache->keysize, ptr, nrbytes);
+  cache->keysize += nrbytes;
+}
+void internal_preprocesscache_addstring(preprocesscache_definition *cache, char *txt)
+{
+  if(txt != NULL)
+    internal_preprocesscache_add(cache, txt, strlen(txt)+1);
+  else
+    internal_preprocesscache_add(cache, "", 1);
+}
+void freePreprocessCache(preprocesscache_definition *cache)
+{
+  if(cache->key != NULL)
+    free(cache->key);
+  cache->key = NULL;
+  cache->keysize = 0;
+}
+int internal_preprocesscache_key(psrsalsaApplication *application, datafile_definition *psrdata, preprocesscache_definition *cache, unsigned long long *hash)
+{
+  int version, i;
+  long long size, mtime;
+  unsigned long long checksum, datahash;
+  if(application->doconcat || application->doalign || application->doonpulsegr || psrdata->packedbits || psrdata->format != MEMORY_format || psrdata->data == NULL)
+    return 0;
+  if(application->doshuffle && application->fixseed == 0)
+    return 0;
+  if(preprocessRequestedApplication(application) == 0)
+    return 0;
+  if(internal_statsindex_filekey(psrdata->filename, &size, &mtime, &checksum) == 0)
+    return 0;
+  freePreprocessCache(cache);
+  version = PREPROCESS_CACHE_VERSION;
+  internal_preprocesscache_add(cache, &version, sizeof(int));
+  internal_preprocesscache_addstring(cache, PSRSALSA_BUILDSTAMP);
+  internal_preprocesscache_add(cache, &size, sizeof(long long));
+  internal_preprocesscache_add(cache, &mtime, sizeof(long long));
+  internal_preprocesscache_add(cache, &checksum, sizeof(unsigned long long));
+  datahash = 14695981039346656037ULL;
+  internal_preprocesscache_hash(&datahash, psrdata->data, psrdata->NrSubints*psrdata->NrPols*psrdata->NrFreqChan*psrdata->NrBins*sizeof(float));
+  internal_preprocesscache_add(cache, &datahash, sizeof(unsigned long long));
+  internal_preprocesscache_addstring(cache, psrdata->psrname);
+  internal_preprocesscache_add(cache, &(psrdata->NrSubints), sizeof(long));
+  internal_preprocesscache_add(cache, &(psrdata->NrBins), sizeof(long));
+  internal_preprocesscache_add(cache, &(psrdata->NrPols), sizeof(long));
+  internal_preprocesscache_add(cache, &(psrdata->NrFreqChan), sizeof(long));
+  internal_preprocesscache_add(cache, &(psrdata->poltype), sizeof(int));
+  internal_preprocesscache_add(cache, &(psrdata->gentype), sizeof(int));
+  internal_preprocesscache_add(cache, &(psrdata->feedtype), sizeof(int));
+  internal_preprocesscache_add(cache, &(psrdata->isDeDisp), sizeof(char));
+  internal_preprocesscache_add(cache, &(psrdata->isDeFarad), sizeof(char));
+  internal_preprocesscache_add(cache, &(psrdata->isDePar), sizeof(char));
+  internal_preprocesscache_add(cache, &(psrdata->isDebase), sizeof(char));
+  internal_preprocesscache_add(cache, &(psrdata->dm), sizeof(double));
+  internal_preprocesscache_add(cache, &(psrdata->rm), sizeof(double));
+  internal_preprocesscache_add(cache, &(psrdata->freq_ref), sizeof(double));
+  internal_preprocesscache_add(cache, &(psrdata->fixedPeriod), sizeof(double));
+  internal_preprocesscache_add(cache, &(psrdata->fixedtsamp), sizeof(double));
+  internal_preprocesscache_add(cache, &(psrdata->centrefreq), sizeof(double));
+  internal_preprocesscache_add(cache, &(psrdata->bandwidth), sizeof(double));
+  internal_preprocesscache_add(cache, &(psrdata->ra), sizeof(double));
+  internal_preprocesscache_add(cache, &(psrdata->dec), sizeof(double));
+  internal_preprocesscache_add(cache, &(psrdata->mjd_start), sizeof(long double));
+  internal_preprocesscache_add(cache, &(application->nskip), sizeof(long));
+  internal_preprocesscache_add(cache, &(application->nread), sizeof(long));
+  internal_preprocesscache_add(cache, &(application->dostokes), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->docoherence), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->nr_rotateStokes), sizeof(int));
+  for(i = 0; i < application->nr_rotateStokes; i++) {
+    internal_preprocesscache_add(cache, &(application->rotateStokes1[i]), sizeof(int));
+    internal_preprocesscache_add(cache, &(application->rotateStokes2[i]), sizeof(int));
+    internal_preprocesscache_add(cache, &(application->rotateStokesAngle[i]), sizeof(float));
+  }
+  internal_preprocesscache_add(cache, &(application->do_parang_corr), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->blocksize), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->fchan_select), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->polselectnr), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->newRefFreq), sizeof(double));
+  internal_preprocesscache_add(cache, &(application->doFSCR), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->dofscr), sizeof(long));
+  internal_preprocesscache_add(cache, &(application->do_dedisperse), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->do_deFaraday), sizeof(int));
+  if(application->fzapMask != NULL && (application->dofscr || application->doFSCR))
+    internal_preprocesscache_add(cache, application->fzapMask, psrdata->NrFreqChan*sizeof(int));
+  internal_preprocesscache_add(cache, &(application->doTSCR), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->dotscr), sizeof(long));
+  internal_preprocesscache_add(cache, &(application->tscr_complete), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->doshiftphase), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->shiftPhase), sizeof(float));
+  internal_preprocesscache_add(cache, &(application->doconshift), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->docircshift), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->dorebin), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->rebin), sizeof(long));
+  internal_preprocesscache_add(cache, &(application->dodebase), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->do_norm), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->do_normglobal), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->normvalue), sizeof(float));
+  internal_preprocesscache_add(cache, &(application->do_clip), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->clipvalue), sizeof(float));
+  internal_preprocesscache_add(cache, &(application->doscale), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->scale_scale), sizeof(float));
+  internal_preprocesscache_add(cache, &(application->scale_offset), sizeof(float));
+  internal_preprocesscache_add(cache, &(application->doshuffle), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->fixseed), sizeof(int));
+  internal_preprocesscache_add(cache, &(application->onpulse.nrRegions), sizeof(int));
+  for(i = 0; i < application->onpulse.nrRegions; i++) {
+    internal_preprocesscache_add(cache, &(application->onpulse.bins_defined[i]), sizeof(int));
+    internal_preprocesscache_add(cache, &(application->onpulse.left_bin[i]), sizeof(int));
+    internal_preprocesscache_add(cache, &(application->onpulse.right_bin[i]), sizeof(int));
+    internal_preprocesscache_add(cache, &(application->onpulse.frac_defined[i]), sizeof(int));
+    internal_preprocesscache_add(cache, &(application->onpulse.left_frac[i]), sizeof(float));
+    internal_preprocesscache_add(cache, &(application->onpulse.right_frac[i]), sizeof(float));
+  }
+  if(cache->keysize <= 0)
+    return 0;
+  *hash = 14695981039346656037ULL;
+  internal_preprocesscache_hash(hash, cache->key, cache->keysize);
+  return 1;
+}
+void internal_preprocesscache_evict(char *cachedir, long long maxbytes, verbose_definition verbose)
+{
+  DIR *dir;
+  struct dirent *entry;
+  struct stat filestat;
+  char **names, filename[MaxFilenameLength];
+  time_t *lastused;
+  long long *sizes, total;
+  long nrfiles, maxnrfiles, i, oldest;
+  size_t len;
+  dir = opendir(cachedir);
+  if(dir == NULL)
+    return;
+  names = NULL;
+  lastused = NULL;
+  sizes = NULL;
+  nrfiles = maxnrfiles = 0;
+  total = 0;
+  while((entry = readdir(dir)) != NULL) {
+    len = strlen(entry->d_name);
+    if(strncmp(entry->d_name, PREPROCESS_CACHE_PREFIX, strlen(PREPROCESS_CACHE_PREFIX)) != 0 || len <= strlen(PREPROCESS_CACHE_EXTENSION) || strcmp(entry->d_name+len-strlen(PREPROCESS_CACHE_EXTENSION), PREPROCESS_CACHE_EXTENSION) != 0)
+      continue;
+    snprintf(filename, MaxFilenameLength, "%s/%s", cachedir, entry->d_name);
+    if(stat(filename, &filestat) != 0)
+      continue;
+    if(nrfiles == maxnrfiles) {
+      maxnrfiles = 2*maxnrfiles+16;
+      names = (char **)realloc(names, maxnrfiles*sizeof(char *));
+      lastused = (time_t *)realloc(lastused, maxnrfiles*sizeof(time_t));
+      sizes = (long long *)realloc(sizes, maxnrfiles*sizeof(long long));
+      if(names == NULL || lastused == NULL || sizes == NULL) {
+ fflush(stdout);
+ printwarning(verbose.debug, "WARNING preprocessCacheStore: Memory allocation error, cache is not trimmed.");
+ closedir(dir);
+ return;
+      }
+    }
+    names[nrfiles] = strdup(filename);
+    if(names[nrfiles] == NULL)
+      continue;
+    lastused[nrfiles] = filestat.st_mtime;
+    sizes[nrfiles] = filestat.st_size;
+    total += sizes[nrfiles];
+    nrfiles++;
+  }
+  closedir(dir);
+  while(total > maxbytes && nrfiles > 1) {
+    oldest = 0;
+    for(i = 1; i < nrfiles; i++) {
+      if(lastused[i] < lastused[oldest])
+ oldest = i;
+    }
+    if(verbose.verbose) {
+      for(i = 0; i < verbose.indent; i++)
+ printf(" ");
+      printf("Removing least recently used cache file %s\n", names[oldest]);
+    }
+    unlink(names[oldest]);
+    total -= sizes[oldest];
+    free(names[oldest]);
+    nrfiles--;
+    names[oldest] = names[nrfiles];
+    lastused[oldest] = lastused[nrfiles];
+    sizes[oldest] = sizes[nrfiles];
+  }
+  for(i = 0; i < nrfiles; i++)
+    free(names[i]);
+  free(names);
+  free(lastused);
+  free(sizes);
+}
+long long internal_preprocesscache_alignment(long long nrbytes)
+{
+  if(nrbytes >= dataAllocationHugePageThreshold)
+    return dataAllocationHugePageSize;
+  return dataAllocationAlignment;
+}
+int internal_preprocesscache_map(datafile_definition *cached, verbose_definition verbose)
+{
+  struct stat filestat;
+  char *reserved, *base;
+  long long nrbytes, alignment;
+  size_t pagesize, mapsize, reservedsize;
+  if(cached->format != PSRSALSA_BINARY_format || cached->version == 2)
+    return 0;
+  if(fstat(fileno(cached->fptr), &filestat) != 0)
+    return 0;
+  nrbytes = cached->NrSubints*cached->NrBins*cached->NrPols*cached->NrFreqChan*sizeof(float);
+  if(nrbytes <= 0 || cached->datastart+nrbytes > filestat.st_size)
+    return 0;
+  alignment = internal_preprocesscache_alignment(nrbytes);
+  if(cached->datastart % alignment != 0)
+    return 0;
+  pagesize = sysconf(_SC_PAGESIZE);
+  mapsize = ((filestat.st_size+pagesize-1)/pagesize)*pagesize;
+  reservedsize = mapsize;
+  if(alignment > pagesize)
+    reservedsize += alignment;
+  reserved = mmap(NULL, reservedsize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  base = MAP_FAILED;
+  if(reserved != MAP_FAILED) {
+    base = (char *)((((uintptr_t)reserved+alignment-1)/alignment)*alignment);
+    if(base > reserved)
+      munmap(reserved, base-reserved);
+    if(reserved+reservedsize > base+mapsize)
+      munmap(base+mapsize, reserved+reservedsize-(base+mapsize));
+    if(mmap(base, filestat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fileno(cached->fptr), 0) == MAP_FAILED) {
+      munmap(base, mapsize);
+      base = MAP_FAILED;
+    }
+  }
+  if(base == MAP_FAILED) {
+    if(verbose.debug)
+      printf("Memory mapping cache file failed, reading it instead\n");
+    return 0;
+  }
+#ifdef MADV_HUGEPAGE
+  if(alignment == dataAllocationHugePageSize)
+    madvise(base, mapsize, MADV_HUGEPAGE);
+#endif
+  closePSRData(cached, 2, verbose);
+  cached->mappedbase = base;
+  cached->mappedsize = mapsize;
+  cached->data = (float *)((char *)base + cached->datastart);
+  cached->format = MEMORY_format;
+  cached->opened_flag = 1;
+  return 1;
+}
+int internal_preprocesscache_checkkey(preprocesscache_definition *cache)
+{
+  FILE *fptr;
+  char identifier[9];
+  long long keysize;
+  unsigned char *key;
+  int ret;
+  fptr = fopen(cache->filename, "rb");
+  if(fptr == NULL)
+    return 0;
+  ret = 0;
+  if(fseeko(fptr, -(off_t)(sizeof(long long)+8), SEEK_END) == 0 && fread(&keysize, sizeof(long long), 1, fptr) == 1 && fread(identifier, 1, 8, fptr) == 8) {
+    identifier[8] = 0;
+    if(strcmp(identifier, PREPROCESS_CACHE_KEY_ID) == 0 && keysize == cache->keysize) {
+      key = (unsigned char *)malloc(keysize);
+      if(key != NULL) {
+ if(fseeko(fptr, -(off_t)(keysize+sizeof(long long)+8), SEEK_END) == 0 && fread(key, 1, keysize, fptr) == keysize && memcmp(key, cache->key, keysize) == 0)
+   ret = 1;
+ free(key);
+      }
+    }
+  }
+  fclose(fptr);
+  return ret;
+}
+int internal_preprocesscache_writekey(char *filename, preprocesscache_definition *cache)
+{
+  FILE *fptr;
+  int ret;
+  fptr = fopen(filename, "ab");
+  if(fptr == NULL)
+    return 0;
+  ret = 1;
+  if(fwrite(cache->key, 1, cache->keysize, fptr) != cache->keysize || fwrite(&(cache->keysize), sizeof(long long), 1, fptr) != 1 || fwrite(PREPROCESS_CACHE_KEY_ID, 1, 8, fptr) != 8)
+    ret = 0;
+  if(fclose(fptr) != 0)
+    ret = 0;
+  return ret;
+}
+int preprocessCacheLookup(psrsalsaApplication *application, datafile_definition *psrdata, preprocesscache_definition *cache, verbose_definition verbose)
+{
+  datafile_definition cached;
+  unsigned long long hash;
+  long nrsubints;
+  int i;
+  verbose_definition verbose2;
+  copyVerboseState(verbose, &verbose2);
+  verbose2.indent = verbose.indent + 2;
+  verbose2.verbose = 0;
+  cache->filename[0] = 0;
+  if(internal_preprocesscache_key(application, psrdata, cache, &hash) == 0) {
+    freePreprocessCache(cache);
+    return 0;
+  }
+  if(access(application->cachedir, F_OK) != 0)
+    mkdir(application->cachedir, 0777);
+  snprintf(cache->filename, MaxFilenameLength, "%s/%s%016llx%s", application->cachedir, PREPROCESS_CACHE_PREFIX, hash, PREPROCESS_CACHE_EXTENSION);
+  if(access(cache->filename, R_OK) != 0) {
+    if(verbose.verbose) {
+      for(i = 0; i < verbose.indent; i++)
+ printf(" ");
+      printf("No cached result of the preprocessing found\n");
+    }
+    return 0;
+  }
+  if(internal_preprocesscache_checkkey(cache) == 0) {
+    if(verbose.verbose) {
+      for(i = 0; i < verbose.indent; i++)
+ printf(" ");
+      printf("Cache file %s was produced from different input, preprocessing the data again\n", cache->filename);
+    }
+    return 0;
+  }
+  if(openPSRData(&cached, cache->filename, PSRSALSA_BINARY_format, 0, 0, 1, verbose2) == 0 || readHeaderPSRData(&cached, 0, 1, verbose2) == 0) {
+    fflush(stdout);
+    printwarning(verbose.debug, "WARNING preprocessCacheLookup: Cannot read %s, preprocessing the data again.", cache->filename);
+    return 0;
+  }
+  if(internal_preprocesscache_map(&cached, verbose2) == 0) {
+    closePSRData(&cached, 0, verbose2);
+    if(openPSRData(&cached, cache->filename, PSRSALSA_BINARY_format, 0, 1, 1, verbose2) == 0) {
+      fflush(stdout);
+      printwarning(verbose.debug, "WARNING preprocessCacheLookup: Cannot read %s, preprocessing the data again.", cache->filename);
+      return 0;
+    }
+  }
+  if(set_filename_PSRData(&cached, psrdata->filename, verbose2) == 0) {
+    closePSRData(&cached, 0, verbose2);
+    return 0;
+  }
+  utime(cache->filename, NULL);
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("Using cached result of the preprocessing (%s)\n", cache->filename);
+  }
+  nrsubints = psrdata->NrSubints;
+  if(application->nskip != 0 || application->nread > 0) {
+    if(application->nread <= 0)
+      application->nread = nrsubints-application->nskip;
+    nrsubints = application->nread;
+  }
+  if(application->blocksize > 0)
+    nrsubints = (nrsubints/application->blocksize)*application->blocksize;
+  if(application->doFSCR) {
+    if(application->fchan_select != -1)
+      application->dofscr = 1;
+    else
+      application->dofscr = psrdata->NrFreqChan;
+  }
+  if(application->doTSCR)
+    application->dotscr = nrsubints;
+  swap_orig_clone(psrdata, &cached, verbose2);
+  return 1;
+}
+int preprocessCacheStore(psrsalsaApplication *application, datafile_definition *psrdata, preprocesscache_definition *cache, verbose_definition verbose)
+{
+  datafile_definition cached;
+  char *tmpname;
+  int i;
+  verbose_definition verbose2;
+  if(cache->filename[0] == 0 || cache->keysize <= 0 || psrdata->format != MEMORY_format || psrdata->data == NULL || psrdata->packedbits)
+    return 0;
+  copyVerboseState(verbose, &verbose2);
+  verbose2.indent = verbose.indent + 2;
+  verbose2.verbose = 0;
+  tmpname = malloc(strlen(cache->filename)+32);
+  if(tmpname == NULL) {
+    fflush(stdout);
+    printwarning(verbose.debug, "WARNING preprocessCacheStore: Memory allocation error, result is not cached.");
+    return 0;
+  }
+  sprintf(tmpname, "%s.%ld", cache->filename, (long)getpid());
+  cleanPSRData(&cached, verbose2);
+  copy_params_PSRData(*psrdata, &cached, verbose2);
+  cached.headeralign = internal_preprocesscache_alignment(psrdata->NrSubints*psrdata->NrBins*psrdata->NrPols*psrdata->NrFreqChan*sizeof(float));
+  if(openPSRData(&cached, tmpname, PSRSALSA_BINARY_format, 1, 0, 0, verbose2) == 0) {
+    fflush(stdout);
+    printwarning(verbose.debug, "WARNING preprocessCacheStore: Cannot create %s, result is not cached.", tmpname);
+    closePSRData(&cached, 0, verbose2);
+    free(tmpname);
+    return 0;
+  }
+  if(writeHeaderPSRData(&cached, 0, NULL, 0, verbose2) == 0 || writePSRData(&cached, psrdata->data, verbose2) == 0) {
+    fflush(stdout);
+    printwarning(verbose.debug, "WARNING preprocessCacheStore: Cannot write %s, result is not cached.", tmpname);
+    closePSRData(&cached, 0, verbose2);
+    unlink(tmpname);
+    free(tmpname);
+    return 0;
+  }
+  closePSRData(&cached, 0, verbose2);
+  if(internal_preprocesscache_writekey(tmpname, cache) == 0) {
+    fflush(stdout);
+    printwarning(verbose.debug, "WARNING preprocessCacheStore: Cannot write %s, result is not cached.", tmpname);
+    unlink(tmpname);
+    free(tmpname);
+    return 0;
+  }
+  if(rename(tmpname, cache->filename) != 0) {
+    fflush(stdout);
+    printwarning(verbose.debug, "WARNING preprocessCacheStore: Cannot rename %s, result is not cached.", tmpname);
+    unlink(tmpname);
+    free(tmpname);
+    return 0;
+  }
+  free(tmpname);
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("Stored result of the preprocessing in %s\n", cache->filename);
+  }
+  internal_preprocesscache_evict(application->cachedir, application->cachesize, verbose);
+  return 1;
+}
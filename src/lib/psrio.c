@@ -19,6 +19,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <math.h>
 #include <errno.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include "psrsalsa.h"
 int readWSRTHeader(datafile_definition *datafile, verbose_definition verbose);
 int readPulseWSRTData(datafile_definition datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse);
@@ -32,6 +33,8 @@ int readFITSfile(datafile_definition *datafile, float *data, verbose_definition
 int writePSRFITSHeader(datafile_definition *datafile, verbose_definition verbose);
 int writeFITSpulse(datafile_definition datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse, verbose_definition verbose);
 int writeFITSfile(datafile_definition datafile, float *data, verbose_definition verbose);
+int writeFITSpulse_buffered(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse, verbose_definition verbose);
+int flushFITSrowbuffer(datafile_definition *datafile, verbose_definition verbose);
 int readPSRCHIVE_ASCIIHeader(datafile_definition *datafile, verbose_definition verbose);
 int readPSRCHIVE_ASCIIfilepulse(datafile_definition datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse, verbose_definition verbose);
 int readPSRCHIVE_ASCIIfile(datafile_definition datafile, float *data, verbose_definition verbose);
@@ -49,12 +52,22 @@ int writePPOLHeader(datafile_definition datafile, int argc, char **argv, verbose
 int readHistoryFITS(datafile_definition *datafile, verbose_definition verbose);
 int writeHistoryFITS(datafile_definition datafile, verbose_definition verbose);
 int readHistoryPSRData(datafile_definition *datafile, verbose_definition verbose);
+int readPSRFITSdeferred(datafile_definition *datafile, verbose_definition verbose);
 int writeHistoryPSRData(datafile_definition *datafile, int argc, char **argv, int cmdOnly, verbose_definition verbose);
 int writeHistoryPuma(datafile_definition datafile, verbose_definition verbose);
 int readHistoryPuma(datafile_definition *datafile, verbose_definition verbose);
 int readSigprocfile(datafile_definition datafile, float *data, verbose_definition verbose);
 int readSigprocASCIIHeader(datafile_definition *datafile, verbose_definition verbose);
 int writeSigprocASCIIHeader(datafile_definition datafile, verbose_definition verbose);
+int readPulsePSRSALSA2Data(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse, verbose_definition verbose);
+int readPSRSALSA2file(datafile_definition *datafile, float *data, verbose_definition verbose);
+int writePSRSALSA2file(datafile_definition *datafile, float *data, verbose_definition verbose);
+int closePSRSALSA2Data(datafile_definition *datafile, verbose_definition verbose);
+int readPulsePackedData(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse);
+int writePulsePackedData(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse);
+int readPulseConcatData(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse, verbose_definition verbose);
+int readConcatfile(datafile_definition *datafile, float *data, verbose_definition verbose);
+int closeConcatPSRData(datafile_definition *datafile, verbose_definition verbose);
 int writeSigprocASCIIfile(datafile_definition datafile, float *data, verbose_definition verbose);
 int readSigprocASCIIfile(datafile_definition datafile, float *data, verbose_definition verbose);
 int isValidPSRDATA_format(int format)
@@ -77,6 +90,8 @@ int isValidPSRDATA_format(int format)
     return 1;
   if(format == PSRSALSA_BINARY_format)
     return 1;
+  if(format == PSRSALSA_COMPRESSED_format)
+    return 1;
   if(format == MEMORY_format)
     return 1;
   printerror(0, "ERROR isValidPSRDATA_format: specified data format is not recognized.");
@@ -114,6 +129,12 @@ void printPSRDataFormats(FILE *printdevice, int nrspaces)
   fprintf(printdevice, "(SIGPROCASCII) - Sigproc ascii format\n");
   for(i = 0; i < nrspaces; i++) fprintf(printdevice, " ");
   fprintf(printdevice, "(PSRSALSA)     - PSRSALSA binary format\n");
+  for(i = 0; i < nrspaces; i++) fprintf(printdevice, " ");
+  fprintf(printdevice, "(PSRSALSA2)    - PSRSALSA binary format v2, losslessly compressed per\n");
+  for(i = 0; i < nrspaces2; i++) fprintf(printdevice, " ");
+  fprintf(printdevice, "subint with an index for random access (output only, it\n");
+  for(i = 0; i < nrspaces2; i++) fprintf(printdevice, " ");
+  fprintf(printdevice, "is recognised as PSRSALSA when reading).\n");
 }
 int parsePSRDataFormats(char *cmd)
 {
@@ -123,6 +144,8 @@ int parsePSRDataFormats(char *cmd)
     return FITS_format;
   else if(strcasecmp(cmd, "PSRSALSA") == 0 || strcasecmp(cmd, "SALSA") == 0 || atoi(cmd) == PSRSALSA_BINARY_format)
     return PSRSALSA_BINARY_format;
+  else if(strcasecmp(cmd, "PSRSALSA2") == 0 || strcasecmp(cmd, "SALSA2") == 0 || atoi(cmd) == PSRSALSA_COMPRESSED_format)
+    return PSRSALSA_COMPRESSED_format;
   else if(strcasecmp(cmd, "PUMA") == 0 || atoi(cmd) == PUMA_format)
     return PUMA_format;
   else if(strcasecmp(cmd, "EPN") == 0 || atoi(cmd) == EPN_format)
@@ -151,6 +174,17 @@ void cleanPSRData(datafile_definition *datafile, verbose_definition verbose)
   datafile->scales = NULL;
   datafile->offsets = NULL;
   datafile->weights = NULL;
+  datafile->fits_rowbuffer = NULL;
+  datafile->fits_rowbuffer_profiles = NULL;
+  datafile->salsachunks = NULL;
+  datafile->packedbits = 0;
+  datafile->packeddata = NULL;
+  datafile->packedscale = NULL;
+  datafile->packedoffset = NULL;
+  datafile->packedrow = NULL;
+  datafile->concat = NULL;
+  datafile->mappedbase = NULL;
+  datafile->mappedsize = 0;
   datafile->data = NULL;
   datafile->format = 0;
   datafile->version = 0;
@@ -212,6 +246,7 @@ void cleanPSRData(datafile_definition *datafile, verbose_definition verbose)
   datafile->feedtype = FEEDTYPE_UNKNOWN;
   datafile->poltype = POLTYPE_UNKNOWN;
   datafile->datastart = 0;
+  datafile->headeralign = 0;
   datafile->isTransposed = 0;
   datafile->gentype = GENTYPE_UNDEFINED;
   datafile->xrangeset = 0;
@@ -243,6 +278,20 @@ int copy_params_PSRData(datafile_definition datafile_source, datafile_definition
   datafile_dest->scales = NULL;
   datafile_dest->offsets = NULL;
   datafile_dest->weights = NULL;
+  datafile_dest->fits_rowbuffer = NULL;
+  datafile_dest->fits_rowbuffer_profiles = NULL;
+  datafile_dest->fits_rowbuffer_filled = 0;
+  datafile_dest->salsachunks = NULL;
+  datafile_dest->packedbits = 0;
+  datafile_dest->packeddata = NULL;
+  datafile_dest->packedscale = NULL;
+  datafile_dest->packedoffset = NULL;
+  datafile_dest->packedrow = NULL;
+  datafile_dest->headeralign = 0;
+  datafile_dest->concat = NULL;
+  datafile_dest->mappedbase = NULL;
+  datafile_dest->mappedsize = 0;
+  datafile_dest->deferred = 0;
   datafile_dest->offpulse_rms = NULL;
   datafile_dest->format = datafile_source.format;
   datafile_dest->version = datafile_source.version;
@@ -427,6 +476,8 @@ int writePSRSALSAHeader(datafile_definition *datafile, verbose_definition verbos
   int ret, dummyi;
   char identifier[] = "PSRSALSAdump";
   int version = 1;
+  if(datafile->version == 2)
+    version = 2;
   ret = fwrite(identifier, 12, 1, datafile->fptr_hdr);
   if(ret != 1) {
     fflush(stdout);
@@ -784,6 +835,7 @@ int writeHistoryPSRSALSA(datafile_definition *datafile, verbose_definition verbo
   int nrHistoryLines, dummyi;
   size_t ret;
   char *history_id = "HISTORY";
+  char *padding_id = "PADDING";
   curHistoryEntry = &(datafile->history);
   nrHistoryLines = 0;
   do {
@@ -890,6 +942,24 @@ int writeHistoryPSRSALSA(datafile_definition *datafile, verbose_definition verbo
     }
   }while(curHistoryEntry != NULL);
   datafile->datastart = ftell(datafile->fptr_hdr);
+  if(datafile->headeralign > 0) {
+    char *padding;
+    dummyi = (datafile->headeralign - (datafile->datastart+strlen(padding_id)+sizeof(int)) % datafile->headeralign) % datafile->headeralign;
+    padding = calloc(dummyi+1, 1);
+    if(padding == NULL) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR writePSRSALSAHeader: Memory allocation error");
+      return 0;
+    }
+    if(fwrite(padding_id, 1, strlen(padding_id), datafile->fptr_hdr) != strlen(padding_id) || fwrite(&dummyi, sizeof(int), 1, datafile->fptr_hdr) != 1 || fwrite(padding, 1, dummyi, datafile->fptr_hdr) != dummyi) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR writePSRSALSAHeader: Write error to %s", datafile->filename);
+      free(padding);
+      return 0;
+    }
+    free(padding);
+    datafile->datastart = ftell(datafile->fptr_hdr);
+  }
   return 1;
 }
 int readPSRSALSAHeader(datafile_definition *datafile, int nohistory_expected, verbose_definition verbose)
@@ -921,11 +991,12 @@ int readPSRSALSAHeader(datafile_definition *datafile, int nohistory_expected, ve
     printerror(verbose.debug, "ERROR readPSRSALSAHeader: Read error from %s", datafile->filename);
     return 0;
   }
-  if(version < 1 || version > 1) {
+  if(version < 1 || version > 2) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR readPSRSALSAHeader: File %s is in an unsupported version number (%d)", datafile->filename, version);
     return 0;
   }
+  datafile->version = version;
   if(verbose.debug) {
     printf("  PSRSALSA file is version %d\n", version);
   }
@@ -1481,6 +1552,19 @@ int readPSRSALSAHeader(datafile_definition *datafile, int nohistory_expected, ve
       }
     }
   }
+  if(readhistory) {
+    off_t filepos;
+    filepos = ftello(datafile->fptr_hdr);
+    identifier[7] = 0;
+    if(fread(identifier, 1, 7, datafile->fptr_hdr) == 7 && strcmp(identifier, "PADDING") == 0 && fread(&dummyi, sizeof(int), 1, datafile->fptr_hdr) == 1 && dummyi >= 0) {
+      if(verbose.debug) {
+ printf("  Skipping %d bytes of header padding\n", dummyi);
+      }
+      fseeko(datafile->fptr_hdr, dummyi, SEEK_CUR);
+    }else {
+      fseeko(datafile->fptr_hdr, filepos, SEEK_SET);
+    }
+  }
   datafile->datastart = ftell(datafile->fptr_hdr);
   free(txt);
   return 1;
@@ -1869,6 +1953,35 @@ int guessPSRData_format(char *filename, int noerror, verbose_definition verbose)
   free(txt);
   return 0;
 }
+int readInMemoryPSRData(datafile_definition *datafile, verbose_definition verbose)
+{
+  long long datasize;
+  verbose_definition verbose2;
+  if(datafile->format == MEMORY_format)
+    return 1;
+  copyVerboseState(verbose, &verbose2);
+  verbose2.indent = verbose.indent + 2;
+  if(datafile->NrPols != 0) {
+    datasize = datafile->NrSubints*datafile->NrBins*datafile->NrPols*datafile->NrFreqChan*sizeof(float);
+    datafile->data = allocDataPSRData(datasize/sizeof(float));
+    if(datafile->data == NULL) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR readInMemoryPSRData: Cannot allocate memory (data=%lld bytes=%.3fGB).", datasize, datasize/1073741824.0);
+      return 0;
+    }
+    timingCount(verbose, TIMING_ALLOCATIONS, 1);
+    timingCount(verbose, TIMING_ALLOCATEDBYTES, datasize);
+  }
+  if(readPSRData(datafile, datafile->data, verbose2) == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR readInMemoryPSRData: Cannot read data.");
+    return 0;
+  }
+  closePSRData(datafile, 2, verbose2);
+  datafile->format = MEMORY_format;
+  datafile->opened_flag = 1;
+  return 1;
+}
 int openPSRData(datafile_definition *datafile, char *filename, int format, int enable_write, int read_in_memory, int nowarnings, verbose_definition verbose)
 {
   int status = 0, iomode, i;
@@ -1915,6 +2028,12 @@ int openPSRData(datafile_definition *datafile, char *filename, int format, int e
     printerror(verbose.debug, "ERROR openPSRData:\n  Error determining file type, please specify on command line.");
     return 0;
   }
+  if(format == PSRSALSA_COMPRESSED_format) {
+    format = PSRSALSA_BINARY_format;
+    datafile->version = 2;
+  }else if(format == PSRSALSA_BINARY_format && enable_write) {
+    datafile->version = 1;
+  }
   datafile->format = format;
   open_mode[0] = 0;
   if(enable_write) {
@@ -1926,7 +2045,7 @@ int openPSRData(datafile_definition *datafile, char *filename, int format, int e
       }
       printf("Opening file '%s' for writing\n", filename);
     }
-    if(format == PSRCHIVE_ASCII_format) {
+    if(format == PSRCHIVE_ASCII_format || (format == PSRSALSA_BINARY_format && datafile->version == 2)) {
       if(verbose.debug) {
  if(verbose.verbose) {
    for(i = 0; i <= verbose2.indent; i++)
@@ -2015,23 +2134,7 @@ int openPSRData(datafile_definition *datafile, char *filename, int format, int e
   }
   if(read_in_memory && datafile->opened_flag) {
     if(readHeaderPSRData(datafile, 0, nowarnings, verbose2)) {
-      if(datafile->NrPols != 0) {
- long datasize = datafile->NrSubints*datafile->NrBins*datafile->NrPols*datafile->NrFreqChan*sizeof(float);
- datafile->data = (float *)malloc(datasize);
- if(datafile->data == NULL) {
-   fflush(stdout);
-   printerror(verbose.debug, "ERROR openPSRData: Cannot allocate memory (data=%ld bytes=%.3fGB).", datasize, datasize/1073741824.0);
-   closePSRData(datafile, 0, verbose2);
-   return 0;
- }
-      }
-      if(readPSRData(datafile, datafile->data, verbose2)) {
- closePSRData(datafile, 2, verbose2);
- datafile->format = MEMORY_format;
- datafile->opened_flag = 1;
-      }else {
- fflush(stdout);
- printerror(verbose.debug, "ERROR openPSRData: Cannot read data.");
+      if(readInMemoryPSRData(datafile, verbose) == 0) {
  closePSRData(datafile, 0, verbose2);
  return 0;
       }
@@ -2044,6 +2147,49 @@ int openPSRData(datafile_definition *datafile, char *filename, int format, int e
   }
   return datafile->opened_flag;
 }
+int internal_psrio_firsttouch = 0;
+void setFirstTouchDataPSRData(int enable)
+{
+  internal_psrio_firsttouch = enable;
+}
+float *allocDataPSRData(long long nrsamples)
+{
+  void *ptr;
+  size_t nrbytes, alignment;
+  long long i, nrpages;
+  nrbytes = nrsamples*sizeof(float);
+  if(nrbytes < dataAllocationAlignment)
+    nrbytes = dataAllocationAlignment;
+  alignment = dataAllocationAlignment;
+  if(nrbytes >= dataAllocationHugePageThreshold) {
+    alignment = dataAllocationHugePageSize;
+    nrbytes = ((nrbytes+dataAllocationHugePageSize-1)/dataAllocationHugePageSize)*dataAllocationHugePageSize;
+  }
+  if(posix_memalign(&ptr, alignment, nrbytes) != 0)
+    return NULL;
+  if(alignment == dataAllocationHugePageSize) {
+#ifdef MADV_HUGEPAGE
+    madvise(ptr, nrbytes, MADV_HUGEPAGE);
+#endif
+    if(internal_psrio_firsttouch) {
+      nrpages = nrbytes/dataAllocationHugePageSize;
+#pragma omp parallel for schedule(static)
+      for(i = 0; i < nrpages; i++)
+ memset((char *)ptr+i*dataAllocationHugePageSize, 0, dataAllocationHugePageSize);
+    }
+  }
+  return (float *)ptr;
+}
+void freeDataPSRData(datafile_definition *datafile, float *data)
+{
+  if(datafile->mappedbase != NULL) {
+    munmap(datafile->mappedbase, datafile->mappedsize);
+    datafile->mappedbase = NULL;
+    datafile->mappedsize = 0;
+  }else {
+    free(data);
+  }
+}
 int closePSRData(datafile_definition *datafile, int perserve_info, verbose_definition verbose)
 {
   int indent;
@@ -2073,6 +2219,19 @@ int closePSRData(datafile_definition *datafile, int perserve_info, verbose_defin
       }
     }
     if(datafile->format == FITS_format) {
+      if(datafile->fits_rowbuffer != NULL) {
+ if(verbose.debug) {
+   printf("  - Writing out buffered subint\n");
+ }
+ if(flushFITSrowbuffer(datafile, verbose) != 1) {
+   fflush(stdout);
+   printerror(verbose.debug, "ERROR closePSRData: Writing of buffered subint failed.");
+ }
+ free(datafile->fits_rowbuffer);
+ free(datafile->fits_rowbuffer_profiles);
+ datafile->fits_rowbuffer = NULL;
+ datafile->fits_rowbuffer_profiles = NULL;
+      }
       if(verbose.debug) {
  printf("  - Releasing FITS file pointer\n");
       }
@@ -2087,7 +2246,18 @@ int closePSRData(datafile_definition *datafile, int perserve_info, verbose_defin
       free(datafile->scales);
       free(datafile->offsets);
       free(datafile->weights);
+    }else if(datafile->format == CONCAT_format) {
+      if(verbose.debug) {
+ printf("  - Releasing combined files\n");
+      }
+      closeConcatPSRData(datafile, verbose);
     }else if(datafile->format != MEMORY_format){
+      if(datafile->format == PSRSALSA_BINARY_format && datafile->salsachunks != NULL) {
+ if(closePSRSALSA2Data(datafile, verbose) != 1) {
+   fflush(stdout);
+   printerror(verbose.debug, "ERROR closePSRData: Writing of buffered compressed data failed.");
+ }
+      }
       if(verbose.debug) {
  printf("  - Releasing file pointer\n");
       }
@@ -2100,9 +2270,24 @@ int closePSRData(datafile_definition *datafile, int perserve_info, verbose_defin
       if(verbose.debug) {
  printf("  - Releasing memory containing data\n");
       }
-      free(datafile->data);
+      freeDataPSRData(datafile, datafile->data);
       datafile->data = NULL;
     }
+    if(datafile->packeddata != NULL) {
+      if(verbose.debug) {
+ printf("  - Releasing memory containing packed data\n");
+      }
+      free(datafile->packeddata);
+      free(datafile->packedscale);
+      free(datafile->packedoffset);
+      if(datafile->packedrow != NULL)
+ free(datafile->packedrow);
+      datafile->packeddata = NULL;
+      datafile->packedscale = NULL;
+      datafile->packedoffset = NULL;
+      datafile->packedrow = NULL;
+      datafile->packedbits = 0;
+    }
   }
   if(perserve_info == 0) {
     if(verbose.debug) {
@@ -2236,6 +2421,7 @@ static char * internal_format_string_PSRFITS = "PSRfits";
 static char * internal_format_string_SIGPROC = "Sigproc";
 static char * internal_format_string_SIGPROCAscii = "Sigproc (ascii)";
 static char * internal_format_string_PSRSALSA = "PSRSALSA binary";
+static char * internal_format_string_Concat = "Combined files";
 static char * internal_format_string_Memory = "Loaded in RAM";
 static char * internal_format_string_bug = "BUG, undefined????";
 char *returnFileFormat_str(int format)
@@ -2250,6 +2436,7 @@ char *returnFileFormat_str(int format)
   case PSRCHIVE_ASCII_format: return internal_format_string_PSRCHIVEAscii; break;
   case FITS_format: return internal_format_string_PSRFITS; break;
   case PSRSALSA_BINARY_format: return internal_format_string_PSRSALSA; break;
+  case CONCAT_format: return internal_format_string_Concat; break;
   case MEMORY_format: return internal_format_string_Memory; break;
   default: return internal_format_string_bug; break;
   }
@@ -3027,7 +3214,8 @@ int readHeaderPSRData(datafile_definition *datafile, int readnoscales, int nowar
   if(datafile->freq_ref < -0.9 && datafile->freq_ref >= -1.1) {
     datafile->freq_ref = 1e10;
   }
-  readHistoryPSRData(datafile, verbose2);
+  if((datafile->deferred & DEFERRED_HISTORY) == 0)
+    readHistoryPSRData(datafile, verbose2);
   if(verbose.verbose) {
     printHeaderPSRData(*datafile, 0, verbose2);
   }
@@ -3122,38 +3310,79 @@ int writeHeaderPSRData(datafile_definition *datafile, int argc, char **argv, int
 }
 int readPulsePSRData(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse, verbose_definition verbose)
 {
-  if(datafile->format == PSRSALSA_BINARY_format)
-    return readPulsePSRSALSAData(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
+  int ret;
+  double t0;
+  if(datafile->deferred) {
+    if(loadDeferredHeaderPSRData(datafile, verbose) == 0)
+      return 0;
+  }
+  if(datafile->format == MEMORY_format) {
+    if(datafile->packedbits) {
+      if(readPulsePackedData(datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse) == 0) {
+ fflush(stdout);
+ printerror(verbose.debug, "ERROR readPulsePSRData: Cannot decode packed data.");
+ return 0;
+      }
+      timingCount(verbose, TIMING_PROFILES, 1);
+      return 1;
+    }
+    memcpy(pulse, &datafile->data[datafile->NrBins*(polarization+datafile->NrPols*(freq+pulsenr*datafile->NrFreqChan))+binnr], sizeof(float)*nrSamples);
+    timingCount(verbose, TIMING_PROFILES, 1);
+    return 1;
+  }
+  if(datafile->format == CONCAT_format)
+    return readPulseConcatData(datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
+  t0 = timingStart(verbose);
+  if(datafile->format == PSRSALSA_BINARY_format && datafile->version == 2)
+    ret = readPulsePSRSALSA2Data(datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
+  else if(datafile->format == PSRSALSA_BINARY_format)
+    ret = readPulsePSRSALSAData(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
   else if(datafile->format == PUMA_format)
-    return readPulseWSRTData(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse);
+    ret = readPulseWSRTData(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse);
   else if(datafile->format == FITS_format)
-    return readFITSpulse(datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
+    ret = readFITSpulse(datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
   else if(datafile->format == PSRCHIVE_ASCII_format)
-    return readPSRCHIVE_ASCIIfilepulse(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
+    ret = readPSRCHIVE_ASCIIfilepulse(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
   else if(datafile->format == EPN_format)
-    return readPulseEPNData(datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
+    ret = readPulseEPNData(datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
   else if(datafile->format == SIGPROC_format)
-    return readPulseSigprocData(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
-  else if(datafile->format == MEMORY_format) {
-    memcpy(pulse, &datafile->data[datafile->NrBins*(polarization+datafile->NrPols*(freq+pulsenr*datafile->NrFreqChan))+binnr], sizeof(float)*nrSamples);
-    return 1;
-  }else {
+    ret = readPulseSigprocData(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
+  else {
     fflush(stdout);
     printerror(verbose.debug, "ERROR readPulsePSRData: Reading of this format is not implemented. Maybe converting the data in a different format will solve this issue.");
+    return 0;
   }
-  return 0;
+  if(ret == 1 && verbose.timing != NULL) {
+    timingStop(verbose, "readPulsePSRData", t0);
+    timingCount(verbose, TIMING_PROFILES, 1);
+    timingCount(verbose, TIMING_BYTESREAD, nrSamples*sizeof(float));
+  }
+  return ret;
 }
 int writePulsePSRData(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse, verbose_definition verbose)
 {
+  int ret;
+  double t0;
   if(pulsenr < 0 || binnr < 0 || freq < 0) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR writePulsePSRData: Parameters outside boundaries.");
     return 0;
   }
+  t0 = timingStart(verbose);
+  ret = 1;
+  if(datafile->format == MEMORY_format && datafile->packedbits) {
+    if(writePulsePackedData(datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse) == 0) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR writePulsePSRData: Cannot encode packed data.");
+      return 0;
+    }
+    timingCount(verbose, TIMING_PROFILES, 1);
+    return 1;
+  }
   if(datafile->format == MEMORY_format || datafile->dumpOnClose) {
     if(datafile->dumpOnClose && datafile->data == NULL) {
       long datasize = datafile->NrSubints*datafile->NrBins*datafile->NrPols*datafile->NrFreqChan*sizeof(float);
-      datafile->data = (float *)malloc(datasize);
+      datafile->data = allocDataPSRData(datasize/sizeof(float));
       if(datafile->data == NULL) {
  fflush(stdout);
  printerror(verbose.debug, "ERROR writePulsePSRData: Cannot allocate memory (data=%ld bytes=%.3fGB).", datasize, datasize/1073741824.0);
@@ -3168,14 +3397,22 @@ int writePulsePSRData(datafile_definition *datafile, long pulsenr, int polarizat
       }else if(verbose.debug) {
  printf("DEBUG: Allocated %ld bytes of memory for memory buffering.\n", datasize);
       }
+      timingCount(verbose, TIMING_ALLOCATIONS, 1);
+      timingCount(verbose, TIMING_ALLOCATEDBYTES, datasize);
     }
     memcpy(&datafile->data[datafile->NrBins*(polarization+datafile->NrPols*(freq+pulsenr*datafile->NrFreqChan))+binnr], pulse, sizeof(float)*nrSamples);
+    timingCount(verbose, TIMING_PROFILES, 1);
+    return 1;
+  }else if(datafile->format == PSRSALSA_BINARY_format && datafile->version == 2) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writePulsePSRData: Writing out individual subintegrations to compressed PSRSALSA data is only possible before the whole dataset is written.");
+    return 0;
   }else if(datafile->format == PSRSALSA_BINARY_format) {
-    return writePulsePSRSALSAData(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
+    ret = writePulsePSRSALSAData(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
   }else if(datafile->format == PUMA_format) {
-    return writePulseWSRTData(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse);
+    ret = writePulseWSRTData(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse);
   }else if(datafile->format == FITS_format) {
-    return writeFITSpulse(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
+    ret = writeFITSpulse_buffered(datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
   }else if(datafile->format == PSRCHIVE_ASCII_format) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR writePulsePSRData: Writing out individual subintegrations is not implemented for ASCII formats.");
@@ -3185,60 +3422,92 @@ int writePulsePSRData(datafile_definition *datafile, long pulsenr, int polarizat
     printerror(verbose.debug, "ERROR writePulsePSRData: Writing in this format (%s) is not implemented", returnFileFormat_str(datafile->format));
     return 0;
   }
-  return 1;
+  if(ret == 1 && verbose.timing != NULL) {
+    timingStop(verbose, "writePulsePSRData", t0);
+    timingCount(verbose, TIMING_PROFILES, 1);
+    timingCount(verbose, TIMING_BYTESWRITTEN, nrSamples*sizeof(float));
+  }
+  return ret;
 }
 int readPSRData(datafile_definition *datafile, float *data, verbose_definition verbose)
 {
-  if(datafile->format == PSRSALSA_BINARY_format)
-    return readPSRSALSAfile(*datafile, data, verbose);
+  int ret;
+  double t0;
+  if(datafile->deferred) {
+    if(loadDeferredHeaderPSRData(datafile, verbose) == 0)
+      return 0;
+  }
+  if(datafile->format == CONCAT_format)
+    return readConcatfile(datafile, data, verbose);
+  t0 = timingStart(verbose);
+  if(datafile->format == PSRSALSA_BINARY_format && datafile->version == 2)
+    ret = readPSRSALSA2file(datafile, data, verbose);
+  else if(datafile->format == PSRSALSA_BINARY_format)
+    ret = readPSRSALSAfile(*datafile, data, verbose);
   else if(datafile->format == PUMA_format)
-    return readPuMafile(*datafile, data, verbose);
+    ret = readPuMafile(*datafile, data, verbose);
   else if(datafile->format == PSRCHIVE_ASCII_format)
-    return readPSRCHIVE_ASCIIfile(*datafile, data, verbose);
+    ret = readPSRCHIVE_ASCIIfile(*datafile, data, verbose);
   else if(datafile->format == EPN_format)
-    return readEPNfile(datafile, data, verbose, -1);
-  else if(datafile->format == FITS_format) {
-    int ret;
+    ret = readEPNfile(datafile, data, verbose, -1);
+  else if(datafile->format == FITS_format)
     ret = readFITSfile(datafile, data, verbose);
-    return ret;
-  }else if(datafile->format == PPOL_format)
-    return readPPOLfile(datafile, data, 1, 0, verbose);
+  else if(datafile->format == PPOL_format)
+    ret = readPPOLfile(datafile, data, 1, 0, verbose);
   else if(datafile->format == PPOL_SHORT_format)
-    return readPPOLfile(datafile, data, 0, 0, verbose);
+    ret = readPPOLfile(datafile, data, 0, 0, verbose);
   else if(datafile->format == SIGPROC_ASCII_format)
-    return readSigprocASCIIfile(*datafile, data, verbose);
+    ret = readSigprocASCIIfile(*datafile, data, verbose);
   else if(datafile->format == SIGPROC_format)
-    return readSigprocfile(*datafile, data, verbose);
-  else
+    ret = readSigprocfile(*datafile, data, verbose);
+  else {
     fflush(stdout);
     printerror(verbose.debug, "ERROR readPSRData: Reading whole dataset is not supported for this type of data.");
-  return 0;
+    return 0;
+  }
+  if(ret == 1 && verbose.timing != NULL) {
+    timingStop(verbose, "readPSRData", t0);
+    timingCount(verbose, TIMING_PROFILES, datafile->NrSubints*datafile->NrFreqChan*datafile->NrPols);
+    timingCount(verbose, TIMING_BYTESREAD, datafile->NrSubints*datafile->NrFreqChan*datafile->NrPols*datafile->NrBins*sizeof(float));
+  }
+  return ret;
 }
 int writePSRData(datafile_definition *datafile, float *data, verbose_definition verbose)
 {
+  int ret;
+  double t0;
   if(verbose.verbose) printf("Writing %ld x %ld x %ld x %ld samples\n", datafile->NrSubints, datafile->NrFreqChan, datafile->NrBins, datafile->NrPols);
   datafile->dumpOnClose = 0;
-  if(datafile->format == PSRSALSA_BINARY_format) {
-    return writePSRSALSAfile(*datafile, data, verbose);
+  t0 = timingStart(verbose);
+  if(datafile->format == PSRSALSA_BINARY_format && datafile->version == 2) {
+    ret = writePSRSALSA2file(datafile, data, verbose);
+  }else if(datafile->format == PSRSALSA_BINARY_format) {
+    ret = writePSRSALSAfile(*datafile, data, verbose);
   }else if(datafile->format == PUMA_format) {
-    return writePuMafile(*datafile, data, verbose);
+    ret = writePuMafile(*datafile, data, verbose);
   }else if(datafile->format == EPN_format) {
-    return writeEPNfile(*datafile, data, verbose);
+    ret = writeEPNfile(*datafile, data, verbose);
   }else if(datafile->format == PSRCHIVE_ASCII_format) {
-    return writePSRCHIVE_ASCIIfile(*datafile, data, verbose);
+    ret = writePSRCHIVE_ASCIIfile(*datafile, data, verbose);
   }else if(datafile->format == FITS_format) {
-    return writeFITSfile(*datafile, data, verbose);
+    ret = writeFITSfile(*datafile, data, verbose);
   }else if(datafile->format == PPOL_format) {
-    return writePPOLfile(*datafile, data, 1, 0, 0, 0, verbose);
+    ret = writePPOLfile(*datafile, data, 1, 0, 0, 0, verbose);
   }else if(datafile->format == PPOL_SHORT_format) {
-    return writePPOLfile(*datafile, data, 0, 0, 0, 0, verbose);
+    ret = writePPOLfile(*datafile, data, 0, 0, 0, 0, verbose);
   }else if(datafile->format == SIGPROC_ASCII_format) {
-    return writeSigprocASCIIfile(*datafile, data, verbose);
+    ret = writeSigprocASCIIfile(*datafile, data, verbose);
   }else {
     fflush(stdout);
     printerror(verbose.debug, "ERROR writePSRData: Writing whole dataset is not supported for this type of data (%s).", returnFileFormat_str(datafile->format));
+    return 0;
   }
-  return 0;
+  if(ret == 1 && verbose.timing != NULL) {
+    timingStop(verbose, "writePSRData", t0);
+    timingCount(verbose, TIMING_PROFILES, datafile->NrSubints*datafile->NrFreqChan*datafile->NrPols);
+    timingCount(verbose, TIMING_BYTESWRITTEN, datafile->NrSubints*datafile->NrFreqChan*datafile->NrPols*datafile->NrBins*sizeof(float));
+  }
+  return ret;
 }
 int read_profilePSRData(datafile_definition datafile, float *profileI, int *zapMask, int polchan, verbose_definition verbose)
 {
@@ -3764,13 +4033,23 @@ int make_clone(datafile_definition original, datafile_definition *clone, verbose
     return 0;
   }
   copy_params_PSRData(original, clone, verbose);
-  clone->data = (float *)malloc((original.NrBins)*(original.NrPols)*(original.NrFreqChan)*(original.NrSubints)*sizeof(float));
+  clone->data = allocDataPSRData((original.NrBins)*(original.NrPols)*(original.NrFreqChan)*(original.NrSubints));
   if(clone->data == NULL) {
     fflush(stdout);
     printerror(debug, "ERROR make_clone: Memory allocation error.");
     return 0;
   }
-  memcpy(clone->data, original.data, (original.NrBins)*(original.NrPols)*(original.NrFreqChan)*(original.NrSubints)*sizeof(float));
+  timingCount(verbose, TIMING_ALLOCATIONS, 1);
+  timingCount(verbose, TIMING_ALLOCATEDBYTES, (original.NrBins)*(original.NrPols)*(original.NrFreqChan)*(original.NrSubints)*sizeof(float));
+  if(original.packedbits) {
+    if(readPulsePackedData(&original, 0, 0, 0, 0, (original.NrBins)*(original.NrPols)*(original.NrFreqChan)*(original.NrSubints), clone->data) == 0) {
+      fflush(stdout);
+      printerror(debug, "ERROR make_clone: Cannot decode packed data.");
+      return 0;
+    }
+  }else {
+    memcpy(clone->data, original.data, (original.NrBins)*(original.NrPols)*(original.NrFreqChan)*(original.NrSubints)*sizeof(float));
+  }
   if(original.offpulse_rms != NULL) {
     clone->offpulse_rms = (float *)malloc(original.NrPols*original.NrFreqChan*original.NrSubints*sizeof(float));
     if(clone->offpulse_rms == NULL) {
@@ -3883,6 +4162,29 @@ int writeHistoryPSRData(datafile_definition *datafile, int argc, char **argv, in
     fprintf(stdout, "  done\n");
   return ret;
 }
+int loadDeferredHeaderPSRData(datafile_definition *datafile, verbose_definition verbose)
+{
+  if(datafile->deferred == 0)
+    return 1;
+  if(datafile->opened_flag == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR loadDeferredHeaderPSRData: File is already closed.");
+    return 0;
+  }
+  if(datafile->format == FITS_format) {
+    if(readPSRFITSdeferred(datafile, verbose) == 0) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR loadDeferredHeaderPSRData (%s): Cannot read deferred header information.", datafile->filename);
+      return 0;
+    }
+  }
+  if(datafile->deferred & DEFERRED_HISTORY) {
+    datafile->deferred &= ~DEFERRED_HISTORY;
+    readHistoryPSRData(datafile, verbose);
+  }
+  datafile->deferred = 0;
+  return 1;
+}
 int readHistoryPSRData(datafile_definition *datafile, verbose_definition verbose)
 {
   int ret, indent;
@@ -4167,6 +4469,7 @@ void cleanVerboseState(verbose_definition *verbose_state)
   verbose_state->debug = 0;
   verbose_state->nocounters = 0;
   verbose_state->indent = 0;
+  verbose_state->timing = NULL;
 }
 void copyVerboseState(verbose_definition verbose_state_src, verbose_definition *verbose_state_dst)
 {
@@ -4174,6 +4477,7 @@ void copyVerboseState(verbose_definition verbose_state_src, verbose_definition *
   verbose_state_dst->debug = verbose_state_src.debug;
   verbose_state_dst->nocounters = verbose_state_src.nocounters;
   verbose_state_dst->indent = verbose_state_src.indent;
+  verbose_state_dst->timing = verbose_state_src.timing;
 }
 int convert_if_uniform_frequency_spacing(datafile_definition *datafile, verbose_definition verbose)
 {
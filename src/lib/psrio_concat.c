@@ -0,0 +1,377 @@
+/*
+Copyright (c) 2015, Patrick Weltevrede
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "psrsalsa.h"
+datafile_definition *internal_concat_file(psrsalsa_concat_definition *concat, int filenr, verbose_definition verbose)
+{
+  int i, oldest;
+  verbose_definition verbose2;
+  concat->age++;
+  concat->lastused[filenr] = concat->age;
+  if(concat->files[filenr].opened_flag)
+    return &(concat->files[filenr]);
+  copyVerboseState(verbose, &verbose2);
+  verbose2.verbose = 0;
+  verbose2.nocounters = 1;
+  if(concat->nropen >= maxNrConcatFilesOpen) {
+    oldest = -1;
+    for(i = 0; i < concat->nrfiles; i++) {
+      if(concat->files[i].opened_flag && i != filenr) {
+ if(oldest < 0 || concat->lastused[i] < concat->lastused[oldest])
+   oldest = i;
+      }
+    }
+    if(oldest >= 0) {
+      if(verbose.debug)
+ printf("DEBUG: Closing '%s' to stay within %d open files\n", concat->filenames[oldest], maxNrConcatFilesOpen);
+      closePSRData(&(concat->files[oldest]), 0, verbose2);
+      concat->nropen--;
+    }
+  }
+  if(openPSRData(&(concat->files[filenr]), concat->filenames[filenr], concat->format, 0, 0, 1, verbose2) == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR internal_concat_file: Cannot open '%s'.", concat->filenames[filenr]);
+    return NULL;
+  }
+  if(readHeaderPSRData(&(concat->files[filenr]), 0, 1, verbose2) == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR internal_concat_file: Cannot read header of '%s'.", concat->filenames[filenr]);
+    closePSRData(&(concat->files[filenr]), 0, verbose2);
+    return NULL;
+  }
+  if(concat->files[filenr].NrSubints != concat->firstsubint[filenr+1]-concat->firstsubint[filenr]) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR internal_concat_file: Number of subintegrations in '%s' changed after it was first opened.", concat->filenames[filenr]);
+    closePSRData(&(concat->files[filenr]), 0, verbose2);
+    return NULL;
+  }
+  concat->nropen++;
+  return &(concat->files[filenr]);
+}
+int internal_concat_compatible(datafile_definition *first, datafile_definition *other, verbose_definition verbose)
+{
+  if(other->NrBins != first->NrBins || other->NrPols != first->NrPols || other->NrFreqChan != first->NrFreqChan) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR openConcatPSRData: Dimensions of '%s' (%ld bins, %ld polarizations, %ld channels) differ from those of '%s' (%ld bins, %ld polarizations, %ld channels).", other->filename, other->NrBins, other->NrPols, other->NrFreqChan, first->filename, first->NrBins, first->NrPols, first->NrFreqChan);
+    return 0;
+  }
+  if(other->gentype != first->gentype || other->poltype != first->poltype || other->isFolded != first->isFolded || other->isTransposed != first->isTransposed) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR openConcatPSRData: Type of data in '%s' differs from that in '%s'.", other->filename, first->filename);
+    return 0;
+  }
+  if(other->isFolded && fabs(other->fixedPeriod-first->fixedPeriod) > 1e-9*fabs(first->fixedPeriod)) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR openConcatPSRData: Folding period of '%s' differs from that of '%s'.", other->filename, first->filename);
+    return 0;
+  }
+  if(other->isDeDisp != first->isDeDisp || other->isDeFarad != first->isDeFarad || other->isDePar != first->isDePar || other->isDebase != first->isDebase) {
+    fflush(stdout);
+    printwarning(verbose.debug, "WARNING openConcatPSRData: Applied corrections (dedispersion, de-Faraday rotation, parallactic angle, baseline) of '%s' differ from those of '%s'. The values of the first file are used.", other->filename, first->filename);
+  }
+  return 1;
+}
+int closeConcatPSRData(datafile_definition *datafile, verbose_definition verbose)
+{
+  int i;
+  psrsalsa_concat_definition *concat;
+  verbose_definition verbose2;
+  concat = (psrsalsa_concat_definition *)datafile->concat;
+  if(concat == NULL)
+    return 1;
+  copyVerboseState(verbose, &verbose2);
+  verbose2.verbose = 0;
+  verbose2.nocounters = 1;
+  for(i = 0; i < concat->nrfiles; i++) {
+    if(concat->files[i].opened_flag)
+      closePSRData(&(concat->files[i]), 0, verbose2);
+    free(concat->filenames[i]);
+  }
+  free(concat->filenames);
+  free(concat->files);
+  free(concat->firstsubint);
+  free(concat->lastused);
+  free(concat);
+  datafile->concat = NULL;
+  return 1;
+}
+int openConcatPSRData(datafile_definition *datafile, char **filenames, int nrfiles, int format, int read_in_memory, verbose_definition verbose)
+{
+  int i, fixedtsub;
+  long j, c, nrsubints;
+  long double mjd_expected;
+  double *tsub, *freqs, *ptr;
+  psrsalsa_concat_definition *concat;
+  datafile_definition *file;
+  verbose_definition verbose2;
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("Combining %d files into a single dataset\n", nrfiles);
+  }
+  cleanPSRData(datafile, verbose);
+  if(nrfiles < 1) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR openConcatPSRData: No files specified.");
+    return 0;
+  }
+  copyVerboseState(verbose, &verbose2);
+  verbose2.indent = verbose.indent + 2;
+  if(format <= 0)
+    format = guessPSRData_format(filenames[0], 0, verbose);
+  if(isValidPSRDATA_format(format) == 0)
+    return 0;
+  concat = (psrsalsa_concat_definition *)malloc(sizeof(psrsalsa_concat_definition));
+  if(concat == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR openConcatPSRData: Memory allocation error.");
+    return 0;
+  }
+  concat->nrfiles = nrfiles;
+  concat->format = format;
+  concat->nropen = 0;
+  concat->age = 0;
+  concat->filenames = (char **)calloc(nrfiles, sizeof(char *));
+  concat->files = (datafile_definition *)malloc(nrfiles*sizeof(datafile_definition));
+  concat->firstsubint = (long *)malloc((nrfiles+1)*sizeof(long));
+  concat->lastused = (long *)calloc(nrfiles, sizeof(long));
+  if(concat->filenames == NULL || concat->files == NULL || concat->firstsubint == NULL || concat->lastused == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR openConcatPSRData: Memory allocation error.");
+    return 0;
+  }
+  datafile->concat = concat;
+  for(i = 0; i < nrfiles; i++) {
+    cleanPSRData(&(concat->files[i]), verbose);
+    concat->filenames[i] = (char *)malloc(strlen(filenames[i])+1);
+    if(concat->filenames[i] == NULL) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR openConcatPSRData: Memory allocation error.");
+      closeConcatPSRData(datafile, verbose);
+      return 0;
+    }
+    strcpy(concat->filenames[i], filenames[i]);
+  }
+  tsub = NULL;
+  freqs = NULL;
+  fixedtsub = 1;
+  mjd_expected = 0;
+  concat->firstsubint[0] = 0;
+  for(i = 0; i < nrfiles; i++) {
+    if(verbose.verbose) {
+      for(j = 0; j < verbose2.indent; j++)
+ printf(" ");
+      printf("Reading header of '%s'\n", filenames[i]);
+    }
+    concat->firstsubint[i+1] = -1;
+    file = &(concat->files[i]);
+    if(openPSRData(file, filenames[i], format, 0, 0, 1, verbose2) == 0 || readHeaderPSRData(file, 0, 1, verbose2) == 0) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR openConcatPSRData: Cannot open '%s'.", filenames[i]);
+      free(tsub);
+      free(freqs);
+      closeConcatPSRData(datafile, verbose);
+      return 0;
+    }
+    if(i == 0) {
+      if(copy_params_PSRData(*file, datafile, verbose) == 0) {
+ datafile->concat = concat;
+ free(tsub);
+ free(freqs);
+ closeConcatPSRData(datafile, verbose);
+ return 0;
+      }
+      datafile->concat = concat;
+    }else {
+      if(internal_concat_compatible(&(concat->files[0]), file, verbose) == 0) {
+ free(tsub);
+ free(freqs);
+ closeConcatPSRData(datafile, verbose);
+ return 0;
+      }
+      if(fabsl(file->mjd_start-mjd_expected)*86400.0 > 0.5*get_tsub(*file, 0, verbose)) {
+ fflush(stdout);
+ printwarning(verbose.debug, "WARNING openConcatPSRData: '%s' does not start where '%s' ends (offset is %.3lf s). The subintegrations are treated as being consecutive.", filenames[i], filenames[i-1], (double)((file->mjd_start-mjd_expected)*86400.0));
+      }
+    }
+    concat->firstsubint[i+1] = concat->firstsubint[i] + file->NrSubints;
+    nrsubints = concat->firstsubint[i+1];
+    ptr = (double *)realloc(tsub, nrsubints*sizeof(double));
+    if(ptr == NULL) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR openConcatPSRData: Memory allocation error.");
+      free(tsub);
+      free(freqs);
+      closeConcatPSRData(datafile, verbose);
+      return 0;
+    }
+    tsub = ptr;
+    ptr = (double *)realloc(freqs, nrsubints*file->NrFreqChan*sizeof(double));
+    if(ptr == NULL) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR openConcatPSRData: Memory allocation error.");
+      free(tsub);
+      free(freqs);
+      closeConcatPSRData(datafile, verbose);
+      return 0;
+    }
+    freqs = ptr;
+    mjd_expected = file->mjd_start;
+    for(j = 0; j < file->NrSubints; j++) {
+      tsub[concat->firstsubint[i]+j] = get_tsub(*file, j, verbose);
+      if(fabs(tsub[concat->firstsubint[i]+j]-tsub[0]) > 1e-9*fabs(tsub[0]))
+ fixedtsub = 0;
+      mjd_expected += tsub[concat->firstsubint[i]+j]/86400.0;
+      for(c = 0; c < file->NrFreqChan; c++)
+ freqs[(concat->firstsubint[i]+j)*file->NrFreqChan+c] = get_weighted_channel_freq(*file, j, c, verbose);
+    }
+    if(concat->nropen < maxNrConcatFilesOpen-1) {
+      concat->nropen++;
+      concat->lastused[i] = ++concat->age;
+    }else {
+      closePSRData(file, 0, verbose2);
+    }
+  }
+  datafile->NrSubints = nrsubints;
+  free(datafile->tsub_list);
+  if(fixedtsub) {
+    datafile->tsubMode = TSUBMODE_FIXEDTSUB;
+    datafile->tsub_list = (double *)malloc(sizeof(double));
+    if(datafile->tsub_list != NULL)
+      datafile->tsub_list[0] = tsub[0];
+    free(tsub);
+  }else {
+    datafile->tsubMode = TSUBMODE_TSUBLIST;
+    datafile->tsub_list = tsub;
+  }
+  if(datafile->tsub_list == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR openConcatPSRData: Memory allocation error.");
+    free(freqs);
+    closeConcatPSRData(datafile, verbose);
+    return 0;
+  }
+  if(datafile->freqlabel_list != NULL) {
+    free(datafile->freqlabel_list);
+    datafile->freqlabel_list = NULL;
+  }
+  for(j = 0; j < nrsubints*datafile->NrFreqChan; j++) {
+    if(fabs(freqs[j]-freqs[j % datafile->NrFreqChan]) > 1e-6*fabs(freqs[j % datafile->NrFreqChan]))
+      break;
+  }
+  if(datafile->freqMode == FREQMODE_FREQTABLE || j != nrsubints*datafile->NrFreqChan) {
+    datafile->freqMode = FREQMODE_FREQTABLE;
+    datafile->freqlabel_list = freqs;
+  }else {
+    free(freqs);
+  }
+  datafile->format = CONCAT_format;
+  datafile->opened_flag = 1;
+  if(verbose.verbose) {
+    for(i = 0; i < verbose2.indent; i++)
+      printf(" ");
+    printf("%ld subintegrations in total\n", datafile->NrSubints);
+  }
+  if(read_in_memory) {
+    if(readInMemoryPSRData(datafile, verbose) == 0) {
+      closePSRData(datafile, 0, verbose2);
+      return 0;
+    }
+  }
+  return 1;
+}
+int internal_concat_locate(psrsalsa_concat_definition *concat, long pulsenr)
+{
+  int lo, hi, mid;
+  lo = 0;
+  hi = concat->nrfiles-1;
+  while(lo < hi) {
+    mid = (lo+hi+1)/2;
+    if(concat->firstsubint[mid] <= pulsenr)
+      lo = mid;
+    else
+      hi = mid-1;
+  }
+  return lo;
+}
+int readPulseConcatData(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse, verbose_definition verbose)
+{
+  int filenr;
+  long offset, available, nr;
+  psrsalsa_concat_definition *concat;
+  datafile_definition *file;
+  concat = (psrsalsa_concat_definition *)datafile->concat;
+  if(pulsenr < 0 || pulsenr >= datafile->NrSubints) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR readPulseConcatData: Subintegration %ld is out of range.", pulsenr);
+    return 0;
+  }
+  filenr = internal_concat_locate(concat, pulsenr);
+  pulsenr -= concat->firstsubint[filenr];
+  while(nrSamples > 0) {
+    if(filenr >= concat->nrfiles) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR readPulseConcatData: Requested samples extend beyond the end of the data.");
+      return 0;
+    }
+    file = internal_concat_file(concat, filenr, verbose);
+    if(file == NULL)
+      return 0;
+    offset = datafile->NrBins*(polarization+datafile->NrPols*(freq+pulsenr*datafile->NrFreqChan))+binnr;
+    available = (concat->firstsubint[filenr+1]-concat->firstsubint[filenr])*datafile->NrFreqChan*datafile->NrPols*datafile->NrBins-offset;
+    nr = nrSamples;
+    if(nr > available)
+      nr = available;
+    if(readPulsePSRData(file, pulsenr, polarization, freq, binnr, nr, pulse, verbose) != 1)
+      return 0;
+    pulse += nr;
+    nrSamples -= nr;
+    filenr++;
+    pulsenr = 0;
+    polarization = 0;
+    freq = 0;
+    binnr = 0;
+  }
+  return 1;
+}
+int readConcatfile(datafile_definition *datafile, float *data, verbose_definition verbose)
+{
+  int filenr;
+  long i, profilesize;
+  psrsalsa_concat_definition *concat;
+  datafile_definition *file;
+  concat = (psrsalsa_concat_definition *)datafile->concat;
+  profilesize = datafile->NrBins*datafile->NrPols*datafile->NrFreqChan;
+  for(filenr = 0; filenr < concat->nrfiles; filenr++) {
+    if(verbose.verbose) {
+      for(i = 0; i < verbose.indent; i++)
+ printf(" ");
+      printf("Reading data from '%s'\n", concat->filenames[filenr]);
+    }
+    file = internal_concat_file(concat, filenr, verbose);
+    if(file == NULL)
+      return 0;
+    if(readPSRData(file, &data[concat->firstsubint[filenr]*profilesize], verbose) != 1) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR readConcatfile: Cannot read data from '%s'.", concat->filenames[filenr]);
+      return 0;
+    }
+  }
+  return 1;
+}
@@ -18,11 +18,15 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #define _LARGEFILE_SOURCE 1
 #include <string.h>
 #include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "fitsio.h"
 #include "psrsalsa.h"
 static int psrfits_weightmode = 0;
 static int psrfits_use_weighted_freq = 0;
 static int psrfits_absweights = 0;
+static int psrfits_headeronly = 0;
 void print_fitsio_version_used(FILE *stream)
 {
   float version;
@@ -40,19 +44,23 @@ void psrfits_set_use_weighted_freq(int val)
 {
   psrfits_use_weighted_freq = val;
 }
+void psrfits_set_headeronly(int val)
+{
+  psrfits_headeronly = val;
+}
 void internalFITSscalePulse(float *pulse, long nrSamples, float *offset, float *scale, float maxvalue)
 {
   long i;
-  *offset = pulse[0];
-  for(i = 0; i < nrSamples; i++) {
-    if(pulse[i] < *offset)
-      *offset = pulse[i];
-  }
-  *scale = (pulse[0]-*offset)/maxvalue;
+  float vmin, vmax;
+  vmin = pulse[0];
+  vmax = pulse[0];
+#pragma omp simd reduction(min:vmin) reduction(max:vmax)
   for(i = 0; i < nrSamples; i++) {
-    if((pulse[i]-*offset)/(*scale) > maxvalue)
-      *scale = (pulse[i]-*offset)/maxvalue;
+    vmin = pulse[i] < vmin ? pulse[i] : vmin;
+    vmax = pulse[i] > vmax ? pulse[i] : vmax;
   }
+  *offset = vmin;
+  *scale = (vmax-vmin)/maxvalue;
   if(*scale == 0.0)
     *scale = 1;
 }
@@ -207,6 +215,192 @@ int writeFITSpulse(datafile_definition datafile, long pulsenr, int polarization,
   }
   return 1;
 }
+void internalFITSscaleSubint(float *subintdata, long nrBins, long nrPols, long nrFreqChan, float *offsets, float *scales, short *rowdata, float maxvalue)
+{
+  long i, p, f, nrprofiles;
+  nrprofiles = nrPols*nrFreqChan;
+#pragma omp parallel for private(i, p, f) if(nrprofiles*nrBins >= 65536)
+  for(i = 0; i < nrprofiles; i++) {
+    float *pulse, scale, offset;
+    short *output;
+    long b;
+    p = i / nrFreqChan;
+    f = i % nrFreqChan;
+    pulse = &subintdata[nrBins*(p+nrPols*f)];
+    output = &rowdata[nrBins*(f+nrFreqChan*p)];
+    internalFITSscalePulse(pulse, nrBins, &offset, &scale, maxvalue);
+#pragma omp simd
+    for(b = 0; b < nrBins; b++) {
+      output[b] = (pulse[b]-offset)/scale;
+    }
+    offsets[i] = offset;
+    scales[i] = scale;
+  }
+}
+int writeFITSsubint_folded(datafile_definition datafile, long subintnr, float *subintdata, verbose_definition verbose)
+{
+  int status = 0;
+  long i, nrprofiles;
+  short *rowdata;
+  float *scales, *offsets, *weights;
+  double period;
+  int ret;
+  if(datafile.isFolded) {
+    ret = get_period(datafile, 0, &period, verbose);
+    if(ret == 2) {
+      printerror(verbose.debug, "ERROR writeFITSsubint_folded (%s): Cannot obtain period", datafile.filename);
+      return 0;
+    }
+  }else {
+    ret = 1;
+    period = -1;
+  }
+  if(datafile.gentype == GENTYPE_SEARCHMODE || datafile.gentype == GENTYPE_RECEIVERMODEL || datafile.gentype == GENTYPE_RECEIVERMODEL2 || datafile.isFolded != 1 || ret == 1 || period < 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writeFITSsubint_folded: This function only supports folded data.");
+    return 0;
+  }
+  if(lookupSubintTable(datafile, verbose) == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writeFITSsubint_folded: Cannot move to subint table.");
+    return 0;
+  }
+  nrprofiles = datafile.NrPols*datafile.NrFreqChan;
+  rowdata = (short *)malloc(nrprofiles*datafile.NrBins*sizeof(short));
+  scales = (float *)malloc(nrprofiles*sizeof(float));
+  offsets = (float *)malloc(nrprofiles*sizeof(float));
+  weights = (float *)malloc(datafile.NrFreqChan*sizeof(float));
+  if(rowdata == NULL || scales == NULL || offsets == NULL || weights == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writeFITSsubint_folded: Memory allocation error.");
+    free(rowdata);
+    free(scales);
+    free(offsets);
+    free(weights);
+    return 0;
+  }
+  internalFITSscaleSubint(subintdata, datafile.NrBins, datafile.NrPols, datafile.NrFreqChan, offsets, scales, rowdata, 32767);
+  for(i = 0; i < datafile.NrFreqChan; i++)
+    weights[i] = 1;
+  ret = 0;
+  if(fits_write_col(datafile.fits_fptr, TSHORT, 18, 1+subintnr, 1, nrprofiles*datafile.NrBins, rowdata, &status) != 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writeFITSsubint_folded: Error writing data (subint=%ld).", subintnr);
+    fits_report_error(stderr, status);
+    for(i = 0; i < nrprofiles*datafile.NrBins; i++) {
+      if(isnan(subintdata[i]) || isinf(subintdata[i])) {
+ printerror(verbose.debug, "ERROR writeFITSsubint_folded: Sample %ld: %f", i+1, subintdata[i]);
+ break;
+      }
+    }
+  }else if(fits_write_col(datafile.fits_fptr, TFLOAT, 17, 1+subintnr, 1, nrprofiles, scales, &status) != 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writeFITSsubint_folded: Error writing scales.");
+    fits_report_error(stderr, status);
+  }else if(fits_write_col(datafile.fits_fptr, TFLOAT, 16, 1+subintnr, 1, nrprofiles, offsets, &status) != 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writeFITSsubint_folded: Error writing offsets.");
+    fits_report_error(stderr, status);
+  }else if(fits_write_col(datafile.fits_fptr, TFLOAT, 15, 1+subintnr, 1, datafile.NrFreqChan, weights, &status) != 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writeFITSsubint_folded: Error writing weights (subint=%ld).", 1+subintnr);
+    fits_report_error(stderr, status);
+  }else {
+    ret = 1;
+  }
+  free(rowdata);
+  free(scales);
+  free(offsets);
+  free(weights);
+  return ret;
+}
+int flushFITSrowbuffer(datafile_definition *datafile, verbose_definition verbose)
+{
+  int ret;
+  long profile, nrprofiles;
+  if(datafile->fits_rowbuffer == NULL || datafile->fits_rowbuffer_filled == 0)
+    return 1;
+  nrprofiles = datafile->NrPols*datafile->NrFreqChan;
+  if(datafile->fits_rowbuffer_filled == nrprofiles) {
+    ret = writeFITSsubint_folded(*datafile, datafile->fits_rowbuffer_subint, datafile->fits_rowbuffer, verbose);
+  }else {
+    if(verbose.debug) {
+      printf("    Subint %ld is written out per profile as only %ld out of %ld profiles were provided\n", datafile->fits_rowbuffer_subint, datafile->fits_rowbuffer_filled, nrprofiles);
+    }
+    ret = 1;
+    for(profile = 0; profile < nrprofiles; profile++) {
+      if(datafile->fits_rowbuffer_profiles[profile]) {
+ if(writeFITSpulse(*datafile, datafile->fits_rowbuffer_subint, profile % datafile->NrPols, profile / datafile->NrPols, 0, datafile->NrBins, &datafile->fits_rowbuffer[datafile->NrBins*profile], verbose) != 1) {
+   ret = 0;
+   break;
+ }
+      }
+    }
+  }
+  memset(datafile->fits_rowbuffer_profiles, 0, nrprofiles);
+  datafile->fits_rowbuffer_filled = 0;
+  if(ret != 1) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR flushFITSrowbuffer: Cannot write subint %ld.", datafile->fits_rowbuffer_subint);
+    return 0;
+  }
+  return 1;
+}
+int writeFITSpulse_buffered(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse, verbose_definition verbose)
+{
+  long profile, nrprofiles;
+  if(datafile->gentype == GENTYPE_RECEIVERMODEL || datafile->gentype == GENTYPE_RECEIVERMODEL2) {
+    return writeFITSpulse(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
+  }
+  nrprofiles = datafile->NrPols*datafile->NrFreqChan;
+  if(pulsenr < 0 || pulsenr >= datafile->NrSubints || polarization < 0 || polarization >= datafile->NrPols || freq < 0 || freq >= datafile->NrFreqChan || binnr < 0 || binnr+nrSamples > datafile->NrBins) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writeFITSpulse_buffered: Trying to write outside the data range (subint=%ld pol=%d freq=%d bins %d-%ld).", pulsenr, polarization, freq, binnr, binnr+nrSamples-1);
+    return 0;
+  }
+  if(datafile->fits_rowbuffer == NULL) {
+    double period;
+    if(datafile->gentype == GENTYPE_SEARCHMODE || datafile->isFolded != 1 || get_period(*datafile, 0, &period, verbose) != 0 || period < 0) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR writeFITSpulse_buffered: This function is not working properly for search mode data. Write out whole subints instead of per channel data.");
+      return 0;
+    }
+    datafile->fits_rowbuffer = (float *)malloc(nrprofiles*datafile->NrBins*sizeof(float));
+    datafile->fits_rowbuffer_profiles = (char *)calloc(nrprofiles, sizeof(char));
+    if(datafile->fits_rowbuffer == NULL || datafile->fits_rowbuffer_profiles == NULL) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR writeFITSpulse_buffered: Memory allocation error.");
+      if(datafile->fits_rowbuffer != NULL)
+ free(datafile->fits_rowbuffer);
+      if(datafile->fits_rowbuffer_profiles != NULL)
+ free(datafile->fits_rowbuffer_profiles);
+      datafile->fits_rowbuffer = NULL;
+      datafile->fits_rowbuffer_profiles = NULL;
+      return 0;
+    }
+    datafile->fits_rowbuffer_subint = pulsenr;
+    datafile->fits_rowbuffer_filled = 0;
+  }
+  if(pulsenr != datafile->fits_rowbuffer_subint) {
+    if(flushFITSrowbuffer(datafile, verbose) != 1)
+      return 0;
+    datafile->fits_rowbuffer_subint = pulsenr;
+  }
+  profile = polarization+datafile->NrPols*freq;
+  if(datafile->fits_rowbuffer_profiles[profile] == 0 && (binnr != 0 || nrSamples != datafile->NrBins)) {
+    return writeFITSpulse(*datafile, pulsenr, polarization, freq, binnr, nrSamples, pulse, verbose);
+  }
+  memcpy(&datafile->fits_rowbuffer[datafile->NrBins*profile+binnr], pulse, nrSamples*sizeof(float));
+  if(datafile->fits_rowbuffer_profiles[profile] == 0) {
+    datafile->fits_rowbuffer_profiles[profile] = 1;
+    datafile->fits_rowbuffer_filled++;
+  }
+  if(datafile->fits_rowbuffer_filled == nrprofiles) {
+    if(flushFITSrowbuffer(datafile, verbose) != 1)
+      return 0;
+  }
+  return 1;
+}
 int readFITSpulse_receivermodel(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse, verbose_definition verbose)
 {
   int status = 0;
@@ -637,21 +831,32 @@ int readPSRFITSscales(datafile_definition *datafile, verbose_definition verbose)
       printf(" ");
     printf("readPSRFITSscales: fullscales = %d\n", fullscales);
   }
-  for(n = 0; n < datafile->NrSubints; n++) {
-    for(p = 0; p < datafile->NrPols; p++) {
-      if(!fits_read_col(datafile->fits_fptr, TFLOAT, colnum_s, 1+n, 1+fullscales*p*datafile->NrFreqChan, datafile->NrFreqChan, NULL, &datafile->scales[n*datafile->NrPols*datafile->NrFreqChan+p*datafile->NrFreqChan], &anynul, &status)) {
-      }
-      if(!fits_read_col(datafile->fits_fptr, TFLOAT, colnum_o, 1+n, 1+fullscales*p*datafile->NrFreqChan, datafile->NrFreqChan, NULL, &datafile->offsets[n*datafile->NrPols*datafile->NrFreqChan+p*datafile->NrFreqChan], &anynul, &status)) {
-      }
-      if(p == 0) {
- if(!fits_read_col(datafile->fits_fptr, TFLOAT, colnum_w, 1+n, 1+fullscales*p*datafile->NrFreqChan, datafile->NrFreqChan, NULL, &datafile->weights[n*datafile->NrFreqChan], &anynul, &status)) {
+  if(fullscales) {
+    fits_read_col(datafile->fits_fptr, TFLOAT, colnum_s, 1, 1, datafile->NrSubints*datafile->NrPols*datafile->NrFreqChan, NULL, datafile->scales, &anynul, &status);
+    fits_read_col(datafile->fits_fptr, TFLOAT, colnum_o, 1, 1, datafile->NrSubints*datafile->NrPols*datafile->NrFreqChan, NULL, datafile->offsets, &anynul, &status);
+    fits_read_col(datafile->fits_fptr, TFLOAT, colnum_w, 1, 1, datafile->NrSubints*datafile->NrFreqChan, NULL, datafile->weights, &anynul, &status);
+    if (status) {
+      fflush(stdout);
+      fits_report_error(stderr, status);
+      ret = 0;
+    }
+  }else {
+    for(n = 0; n < datafile->NrSubints; n++) {
+      for(p = 0; p < datafile->NrPols; p++) {
+ if(!fits_read_col(datafile->fits_fptr, TFLOAT, colnum_s, 1+n, 1+fullscales*p*datafile->NrFreqChan, datafile->NrFreqChan, NULL, &datafile->scales[n*datafile->NrPols*datafile->NrFreqChan+p*datafile->NrFreqChan], &anynul, &status)) {
+ }
+ if(!fits_read_col(datafile->fits_fptr, TFLOAT, colnum_o, 1+n, 1+fullscales*p*datafile->NrFreqChan, datafile->NrFreqChan, NULL, &datafile->offsets[n*datafile->NrPols*datafile->NrFreqChan+p*datafile->NrFreqChan], &anynul, &status)) {
+ }
+ if(p == 0) {
+   if(!fits_read_col(datafile->fits_fptr, TFLOAT, colnum_w, 1+n, 1+fullscales*p*datafile->NrFreqChan, datafile->NrFreqChan, NULL, &datafile->weights[n*datafile->NrFreqChan], &anynul, &status)) {
+   }
+ }
+ if (status) {
+   fflush(stdout);
+   fits_report_error(stderr, status);
+   ret = 0;
+   break;
  }
-      }
-      if (status) {
- fflush(stdout);
- fits_report_error(stderr, status);
- ret = 0;
- break;
       }
     }
   }
@@ -1416,29 +1621,38 @@ void update_freqs_using_DAT_FREQ_column(datafile_definition *datafile, verbose_d
       printerror(verbose.debug, "ERROR readPSRFITSHeader (%s): Memory allocation error.", datafile->filename);
       exit(0);
     }
-    long subint, freqchan;
-    double freq;
-    for(subint = 0; subint < datafile->NrSubints; subint++) {
-      for(freqchan = 0; freqchan < datafile->NrFreqChan; freqchan++) {
- if(fits_read_col(datafile->fits_fptr, TDOUBLE, colnum, 1+subint, 1+freqchan, 1, NULL, &(freq), &anynul, &status)) {
-   fflush(stdout);
-   printwarning(verbose.debug, "WARNING readPSRFITSHeader (%s): Cannot read DAT_FREQ in subint table to determine observing frequency.", datafile->filename);
-   status = 0;
-   datafile->freqMode = FREQMODE_UNIFORM;
-   free(datafile->freqlabel_list);
-   datafile->freqlabel_list = NULL;
-   return;
- }else {
-   if(set_weighted_channel_freq(datafile, subint, freqchan, freq, verbose) == 0) {
-     fflush(stdout);
-     printerror(verbose.debug, "ERROR readPSRFITSHeader (%s): Error setting (weighted) frequency for channel/subint.", datafile->filename);
-     exit(0);
-   }
- }
-      }
+    if(fits_read_col(datafile->fits_fptr, TDOUBLE, colnum, 1, 1, datafile->NrSubints*datafile->NrFreqChan, NULL, datafile->freqlabel_list, &anynul, &status)) {
+      fflush(stdout);
+      printwarning(verbose.debug, "WARNING readPSRFITSHeader (%s): Cannot read DAT_FREQ in subint table to determine observing frequency.", datafile->filename);
+      status = 0;
+      datafile->freqMode = FREQMODE_UNIFORM;
+      free(datafile->freqlabel_list);
+      datafile->freqlabel_list = NULL;
+      return;
     }
   }
 }
+int readPSRFITSdeferred(datafile_definition *datafile, verbose_definition verbose)
+{
+  int status = 0;
+  if((datafile->deferred & (DEFERRED_SCALES | DEFERRED_FREQTABLE)) == 0)
+    return 1;
+  if(fits_movnam_hdu(datafile->fits_fptr, BINARY_TBL, "SUBINT", 0, &status)) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR readPSRFITSdeferred (%s): SUBINT table does not exist!", datafile->filename);
+    return 0;
+  }
+  if(datafile->deferred & DEFERRED_FREQTABLE) {
+    datafile->deferred &= ~DEFERRED_FREQTABLE;
+    update_freqs_using_DAT_FREQ_column(datafile, verbose);
+  }
+  if(datafile->deferred & DEFERRED_SCALES) {
+    datafile->deferred &= ~DEFERRED_SCALES;
+    if(readPSRFITSscales(datafile, verbose) == 0)
+      return 0;
+  }
+  return 1;
+}
 int readPSRFITSHeader(datafile_definition *datafile, int readnoscales, verbose_definition verbose)
 {
   char card[FLEN_CARD], comment[FLEN_COMMENT], value[FLEN_VALUE], value_tmp[FLEN_VALUE];
@@ -2257,7 +2471,10 @@ int readPSRFITSHeader(datafile_definition *datafile, int readnoscales, verbose_d
       fflush(stdout);
       printf("  readPSRFITSHeader (%s): Trying to use DAT_FREQ column in subint table to update centre frequency.\n", datafile->filename);
     }
-    update_freqs_using_DAT_FREQ_column(datafile, verbose);
+    if(psrfits_headeronly)
+      datafile->deferred |= DEFERRED_FREQTABLE;
+    else
+      update_freqs_using_DAT_FREQ_column(datafile, verbose);
     if (status == END_OF_FILE) status = 0;
     if(issearch) {
       datafile->tsubMode = TSUBMODE_FIXEDTSUB;
@@ -2293,8 +2510,24 @@ int readPSRFITSHeader(datafile_definition *datafile, int readnoscales, verbose_d
    }
  }
  tot_duration = subint_duration = 0;
+ double *tsub_column;
+ long nrtsubread;
+ tsub_column = (double *)malloc(datafile->NrSubints*sizeof(double));
+ if(tsub_column == NULL) {
+   fflush(stdout);
+   printerror(verbose.debug, "ERROR readPSRFITSHeader: Memory allocation error");
+   return 0;
+ }
+ nrtsubread = datafile->NrSubints;
+ if(datafile->NrSubints > 0 && fits_read_col(datafile->fits_fptr, TDOUBLE, colnum, 1, 1, datafile->NrSubints, NULL, tsub_column, &anynul, &status)) {
+   status = 0;
+   for(nrtsubread = 0; nrtsubread < datafile->NrSubints; nrtsubread++) {
+     if(fits_read_col(datafile->fits_fptr, TDOUBLE, colnum, 1+nrtsubread, 1, 1, NULL, &tsub_column[nrtsubread], &anynul, &status))
+       break;
+   }
+ }
  for(i = 0; i < datafile->NrSubints; i++) {
-   if(fits_read_col(datafile->fits_fptr, TDOUBLE, colnum, 1+i, 1, 1, NULL, &(subint_duration), &anynul, &status)) {
+   if(i >= nrtsubread) {
      if(tsubnotset) {
        fflush(stdout);
        printwarning(verbose.debug, "WARNING readPSRFITSHeader (%s): Cannot read TSUBINT in subint table to determine observation duration.", datafile->filename);
@@ -2307,12 +2540,14 @@ int readPSRFITSHeader(datafile_definition *datafile, int readnoscales, verbose_d
      }
      break;
    }else {
+     subint_duration = tsub_column[i];
      if(tsubnotset) {
        datafile->tsub_list[i] = subint_duration;
      }
      tot_duration += subint_duration;
    }
  }
+ free(tsub_column);
  if(ok) {
    double expected_duration, testvalue;
    double period;
@@ -2424,9 +2659,14 @@ int readPSRFITSHeader(datafile_definition *datafile, int readnoscales, verbose_d
       fflush(stdout);
       fits_report_error(stderr, status);
     }
+    if(psrfits_headeronly)
+      datafile->deferred |= DEFERRED_HISTORY;
     if(readnoscales)
       return 1;
-    else
+    else if(psrfits_headeronly) {
+      datafile->deferred |= DEFERRED_SCALES;
+      return 1;
+    }else
       return readPSRFITSscales(datafile, verbose);
   }
   if(nodata) {
@@ -2497,22 +2737,46 @@ int readPSRFITSHeader(datafile_definition *datafile, int readnoscales, verbose_d
   }
   return 1;
 }
+void internalFITSpackSamples(unsigned short *samples, long nrsamples, int nrbits, unsigned char *output)
+{
+  long i, nrbytes, nrfull;
+  if(nrbits == 8) {
+#pragma omp simd
+    for(i = 0; i < nrsamples; i++)
+      output[i] = samples[i];
+  }else if(nrbits == 16) {
+#pragma omp simd
+    for(i = 0; i < nrsamples; i++) {
+      output[2*i] = samples[i] >> 8;
+      output[2*i+1] = samples[i] & 255;
+    }
+  }else if(nrbits == 4) {
+    nrfull = nrsamples/2;
+#pragma omp simd
+    for(i = 0; i < nrfull; i++)
+      output[i] = (samples[2*i] << 4) | samples[2*i+1];
+    if(nrsamples % 2)
+      output[nrfull] = samples[2*nrfull] << 4;
+  }else if(nrbits == 2) {
+    nrfull = nrsamples/4;
+#pragma omp simd
+    for(i = 0; i < nrfull; i++)
+      output[i] = (samples[4*i] << 6) | (samples[4*i+1] << 4) | (samples[4*i+2] << 2) | samples[4*i+3];
+    if(nrsamples % 4) {
+      nrbytes = nrfull;
+      output[nrbytes] = 0;
+      for(i = 4*nrfull; i < nrsamples; i++)
+ output[nrbytes] |= samples[i] << (6-2*(i-4*nrfull));
+    }
+  }
+}
 int constructFITSsearchsubint(datafile_definition datafile, float *data, int subintnr, unsigned char **subintdata, float **scales, float **offsets, int alreadyscaled, int allocmem, int destroymem, verbose_definition verbose)
 {
-  long subintsize, f, p, b, samplenr, bitnr, bytenr;
-  int bitoff, ivalue, bitofffac[8];
-  float offset, scale, fvalue;
-  if(datafile.NrBits == 4) {
-    bitofffac[0] = 16;
-    bitofffac[4] = 1;
-  }else if(datafile.NrBits == 8) {
-    bitofffac[0] = 1;
-  }else if(datafile.NrBits == 2) {
-    bitofffac[0] = 64;
-    bitofffac[2] = 16;
-    bitofffac[4] = 4;
-    bitofffac[6] = 1;
-  }else if(datafile.NrBits != 8) {
+  long subintsize, nrprofiles, nrsamples, b, k, badsample;
+  int maxvalue;
+  unsigned short *samples;
+  float *subint, *invscales;
+  if(datafile.NrBits != 2 && datafile.NrBits != 4 && datafile.NrBits != 8 && datafile.NrBits != 16) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR constructFITSsearchsubint: Writing of %d bits data is not supported", datafile.NrBits);
     return 0;
@@ -2523,13 +2787,13 @@ int constructFITSsearchsubint(datafile_definition datafile, float *data, int sub
     free(*offsets);
     return 1;
   }
-  subintsize = datafile.NrPols*datafile.NrBins*datafile.NrFreqChan;
-  subintsize *= datafile.NrBits;
-  subintsize /= 8;
+  nrprofiles = datafile.NrPols*datafile.NrFreqChan;
+  nrsamples = nrprofiles*datafile.NrBins;
+  subintsize = (nrsamples*datafile.NrBits+7)/8;
   if(allocmem) {
     *subintdata = (unsigned char *)malloc(subintsize);
-    *scales = (float *)malloc(datafile.NrPols*datafile.NrFreqChan*sizeof(float));
-    *offsets = (float *)malloc(datafile.NrPols*datafile.NrFreqChan*sizeof(float));
+    *scales = (float *)malloc(nrprofiles*sizeof(float));
+    *offsets = (float *)malloc(nrprofiles*sizeof(float));
     if(*subintdata == NULL || *scales == NULL || *offsets == NULL) {
       fflush(stdout);
       printerror(verbose.debug, "ERROR constructFITSsearchsubint: Cannot allocate %ld bytes", subintsize);
@@ -2537,42 +2801,77 @@ int constructFITSsearchsubint(datafile_definition datafile, float *data, int sub
     }
     return 1;
   }
-  memset(*subintdata, 0, subintsize);
-  for(f = 0; f < datafile.NrFreqChan; f++) {
+  maxvalue = (1 << datafile.NrBits) - 1;
+  subint = &data[nrsamples*(long)subintnr];
+  samples = (unsigned short *)malloc(nrsamples*sizeof(unsigned short));
+  invscales = (float *)malloc(nrprofiles*sizeof(float));
+  if(samples == NULL || invscales == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR constructFITSsearchsubint: Cannot allocate temporary memory");
+    free(samples);
+    free(invscales);
+    return 0;
+  }
+#pragma omp parallel for private(k) if(nrsamples >= 65536)
+  for(k = 0; k < nrprofiles; k++) {
+    long p, f;
+    float offset, scale;
+    p = k / datafile.NrFreqChan;
+    f = k % datafile.NrFreqChan;
+    if(alreadyscaled == 0) {
+      internalFITSscalePulse(&subint[datafile.NrBins*(p+datafile.NrPols*f)], datafile.NrBins, &offset, &scale, maxvalue);
+      (*offsets)[k] = offset;
+      (*scales)[k] = scale;
+      invscales[k] = 1.0/scale;
+    }else {
+      invscales[k] = 1;
+    }
+  }
+  badsample = -1;
+#pragma omp parallel for private(b) if(nrsamples >= 65536)
+  for(b = 0; b < datafile.NrBins; b++) {
+    long p, f, k;
+    float *input;
+    unsigned short *output;
+    int ivalue, bad;
+    output = &samples[b*nrprofiles];
+    bad = 0;
     for(p = 0; p < datafile.NrPols; p++) {
+      input = &subint[datafile.NrBins*p+b];
+      k = p*datafile.NrFreqChan;
       if(alreadyscaled == 0) {
- internalFITSscalePulse(&data[datafile.NrBins*(p+datafile.NrPols*(f+subintnr*datafile.NrFreqChan))], datafile.NrBins, &offset, &scale, pow(2, datafile.NrBits)-1);
- (*offsets)[p*datafile.NrFreqChan+f] = offset;
- (*scales)[p*datafile.NrFreqChan+f] = scale;
-      }
-      for(b = 0; b < datafile.NrBins; b++) {
- if(alreadyscaled == 0)
-   fvalue = (data[datafile.NrBins*(p+datafile.NrPols*(f+subintnr*datafile.NrFreqChan))+b]-(*offsets)[p*datafile.NrFreqChan+f])/(*scales)[p*datafile.NrFreqChan+f];
- else
-   fvalue = data[datafile.NrBins*(p+datafile.NrPols*(f+subintnr*datafile.NrFreqChan))+b];
- ivalue = fvalue+0.5;
-         samplenr = b*datafile.NrPols*datafile.NrFreqChan+p*datafile.NrFreqChan+f;
- bitnr = samplenr * datafile.NrBits;
- bytenr = bitnr/8;
- bitoff = bitnr % 8;
- if(datafile.NrBits != 16) {
-   ivalue *= bitofffac[bitoff];
-   if(ivalue > 255) {
-     fflush(stdout);
-     printerror(verbose.debug, "ERROR constructFITSsearchsubint: Packing error (sample %ld: val=%d mult=%d nrbits=%d)", samplenr, ivalue, bitofffac[bitoff], datafile.NrBits);
-     return 0;
-   }
-   (*subintdata)[bytenr] += ivalue;
- }else {
-   int ivalue2;
-   ivalue2 = ivalue/256;
-   (*subintdata)[bytenr] += ivalue2;
-   ivalue2 = ivalue % 256;
-   (*subintdata)[bytenr+1] += ivalue2;
+#pragma omp simd
+ for(f = 0; f < datafile.NrFreqChan; f++) {
+   float fvalue;
+   fvalue = (input[f*datafile.NrPols*datafile.NrBins]-(*offsets)[k+f])*invscales[k+f];
+   fvalue = fvalue >= 0 ? fvalue : 0;
+   fvalue = fvalue <= maxvalue ? fvalue : maxvalue;
+   output[k+f] = fvalue+0.5;
+ }
+      }else {
+#pragma omp simd reduction(|:bad) private(ivalue)
+ for(f = 0; f < datafile.NrFreqChan; f++) {
+   ivalue = input[f*datafile.NrPols*datafile.NrBins]+0.5;
+   bad |= (ivalue < 0 || ivalue > maxvalue);
+   output[k+f] = ivalue;
  }
       }
     }
+    if(bad) {
+#pragma omp critical
+      badsample = b;
+    }
   }
+  if(badsample >= 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR constructFITSsearchsubint: Packing error (sample %ld does not fit in %d bits)", badsample, datafile.NrBits);
+    free(samples);
+    free(invscales);
+    return 0;
+  }
+  internalFITSpackSamples(samples, nrsamples, datafile.NrBits, *subintdata);
+  free(samples);
+  free(invscales);
   return 1;
 }
 int writeFITSsubint(datafile_definition datafile, long subintnr, unsigned char *subintdata, float *scales, float *offsets, verbose_definition verbose)
@@ -2683,8 +2982,6 @@ int writeFITSsubint(datafile_definition datafile, long subintnr, unsigned char *
 }
 int writeFITSfile(datafile_definition datafile, float *data, verbose_definition verbose)
 {
-  unsigned char *subintdata;
-  float *scales, *offsets;
   long n, f, p;
   double period;
   int ret;
@@ -2698,7 +2995,7 @@ int writeFITSfile(datafile_definition datafile, float *data, verbose_definition
     ret = 1;
     period = -1;
   }
-  if((datafile.gentype != GENTYPE_SEARCHMODE && datafile.isFolded && ret == 0 && period >= 0) || datafile.gentype == GENTYPE_RECEIVERMODEL || datafile.gentype == GENTYPE_RECEIVERMODEL2) {
+  if(datafile.gentype == GENTYPE_RECEIVERMODEL || datafile.gentype == GENTYPE_RECEIVERMODEL2) {
     for(n = 0; n < datafile.NrSubints; n++) {
       if(verbose.verbose && verbose.nocounters == 0) printf("writeFITSfile: pulse %ld/%ld          \r", n+1, datafile.NrSubints);
       for(f = 0; f < datafile.NrFreqChan; f++) {
@@ -2711,31 +3008,77 @@ int writeFITSfile(datafile_definition datafile, float *data, verbose_definition
  }
       }
     }
+  }else if(datafile.gentype != GENTYPE_SEARCHMODE && datafile.isFolded && ret == 0 && period >= 0) {
+    for(n = 0; n < datafile.NrSubints; n++) {
+      if(verbose.verbose && verbose.nocounters == 0) printf("writeFITSfile: pulse %ld/%ld          \r", n+1, datafile.NrSubints);
+      if(writeFITSsubint_folded(datafile, n, &data[datafile.NrBins*datafile.NrPols*datafile.NrFreqChan*n], verbose) == 0) {
+ fflush(stdout);
+ printerror(verbose.debug, "ERROR writeFITSfile: Cannot write data               ");
+ return 0;
+      }
+    }
   }else {
-    n = 0;
-    if(constructFITSsearchsubint(datafile, data, n, &subintdata, &scales, &offsets, 0, 1, 0, verbose) != 1) {
+    long nrbuffers, block, nrblock;
+    int error;
+    unsigned char **subintdata_list;
+    float **scales_list, **offsets_list;
+    nrbuffers = 1;
+#ifdef _OPENMP
+    nrbuffers = omp_get_max_threads();
+#endif
+    if(nrbuffers > datafile.NrSubints)
+      nrbuffers = datafile.NrSubints;
+    if(nrbuffers < 1)
+      nrbuffers = 1;
+    subintdata_list = (unsigned char **)calloc(nrbuffers, sizeof(unsigned char *));
+    scales_list = (float **)calloc(nrbuffers, sizeof(float *));
+    offsets_list = (float **)calloc(nrbuffers, sizeof(float *));
+    if(subintdata_list == NULL || scales_list == NULL || offsets_list == NULL) {
       fflush(stdout);
       printerror(verbose.debug, "ERROR writeFITSfile: Cannot allocate temporary memory               ");
       return 0;
     }
-    for(n = 0; n < datafile.NrSubints; n++) {
-      if(verbose.verbose && verbose.nocounters == 0) printf("writeFITSfile: pulse %ld/%ld             \r", n+1, datafile.NrSubints);
-      if(constructFITSsearchsubint(datafile, data, n, &subintdata, &scales, &offsets, 0, 0, 0, verbose) != 1) {
+    for(n = 0; n < nrbuffers; n++) {
+      if(constructFITSsearchsubint(datafile, data, 0, &subintdata_list[n], &scales_list[n], &offsets_list[n], 0, 1, 0, verbose) != 1) {
  fflush(stdout);
- printerror(verbose.debug, "ERROR writeFITSfile: Cannot construct subint data               ");
+ printerror(verbose.debug, "ERROR writeFITSfile: Cannot allocate temporary memory               ");
  return 0;
       }
-      if(writeFITSsubint(datafile, n, subintdata, scales, offsets, verbose) != 1) {
+    }
+    error = 0;
+    for(block = 0; block < datafile.NrSubints && error == 0; block += nrbuffers) {
+      nrblock = datafile.NrSubints - block;
+      if(nrblock > nrbuffers)
+ nrblock = nrbuffers;
+#pragma omp parallel for if(nrblock > 1)
+      for(n = 0; n < nrblock; n++) {
+ if(constructFITSsearchsubint(datafile, data, block+n, &subintdata_list[n], &scales_list[n], &offsets_list[n], 0, 0, 0, verbose) != 1) {
+#pragma omp critical
+   error = 1;
+ }
+      }
+      if(error) {
  fflush(stdout);
- printerror(verbose.debug, "ERROR writeFITSfile: Cannot write subint data               ");
- return 0;
+ printerror(verbose.debug, "ERROR writeFITSfile: Cannot construct subint data               ");
+ break;
+      }
+      for(n = 0; n < nrblock; n++) {
+ if(verbose.verbose && verbose.nocounters == 0) printf("writeFITSfile: pulse %ld/%ld             \r", block+n+1, datafile.NrSubints);
+ if(writeFITSsubint(datafile, block+n, subintdata_list[n], scales_list[n], offsets_list[n], verbose) != 1) {
+   fflush(stdout);
+   printerror(verbose.debug, "ERROR writeFITSfile: Cannot write subint data               ");
+   error = 1;
+   break;
+ }
       }
     }
-    if(constructFITSsearchsubint(datafile, data, n, &subintdata, &scales, &offsets, 0, 0, 1, verbose) != 1) {
-      fflush(stdout);
-      printerror(verbose.debug, "ERROR writeFITSfile: Cannot free temporary memory               ");
+    for(n = 0; n < nrbuffers; n++)
+      constructFITSsearchsubint(datafile, data, 0, &subintdata_list[n], &scales_list[n], &offsets_list[n], 0, 0, 1, verbose);
+    free(subintdata_list);
+    free(scales_list);
+    free(offsets_list);
+    if(error)
       return 0;
-    }
   }
   if(verbose.verbose) printf("Writing is done.                                  \n");
   return 1;
@@ -94,7 +94,7 @@ int continuous_shift(datafile_definition fin, datafile_definition *fout, int shi
   }
   if(oformat == MEMORY_format) {
     fout->format = oformat;
-    fout->data = (float *)malloc(fout->NrPols*fout->NrBins*fout->NrSubints*fout->NrFreqChan*sizeof(float));
+    fout->data = allocDataPSRData(fout->NrPols*fout->NrBins*fout->NrSubints*fout->NrFreqChan);
     if(fout->data == NULL) {
       fflush(stdout);
       printerror(verbose.debug, "ERROR continuous_shift: Cannot allocate memory.");
@@ -578,35 +578,38 @@ int data_parang(datafile_definition data, long subintnr, double *parang, verbose
 int check_baseline_subtracted(datafile_definition data, verbose_definition verbose)
 {
   long f, n, b;
-  float sample, miny, maxy;
-  miny = maxy = 0;
+  float *profile, miny, maxy;
   if(data.format != MEMORY_format) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR check_baseline_subtracted: Data should be loaded into memory.");
     return 0;
   }
+  profile = (float *)malloc(data.NrBins*sizeof(float));
+  if(profile == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR check_baseline_subtracted: Memory allocation error.");
+    exit(-1);
+  }
   for(f = 0; f < data.NrFreqChan; f++) {
     for(n = 0; n < data.NrSubints; n++) {
-      for(b = 0; b < data.NrBins; b++) {
- if(readPulsePSRData(&data, n, 0, f, b, 1, &sample, verbose) != 1) {
-   fflush(stdout);
-   printerror(verbose.debug, "ERROR check_baseline_subtracted: Cannot read data.");
-   exit(-1);
- }
- if(b == 0) {
-   miny = sample;
-   maxy = sample;
- }else {
-   if(sample < miny)
-     miny = sample;
-   if(sample > maxy)
-     maxy = sample;
- }
+      if(readPulsePSRData(&data, n, 0, f, 0, data.NrBins, profile, verbose) != 1) {
+ fflush(stdout);
+ printerror(verbose.debug, "ERROR check_baseline_subtracted: Cannot read data.");
+ exit(-1);
+      }
+      miny = maxy = profile[0];
+      for(b = 1; b < data.NrBins; b++) {
+ if(profile[b] < miny)
+   miny = profile[b];
+ if(profile[b] > maxy)
+   maxy = profile[b];
       }
       if(maxy < 0 || miny > 0) {
+ free(profile);
  return 0;
       }
     }
   }
+  free(profile);
   return 1;
 }
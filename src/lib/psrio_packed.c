@@ -0,0 +1,301 @@
+/*
+Copyright (c) 2015, Patrick Weltevrede
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "psrsalsa.h"
+int internal_packed_encode_samples(float *data, long nrsamples, int nrbits, void *codes, float scale, float offset)
+{
+  long b, code;
+  int maxcode, nancode, ok;
+  float invscale, value;
+  signed char *codes8;
+  short *codes16;
+  codes8 = (signed char *)codes;
+  codes16 = (short *)codes;
+  if(nrbits == 8) {
+    maxcode = 127;
+    nancode = -128;
+  }else {
+    maxcode = 32767;
+    nancode = -32768;
+  }
+  invscale = 0;
+  if(scale > 0)
+    invscale = 1.0/scale;
+  ok = 1;
+  for(b = 0; b < nrsamples; b++) {
+    if(isnan(data[b])) {
+      code = nancode;
+    }else if(isinf(data[b])) {
+      if(data[b] > 0)
+ code = maxcode;
+      else
+ code = -maxcode;
+    }else {
+      value = (data[b]-offset)*invscale;
+      if(value > maxcode-0.5 || value < -(maxcode-0.5) || (scale <= 0 && data[b] != offset))
+ ok = 0;
+      if(value > maxcode-1)
+ code = maxcode-1;
+      else if(value < -(maxcode-1))
+ code = -(maxcode-1);
+      else
+ code = lrintf(value);
+    }
+    if(nrbits == 8)
+      codes8[b] = code;
+    else
+      codes16[b] = code;
+  }
+  return ok;
+}
+void internal_packed_encode_row(float *data, long nrbins, int nrbits, void *codes, float *scale, float *offset)
+{
+  long b;
+  int first, maxcode;
+  float vmin, vmax;
+  if(nrbits == 8)
+    maxcode = 127;
+  else
+    maxcode = 32767;
+  first = 1;
+  vmin = vmax = 0;
+  for(b = 0; b < nrbins; b++) {
+    if(isnan(data[b]) || isinf(data[b]))
+      continue;
+    if(first || data[b] < vmin)
+      vmin = data[b];
+    if(first || data[b] > vmax)
+      vmax = data[b];
+    first = 0;
+  }
+  *offset = 0.5*(vmin+vmax);
+  *scale = (vmax-vmin)/(2.0*(maxcode-1));
+  internal_packed_encode_samples(data, nrbins, nrbits, codes, *scale, *offset);
+}
+void internal_packed_decode_row(void *codes, long nrbins, int nrbits, float scale, float offset, float *data)
+{
+  long b;
+  if(nrbits == 8) {
+    signed char *codes8;
+    codes8 = (signed char *)codes;
+#pragma omp simd
+    for(b = 0; b < nrbins; b++)
+      data[b] = codes8[b] == -128 ? NAN : (codes8[b] == 127 ? INFINITY : (codes8[b] == -127 ? -INFINITY : codes8[b]*scale+offset));
+  }else {
+    short *codes16;
+    codes16 = (short *)codes;
+#pragma omp simd
+    for(b = 0; b < nrbins; b++)
+      data[b] = codes16[b] == -32768 ? NAN : (codes16[b] == 32767 ? INFINITY : (codes16[b] == -32767 ? -INFINITY : codes16[b]*scale+offset));
+  }
+}
+void *internal_packed_row(datafile_definition *datafile, long profile)
+{
+  return (char *)datafile->packeddata + profile*datafile->NrBins*(datafile->packedbits/8);
+}
+int internal_packed_allocate(datafile_definition *datafile, int nrbits, verbose_definition verbose)
+{
+  long nrprofiles;
+  if(nrbits != 8 && nrbits != 16) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR packPSRData: Only 8 and 16 bit packing is supported.");
+    return 0;
+  }
+  nrprofiles = datafile->NrSubints*datafile->NrPols*datafile->NrFreqChan;
+  datafile->packeddata = malloc(nrprofiles*datafile->NrBins*(nrbits/8));
+  datafile->packedscale = (float *)malloc(nrprofiles*sizeof(float));
+  datafile->packedoffset = (float *)malloc(nrprofiles*sizeof(float));
+  if(datafile->packeddata == NULL || datafile->packedscale == NULL || datafile->packedoffset == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR packPSRData: Cannot allocate memory (data=%ld bytes=%.3fGB).", nrprofiles*datafile->NrBins*(nrbits/8), nrprofiles*datafile->NrBins*(nrbits/8)/1073741824.0);
+    if(datafile->packeddata != NULL)
+      free(datafile->packeddata);
+    if(datafile->packedscale != NULL)
+      free(datafile->packedscale);
+    if(datafile->packedoffset != NULL)
+      free(datafile->packedoffset);
+    datafile->packeddata = NULL;
+    datafile->packedscale = datafile->packedoffset = NULL;
+    return 0;
+  }
+  datafile->packedbits = nrbits;
+  timingCount(verbose, TIMING_ALLOCATIONS, 1);
+  timingCount(verbose, TIMING_ALLOCATEDBYTES, nrprofiles*(datafile->NrBins*(nrbits/8)+2*sizeof(float)));
+  return 1;
+}
+int packPSRData(datafile_definition *datafile, int nrbits, verbose_definition verbose)
+{
+  long i, nrprofiles;
+  if(datafile->format != MEMORY_format || datafile->data == NULL || datafile->packedbits != 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR packPSRData: Data should be loaded into memory as floating point numbers.");
+    return 0;
+  }
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("Storing data in memory as %d bit integers\n", nrbits);
+  }
+  if(internal_packed_allocate(datafile, nrbits, verbose) == 0)
+    return 0;
+  nrprofiles = datafile->NrSubints*datafile->NrPols*datafile->NrFreqChan;
+#pragma omp parallel for
+  for(i = 0; i < nrprofiles; i++)
+    internal_packed_encode_row(&(datafile->data[i*datafile->NrBins]), datafile->NrBins, nrbits, internal_packed_row(datafile, i), &(datafile->packedscale[i]), &(datafile->packedoffset[i]));
+  freeDataPSRData(datafile, datafile->data);
+  datafile->data = NULL;
+  return 1;
+}
+int unpackPSRData(datafile_definition *datafile, verbose_definition verbose)
+{
+  long i, nrprofiles, datasize;
+  if(datafile->packedbits == 0)
+    return 1;
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("Converting %d bit integer data in memory to floating point numbers\n", datafile->packedbits);
+  }
+  nrprofiles = datafile->NrSubints*datafile->NrPols*datafile->NrFreqChan;
+  datasize = nrprofiles*datafile->NrBins*sizeof(float);
+  datafile->data = allocDataPSRData(nrprofiles*datafile->NrBins);
+  if(datafile->data == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR unpackPSRData: Cannot allocate memory (data=%ld bytes=%.3fGB).", datasize, datasize/1073741824.0);
+    return 0;
+  }
+  timingCount(verbose, TIMING_ALLOCATIONS, 1);
+  timingCount(verbose, TIMING_ALLOCATEDBYTES, datasize);
+#pragma omp parallel for
+  for(i = 0; i < nrprofiles; i++)
+    internal_packed_decode_row(internal_packed_row(datafile, i), datafile->NrBins, datafile->packedbits, datafile->packedscale[i], datafile->packedoffset[i], &(datafile->data[i*datafile->NrBins]));
+  free(datafile->packeddata);
+  free(datafile->packedscale);
+  free(datafile->packedoffset);
+  if(datafile->packedrow != NULL)
+    free(datafile->packedrow);
+  datafile->packeddata = NULL;
+  datafile->packedscale = datafile->packedoffset = datafile->packedrow = NULL;
+  datafile->packedbits = 0;
+  return 1;
+}
+int readPackedPSRData(datafile_definition *datafile, int nrbits, verbose_definition verbose)
+{
+  long n, p, f, i;
+  float *pulse;
+  verbose_definition verbose2;
+  if(datafile->format == MEMORY_format) {
+    if(datafile->packedbits != 0)
+      return 1;
+    return packPSRData(datafile, nrbits, verbose);
+  }
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("Reading data into memory as %d bit integers\n", nrbits);
+  }
+  pulse = (float *)malloc(datafile->NrBins*sizeof(float));
+  if(pulse == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR readPackedPSRData: Memory allocation error.");
+    return 0;
+  }
+  if(internal_packed_allocate(datafile, nrbits, verbose) == 0) {
+    free(pulse);
+    return 0;
+  }
+  for(n = 0; n < datafile->NrSubints; n++) {
+    for(f = 0; f < datafile->NrFreqChan; f++) {
+      for(p = 0; p < datafile->NrPols; p++) {
+ if(readPulsePSRData(datafile, n, p, f, 0, datafile->NrBins, pulse, verbose) != 1) {
+   fflush(stdout);
+   printerror(verbose.debug, "ERROR readPackedPSRData: Cannot read data.");
+   free(pulse);
+   return 0;
+ }
+ i = p+datafile->NrPols*(f+n*datafile->NrFreqChan);
+ internal_packed_encode_row(pulse, datafile->NrBins, nrbits, internal_packed_row(datafile, i), &(datafile->packedscale[i]), &(datafile->packedoffset[i]));
+      }
+    }
+    if(verbose.verbose && verbose.nocounters == 0)
+      printf("  Progress reading data (%.1f%%)\r", 100.0*(n+1)/(float)datafile->NrSubints);
+  }
+  free(pulse);
+  copyVerboseState(verbose, &verbose2);
+  verbose2.verbose = 0;
+  verbose2.nocounters = 1;
+  closePSRData(datafile, 2, verbose2);
+  datafile->format = MEMORY_format;
+  datafile->opened_flag = 1;
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("  done                              \n");
+  }
+  return 1;
+}
+int readPulsePackedData(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse)
+{
+  long profile, nr;
+  profile = polarization+datafile->NrPols*(freq+pulsenr*datafile->NrFreqChan);
+  while(nrSamples > 0) {
+    nr = datafile->NrBins-binnr;
+    if(nr > nrSamples)
+      nr = nrSamples;
+    internal_packed_decode_row((char *)internal_packed_row(datafile, profile) + binnr*(datafile->packedbits/8), nr, datafile->packedbits, datafile->packedscale[profile], datafile->packedoffset[profile], pulse);
+    pulse += nr;
+    nrSamples -= nr;
+    binnr = 0;
+    profile++;
+  }
+  return 1;
+}
+int writePulsePackedData(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse)
+{
+  long profile, nr;
+  int ok;
+  profile = polarization+datafile->NrPols*(freq+pulsenr*datafile->NrFreqChan);
+  ok = 1;
+  while(nrSamples > 0 && ok) {
+    nr = datafile->NrBins-binnr;
+    if(nr > nrSamples)
+      nr = nrSamples;
+    if(binnr == 0 && nr == datafile->NrBins) {
+      internal_packed_encode_row(pulse, nr, datafile->packedbits, internal_packed_row(datafile, profile), &(datafile->packedscale[profile]), &(datafile->packedoffset[profile]));
+    }else if(internal_packed_encode_samples(pulse, nr, datafile->packedbits, (char *)internal_packed_row(datafile, profile) + binnr*(datafile->packedbits/8), datafile->packedscale[profile], datafile->packedoffset[profile]) == 0) {
+#pragma omp critical (packedrow)
+      {
+ if(datafile->packedrow == NULL)
+   datafile->packedrow = (float *)malloc(datafile->NrBins*sizeof(float));
+ if(datafile->packedrow == NULL) {
+   ok = 0;
+ }else {
+   internal_packed_decode_row(internal_packed_row(datafile, profile), datafile->NrBins, datafile->packedbits, datafile->packedscale[profile], datafile->packedoffset[profile], datafile->packedrow);
+   memcpy(&(datafile->packedrow[binnr]), pulse, nr*sizeof(float));
+   internal_packed_encode_row(datafile->packedrow, datafile->NrBins, datafile->packedbits, internal_packed_row(datafile, profile), &(datafile->packedscale[profile]), &(datafile->packedoffset[profile]));
+ }
+      }
+    }
+    pulse += nr;
+    nrSamples -= nr;
+    binnr = 0;
+    profile++;
+  }
+  return ok;
+}
@@ -19,6 +19,9 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <gsl/gsl_sort_float.h>
 #include <gsl/gsl_statistics_float.h>
 #include <gsl/gsl_integration.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "psrsalsa.h"
 int filterPApoints(datafile_definition *datafile, verbose_definition verbose)
 {
@@ -61,7 +64,7 @@ int filterPApoints(datafile_definition *datafile, verbose_definition verbose)
   if(verbose.verbose)
     printf("Keeping %ld significant PA points\n", nrpoints);
   olddata = datafile->data;
-  datafile->data = (float *)malloc(nrpoints*datafile->NrPols*sizeof(float));
+  datafile->data = allocDataPSRData(nrpoints*datafile->NrPols);
   if(datafile->data == NULL) {
     printerror(verbose.debug, "ERROR filterPApoints: Memory allocation error.");
     return 0;
@@ -92,15 +95,214 @@ int filterPApoints(datafile_definition *datafile, verbose_definition verbose)
       j++;
     }
   }
-  free(olddata);
+  freeDataPSRData(datafile, olddata);
   datafile->NrBins = nrpoints;
   return datafile->NrBins;
 }
+void internal_make_paswing_block(datafile_definition *datafile, datafile_definition *rms_file, int rms_file_specified, long pulsenr, long freqnr, long output_nr_pols, int extended, long NrOffpulseBins, long *offbins, int normalize, int correctLbias, float correctQV, float correctV, float paoffset, float rebin_factor, float *newdata, float *newdata_rms, float *Loffpulse, float *Poffpulse, verbose_definition verbose)
+{
+  int indent;
+  long i, j, nrbins;
+  float ymax, baseline_intensity, RMSQ, RMSU, medianL, medianP, scaleI, scaleQ, scaleU, scaleV, rmsI, rmsL, rmsV, rmsT, q, u, v, l, t;
+  float *I, *Q, *U, *V, *Irms, *Qrms, *Urms, *Vrms, *Lrms, *Trms, *newI, *newL, *newV, *newPa, *newdPa, *newT, *newEll, *newdEll, *offrms;
+  nrbins = datafile->NrBins;
+  I = datafile->data + nrbins*(0+datafile->NrPols*(freqnr+pulsenr*datafile->NrFreqChan));
+  Q = datafile->data + nrbins*(1+datafile->NrPols*(freqnr+pulsenr*datafile->NrFreqChan));
+  U = datafile->data + nrbins*(2+datafile->NrPols*(freqnr+pulsenr*datafile->NrFreqChan));
+  V = datafile->data + nrbins*(3+datafile->NrPols*(freqnr+pulsenr*datafile->NrFreqChan));
+  newI = newdata + nrbins*(0+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
+  newL = newdata + nrbins*(1+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
+  newV = newdata + nrbins*(2+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
+  newPa = newdata + nrbins*(3+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
+  newdPa = newdata + nrbins*(4+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
+  newT = newEll = newdEll = NULL;
+  if(extended) {
+    newT = newdata + nrbins*(5+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
+    newEll = newdata + nrbins*(6+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
+    newdEll = newdata + nrbins*(7+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
+  }
+  offrms = datafile->offpulse_rms + output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr);
+  if(normalize == 0) {
+    ymax = 1;
+  }else {
+    ymax = I[0];
+    for(j = 1; j < nrbins; j++) {
+      if(I[j] > ymax)
+ ymax = I[j];
+    }
+  }
+  if(ymax == 0)
+    ymax = 1;
+  scaleI = ymax;
+  scaleQ = correctQV*ymax;
+  scaleU = ymax;
+  scaleV = correctV*correctQV*ymax;
+  if(rms_file_specified) {
+    Irms = rms_file->data + rms_file->NrBins*(0+rms_file->NrPols*(freqnr+pulsenr*rms_file->NrFreqChan));
+    Qrms = rms_file->data + rms_file->NrBins*(1+rms_file->NrPols*(freqnr+pulsenr*rms_file->NrFreqChan));
+    Urms = rms_file->data + rms_file->NrBins*(2+rms_file->NrPols*(freqnr+pulsenr*rms_file->NrFreqChan));
+    Vrms = rms_file->data + rms_file->NrBins*(3+rms_file->NrPols*(freqnr+pulsenr*rms_file->NrFreqChan));
+    Lrms = newdata_rms + rms_file->NrBins*(1+output_nr_pols*(freqnr+rms_file->NrFreqChan*pulsenr));
+#pragma omp simd
+    for(j = 0; j < rms_file->NrBins; j++) {
+      Irms[j] /= scaleI;
+      Qrms[j] /= scaleQ;
+      Urms[j] /= scaleU;
+      Vrms[j] /= scaleV;
+      Lrms[j] = sqrt(Qrms[j]*Qrms[j]+Urms[j]*Urms[j]);
+    }
+    if(extended) {
+      Trms = newdata_rms + rms_file->NrBins*(5+output_nr_pols*(freqnr+rms_file->NrFreqChan*pulsenr));
+      for(j = 0; j < rms_file->NrBins; j++) {
+ if(j < nrbins)
+   l = sqrt((Q[j]/scaleQ)*(Q[j]/scaleQ)+(U[j]/scaleU)*(U[j]/scaleU));
+ else
+   l = Lrms[j];
+ Trms[j] = sqrt(l*l+Vrms[j]*Vrms[j]);
+      }
+    }
+  }
+  baseline_intensity = 0;
+  RMSQ = 0;
+  RMSU = 0;
+  rmsI = rmsL = rmsV = rmsT = 0;
+  for(i = 0; i < NrOffpulseBins; i++) {
+    j = offbins[i];
+    if(rms_file_specified) {
+      q = Qrms[j];
+      u = Urms[j];
+      v = Vrms[j];
+      baseline_intensity += Irms[j];
+      rmsI += Irms[j]*Irms[j];
+      l = Lrms[j];
+    }else {
+      q = Q[j]/scaleQ;
+      u = U[j]/scaleU;
+      v = V[j]/scaleV;
+      baseline_intensity += I[j]/scaleI;
+      rmsI += (I[j]/scaleI)*(I[j]/scaleI);
+      l = sqrt(q*q+u*u);
+    }
+    RMSQ += q*q;
+    RMSU += u*u;
+    rmsL += l*l;
+    rmsV += v*v;
+    Loffpulse[i] = l;
+    if(extended) {
+      rmsT += l*l + v*v;
+      if(rms_file_specified)
+ Poffpulse[i] = Trms[j];
+      else
+ Poffpulse[i] = sqrt(l*l+v*v);
+    }
+  }
+  baseline_intensity /= (float)NrOffpulseBins;
+  RMSQ = sqrt(RMSQ/(float)NrOffpulseBins);
+  RMSU = sqrt(RMSU/(float)NrOffpulseBins);
+  offrms[0] = sqrt(rmsI/(float)NrOffpulseBins);
+  offrms[1] = sqrt(rmsL/(float)NrOffpulseBins);
+  offrms[2] = sqrt(rmsV/(float)NrOffpulseBins);
+  offrms[3] = -1;
+  offrms[4] = -1;
+  if(extended) {
+    offrms[5] = sqrt(rmsT/(float)NrOffpulseBins);
+    offrms[6] = -1;
+    offrms[7] = -1;
+  }
+  if(rms_file_specified) {
+    float scale = 1.0/sqrt(rebin_factor);
+    RMSQ *= scale;
+    RMSU *= scale;
+    offrms[0] *= scale;
+    offrms[1] *= scale;
+    offrms[2] *= scale;
+    if(extended) {
+      offrms[5] *= scale;
+    }
+  }
+  if(verbose.verbose) {
+    if((freqnr == 0 && pulsenr == 0) || verbose.debug) {
+      for(indent = 0; indent < verbose.indent; indent++) printf(" ");
+      fprintf(stdout, "  PA conversion output for subint %ld frequency channel %ld:\n", pulsenr, freqnr);
+      for(indent = 0; indent < verbose.indent; indent++) printf(" ");
+      fprintf(stdout, "    Average baseline Stokes I: %f\n", baseline_intensity);
+      for(indent = 0; indent < verbose.indent; indent++) printf(" ");
+      fprintf(stdout, "    RMS I:                  %f\n", offrms[0]);
+      for(indent = 0; indent < verbose.indent; indent++) printf(" ");
+      fprintf(stdout, "    RMS Q:                  %f\n", RMSQ);
+      for(indent = 0; indent < verbose.indent; indent++) printf(" ");
+      fprintf(stdout, "    RMS U:                  %f\n", RMSU);
+      for(indent = 0; indent < verbose.indent; indent++) printf(" ");
+      fprintf(stdout, "    RMS V:                  %f\n", offrms[2]);
+      for(indent = 0; indent < verbose.indent; indent++) printf(" ");
+      fprintf(stdout, "    RMS L (before de-bias): %f\n", offrms[1]);
+      if(extended) {
+ for(indent = 0; indent < verbose.indent; indent++) printf(" ");
+ fprintf(stdout, "    RMS sqrt(Q^2+U^2+V^2):  %f\n", offrms[5]);
+      }
+    }
+  }
+  medianL = 0;
+  if(correctLbias == 0 || ((verbose.verbose && freqnr == 0 && pulsenr == 0) || verbose.debug))
+    medianL = median_select_float(Loffpulse, NrOffpulseBins);
+  if((verbose.verbose && freqnr == 0 && pulsenr == 0) || verbose.debug) {
+    for(indent = 0; indent < verbose.indent; indent++) printf(" ");
+    fprintf(stdout, "    Median L: %f\n", medianL);
+  }
+  medianP = 0;
+  if(extended) {
+    medianP = median_select_float(Poffpulse, NrOffpulseBins);
+    if((verbose.verbose && freqnr == 0 && pulsenr == 0) || verbose.debug) {
+      for(indent = 0; indent < verbose.indent; indent++) printf(" ");
+      fprintf(stdout, "    Median sqrt(Q^2+U^2+V^2): %f\n", medianP);
+    }
+  }
+  for(j = 0; j < nrbins; j++) {
+    I[j] /= scaleI;
+    Q[j] /= scaleQ;
+    U[j] /= scaleU;
+    V[j] /= scaleV;
+    q = Q[j];
+    u = U[j];
+    v = V[j];
+    l = sqrt(q*q+u*u);
+    if(extended) {
+      t = sqrt(l*l+v*v);
+      newT[j] = t - medianP;
+      newEll[j] = 0;
+      newdEll[j] = 0;
+    }
+    if(correctLbias == 1) {
+      float junk = (0.5*(RMSQ+RMSU)/l);
+      if(junk < 1)
+ l *= sqrt(1.0-junk*junk);
+      else
+ l = 0;
+    }else if(correctLbias == 0) {
+      l -= medianL;
+    }
+    newL[j] = l;
+    newPa[j] = 90.0*atan2(u, q)/M_PI;
+    if(paoffset) {
+      newPa[j] += paoffset;
+      newPa[j] = derotate_180_small_double(newPa[j]);
+    }
+    if(q != 0 || u != 0) {
+      newdPa[j] = sqrt((q*RMSU)*(q*RMSU) + (u*RMSQ)*(u*RMSQ));
+      newdPa[j] /= 2.0*(q*q + u*u);
+      newdPa[j] *= 180.0/M_PI;
+    }else {
+      newdPa[j] = 0;
+    }
+    newI[j] = I[j];
+    newV[j] = v;
+  }
+}
 int make_paswing_fromIQUV(datafile_definition *datafile, int extended, pulselongitude_regions_definition onpulse, int normalize, int correctLbias, float correctQV, float correctV, int nolongitudes, float loffset, float paoffset, datafile_definition *rms_file, float rebin_factor, verbose_definition verbose)
 {
-  int indent, rms_file_specified;
-  long i, j, NrOffpulseBins, pulsenr, freqnr, output_nr_pols;
-  float ymax, baseline_intensity, RMSQ, RMSU, *Loffpulse, *Poffpulse, medianL, medianP, *newdata, *newdata_rms;
+  int indent, rms_file_specified, nrthreads;
+  long i, j, NrOffpulseBins, output_nr_pols, *offbins;
+  float *Loffpulse, *Poffpulse, *newdata, *newdata_rms;
   rms_file_specified = 1;
   if(rms_file == NULL) {
     rms_file = datafile;
@@ -227,21 +429,19 @@ int make_paswing_fromIQUV(datafile_definition *datafile, int extended, pulselong
   if(datafile->offpulse_rms != NULL) {
     free(datafile->offpulse_rms);
   }
-  Loffpulse = (float *)malloc((rms_file->NrBins)*sizeof(float));
-  Poffpulse = (float *)malloc((rms_file->NrBins)*sizeof(float));
   if(extended) {
     output_nr_pols = 8;
   }else {
     output_nr_pols = 5;
   }
-  newdata = (float *)malloc(datafile->NrBins*datafile->NrSubints*datafile->NrFreqChan*output_nr_pols*sizeof(float));
+  newdata = allocDataPSRData(datafile->NrBins*datafile->NrSubints*datafile->NrFreqChan*output_nr_pols);
   if(rms_file_specified) {
-    newdata_rms = (float *)malloc(rms_file->NrBins*rms_file->NrSubints*rms_file->NrFreqChan*output_nr_pols*sizeof(float));
+    newdata_rms = allocDataPSRData(rms_file->NrBins*rms_file->NrSubints*rms_file->NrFreqChan*output_nr_pols);
   }else {
     newdata_rms = newdata;
   }
   datafile->offpulse_rms = (float *)malloc(datafile->NrSubints*datafile->NrFreqChan*output_nr_pols*sizeof(float));
-  if(Loffpulse == NULL || Poffpulse == NULL || newdata == NULL || datafile->offpulse_rms == NULL || newdata_rms == NULL) {
+  if(newdata == NULL || datafile->offpulse_rms == NULL || newdata_rms == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR make_paswing_fromIQUV: Memory allocation error.");
     return 0;
@@ -262,203 +462,44 @@ int make_paswing_fromIQUV(datafile_definition *datafile, int extended, pulselong
     fflush(stdout);
     printwarning(verbose.debug, "WARNING make_paswing_fromIQUV: Normalization will cause all subintegrations/frequency channels to be normalised individually. This may not be desired.");
   }
-  long sindex_I, sindex_Q, sindex_U, sindex_V, sindex_I_rms, sindex_Q_rms, sindex_U_rms, sindex_V_rms, newindex_I, newindex_L, newindex_V, newindex_Pa, newindex_dPa, newindex_T, newindex_Ell, newindex_dEll, newindex_L_rms, newindex_T_rms;
-  for(pulsenr = 0; pulsenr < datafile->NrSubints; pulsenr++) {
-    for(freqnr = 0; freqnr < datafile->NrFreqChan; freqnr++) {
-      sindex_I = datafile->NrBins*(0+datafile->NrPols*(freqnr+pulsenr*datafile->NrFreqChan));
-      sindex_Q = datafile->NrBins*(1+datafile->NrPols*(freqnr+pulsenr*datafile->NrFreqChan));
-      sindex_U = datafile->NrBins*(2+datafile->NrPols*(freqnr+pulsenr*datafile->NrFreqChan));
-      sindex_V = datafile->NrBins*(3+datafile->NrPols*(freqnr+pulsenr*datafile->NrFreqChan));
-      newindex_I = datafile->NrBins*(0+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
-      newindex_L = datafile->NrBins*(1+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
-      newindex_V = datafile->NrBins*(2+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
-      newindex_Pa = datafile->NrBins*(3+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
-      newindex_dPa = datafile->NrBins*(4+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
-      if(extended) {
- newindex_T = datafile->NrBins*(5+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
- newindex_Ell = datafile->NrBins*(6+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
- newindex_dEll = datafile->NrBins*(7+output_nr_pols*(freqnr+datafile->NrFreqChan*pulsenr));
-      }
-      if(rms_file_specified) {
- sindex_I_rms = rms_file->NrBins*(0+rms_file->NrPols*(freqnr+pulsenr*rms_file->NrFreqChan));
- sindex_Q_rms = rms_file->NrBins*(1+rms_file->NrPols*(freqnr+pulsenr*rms_file->NrFreqChan));
- sindex_U_rms = rms_file->NrBins*(2+rms_file->NrPols*(freqnr+pulsenr*rms_file->NrFreqChan));
- sindex_V_rms = rms_file->NrBins*(3+rms_file->NrPols*(freqnr+pulsenr*rms_file->NrFreqChan));
- newindex_L_rms = rms_file->NrBins*(1+output_nr_pols*(freqnr+rms_file->NrFreqChan*pulsenr));
- if(extended) {
-   newindex_T_rms = rms_file->NrBins*(5+output_nr_pols*(freqnr+rms_file->NrFreqChan*pulsenr));
- }
-      }else {
- sindex_I_rms = sindex_I;
- sindex_Q_rms = sindex_Q;
- sindex_U_rms = sindex_U;
- sindex_V_rms = sindex_V;
- newindex_L_rms = newindex_L;
- if(extended) {
-   newindex_T_rms = newindex_T;
- }
-      }
-      if(normalize == 0) {
- ymax = 1;
-      }else {
- ymax = datafile->data[sindex_I];
- for(j = 1; j < (datafile->NrBins); j++) {
-   if(datafile->data[sindex_I+j] > ymax)
-     ymax = datafile->data[sindex_I+j];
- }
-      }
-      if(ymax == 0)
- ymax = 1;
-      for(j = 0; j < (datafile->NrBins); j++) {
- datafile->data[sindex_I + j] /= ymax;
- datafile->data[sindex_Q + j] /= correctQV*ymax;
- datafile->data[sindex_U + j] /= ymax;
- datafile->data[sindex_V + j] /= correctV*correctQV*ymax;
- newdata[j+newindex_L] = sqrt((datafile->data[sindex_Q+j])*(datafile->data[sindex_Q+j])+(datafile->data[sindex_U+j])*(datafile->data[sindex_U+j]));
- if(extended) {
-   newdata[j+newindex_T] = sqrt(newdata[j+newindex_L]*newdata[j+newindex_L]+datafile->data[sindex_V+j]*datafile->data[sindex_V+j]);
- }
-      }
-      if(rms_file_specified) {
- for(j = 0; j < (rms_file->NrBins); j++) {
-   rms_file->data[sindex_I_rms + j] /= ymax;
-   rms_file->data[sindex_Q_rms + j] /= correctQV*ymax;
-   rms_file->data[sindex_U_rms + j] /= ymax;
-   rms_file->data[sindex_V_rms + j] /= correctV*correctQV*ymax;
-   newdata_rms[j+newindex_L_rms] = sqrt((rms_file->data[sindex_Q_rms+j])*(rms_file->data[sindex_Q_rms+j])+(rms_file->data[sindex_U_rms+j])*(rms_file->data[sindex_U_rms+j]));
-   if(extended) {
-     newdata_rms[j+newindex_T_rms] = sqrt(newdata[j+newindex_L_rms]*newdata[j+newindex_L_rms]+rms_file->data[sindex_V_rms+j]*rms_file->data[sindex_V_rms+j]);
-   }
- }
-      }
-      datafile->offpulse_rms[0+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] = 0;
-      datafile->offpulse_rms[1+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] = 0;
-      datafile->offpulse_rms[2+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] = 0;
-      datafile->offpulse_rms[3+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] = -1;
-      datafile->offpulse_rms[4+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] = -1;
-      if(extended) {
- datafile->offpulse_rms[5+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] = 0;
- datafile->offpulse_rms[6+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] = -1;
- datafile->offpulse_rms[7+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] = -1;
-      }
-      baseline_intensity = 0;
-      RMSQ = 0;
-      RMSU = 0;
-      NrOffpulseBins = 0;
-      for(i = 0; i < (rms_file->NrBins); i++) {
- Loffpulse[i] = 0;
- if(checkRegions(i, &onpulse, 0, verbose) == 0) {
-   NrOffpulseBins++;
-   baseline_intensity += rms_file->data[sindex_I_rms+i];
-   RMSQ += (rms_file->data[sindex_Q_rms+i])*(rms_file->data[sindex_Q_rms+i]);
-   RMSU += (rms_file->data[sindex_U_rms+i])*(rms_file->data[sindex_U_rms+i]);
-   datafile->offpulse_rms[0+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] += (rms_file->data[sindex_I_rms+i])*(rms_file->data[sindex_I_rms+i]);
-   datafile->offpulse_rms[1+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] += (newdata_rms[i+newindex_L_rms])*(newdata_rms[i+newindex_L_rms]);
-   datafile->offpulse_rms[2+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] += (rms_file->data[sindex_V_rms+i])*(rms_file->data[sindex_V_rms+i]);
-   if(extended) {
-     datafile->offpulse_rms[5+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] += (newdata_rms[i+newindex_L_rms])*(newdata_rms[i+newindex_L_rms]) + (rms_file->data[sindex_V_rms+i])*(rms_file->data[sindex_V_rms+i]);
-   }
-   Loffpulse[NrOffpulseBins-1] = newdata_rms[i+newindex_L_rms];
-   if(extended)
-     Poffpulse[NrOffpulseBins-1] = newdata_rms[i+newindex_T_rms];
- }
-      }
-      baseline_intensity /= (float)NrOffpulseBins;
-      RMSQ = sqrt(RMSQ/(float)NrOffpulseBins);
-      RMSU = sqrt(RMSU/(float)NrOffpulseBins);
-      datafile->offpulse_rms[0+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] = sqrt(datafile->offpulse_rms[0+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)]/(float)NrOffpulseBins);
-      datafile->offpulse_rms[1+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] = sqrt(datafile->offpulse_rms[1+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)]/(float)NrOffpulseBins);
-      datafile->offpulse_rms[2+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] = sqrt(datafile->offpulse_rms[2+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)]/(float)NrOffpulseBins);
-      if(extended) {
- datafile->offpulse_rms[5+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] = sqrt(datafile->offpulse_rms[5+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)]/(float)NrOffpulseBins);
-      }
-      if(rms_file_specified) {
- float scale = 1.0/sqrt(rebin_factor);
- RMSQ *= scale;
- RMSU *= scale;
- datafile->offpulse_rms[0+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] *= scale;
- datafile->offpulse_rms[1+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] *= scale;
- datafile->offpulse_rms[2+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] *= scale;
- if(extended) {
-   datafile->offpulse_rms[5+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)] *= scale;
- }
-      }
-      if(verbose.verbose) {
- if((freqnr == 0 && pulsenr == 0) || verbose.debug) {
-   for(indent = 0; indent < verbose.indent; indent++) printf(" ");
-   fprintf(stdout, "  PA conversion output for subint %ld frequency channel %ld:\n", pulsenr, freqnr);
-   for(indent = 0; indent < verbose.indent; indent++) printf(" ");
-   fprintf(stdout, "    Average baseline Stokes I: %f\n", baseline_intensity);
-   for(indent = 0; indent < verbose.indent; indent++) printf(" ");
-   fprintf(stdout, "    RMS I:                  %f\n", datafile->offpulse_rms[0+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)]);
-   for(indent = 0; indent < verbose.indent; indent++) printf(" ");
-   fprintf(stdout, "    RMS Q:                  %f\n", RMSQ);
-   for(indent = 0; indent < verbose.indent; indent++) printf(" ");
-   fprintf(stdout, "    RMS U:                  %f\n", RMSU);
-   for(indent = 0; indent < verbose.indent; indent++) printf(" ");
-   fprintf(stdout, "    RMS V:                  %f\n", datafile->offpulse_rms[2+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)]);
-   for(indent = 0; indent < verbose.indent; indent++) printf(" ");
-   fprintf(stdout, "    RMS L (before de-bias): %f\n", datafile->offpulse_rms[1+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)]);
-   if(extended) {
-     for(indent = 0; indent < verbose.indent; indent++) printf(" ");
-     fprintf(stdout, "    RMS sqrt(Q^2+U^2+V^2):  %f\n", datafile->offpulse_rms[5+output_nr_pols*(freqnr + datafile->NrFreqChan*pulsenr)]);
-   }
- }
-      }
-      gsl_sort_float (Loffpulse, 1, NrOffpulseBins);
-      medianL = gsl_stats_float_median_from_sorted_data(Loffpulse, 1, NrOffpulseBins);
-      fflush(stdout);
-      if((verbose.verbose && freqnr == 0 && pulsenr == 0) || verbose.debug) {
- for(indent = 0; indent < verbose.indent; indent++) printf(" ");
- fprintf(stdout, "    Median L: %f\n", medianL);
-      }
-      if(extended) {
- gsl_sort_float (Poffpulse, 1, NrOffpulseBins);
- medianP = gsl_stats_float_median_from_sorted_data(Poffpulse, 1, NrOffpulseBins);
- fflush(stdout);
- if((verbose.verbose && freqnr == 0 && pulsenr == 0) || verbose.debug) {
-   for(indent = 0; indent < verbose.indent; indent++) printf(" ");
-   fprintf(stdout, "    Median sqrt(Q^2+U^2+V^2): %f\n", medianP);
- }
-      }
-      for(j = 0; j < (datafile->NrBins); j++) {
- if(correctLbias == 1) {
-   float junk = (0.5*(RMSQ+RMSU)/newdata[j+newindex_L]);
-   if(junk < 1)
-     newdata[j+newindex_L] *= sqrt(1.0-junk*junk);
-   else
-     newdata[j+newindex_L] = 0;
- }else if(correctLbias == 0) {
-   newdata[j+newindex_L] -= medianL;
- }
- if(extended)
-   newdata[j+newindex_T] -= medianP;
-      }
-      for(i = 0; i < (datafile->NrBins); i++) {
- newdata[i+newindex_Pa] = 90.0*atan2(datafile->data[sindex_U+i],datafile->data[sindex_Q+i])/M_PI;
- if(paoffset) {
-   newdata[i+newindex_Pa] += paoffset;
-   newdata[i+newindex_Pa] = derotate_180_small_double(newdata[i+newindex_Pa]);
- }
- if(datafile->data[i+sindex_Q] != 0 || datafile->data[i+sindex_U] != 0) {
-   newdata[i+newindex_dPa] = sqrt((datafile->data[sindex_Q+i]*RMSU)*(datafile->data[sindex_Q+i]*RMSU) + (datafile->data[sindex_U+i]*RMSQ)*(datafile->data[sindex_U+i]*RMSQ));
-   newdata[i+newindex_dPa] /= 2.0*(datafile->data[i+sindex_Q]*datafile->data[i+sindex_Q] + datafile->data[i+sindex_U]*datafile->data[i+sindex_U]);
-   newdata[i+newindex_dPa] *= 180.0/M_PI;
- }else {
-   newdata[i+newindex_dPa] = 0;
- }
- if(extended) {
-   newdata[i+newindex_Ell] = 0;
-     newdata[i+newindex_dEll] = 0;
- }
-      }
-      for(j = 0; j < (datafile->NrBins); j++) {
- newdata[j+newindex_I] = datafile->data[j+sindex_I];
- newdata[j+newindex_V] = datafile->data[j+sindex_V];
-      }
-    }
+  offbins = (long *)malloc(rms_file->NrBins*sizeof(long));
+  if(offbins == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR make_paswing_fromIQUV: Memory allocation error.");
+    return 0;
+  }
+  NrOffpulseBins = 0;
+  for(i = 0; i < (rms_file->NrBins); i++) {
+    if(checkRegions(i, &onpulse, 0, verbose) == 0)
+      offbins[NrOffpulseBins++] = i;
+  }
+  nrthreads = 1;
+#ifdef _OPENMP
+  if(verbose.debug == 0 && omp_in_parallel() == 0)
+    nrthreads = omp_get_max_threads();
+#endif
+  if(nrthreads > datafile->NrSubints*datafile->NrFreqChan)
+    nrthreads = datafile->NrSubints*datafile->NrFreqChan;
+  if(nrthreads < 1)
+    nrthreads = 1;
+  Loffpulse = (float *)malloc(nrthreads*(rms_file->NrBins)*sizeof(float));
+  Poffpulse = (float *)malloc(nrthreads*(rms_file->NrBins)*sizeof(float));
+  if(Loffpulse == NULL || Poffpulse == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR make_paswing_fromIQUV: Memory allocation error.");
+    return 0;
   }
-  free(datafile->data);
+#pragma omp parallel for schedule(dynamic, 16) num_threads(nrthreads)
+  for(i = 0; i < datafile->NrSubints*datafile->NrFreqChan; i++) {
+    int curthread;
+    curthread = 0;
+#ifdef _OPENMP
+    curthread = omp_get_thread_num();
+#endif
+    internal_make_paswing_block(datafile, rms_file, rms_file_specified, i/datafile->NrFreqChan, i%datafile->NrFreqChan, output_nr_pols, extended, NrOffpulseBins, offbins, normalize, correctLbias, correctQV, correctV, paoffset, rebin_factor, newdata, newdata_rms, Loffpulse+curthread*rms_file->NrBins, Poffpulse+curthread*rms_file->NrBins, verbose);
+  }
+  free(offbins);
+  freeDataPSRData(datafile, datafile->data);
   datafile->data = newdata;
   if(rms_file_specified) {
     free(newdata_rms);
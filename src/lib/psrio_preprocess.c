@@ -51,12 +51,14 @@ int preprocess_rebin(datafile_definition original, datafile_definition *clone, l
   copy_params_PSRData(original, clone, verbose);
   clone->fixedtsamp *= original.NrBins/(double)NrBins;
   clone->NrBins = NrBins;
-  clone->data = (float *)malloc((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
+  clone->data = allocDataPSRData((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints));
   if(clone->data == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR preprocess_rebin: Memory allocation error.");
     return 0;
   }
+  timingCount(verbose, TIMING_ALLOCATIONS, 1);
+  timingCount(verbose, TIMING_ALLOCATEDBYTES, (clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
   for(p = 0; p < clone->NrPols; p++) {
     for(f = 0; f < clone->NrFreqChan; f++) {
       for(n = 0; n < clone->NrSubints; n++) {
@@ -250,13 +252,15 @@ int preprocess_channelselect(datafile_definition original, datafile_definition *
     free(clone->freqlabel_list);
     clone->freqlabel_list = NULL;
   }
-  clone->data = (float *)malloc((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
-  pulse = (float *)malloc((clone->NrBins)*sizeof(float));
+  clone->data = allocDataPSRData((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints));
+  pulse = allocDataPSRData(clone->NrBins);
   if(clone->data == NULL || pulse == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR preprocess_chanelselect: Memory allocation error.");
     return 0;
   }
+  timingCount(verbose, TIMING_ALLOCATIONS, 1);
+  timingCount(verbose, TIMING_ALLOCATEDBYTES, (clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
   set_centre_frequency(clone, get_weighted_channel_freq(original, 0, chanelnr, verbose), verbose);
   double bw;
   if(get_channelbandwidth(original, &bw, verbose) == 0) {
@@ -318,13 +322,15 @@ int preprocess_polselect(datafile_definition original, datafile_definition *clon
   cleanPSRData(clone, verbose);
   copy_params_PSRData(original, clone, verbose);
   clone->NrPols = 1;
-  clone->data = (float *)malloc((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
-  pulse = (float *)malloc((clone->NrBins)*sizeof(float));
+  clone->data = allocDataPSRData((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints));
+  pulse = allocDataPSRData(clone->NrBins);
   if(clone->data == NULL || pulse == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR preprocess_polselect: Memory allocation error.");
     return 0;
   }
+  timingCount(verbose, TIMING_ALLOCATIONS, 1);
+  timingCount(verbose, TIMING_ALLOCATEDBYTES, (clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
   for(p = 0; p < original.NrPols; p++) {
     for(f = 0; f < clone->NrFreqChan; f++) {
       for(n = 0; n < clone->NrSubints; n++) {
@@ -388,13 +394,15 @@ int preprocess_pulsesselect(datafile_definition original, datafile_definition *c
   cleanPSRData(clone, verbose);
   copy_params_PSRData(original, clone, verbose);
   clone->NrSubints = nread;
-  clone->data = (float *)malloc((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
-  pulse = (float *)malloc((clone->NrBins)*sizeof(float));
+  clone->data = allocDataPSRData((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints));
+  pulse = allocDataPSRData(clone->NrBins);
   if(clone->data == NULL || pulse == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR preprocess_pulsesselect: Memory allocation error.");
     return 0;
   }
+  timingCount(verbose, TIMING_ALLOCATIONS, 1);
+  timingCount(verbose, TIMING_ALLOCATEDBYTES, (clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
   for(p = 0; p < original.NrPols; p++) {
     for(f = 0; f < clone->NrFreqChan; f++) {
       for(n = nskip; n < nskip+nread; n++) {
@@ -465,13 +473,15 @@ int preprocess_invertFX(datafile_definition original, datafile_definition *clone
   copy_params_PSRData(original, clone, verbose);
   clone->NrBins = original.NrFreqChan;
   clone->NrFreqChan = original.NrBins;
-  clone->data = (float *)malloc((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
-  pulse = (float *)malloc((original.NrBins)*sizeof(float));
+  clone->data = allocDataPSRData((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints));
+  pulse = allocDataPSRData(original.NrBins);
   if(clone->data == NULL || pulse == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR preprocess_invertFX: Memory allocation error.");
     return 0;
   }
+  timingCount(verbose, TIMING_ALLOCATIONS, 1);
+  timingCount(verbose, TIMING_ALLOCATEDBYTES, (clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
   for(p = 0; p < original.NrPols; p++) {
     for(f = 0; f < original.NrFreqChan; f++) {
       for(n = 0; n < original.NrSubints; n++) {
@@ -520,13 +530,15 @@ int preprocess_transposeRawFBdata(datafile_definition original, datafile_definit
   }
   cleanPSRData(clone, verbose);
   copy_params_PSRData(original, clone, verbose);
-  clone->data = (float *)malloc((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
-  pulse = (float *)malloc((clone->NrBins)*sizeof(float));
+  clone->data = allocDataPSRData((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints));
+  pulse = allocDataPSRData(clone->NrBins);
   if(clone->data == NULL || pulse == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR preprocess_transposeRawFBdata: Memory allocation error.");
     return 0;
   }
+  timingCount(verbose, TIMING_ALLOCATIONS, 1);
+  timingCount(verbose, TIMING_ALLOCATEDBYTES, (clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
   for(p = 0; p < original.NrPols; p++) {
     for(f = 0; f < clone->NrFreqChan; f++) {
       for(n = 0; n < clone->NrSubints; n++) {
@@ -631,14 +643,16 @@ int preprocess_addsuccessivepulses(datafile_definition original, datafile_defini
     printwarning(verbose.debug, "WARNING preprocess_addsuccessivepulses: Unsure about adding subints for a %s file. Setting gentype to undefined.", returnGenType_str(clone->gentype));
     clone->gentype = GENTYPE_UNDEFINED;
   }
-  clone->data = (float *)malloc((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
-  pulse = (float *)malloc((clone->NrBins)*sizeof(float));
-  addedpulse = (float *)malloc((clone->NrBins)*sizeof(float));
+  clone->data = allocDataPSRData((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints));
+  pulse = allocDataPSRData(clone->NrBins);
+  addedpulse = allocDataPSRData(clone->NrBins);
   if(clone->data == NULL || pulse == NULL || addedpulse == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR preprocess_addsuccessivepulses: Memory allocation error.");
     return 0;
   }
+  timingCount(verbose, TIMING_ALLOCATIONS, 1);
+  timingCount(verbose, TIMING_ALLOCATEDBYTES, (clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
   double curtsub;
   for(p = 0; p < original.NrPols; p++) {
     for(f = 0; f < clone->NrFreqChan; f++) {
@@ -754,14 +768,16 @@ int preprocess_addsuccessiveFreqChans(datafile_definition original, datafile_def
     clone->NrFreqChan = original.NrFreqChan*(-nrfreq);
   }
   clone->format = MEMORY_format;
-  clone->data = (float *)malloc((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
-  pulse = (float *)malloc((clone->NrBins)*sizeof(float));
-  addedpulse = (float *)malloc((clone->NrBins)*sizeof(float));
+  clone->data = allocDataPSRData((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints));
+  pulse = allocDataPSRData(clone->NrBins);
+  addedpulse = allocDataPSRData(clone->NrBins);
   if(clone->data == NULL || pulse == NULL || addedpulse == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR preprocess_addsuccessiveFreqChans: Memory allocation error.");
     return 0;
   }
+  timingCount(verbose, TIMING_ALLOCATIONS, 1);
+  timingCount(verbose, TIMING_ALLOCATEDBYTES, (clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
   if(original.freqMode == FREQMODE_FREQTABLE) {
     if(clone->freqlabel_list != NULL)
       free(clone->freqlabel_list);
@@ -882,7 +898,7 @@ int preprocess_debase(datafile_definition *original, pulselongitude_regions_defi
     printerror(verbose.debug, "ERROR preprocess_debase: Cannot handle PA data.");
     return 0;
   }
-  pulse = (float *)malloc((original->NrBins)*sizeof(float));
+  pulse = allocDataPSRData(original->NrBins);
   if(pulse == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR preprocess_debase: Memory allocation error.");
@@ -906,13 +922,17 @@ int preprocess_debase(datafile_definition *original, pulselongitude_regions_defi
  }
  if(nrOffpulseBins > 0) {
    avrg /= (float)nrOffpulseBins;
-   for(j = 0; j < original->NrBins; j++) {
-     pulse[j] -= avrg;
-   }
-   if(writePulsePSRData(original, n, p, f, 0, original->NrBins, pulse, verbose) != 1) {
-     fflush(stdout);
-     printerror(verbose.debug, "ERROR preprocess_debase: Error writing data.");
-     return 0;
+   if(original->packedbits) {
+     original->packedoffset[p+original->NrPols*(f+n*original->NrFreqChan)] -= avrg;
+   }else {
+     for(j = 0; j < original->NrBins; j++) {
+       pulse[j] -= avrg;
+     }
+     if(writePulsePSRData(original, n, p, f, 0, original->NrBins, pulse, verbose) != 1) {
+       fflush(stdout);
+       printerror(verbose.debug, "ERROR preprocess_debase: Error writing data.");
+       return 0;
+     }
    }
  }
         if(verbose.verbose && verbose.nocounters == 0) {
@@ -940,11 +960,11 @@ int preprocess_debase(datafile_definition *original, pulselongitude_regions_defi
   return 1;
 }
 static int preprocess_addNoise_random_nr_generater_initialized = 0;
-static gsl_rng *preprocess_addNoiserand_num_gen;
-static const gsl_rng_type *rand_num_gen_type;
+static unsigned long long preprocess_addNoise_callnr = 0;
+static randomstream_definition preprocess_addNoise_randomstream;
 int preprocess_addNoise(datafile_definition original, datafile_definition *clone, float rms, verbose_definition verbose)
 {
-  long p, f, n, b;
+  long p, f, n;
   int i;
   if(verbose.verbose) {
     for(i = 0; i < verbose.indent; i++)
@@ -968,27 +988,25 @@ int preprocess_addNoise(datafile_definition original, datafile_definition *clone
   }
   cleanPSRData(clone, verbose);
   copy_params_PSRData(original, clone, verbose);
-  clone->data = (float *)malloc((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
+  clone->data = allocDataPSRData((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints));
   if(clone->data == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR preprocess_addNoise: Memory allocation error.");
     return 0;
   }
+  timingCount(verbose, TIMING_ALLOCATIONS, 1);
+  timingCount(verbose, TIMING_ALLOCATEDBYTES, (clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
   if(preprocess_addNoise_random_nr_generater_initialized == 0) {
     gsl_rng_env_setup();
-    rand_num_gen_type = gsl_rng_default;
-    preprocess_addNoiserand_num_gen = gsl_rng_alloc(rand_num_gen_type);
     preprocess_addNoise_random_nr_generater_initialized = 1;
   }
+  randomstream_init(&preprocess_addNoise_randomstream, gsl_rng_default_seed, preprocess_addNoise_callnr++);
   for(p = 0; p < clone->NrPols; p++) {
     for(f = 0; f < clone->NrFreqChan; f++) {
       for(n = 0; n < clone->NrSubints; n++) {
  if(writePulsePSRData(clone, n, p, f, 0, clone->NrBins, &(original.data[original.NrBins*(p+original.NrPols*(f+n*original.NrFreqChan))]), verbose) != 1) {
    return 0;
  }
- for(b = 0; b < clone->NrBins; b++) {
-   clone->data[original.NrBins*(p+original.NrPols*(f+n*original.NrFreqChan))+b] += gsl_ran_gaussian(preprocess_addNoiserand_num_gen, rms);
- }
  if(verbose.verbose && verbose.nocounters == 0) {
    long doprint;
    doprint = 1;
@@ -1004,6 +1022,7 @@ int preprocess_addNoise(datafile_definition original, datafile_definition *clone
       }
     }
   }
+  randomstream_gaussian_float(&preprocess_addNoise_randomstream, 0, (clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints), rms, clone->data);
   if(verbose.verbose && verbose.nocounters == 0) {
     for(i = 0; i < verbose.indent; i++)
       printf(" ");
@@ -1026,12 +1045,14 @@ int preprocess_shuffle(datafile_definition original, datafile_definition *clone,
   cleanPSRData(clone, verbose);
   copy_params_PSRData(original, clone, verbose);
   clone->format = MEMORY_format;
-  clone->data = (float *)malloc((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
+  clone->data = allocDataPSRData((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints));
   if(clone->data == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR preprocess_shuffle: Memory allocation error.");
     return 0;
   }
+  timingCount(verbose, TIMING_ALLOCATIONS, 1);
+  timingCount(verbose, TIMING_ALLOCATEDBYTES, (clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
   if(original.freqMode != FREQMODE_UNIFORM) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR preprocess_shuffle: Frequency channels are not necessarily uniformly separated.");
@@ -1164,12 +1185,14 @@ int preprocess_rotateStokes(datafile_definition *original, datafile_definition *
   if(inplace == 0) {
     cleanPSRData(clone, verbose);
     copy_params_PSRData(*original, clone, verbose);
-    clone->data = (float *)malloc((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
+    clone->data = allocDataPSRData((clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints));
     if(clone->data == NULL) {
       fflush(stdout);
       printerror(verbose.debug, "ERROR preprocess_rotateStokes: Memory allocation error.");
       return 0;
     }
+    timingCount(verbose, TIMING_ALLOCATIONS, 1);
+    timingCount(verbose, TIMING_ALLOCATEDBYTES, (clone->NrBins)*(clone->NrPols)*(clone->NrFreqChan)*(clone->NrSubints)*sizeof(float));
   }
   if(angle_array == NULL) {
     angle *= M_PI/180.0;
@@ -1565,6 +1588,21 @@ int preprocess_scale(datafile_definition original, float factor, float offset, v
     printerror(verbose.debug, "ERROR preprocess_scale: Cannot handle PA data.");
     return 0;
   }
+  if(original.packedbits) {
+    long nrprofiles;
+    nrprofiles = original.NrSubints*original.NrPols*original.NrFreqChan;
+#pragma omp parallel for
+    for(i = 0; i < nrprofiles; i++) {
+      original.packedscale[i] *= factor;
+      original.packedoffset[i] = (original.packedoffset[i]+offset)*factor;
+    }
+    if(verbose.verbose) {
+      for(i = 0; i < verbose.indent; i++)
+ printf(" ");
+      printf("  done                              \n");
+    }
+    return 1;
+  }
   for(f = 0; f < original.NrFreqChan; f++) {
     for(n = 0; n < original.NrSubints; n++) {
       for(p = 0; p < original.NrPols; p++) {
@@ -1886,8 +1924,8 @@ int preprocess_deFaraday(datafile_definition *original, int undo, int update, do
       printf("  Rotating Q&U\n");
     }
   }
-  pulseQ = (float *)malloc(original->NrBins*sizeof(float));
-  pulseU = (float *)malloc(original->NrBins*sizeof(float));
+  pulseQ = allocDataPSRData(original->NrBins);
+  pulseU = allocDataPSRData(original->NrBins);
   if(pulseQ == NULL || pulseU == NULL) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR preprocess_deFaraday (%s): Cannot allocate memory.", original->filename);
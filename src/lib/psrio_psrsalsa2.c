@@ -0,0 +1,813 @@
+/*
+Copyright (c) 2015, Patrick Weltevrede
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#define _FILE_OFFSET_BITS 64
+#define _USE_LARGEFILE 1
+#define _LARGEFILE_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "psrsalsa.h"
+#define PSRSALSA2_INDEX_ID "CHUNKIDX"
+#define PSRSALSA2_METHOD_RAW 0
+#define PSRSALSA2_METHOD_SHUFFLE 1
+#define PSRSALSA2_PLANE_RAW 0
+#define PSRSALSA2_PLANE_LZ 1
+#define PSRSALSA2_PLANE_HUFFMAN 2
+#define PSRSALSA2_HUFFMANBITS 12
+#define PSRSALSA2_MAXOVERHEAD 32
+#define PSRSALSA2_HASHBITS 14
+#define PSRSALSA2_MINMATCH 4
+unsigned int internal_psrsalsa2_read32(unsigned char *ptr)
+{
+  unsigned int value;
+  memcpy(&value, ptr, 4);
+  return value;
+}
+long internal_psrsalsa2_lz_length(unsigned char *op, unsigned char *oend, long length)
+{
+  long n;
+  n = 0;
+  while(length >= 255) {
+    if(op+n >= oend)
+      return -1;
+    op[n++] = 255;
+    length -= 255;
+  }
+  if(op+n >= oend)
+    return -1;
+  op[n++] = length;
+  return n;
+}
+long internal_psrsalsa2_lz_compress(unsigned char *in, long n, unsigned char *out, long outcap)
+{
+  long i, ref, anchor, litlen, matchlen, ret;
+  unsigned int h;
+  unsigned char *op, *oend, *token;
+  long table[1 << PSRSALSA2_HASHBITS];
+  for(i = 0; i < (1 << PSRSALSA2_HASHBITS); i++)
+    table[i] = -1;
+  op = out;
+  oend = out+outcap;
+  anchor = 0;
+  i = 0;
+  while(i+PSRSALSA2_MINMATCH <= n) {
+    h = (internal_psrsalsa2_read32(in+i)*2654435761U) >> (32-PSRSALSA2_HASHBITS);
+    ref = table[h];
+    table[h] = i;
+    if(ref < 0 || i-ref > 65535 || internal_psrsalsa2_read32(in+ref) != internal_psrsalsa2_read32(in+i)) {
+      i++;
+      continue;
+    }
+    matchlen = PSRSALSA2_MINMATCH;
+    while(i+matchlen < n && in[ref+matchlen] == in[i+matchlen])
+      matchlen++;
+    litlen = i-anchor;
+    if(op+1+litlen+2 >= oend)
+      return 0;
+    token = op++;
+    *token = (litlen < 15 ? litlen : 15) << 4;
+    if(litlen >= 15) {
+      if((ret = internal_psrsalsa2_lz_length(op, oend, litlen-15)) < 0)
+ return 0;
+      op += ret;
+    }
+    if(op+litlen+2 >= oend)
+      return 0;
+    memcpy(op, in+anchor, litlen);
+    op += litlen;
+    op[0] = (i-ref) & 255;
+    op[1] = (i-ref) >> 8;
+    op += 2;
+    *token |= (matchlen-PSRSALSA2_MINMATCH < 15 ? matchlen-PSRSALSA2_MINMATCH : 15);
+    if(matchlen-PSRSALSA2_MINMATCH >= 15) {
+      if((ret = internal_psrsalsa2_lz_length(op, oend, matchlen-PSRSALSA2_MINMATCH-15)) < 0)
+ return 0;
+      op += ret;
+    }
+    i += matchlen;
+    anchor = i;
+  }
+  litlen = n-anchor;
+  if(op+1+litlen >= oend)
+    return 0;
+  token = op++;
+  *token = (litlen < 15 ? litlen : 15) << 4;
+  if(litlen >= 15) {
+    if((ret = internal_psrsalsa2_lz_length(op, oend, litlen-15)) < 0)
+      return 0;
+    op += ret;
+  }
+  if(op+litlen > oend)
+    return 0;
+  memcpy(op, in+anchor, litlen);
+  op += litlen;
+  return op-out;
+}
+int internal_psrsalsa2_lz_decompress(unsigned char *in, long insize, unsigned char *out, long n)
+{
+  unsigned char *ip, *iend, *op, *oend, *match;
+  long length, offset;
+  int token;
+  ip = in;
+  iend = in+insize;
+  op = out;
+  oend = out+n;
+  while(ip < iend) {
+    token = *ip++;
+    length = token >> 4;
+    if(length == 15) {
+      do {
+ if(ip >= iend)
+   return 0;
+ length += *ip;
+      }while(*ip++ == 255);
+    }
+    if(ip+length > iend || op+length > oend)
+      return 0;
+    memcpy(op, ip, length);
+    ip += length;
+    op += length;
+    if(ip >= iend)
+      break;
+    if(ip+2 > iend)
+      return 0;
+    offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    length = (token & 15);
+    if(length == 15) {
+      do {
+ if(ip >= iend)
+   return 0;
+ length += *ip;
+      }while(*ip++ == 255);
+    }
+    length += PSRSALSA2_MINMATCH;
+    if(offset == 0 || op-out < offset || op+length > oend)
+      return 0;
+    match = op-offset;
+    while(length-- > 0)
+      *op++ = *match++;
+  }
+  if(op != oend)
+    return 0;
+  return 1;
+}
+int internal_psrsalsa2_huffman_lengths(long *freq, unsigned char *length)
+{
+  int i, j, nrleaves, nrnodes, q1, q2, node, a, b, maxlength, symbol[256], parent[511], depth[511];
+  long weight[511], w, scaled[256];
+  for(i = 0; i < 256; i++)
+    scaled[i] = freq[i];
+  do {
+    nrleaves = 0;
+    for(i = 0; i < 256; i++) {
+      length[i] = 0;
+      if(scaled[i] > 0) {
+ w = scaled[i];
+ for(j = nrleaves; j > 0 && weight[j-1] > w; j--) {
+   weight[j] = weight[j-1];
+   symbol[j] = symbol[j-1];
+ }
+ weight[j] = w;
+ symbol[j] = i;
+ nrleaves++;
+      }
+    }
+    if(nrleaves == 0)
+      return 0;
+    if(nrleaves == 1) {
+      length[symbol[0]] = 1;
+      return 1;
+    }
+    nrnodes = nrleaves;
+    q1 = 0;
+    q2 = nrleaves;
+    while(nrnodes < 2*nrleaves-1) {
+      for(j = 0; j < 2; j++) {
+ if(q1 < nrleaves && (q2 >= nrnodes || weight[q1] <= weight[q2]))
+   node = q1++;
+ else
+   node = q2++;
+ if(j == 0)
+   a = node;
+ else
+   b = node;
+      }
+      weight[nrnodes] = weight[a]+weight[b];
+      parent[a] = parent[b] = nrnodes;
+      nrnodes++;
+    }
+    depth[nrnodes-1] = 0;
+    maxlength = 0;
+    for(node = nrnodes-2; node >= 0; node--) {
+      depth[node] = depth[parent[node]]+1;
+      if(node < nrleaves) {
+ length[symbol[node]] = depth[node];
+ if(depth[node] > maxlength)
+   maxlength = depth[node];
+      }
+    }
+    if(maxlength > PSRSALSA2_HUFFMANBITS) {
+      for(i = 0; i < 256; i++) {
+ if(scaled[i] > 0)
+   scaled[i] = (scaled[i] >> 1) | 1;
+      }
+    }
+  }while(maxlength > PSRSALSA2_HUFFMANBITS);
+  return 1;
+}
+void internal_psrsalsa2_huffman_codes(unsigned char *length, unsigned int *code)
+{
+  int i, bits, count[PSRSALSA2_HUFFMANBITS+1];
+  unsigned int next[PSRSALSA2_HUFFMANBITS+1], c, r;
+  for(i = 0; i <= PSRSALSA2_HUFFMANBITS; i++)
+    count[i] = 0;
+  for(i = 0; i < 256; i++)
+    count[length[i]]++;
+  count[0] = 0;
+  c = 0;
+  for(bits = 1; bits <= PSRSALSA2_HUFFMANBITS; bits++) {
+    c = (c + count[bits-1]) << 1;
+    next[bits] = c;
+  }
+  for(i = 0; i < 256; i++) {
+    if(length[i] == 0)
+      continue;
+    c = next[length[i]]++;
+    r = 0;
+    for(bits = 0; bits < length[i]; bits++)
+      r |= ((c >> bits) & 1) << (length[i]-1-bits);
+    code[i] = r;
+  }
+}
+long internal_psrsalsa2_huffman_compress(unsigned char *in, long n, unsigned char *out, long outcap)
+{
+  long i, freq[256], size;
+  unsigned char length[256];
+  unsigned int code[256];
+  unsigned long long acc;
+  int nbits;
+  unsigned char *op, *oend;
+  for(i = 0; i < 256; i++)
+    freq[i] = 0;
+  for(i = 0; i < n; i++)
+    freq[in[i]]++;
+  if(internal_psrsalsa2_huffman_lengths(freq, length) == 0)
+    return 0;
+  size = 0;
+  for(i = 0; i < 256; i++)
+    size += freq[i]*length[i];
+  size = 128 + (size+7)/8;
+  if(size >= outcap)
+    return 0;
+  if(out == NULL)
+    return size;
+  internal_psrsalsa2_huffman_codes(length, code);
+  for(i = 0; i < 128; i++)
+    out[i] = length[2*i] | (length[2*i+1] << 4);
+  op = out+128;
+  oend = out+outcap;
+  acc = 0;
+  nbits = 0;
+  for(i = 0; i < n; i++) {
+    acc |= (unsigned long long)code[in[i]] << nbits;
+    nbits += length[in[i]];
+    while(nbits >= 8) {
+      if(op >= oend)
+ return 0;
+      *op++ = acc & 255;
+      acc >>= 8;
+      nbits -= 8;
+    }
+  }
+  if(nbits > 0) {
+    if(op >= oend)
+      return 0;
+    *op++ = acc & 255;
+  }
+  return op-out;
+}
+int internal_psrsalsa2_huffman_decompress(unsigned char *in, long insize, unsigned char *out, long n)
+{
+  long i, k;
+  int nbits, bits;
+  unsigned char length[256];
+  unsigned int code[256], entry;
+  unsigned short table[1 << PSRSALSA2_HUFFMANBITS];
+  unsigned long long acc;
+  unsigned char *ip, *iend;
+  if(insize < 128)
+    return 0;
+  for(i = 0; i < 128; i++) {
+    length[2*i] = in[i] & 15;
+    length[2*i+1] = in[i] >> 4;
+  }
+  for(i = 0; i < 256; i++) {
+    if(length[i] > PSRSALSA2_HUFFMANBITS)
+      return 0;
+  }
+  for(i = 0; i < (1 << PSRSALSA2_HUFFMANBITS); i++)
+    table[i] = 0;
+  internal_psrsalsa2_huffman_codes(length, code);
+  for(i = 0; i < 256; i++) {
+    if(length[i] == 0)
+      continue;
+    for(k = code[i]; k < (1 << PSRSALSA2_HUFFMANBITS); k += (1 << length[i]))
+      table[k] = i | (length[i] << 8);
+  }
+  ip = in+128;
+  iend = in+insize;
+  acc = 0;
+  nbits = 0;
+  bits = 0;
+  for(i = 0; i < n; i++) {
+    while(nbits <= 56) {
+      if(ip < iend)
+ acc |= (unsigned long long)(*ip++) << nbits;
+      else
+ bits += 8;
+      nbits += 8;
+    }
+    entry = table[acc & ((1 << PSRSALSA2_HUFFMANBITS)-1)];
+    if((entry >> 8) == 0)
+      return 0;
+    out[i] = entry & 255;
+    acc >>= (entry >> 8);
+    nbits -= (entry >> 8);
+  }
+  if(bits > nbits)
+    return 0;
+  return 1;
+}
+long internal_psrsalsa2_encode(float *data, long nrsamples, unsigned char *out, unsigned char *scratch)
+{
+  long i, size, plane, planesize;
+  unsigned int value;
+  unsigned char *op;
+  for(i = 0; i < nrsamples; i++) {
+    memcpy(&value, &data[i], 4);
+    scratch[i] = value;
+    scratch[i+nrsamples] = value >> 8;
+    scratch[i+2*nrsamples] = value >> 16;
+    scratch[i+3*nrsamples] = value >> 24;
+  }
+  out[0] = PSRSALSA2_METHOD_SHUFFLE;
+  op = out+1;
+  for(plane = 0; plane < 4; plane++) {
+    size = internal_psrsalsa2_huffman_compress(scratch+plane*nrsamples, nrsamples, NULL, nrsamples);
+    op[0] = PSRSALSA2_PLANE_LZ;
+    planesize = internal_psrsalsa2_lz_compress(scratch+plane*nrsamples, nrsamples, op+5, size > 0 ? size : nrsamples);
+    if(planesize <= 0 && size > 0) {
+      op[0] = PSRSALSA2_PLANE_HUFFMAN;
+      planesize = internal_psrsalsa2_huffman_compress(scratch+plane*nrsamples, nrsamples, op+5, nrsamples);
+    }
+    if(planesize <= 0) {
+      op[0] = PSRSALSA2_PLANE_RAW;
+      memcpy(op+5, scratch+plane*nrsamples, nrsamples);
+      planesize = nrsamples;
+    }
+    value = planesize;
+    memcpy(op+1, &value, 4);
+    op += 5+planesize;
+  }
+  if(op-out < 4*nrsamples+1)
+    return op-out;
+  out[0] = PSRSALSA2_METHOD_RAW;
+  memcpy(out+1, data, 4*nrsamples);
+  return 4*nrsamples+1;
+}
+int internal_psrsalsa2_decode(unsigned char *in, long insize, float *data, long nrsamples, unsigned char *scratch)
+{
+  long i, plane;
+  unsigned int value;
+  unsigned char *ip, *iend;
+  if(insize < 1)
+    return 0;
+  if(in[0] == PSRSALSA2_METHOD_RAW) {
+    if(insize != 4*nrsamples+1)
+      return 0;
+    memcpy(data, in+1, 4*nrsamples);
+    return 1;
+  }
+  if(in[0] != PSRSALSA2_METHOD_SHUFFLE)
+    return 0;
+  ip = in+1;
+  iend = in+insize;
+  for(plane = 0; plane < 4; plane++) {
+    if(ip+5 > iend)
+      return 0;
+    memcpy(&value, ip+1, 4);
+    if(ip+5+value > iend)
+      return 0;
+    if(ip[0] == PSRSALSA2_PLANE_RAW) {
+      if(value != nrsamples)
+ return 0;
+      memcpy(scratch+plane*nrsamples, ip+5, nrsamples);
+    }else if(ip[0] == PSRSALSA2_PLANE_LZ) {
+      if(internal_psrsalsa2_lz_decompress(ip+5, value, scratch+plane*nrsamples, nrsamples) == 0)
+ return 0;
+    }else if(ip[0] == PSRSALSA2_PLANE_HUFFMAN) {
+      if(internal_psrsalsa2_huffman_decompress(ip+5, value, scratch+plane*nrsamples, nrsamples) == 0)
+ return 0;
+    }else {
+      return 0;
+    }
+    ip += 5+value;
+  }
+  for(i = 0; i < nrsamples; i++) {
+    value = scratch[i] | ((unsigned int)scratch[i+nrsamples] << 8) | ((unsigned int)scratch[i+2*nrsamples] << 16) | ((unsigned int)scratch[i+3*nrsamples] << 24);
+    memcpy(&data[i], &value, 4);
+  }
+  return 1;
+}
+void internal_psrsalsa2_free(datafile_definition *datafile)
+{
+  int i;
+  psrsalsa_chunks_definition *chunks;
+  chunks = datafile->salsachunks;
+  if(chunks == NULL)
+    return;
+  for(i = 0; i < maxNrPSRSALSAChunksCached; i++) {
+    if(chunks->cache[i] != NULL)
+      free(chunks->cache[i]);
+  }
+  if(chunks->offsets != NULL)
+    free(chunks->offsets);
+  if(chunks->compressed != NULL)
+    free(chunks->compressed);
+  if(chunks->scratch != NULL)
+    free(chunks->scratch);
+  free(chunks);
+  datafile->salsachunks = NULL;
+}
+int internal_psrsalsa2_init(datafile_definition *datafile, int writing, verbose_definition verbose)
+{
+  int i;
+  char identifier[9];
+  long long nrchunks;
+  psrsalsa_chunks_definition *chunks;
+  if(datafile->salsachunks != NULL) {
+    if(datafile->salsachunks->writing != writing) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR PSRSALSA v2: Mixing reading and writing of compressed data in %s is not supported.", datafile->filename);
+      return 0;
+    }
+    return 1;
+  }
+  chunks = (psrsalsa_chunks_definition *)malloc(sizeof(psrsalsa_chunks_definition));
+  if(chunks == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR PSRSALSA v2: Memory allocation error.");
+    return 0;
+  }
+  datafile->salsachunks = chunks;
+  chunks->nrchunks = datafile->NrSubints;
+  chunks->chunksize = datafile->NrPols*datafile->NrFreqChan*datafile->NrBins;
+  chunks->writing = writing;
+  for(i = 0; i < maxNrPSRSALSAChunksCached; i++) {
+    chunks->cache[i] = NULL;
+    chunks->cachechunk[i] = -1;
+    chunks->cacheage[i] = 0;
+  }
+  chunks->age = 0;
+  chunks->writechunk = 0;
+  chunks->offsets = (long long *)calloc(chunks->nrchunks+1, sizeof(long long));
+  chunks->compressed = (unsigned char *)malloc(4*chunks->chunksize+PSRSALSA2_MAXOVERHEAD);
+  chunks->scratch = (unsigned char *)malloc(4*chunks->chunksize);
+  if(chunks->offsets == NULL || chunks->compressed == NULL || chunks->scratch == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR PSRSALSA v2: Memory allocation error.");
+    internal_psrsalsa2_free(datafile);
+    return 0;
+  }
+  if(writing) {
+    chunks->offsets[0] = strlen(PSRSALSA2_INDEX_ID)+sizeof(long long)*(chunks->nrchunks+2);
+    return 1;
+  }
+  fseeko(datafile->fptr, datafile->datastart, SEEK_SET);
+  if(fread(identifier, 1, 8, datafile->fptr) != 8 || fread(&nrchunks, sizeof(long long), 1, datafile->fptr) != 1) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR PSRSALSA v2: Cannot read chunk index from %s.", datafile->filename);
+    internal_psrsalsa2_free(datafile);
+    return 0;
+  }
+  identifier[8] = 0;
+  if(strcmp(identifier, PSRSALSA2_INDEX_ID) != 0 || nrchunks != chunks->nrchunks) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR PSRSALSA v2: Chunk index in %s is corrupt or does not match the header.", datafile->filename);
+    internal_psrsalsa2_free(datafile);
+    return 0;
+  }
+  if(fread(chunks->offsets, sizeof(long long), chunks->nrchunks+1, datafile->fptr) != chunks->nrchunks+1) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR PSRSALSA v2: Cannot read chunk index from %s.", datafile->filename);
+    internal_psrsalsa2_free(datafile);
+    return 0;
+  }
+  for(i = 0; i < chunks->nrchunks; i++) {
+    if(chunks->offsets[i+1] <= chunks->offsets[i] || chunks->offsets[i+1]-chunks->offsets[i] > 4*chunks->chunksize+PSRSALSA2_MAXOVERHEAD) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR PSRSALSA v2: Chunk index in %s is corrupt.", datafile->filename);
+      internal_psrsalsa2_free(datafile);
+      return 0;
+    }
+  }
+  return 1;
+}
+int internal_psrsalsa2_writeindex(datafile_definition *datafile, verbose_definition verbose)
+{
+  long long nrchunks;
+  psrsalsa_chunks_definition *chunks;
+  chunks = datafile->salsachunks;
+  nrchunks = chunks->nrchunks;
+  fseeko(datafile->fptr, datafile->datastart, SEEK_SET);
+  if(fwrite(PSRSALSA2_INDEX_ID, 1, 8, datafile->fptr) != 8 || fwrite(&nrchunks, sizeof(long long), 1, datafile->fptr) != 1 || fwrite(chunks->offsets, sizeof(long long), chunks->nrchunks+1, datafile->fptr) != chunks->nrchunks+1) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR PSRSALSA v2: Cannot write chunk index to %s.", datafile->filename);
+    return 0;
+  }
+  return 1;
+}
+int internal_psrsalsa2_store(datafile_definition *datafile, unsigned char *compressed, long size, verbose_definition verbose)
+{
+  psrsalsa_chunks_definition *chunks;
+  chunks = datafile->salsachunks;
+  fseeko(datafile->fptr, datafile->datastart+chunks->offsets[chunks->writechunk], SEEK_SET);
+  if(fwrite(compressed, 1, size, datafile->fptr) != size) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR PSRSALSA v2: Writing chunk %ld to %s failed.", chunks->writechunk, datafile->filename);
+    return 0;
+  }
+  chunks->offsets[chunks->writechunk+1] = chunks->offsets[chunks->writechunk]+size;
+  chunks->writechunk++;
+  return 1;
+}
+float *internal_psrsalsa2_load(datafile_definition *datafile, long chunk, verbose_definition verbose)
+{
+  int i, slot;
+  long size;
+  psrsalsa_chunks_definition *chunks;
+  chunks = datafile->salsachunks;
+  chunks->age++;
+  slot = 0;
+  for(i = 0; i < maxNrPSRSALSAChunksCached; i++) {
+    if(chunks->cachechunk[i] == chunk) {
+      chunks->cacheage[i] = chunks->age;
+      return chunks->cache[i];
+    }
+    if(chunks->cacheage[i] < chunks->cacheage[slot])
+      slot = i;
+  }
+  if(chunks->cache[slot] == NULL) {
+    chunks->cache[slot] = (float *)malloc(chunks->chunksize*sizeof(float));
+    if(chunks->cache[slot] == NULL) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR PSRSALSA v2: Memory allocation error.");
+      return NULL;
+    }
+  }
+  chunks->cachechunk[slot] = -1;
+  size = chunks->offsets[chunk+1]-chunks->offsets[chunk];
+  fseeko(datafile->fptr, datafile->datastart+chunks->offsets[chunk], SEEK_SET);
+  if(fread(chunks->compressed, 1, size, datafile->fptr) != size) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR PSRSALSA v2: File read failed.");
+    return NULL;
+  }
+  if(internal_psrsalsa2_decode(chunks->compressed, size, chunks->cache[slot], chunks->chunksize, chunks->scratch) == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR PSRSALSA v2: Chunk %ld in %s is corrupt.", chunk, datafile->filename);
+    return NULL;
+  }
+  chunks->cachechunk[slot] = chunk;
+  chunks->cacheage[slot] = chunks->age;
+  return chunks->cache[slot];
+}
+int readPulsePSRSALSA2Data(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse, verbose_definition verbose)
+{
+  float *chunk;
+  if(internal_psrsalsa2_init(datafile, 0, verbose) == 0)
+    return 0;
+  if(pulsenr < 0 || pulsenr >= datafile->salsachunks->nrchunks) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR readPulsePSRSALSA2Data: Subint %ld does not exist.", pulsenr);
+    return 0;
+  }
+  chunk = internal_psrsalsa2_load(datafile, pulsenr, verbose);
+  if(chunk == NULL)
+    return 0;
+  memcpy(pulse, &chunk[datafile->NrBins*(polarization+datafile->NrPols*freq)+binnr], nrSamples*sizeof(float));
+  return 1;
+}
+int readPSRSALSA2file(datafile_definition *datafile, float *data, verbose_definition verbose)
+{
+  long n, n0, nn, size;
+  int ok, nrthreads;
+  unsigned char **compressed, **scratch;
+  psrsalsa_chunks_definition *chunks;
+  if(verbose.verbose) {
+    printf("Start reading PSRSALSA v2 binary file\n");
+  }
+  if(internal_psrsalsa2_init(datafile, 0, verbose) == 0)
+    return 0;
+  chunks = datafile->salsachunks;
+  nrthreads = 1;
+#ifdef _OPENMP
+  if(omp_in_parallel() == 0)
+    nrthreads = omp_get_max_threads();
+#endif
+  if(nrthreads > chunks->nrchunks)
+    nrthreads = chunks->nrchunks;
+  if(nrthreads < 1)
+    nrthreads = 1;
+  compressed = (unsigned char **)malloc(nrthreads*sizeof(unsigned char *));
+  scratch = (unsigned char **)malloc(nrthreads*sizeof(unsigned char *));
+  if(compressed == NULL || scratch == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR readPSRSALSA2file: Memory allocation error.");
+    if(compressed != NULL)
+      free(compressed);
+    if(scratch != NULL)
+      free(scratch);
+    return 0;
+  }
+  ok = 1;
+  for(n = 0; n < nrthreads; n++) {
+    compressed[n] = (unsigned char *)malloc(4*chunks->chunksize+PSRSALSA2_MAXOVERHEAD);
+    scratch[n] = (unsigned char *)malloc(4*chunks->chunksize);
+    if(compressed[n] == NULL || scratch[n] == NULL)
+      ok = 0;
+  }
+  if(ok == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR readPSRSALSA2file: Memory allocation error.");
+    for(n = 0; n < nrthreads; n++) {
+      if(compressed[n] != NULL)
+ free(compressed[n]);
+      if(scratch[n] != NULL)
+ free(scratch[n]);
+    }
+    free(compressed);
+    free(scratch);
+    return 0;
+  }
+  fseeko(datafile->fptr, datafile->datastart+chunks->offsets[0], SEEK_SET);
+  for(n0 = 0; n0 < chunks->nrchunks && ok; n0 += nrthreads) {
+    nn = chunks->nrchunks-n0;
+    if(nn > nrthreads)
+      nn = nrthreads;
+    for(n = 0; n < nn; n++) {
+      size = chunks->offsets[n0+n+1]-chunks->offsets[n0+n];
+      if(fread(compressed[n], 1, size, datafile->fptr) != size) {
+ fflush(stdout);
+ printerror(verbose.debug, "ERROR readPSRSALSA2file: File read failed.");
+ ok = 0;
+ break;
+      }
+    }
+    if(ok == 0)
+      break;
+#pragma omp parallel for num_threads(nrthreads) schedule(static, 1)
+    for(n = 0; n < nn; n++) {
+      if(internal_psrsalsa2_decode(compressed[n], chunks->offsets[n0+n+1]-chunks->offsets[n0+n], &data[(n0+n)*chunks->chunksize], chunks->chunksize, scratch[n]) == 0)
+ ok = 0;
+    }
+    if(ok == 0) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR readPSRSALSA2file: Data in %s is corrupt.", datafile->filename);
+    }
+    if(verbose.verbose && verbose.nocounters == 0)
+      printf("  Progress reading PSRSALSA v2 binary file (%.1f%%)\r", 100.0*(n0+nn)/(float)chunks->nrchunks);
+  }
+  for(n = 0; n < nrthreads; n++) {
+    free(compressed[n]);
+    free(scratch[n]);
+  }
+  free(compressed);
+  free(scratch);
+  if(ok == 0)
+    return 0;
+  if(verbose.verbose) printf("  Reading is done.                                \n");
+  return 1;
+}
+int writePSRSALSA2file(datafile_definition *datafile, float *data, verbose_definition verbose)
+{
+  long n, n0, nn, *size;
+  int ok, nrthreads;
+  unsigned char **compressed, **scratch;
+  psrsalsa_chunks_definition *chunks;
+  if(internal_psrsalsa2_init(datafile, 1, verbose) == 0)
+    return 0;
+  chunks = datafile->salsachunks;
+  if(chunks->writechunk != 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writePSRSALSA2file: Part of the data has already been written to %s.", datafile->filename);
+    return 0;
+  }
+  nrthreads = 1;
+#ifdef _OPENMP
+  if(omp_in_parallel() == 0)
+    nrthreads = omp_get_max_threads();
+#endif
+  if(nrthreads > chunks->nrchunks)
+    nrthreads = chunks->nrchunks;
+  if(nrthreads < 1)
+    nrthreads = 1;
+  compressed = (unsigned char **)malloc(nrthreads*sizeof(unsigned char *));
+  scratch = (unsigned char **)malloc(nrthreads*sizeof(unsigned char *));
+  size = (long *)malloc(nrthreads*sizeof(long));
+  if(compressed == NULL || scratch == NULL || size == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writePSRSALSA2file: Memory allocation error.");
+    if(compressed != NULL)
+      free(compressed);
+    if(scratch != NULL)
+      free(scratch);
+    if(size != NULL)
+      free(size);
+    return 0;
+  }
+  ok = 1;
+  for(n = 0; n < nrthreads; n++) {
+    compressed[n] = (unsigned char *)malloc(4*chunks->chunksize+PSRSALSA2_MAXOVERHEAD);
+    scratch[n] = (unsigned char *)malloc(4*chunks->chunksize);
+    if(compressed[n] == NULL || scratch[n] == NULL)
+      ok = 0;
+  }
+  if(ok == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writePSRSALSA2file: Memory allocation error.");
+    for(n = 0; n < nrthreads; n++) {
+      if(compressed[n] != NULL)
+ free(compressed[n]);
+      if(scratch[n] != NULL)
+ free(scratch[n]);
+    }
+    free(compressed);
+    free(scratch);
+    free(size);
+    return 0;
+  }
+  for(n0 = 0; n0 < chunks->nrchunks && ok; n0 += nrthreads) {
+    nn = chunks->nrchunks-n0;
+    if(nn > nrthreads)
+      nn = nrthreads;
+#pragma omp parallel for num_threads(nrthreads) schedule(static, 1)
+    for(n = 0; n < nn; n++) {
+      size[n] = internal_psrsalsa2_encode(&data[(n0+n)*chunks->chunksize], chunks->chunksize, compressed[n], scratch[n]);
+    }
+    for(n = 0; n < nn && ok; n++) {
+      if(internal_psrsalsa2_store(datafile, compressed[n], size[n], verbose) == 0)
+ ok = 0;
+    }
+    if(verbose.verbose && verbose.nocounters == 0)
+      printf("  Progress writing PSRSALSA v2 binary file (%.1f%%)\r", 100.0*(n0+nn)/(float)chunks->nrchunks);
+  }
+  for(n = 0; n < nrthreads; n++) {
+    free(compressed[n]);
+    free(scratch[n]);
+  }
+  free(compressed);
+  free(scratch);
+  free(size);
+  if(ok == 0)
+    return 0;
+  if(internal_psrsalsa2_writeindex(datafile, verbose) == 0)
+    return 0;
+  if(verbose.verbose) {
+    printf("  Writing is done (compressed to %.1f%% of the original size).\n", 100.0*(chunks->offsets[chunks->nrchunks]-chunks->offsets[0])/(4.0*chunks->chunksize*chunks->nrchunks));
+  }
+  return 1;
+}
+int closePSRSALSA2Data(datafile_definition *datafile, verbose_definition verbose)
+{
+  int ret;
+  psrsalsa_chunks_definition *chunks;
+  ret = 1;
+  chunks = datafile->salsachunks;
+  if(chunks == NULL)
+    return 1;
+  if(chunks->writing && chunks->writechunk < chunks->nrchunks) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR closePSRSALSA2Data: Only %ld out of %ld subints were written to %s.", chunks->writechunk, chunks->nrchunks, datafile->filename);
+    ret = 0;
+  }
+  internal_psrsalsa2_free(datafile);
+  return ret;
+}
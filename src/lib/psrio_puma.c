@@ -20,7 +20,14 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <time.h>
 #include <string.h>
 #include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "psrsalsa.h"
+#define puma_io_chunk_size 4194304
 #define PUMA_STD 
 #ifndef _PUMA_H
 #define _PUMA_H 
@@ -1347,37 +1354,150 @@ int writePulseWSRTData(datafile_definition datafile, long pulsenr, int polarizat
   pumawrite(pulse, sizeof(float), nrSamples, datafile.fptr);
   return 1;
 }
+void internal_puma_swapcopy(float *dst, float *src, long n)
+{
+  long i;
+  unsigned char *s, *d, tmp;
+  i = 0;
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) || defined(__hpux)
+  if(dst != src)
+    memmove(dst, src, n*sizeof(float));
+  return;
+#endif
+#ifdef __SSE2__
+  for(; i+4 <= n; i += 4) {
+    __m128i x;
+    x = _mm_loadu_si128((__m128i *)(src+i));
+    x = _mm_shufflelo_epi16(_mm_shufflehi_epi16(x, 0xb1), 0xb1);
+    x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+    _mm_storeu_si128((__m128i *)(dst+i), x);
+  }
+#endif
+  for(; i < n; i++) {
+    s = (unsigned char *)(src+i);
+    d = (unsigned char *)(dst+i);
+    tmp = s[0]; d[0] = s[3]; d[3] = tmp;
+    tmp = s[1]; d[1] = s[2]; d[2] = tmp;
+  }
+}
+void internal_puma_chunk(datafile_definition datafile, long chunk, long subintsperchunk, long *p, long *f, long *n0, long *nn)
+{
+  long chunksperchan;
+  chunksperchan = (datafile.NrSubints+subintsperchunk-1)/subintsperchunk;
+  *n0 = (chunk % chunksperchan)*subintsperchunk;
+  *f = (chunk / chunksperchan) % datafile.NrFreqChan;
+  *p = chunk / (chunksperchan*datafile.NrFreqChan);
+  *nn = datafile.NrSubints - *n0;
+  if(*nn > subintsperchunk)
+    *nn = subintsperchunk;
+}
+void internal_puma_scatter(datafile_definition datafile, float *data, float *buffer, long p, long f, long n0, long nn)
+{
+  long n;
+  for(n = 0; n < nn; n++)
+    internal_puma_swapcopy(&data[datafile.NrBins*(p+datafile.NrPols*(f+(n0+n)*datafile.NrFreqChan))], buffer+n*datafile.NrBins, datafile.NrBins);
+}
+void internal_puma_gather(datafile_definition datafile, float *data, float *buffer, long p, long f, long n0, long nn)
+{
+  long n;
+  for(n = 0; n < nn; n++)
+    internal_puma_swapcopy(buffer+n*datafile.NrBins, &data[datafile.NrBins*(p+datafile.NrPols*(f+(n0+n)*datafile.NrFreqChan))], datafile.NrBins);
+}
 int writePuMafile(datafile_definition datafile, float *data, verbose_definition verbose)
 {
-  long n, f, p;
+  long chunk, nrchunks, subintsperchunk, p, f, n0, nn;
+  int ok;
+  float *buffer[2];
+  subintsperchunk = puma_io_chunk_size/(datafile.NrBins*sizeof(float));
+  if(subintsperchunk < 1)
+    subintsperchunk = 1;
+  if(subintsperchunk > datafile.NrSubints)
+    subintsperchunk = datafile.NrSubints;
+  nrchunks = ((datafile.NrSubints+subintsperchunk-1)/subintsperchunk)*datafile.NrFreqChan*datafile.NrPols;
+  buffer[0] = (float *)malloc(subintsperchunk*datafile.NrBins*sizeof(float));
+  buffer[1] = (float *)malloc(subintsperchunk*datafile.NrBins*sizeof(float));
+  if(buffer[0] == NULL || buffer[1] == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writePuMafile: Memory allocation error.");
+    return 0;
+  }
   fseeko(datafile.fptr, datafile.datastart, SEEK_SET);
-  for(p = 0; p < datafile.NrPols; p++) {
-    for(f = 0; f < datafile.NrFreqChan; f++) {
-      for(n = 0; n < datafile.NrSubints; n++) {
- if(verbose.verbose && verbose.nocounters == 0) printf("writePuMafile: pulse %ld/%ld\r", n+1, datafile.NrSubints);
- pumawrite(&data[datafile.NrBins*(p+datafile.NrPols*(f+n*datafile.NrFreqChan))], sizeof(float), datafile.NrBins, datafile.fptr);
+  ok = 1;
+#pragma omp parallel num_threads(2) if(nrchunks > 1)
+  {
+#pragma omp single
+    {
+      for(chunk = 0; chunk < nrchunks; chunk++) {
+ internal_puma_chunk(datafile, chunk, subintsperchunk, &p, &f, &n0, &nn);
+ internal_puma_gather(datafile, data, buffer[chunk % 2], p, f, n0, nn);
+#pragma omp taskwait
+ if(verbose.verbose && verbose.nocounters == 0) printf("writePuMafile: pulse %ld/%ld\r", n0+nn, datafile.NrSubints);
+#pragma omp task firstprivate(chunk, nn)
+ {
+   if(fwrite(buffer[chunk % 2], sizeof(float), nn*datafile.NrBins, datafile.fptr) != nn*datafile.NrBins)
+     ok = 0;
+ }
       }
+#pragma omp taskwait
     }
   }
+  free(buffer[0]);
+  free(buffer[1]);
+  if(ok == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writePuMafile: Writing data failed.");
+    return 0;
+  }
   if(verbose.verbose) printf("  Writing is done.              \n");
   return 1;
 }
 int readPuMafile(datafile_definition datafile, float *data, verbose_definition verbose)
 {
-  long n, f, p;
+  long chunk, nrchunks, subintsperchunk, p, f, n0, nn;
+  int ok;
+  float *buffer[2];
   if(verbose.verbose) {
     printf("Start reading PuMa file\n");
   }
+  subintsperchunk = puma_io_chunk_size/(datafile.NrBins*sizeof(float));
+  if(subintsperchunk < 1)
+    subintsperchunk = 1;
+  if(subintsperchunk > datafile.NrSubints)
+    subintsperchunk = datafile.NrSubints;
+  nrchunks = ((datafile.NrSubints+subintsperchunk-1)/subintsperchunk)*datafile.NrFreqChan*datafile.NrPols;
+  buffer[0] = (float *)malloc(subintsperchunk*datafile.NrBins*sizeof(float));
+  buffer[1] = (float *)malloc(subintsperchunk*datafile.NrBins*sizeof(float));
+  if(buffer[0] == NULL || buffer[1] == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR readPuMafile: Memory allocation error.");
+    return 0;
+  }
   fseeko(datafile.fptr, datafile.datastart, SEEK_SET);
-  for(p = 0; p < datafile.NrPols; p++) {
-    for(f = 0; f < datafile.NrFreqChan; f++) {
-      for(n = 0; n < datafile.NrSubints; n++) {
+  ok = 1;
+#pragma omp parallel num_threads(2) if(nrchunks > 1)
+  {
+#pragma omp single
+    {
+      for(chunk = 0; chunk < nrchunks && ok; chunk++) {
+ internal_puma_chunk(datafile, chunk, subintsperchunk, &p, &f, &n0, &nn);
+ if(fread(buffer[chunk % 2], sizeof(float), nn*datafile.NrBins, datafile.fptr) != nn*datafile.NrBins)
+   ok = 0;
+#pragma omp taskwait
  if(verbose.verbose && verbose.nocounters == 0)
-   printf("  Progress reading PuMa file (%.1f%%)\r", 100.0*(n+(f+p*datafile.NrFreqChan)*datafile.NrSubints)/(float)(datafile.NrSubints*datafile.NrFreqChan*datafile.NrPols));
- pumaread(&data[datafile.NrBins*(p+datafile.NrPols*(f+n*datafile.NrFreqChan))], sizeof(float), datafile.NrBins, datafile.fptr);
+   printf("  Progress reading PuMa file (%.1f%%)\r", 100.0*(chunk+1)/(float)nrchunks);
+#pragma omp task firstprivate(chunk, p, f, n0, nn)
+ internal_puma_scatter(datafile, data, buffer[chunk % 2], p, f, n0, nn);
       }
+#pragma omp taskwait
     }
   }
+  free(buffer[0]);
+  free(buffer[1]);
+  if(ok == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR readPuMafile: Reading data failed.");
+    return 0;
+  }
   if(verbose.verbose) printf("  Reading is done.                           \n");
   return 1;
 }
@@ -29,14 +29,23 @@ int set_instrument_PSRData(datafile_definition *datafile_dest, char *instrument,
 int set_scanID_PSRData(datafile_definition *datafile_dest, char *scanID, verbose_definition verbose);
 int guessPSRData_format(char *filename, int noerror, verbose_definition verbose);
 int openPSRData(datafile_definition *datafile, char *filename, int format, int enable_write, int read_in_memory, int nowarnings, verbose_definition verbose);
+int readInMemoryPSRData(datafile_definition *datafile, verbose_definition verbose);
+int openConcatPSRData(datafile_definition *datafile, char **filenames, int nrfiles, int format, int read_in_memory, verbose_definition verbose);
 int closePSRData(datafile_definition *datafile, int perserve_header_info, verbose_definition verbose);
+float *allocDataPSRData(long long nrsamples);
+void setFirstTouchDataPSRData(int enable);
+void freeDataPSRData(datafile_definition *datafile, float *data);
 void printHeaderPSRData(datafile_definition datafile, int update, verbose_definition verbose);
 int readHeaderPSRData(datafile_definition *datafile, int readnoscales, int nowarnings, verbose_definition verbose);
+int loadDeferredHeaderPSRData(datafile_definition *datafile, verbose_definition verbose);
 int writeHeaderPSRData(datafile_definition *datafile, int argc, char **argv, int cmdOnly, verbose_definition verbose);
 int readPulsePSRData(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse, verbose_definition verbose);
 int writePulsePSRData(datafile_definition *datafile, long pulsenr, int polarization, int freq, int binnr, long nrSamples, float *pulse, verbose_definition verbose);
 int readPSRData(datafile_definition *datafile, float *data, verbose_definition verbose);
 int writePSRData(datafile_definition *datafile, float *data, verbose_definition verbose);
+int packPSRData(datafile_definition *datafile, int nrbits, verbose_definition verbose);
+int unpackPSRData(datafile_definition *datafile, verbose_definition verbose);
+int readPackedPSRData(datafile_definition *datafile, int nrbits, verbose_definition verbose);
 int read_profilePSRData(datafile_definition datafile, float *profileI, int *zapMask, int polchan, verbose_definition verbose);
 int read_partprofilePSRData(datafile_definition datafile, float *profileI, int *zapMask, int polchan, long nskip, long nread, verbose_definition verbose);
 int read_rmsPSRData(datafile_definition datafile, float *rms, float *avrg, int *zapMask, pulselongitude_regions_definition *regions, int invert, int polchan, int freqchan, verbose_definition verbose);
@@ -81,6 +90,7 @@ void print_fitsio_version_used(FILE *stream);
 void psrfits_set_noweights(int val);
 void psrfits_set_absweights(int val);
 void psrfits_set_use_weighted_freq(int val);
+void psrfits_set_headeronly(int val);
 int filterPApoints(datafile_definition *datafile, verbose_definition verbose);
 int readPPOLfile(datafile_definition *datafile, float *data, int extended, float add_longitude_shift, verbose_definition verbose);
 int writePPOLfile(datafile_definition datafile, float *data, int extended, int onlysignificantPA, int twoprofiles, float PAoffset, verbose_definition verbose);
@@ -116,6 +126,10 @@ int rotateSinglepulse(float *data, int npts, float epsilon, verbose_definition v
 int crosscorrelation_fft(float *data1, float *data2, int ndata, float *cc, verbose_definition verbose);
 int crosscorrelation_fft_padding_cclength(int ndata, int extrazeropad);
 int crosscorrelation_fft_padding(float *data1, float *data2, int ndata, int extrazeropad, float **cc, int *cclength, verbose_definition verbose);
+int initTemplateAlignment(templatealign_definition *engine, float *template, long nrbins, verbose_definition verbose);
+int initTemplateAlignmentVonMises(templatealign_definition *engine, vonMises_collection_definition *components, long nrbins, verbose_definition verbose);
+int templateAlignProfiles(templatealign_definition *engine, float *profiles, long nrprofiles, double *shifts, double *errors, double *amplitudes, verbose_definition verbose);
+void freeTemplateAlignment(templatealign_definition *engine);
 int calcLRFS(float *data, long nry, long nrx, unsigned long fft_size, float *lrfs, int subtractDC, float *phase_track, float *phase_track_phases, int calcPhaseTrack, float freq_min, float freq_max, int track_only_first_region, float *subpulseAmplitude, int calcsubpulseAmplitude, int mask_freqs, int inverseFFT, pulselongitude_regions_definition *regions, float *var_rms, int argc, char **argv, verbose_definition verbose);
 void calcModindex(float *lrfs, float *profile, long nrx, unsigned long fft_size, unsigned long nrpulses, float *sigma, float *rms_sigma, float *modind, float *rms_modind, pulselongitude_regions_definition *regions, float var_rms, verbose_definition verbose);
 int calc2DFS(float *data, long nry, long nrx, unsigned long fft_size, float *twodfs, pulselongitude_regions_definition *onpulse, int region, verbose_definition verbose);
@@ -165,6 +179,21 @@ int pgplot_opendevice(pgplot_viewport_definition *viewport, int *deviceID, verbo
 int pgplotGraph1(pgplot_options_definition *pgplot, float *data, float *datax, float *sigma, int nrx, float xmin, float xmax, int dontsetranges, float xmin_show, float xmax_show, float ymin_show, float ymax_show, int forceMinZero, int hist, int noline, int pointtype, int color, int boxcolor, pulselongitude_regions_definition *regions, verbose_definition verbose);
 int pgplotMap(pgplot_options_definition *pgplot, float *cmap, int nrx, int nry, float xmin, float xmax, float xminshow, float xmaxshow, float ymin, float ymax, float yminshow, float ymaxshow, int maptype, int itf, int nogray, int nrcontours, float *contours, int contourlw, int forceMinZero, float saturize, int levelset, float levelmin, float levelmax, int levelInversion, int onlyData, int sideright, int forceMinZeroRight, int sidetop, int forceMinZeroTop, int sidelw, int showwedge, int plotSubset, int showTwice, verbose_definition verbose);
 int pgplotMapCoordinate(float x, float y, int *nx, int *ny);
+void pgplotMapPyramid(map_pyramid_definition *pyramid);
+int initMapPyramid(map_pyramid_definition *pyramid, float *cmap, long nrx, long nry, verbose_definition verbose);
+void freeMapPyramid(map_pyramid_definition *pyramid);
+int mapPyramidSelectLevel(map_pyramid_definition *pyramid, long subset_nrx, long subset_nry, long npixx, long npixy);
+int mapPyramidRange(map_pyramid_definition *pyramid, long x0, long x1, long y0, long y1, float *min, float *max);
+int writeMapPyramid(map_pyramid_definition *pyramid, char *filename, verbose_definition verbose);
+int readMapPyramid(map_pyramid_definition *pyramid, float *cmap, long nrx, long nry, char *filename, verbose_definition verbose);
+int initStatsIndex(statsindex_definition *index, datafile_definition *datafile, verbose_definition verbose);
+void freeStatsIndex(statsindex_definition *index);
+int writeStatsIndex(statsindex_definition *index, datafile_definition *datafile, char *filename, verbose_definition verbose);
+int readStatsIndex(statsindex_definition *index, datafile_definition *datafile, char *filename, verbose_definition verbose);
+int getStatsIndex(statsindex_definition *index, datafile_definition *datafile, int sidecar, verbose_definition verbose);
+int statsIndexProfile(statsindex_definition *index, long subint, long pol, long freq, float *min, float *max, double *mean, double *rms, long *nrnan);
+int statsIndexRange(statsindex_definition *index, long pol, long freq, float *min, float *max);
+int statsIndexBaselineSubtracted(statsindex_definition *index);
 int pgplotMapCoordinate_dbl(double x, double y, int *nx, int *ny);
 void pgplotMapCoordinateInverse(float *x, float *y, int nx, int ny);
 void pgplotMapCoordinateInverse_dbl(double *x, double *y, int nx, int ny);
@@ -229,6 +258,10 @@ int readVonMisesModel(char *filename, vonMises_collection_definition *components
 double calcVonMisesFunction(vonMises_collection_definition *components, double phase, double shift);
 double calcVonMisesFunction2(double centre, double concentration, double height, double phase, double shift);
 void calcVonMisesProfile(vonMises_collection_definition *components, int nrbins, float *profile, double shift, int normalize);
+int initVonMisesTemplate(vonMises_template_definition *tmpl, long nrbins, verbose_definition verbose);
+void calcVonMisesTemplate(vonMises_template_definition *tmpl, vonMises_collection_definition *components, double shift, int normalize, float *profile);
+void freeVonMisesTemplate(vonMises_template_definition *tmpl);
+int calcVonMisesSpectrum(vonMises_collection_definition *components, long nrbins, long nrharmonics, double shift, float *spectrum, verbose_definition verbose);
 float correlateVonMisesFunction(vonMises_collection_definition *components, int nrbins, float *profile, verbose_definition verbose);
 int find_peak_correlation(float *data1, float *data2, int ndata, int zeropad, int circularpad, int duplicate, int *lag, float *correl_max, verbose_definition verbose);
 void randomize_idnum(long *idnum);
@@ -236,12 +269,60 @@ long calculate_bin_number(double x, double dx, double min_x, int centered_at_zer
 double calculate_bin_location(long binnr, double dx, double min_x, int centered_at_zero, double extra_phase);
 double calculate_required_bin_width(double x, long binnr, double min_x, int centered_at_zero, double extra_phase, verbose_definition verbose);
 int set_binning_histogram(double min_x_data, double max_x_data, int rangex_set, double rangex_min, double rangex_max, int nrbins_specified, long nrbins, int centered_at_zero, double extra_phase, double *min_x, double *max_x, double *dx, verbose_definition verbose);
+int initHistogram(histogram_definition *hist, long nrbinsx, double dx, double min_x, long nrbinsy, double dy, double min_y, int centered_at_zero, double extra_phase, int truncate, verbose_definition verbose);
+void freeHistogram(histogram_definition *hist);
+long histogramBinNumber(histogram_definition *hist, double x, double y);
+int fillHistogram(histogram_definition *hist, double *x, double *y, long n, verbose_definition verbose);
+void cumulativeHistogram(histogram_definition *hist);
+int streamHistogramRange(datafile_definition *psrdata, char *filename, int skiplines, char skipChar, int colx, int coly, int twoD, int read_log, long chunksize, long *ndata, double *min_x, double *max_x, double *min_y, double *max_y, verbose_definition verbose);
+int streamHistogramFill(datafile_definition *psrdata, char *filename, int skiplines, char skipChar, int colx, int coly, int twoD, int read_log, long chunksize, histogram_definition *hist, verbose_definition verbose);
+double select_kth_smallest_double(double *data, long n, long k);
+double quantile_select_double(double *data, long n, double fraction);
+double median_select_double(double *data, long n);
+float select_kth_smallest_float(float *data, long n, long k);
+float quantile_select_float(float *data, long n, double fraction);
+float median_select_float(float *data, long n);
+int init_quantile_sketch(quantile_sketch_definition *sketch, int k, verbose_definition verbose);
+void free_quantile_sketch(quantile_sketch_definition *sketch);
+double quantile_sketch_rank_error(int k);
+int add_quantile_sketch(quantile_sketch_definition *sketch, double value, verbose_definition verbose);
+int query_quantile_sketch(quantile_sketch_definition *sketch, double fraction, double *value, verbose_definition verbose);
+int parallel_sort_double(double *data, long n, verbose_definition verbose);
+int ks_reference_init(ks_reference_definition *ref, double *data, double *weights, long n, verbose_definition verbose);
+void ks_reference_free(ks_reference_definition *ref);
+double kstest_probability(double max_diff, double effective_n, verbose_definition verbose);
+int kstest_reference(ks_reference_definition *ref, double *data, double *weights, long n, int presorted, double *max_diff, double *prob, verbose_definition verbose);
+int kstest_reference_multi(ks_reference_definition *ref, double **data, long *n, int nrsets, double *max_diff, double *prob, verbose_definition verbose);
+void randomstream_init(randomstream_definition *rs, unsigned long long seed, unsigned long long stream);
+void randomstream_block(randomstream_definition *rs, unsigned long long index, unsigned int draw, unsigned int *out);
+double randomstream_uniform_at(randomstream_definition *rs, unsigned long long index, unsigned int draw);
+double randomstream_gaussian_at(randomstream_definition *rs, unsigned long long index, unsigned int draw);
+double randomstream_gamma_at(randomstream_definition *rs, unsigned long long index, double k);
+void randomstream_uniform(randomstream_definition *rs, unsigned long long offset, long n, double min, double max, double *data);
+void randomstream_gaussian(randomstream_definition *rs, unsigned long long offset, long n, double mu, double sigma, double *data);
+void randomstream_gaussian_float(randomstream_definition *rs, unsigned long long offset, long n, float sigma, float *data);
+void randomstream_gamma(randomstream_definition *rs, unsigned long long offset, long n, double k, double theta, double *data);
+void initSyntheticParams(synthetic_definition *params);
+int fillSyntheticData(synthetic_definition params, float *data, verbose_definition verbose);
+int fillSyntheticPAswing(synthetic_definition params, float *data, double *longitudes, float *offpulse_rms, verbose_definition verbose);
+int setSyntheticHeader(datafile_definition *datafile, synthetic_definition params, verbose_definition verbose);
+int writeSyntheticPSRData(char *filename, int format, synthetic_definition params, int argc, char **argv, verbose_definition verbose);
+void initTiming(timing_definition *timing);
+double timingStart(verbose_definition verbose);
+void timingStop(verbose_definition verbose, char *stage, double start);
+void timingCount(verbose_definition verbose, int counter, long long amount);
+void printTiming(FILE *stream, timing_definition *timing);
+int writeTimingJSON(char *filename, char *progname, timing_definition *timing, verbose_definition verbose);
 void kstest(double *data1, long n1, double *data2, long n2, int cdf_type, double (*cdf)(double), double *max_diff, double *prob, verbose_definition verbose);
 void print_gsl_version_used(FILE *stream);
 int minimize_1D_double(int findroot, double (*funk)(double, void *), void *params, double x_lower, double x_upper, int gridsearch, int investigateLocalMinima, int nested, double *x_minimum, int max_iter, double epsabs, double epsrel, int verbose, int debug_verbose);
+int minimize_1D_double_ctx(int findroot, double (*funk)(double, void *), void *params, double x_lower, double x_upper, int gridsearch, int investigateLocalMinima, int nested, double *x_minimum, int max_iter, double epsabs, double epsrel, int verbose, int debug_verbose);
 int find_1D_error(double (*funk)(double *, void *), double *xminimum, int paramnr, int nrparameters, double dx, double dxmax, void *params, double sigma, double chi2min, int max_itr, double epsabs, double epsrel, double *errorbar, int verbose);
+int find_1D_error_ctx(double (*funk)(double *, void *), double *xminimum, int paramnr, int nrparameters, double dx, double dxmax, void *params, double sigma, double chi2min, int max_itr, double epsabs, double epsrel, double *errorbar, int verbose);
 int doAmoeba_d(int algorithm, double *xstart, double *dx, int *fixed, double *xfit, double *yfit, int nrparams, double (*funk)(double []), double ftol, int *nfunk, int verbose, int finderrors, double sigma, double *dplus, double *dmin);
 int find_errors_amoeba_d(int algorithm, double *dx, int *fixed, double *xfit, double yfit, int nrparams, double (*funk)(double []), double ftol, int paramnr, double *dplus, double *dmin, double sigma);
+int doAmoeba_d_ctx(int algorithm, double *xstart, double *dx, int *fixed, double *xfit, double *yfit, int nrparams, double (*funk)(double [], void *), void *params, double ftol, int *nfunk, int verbose, int finderrors, double sigma, double *dplus, double *dmin);
+int find_errors_amoeba_d_ctx(int algorithm, double *dx, int *fixed, double *xfit, double yfit, int nrparams, double (*funk)(double [], void *), void *params, double ftol, int paramnr, double *dplus, double *dmin, double sigma);
 int boxcarFindpeak(float *pulse, int nrBins, pulselongitude_regions_definition *onpulse, int *bin, int *pulsewidth, float *snrbest, float *E_best, int squared, int posOrNeg, int allwidths, int refine, int maxwidth, int only_onpulse, int nodebase, verbose_definition verbose);
 void initApplication(psrsalsaApplication *application, char *name, char *genusage);
 void terminateApplication(psrsalsaApplication *application);
@@ -250,11 +331,18 @@ int processCommandLine(psrsalsaApplication *application, int argc, char **argv,
 void printCitationInfo();
 int parse_command_string(verbose_definition verbose, int argc, char **argv, int argv_index, int check_only, int minrequestedparameters, char *format, ...);
 int preprocessApplication(psrsalsaApplication *application, datafile_definition *psrdata);
+int preprocessRequestedApplication(psrsalsaApplication *application);
+long long memoryEstimateApplication(psrsalsaApplication *application, datafile_definition *datafile, double analysiscopies, verbose_definition verbose);
+int memoryPlanApplication(psrsalsaApplication *application, datafile_definition *datafile, double analysiscopies, int canstream, verbose_definition verbose);
+int preprocessCacheLookup(psrsalsaApplication *application, datafile_definition *psrdata, preprocesscache_definition *cache, verbose_definition verbose);
+int preprocessCacheStore(psrsalsaApplication *application, datafile_definition *psrdata, preprocesscache_definition *cache, verbose_definition verbose);
+void freePreprocessCache(preprocesscache_definition *cache);
 int applicationAddFilename(int argi, verbose_definition verbose);
 int applicationFilenameList_checkConsecutive(char **argv, verbose_definition verbose);
 int numberInApplicationFilenameList(psrsalsaApplication *application, char **argv, verbose_definition verbose);
 char *getNextFilenameFromList(psrsalsaApplication *application, char **argv, verbose_definition verbose);
 void rewindFilenameList(psrsalsaApplication *application);
+int openApplicationConcatData(psrsalsaApplication *application, char **argv, datafile_definition *datafile, int read_in_memory, verbose_definition verbose);
 int getOutputName(psrsalsaApplication *application, char *filename, char *outputname, verbose_definition verbose);
 void showlibraryversioninformation(FILE *stream);
 int pgetch(void);
@@ -265,10 +353,12 @@ void constructCommandLineString(char *txt, int length, int argc, char **argv, ve
 int getMachinename(char *hostname, int size, verbose_definition verbose);
 char * pickWordFromString(char *string, int n, int *nrwords, int replacetabs, char separator, verbose_definition verbose);
 char *str_replace(char *orig, char *rep, char *with, verbose_definition verbose);
+int skipLinesInFile(FILE *fptr, int skiplines, verbose_definition verbose);
 int ascii_file_get_next_line(FILE *fin, char *txt, int maxlinelength, int skipChar, verbose_definition verbose);
 int ascii_file_stats(FILE *fin, char skipChar, long *nrlines, int maxlinelength, int autoNrColumns, int *nrColumns, verbose_definition verbose);
 int change_filename_extension(char *inputname, char *outputname, char *extension, int outputnamelength, verbose_definition verbose);
 int read_ascii_column(char *fname, int skiplines, char skipChar, int nrColumns, int autoNrColumns, long *nrdatapoints, int colnum, double scale, int read_log, float **data, float *mindata, float *maxdata, float *avdata, verbose_definition verbose, int verbose_stderr);
 int read_ascii_column_double(char *fname, int skiplines, char skipChar, int nrColumns, int autoNrColumns, long *nrdatapoints, int colnum, double scale, int read_log, double **data, double *mindata, double *maxdata, double *avdata, verbose_definition verbose, int verbose_stderr);
+int read_ascii_column_sketch(char *fname, int skiplines, char skipChar, int colnum, double scale, int read_log, quantile_sketch_definition *sketch, verbose_definition verbose, int verbose_stderr);
 int read_ascii_column_int(char *fname, int skiplines, char skipChar, int nrColumns, int autoNrColumns, long *nrdatapoints, int colnum, int **data, int *mindata, int *maxdata, double *avdata, verbose_definition verbose, int verbose_stderr);
 int read_ascii_column_str(char *fname, int skiplines, char skipChar, int nrColumns, int autoNrColumns, long *nrdatapoints, int colnum, char ***data, verbose_definition verbose, int verbose_stderr);
@@ -16,6 +16,18 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #define DM_CONST 4.148808e3
 #define MAX_pulselongitude_regions 200
 #define maxNrVonMisesComponents 100
+#define maxNrQuantileSketchLevels 64
+#define maxNrMapPyramidLevels 32
+#define maxNrPSRSALSAChunksCached 4
+#define maxNrConcatFilesOpen 16
+#define maxNrPendingJobLogs 512
+#define defaultPreprocessCacheSizeMB 4096
+#define memoryPlanOverheadMB 64
+#define dataAllocationAlignment 64
+#define dataAllocationHugePageSize 2097152
+#define dataAllocationHugePageThreshold 33554432
+#define MEMORYPLAN_STREAM 1
+#define MEMORYPLAN_INMEMORY 2
 #define MaxPickWordFromString_WordLength 1000
 #define MaxFilenameLength 10000
 #define MaxPgplotDeviceLength 2000
@@ -29,6 +41,8 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #define PPOL_SHORT_format 10
 #define SIGPROC_ASCII_format 11
 #define PSRSALSA_BINARY_format 20
+#define PSRSALSA_COMPRESSED_format 21
+#define CONCAT_format 98
 #define MEMORY_format 99
 #define PPGPLOT_GRAYSCALE 1
 #define PPGPLOT_INVERTED_GRAYSCALE 2
@@ -93,12 +107,25 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #define FREQMODE_UNKNOWN -1
 #define FREQMODE_UNIFORM 1
 #define FREQMODE_FREQTABLE 2
+#define DEFERRED_SCALES 1
+#define DEFERRED_FREQTABLE 2
+#define DEFERRED_HISTORY 4
 #define FEEDTYPE_UNKNOWN 0
 #define FEEDTYPE_LINEAR 1
 #define FEEDTYPE_CIRCULAR 2
 #define FEEDTYPE_INV_LINEAR -1
 #define FEEDTYPE_INV_CIRCULAR -2
 #define MaxNrApplicationFilenames 1025
+#define MaxNrTimingStages 64
+#define MaxTimingStageNameLength 64
+#define TIMING_BYTESREAD 0
+#define TIMING_BYTESWRITTEN 1
+#define TIMING_FFTPLANS 2
+#define TIMING_FFTEXECS 3
+#define TIMING_ALLOCATIONS 4
+#define TIMING_ALLOCATEDBYTES 5
+#define TIMING_PROFILES 6
+#define TIMING_NRCOUNTERS 7
 #define maxNrRotateStokes 10
 #ifndef NAN
   #define NAN (0.0/0.0)
@@ -20,16 +20,93 @@ typedef struct {
   int *frac_defined;
   float *left_frac, *right_frac;
 }pulselongitude_regions_definition;
+typedef struct {
+  int nrstages;
+  char stagename[MaxNrTimingStages][MaxTimingStageNameLength];
+  char *stagekey[MaxNrTimingStages];
+  double stagetime[MaxNrTimingStages];
+  long stagecalls[MaxNrTimingStages];
+  long long counters[TIMING_NRCOUNTERS];
+  double starttime;
+}timing_definition;
 typedef struct {
   int verbose;
   int debug;
   int nocounters;
   int indent;
+  timing_definition *timing;
 }verbose_definition;
 typedef struct {
   double centre[maxNrVonMisesComponents], concentration[maxNrVonMisesComponents], height[maxNrVonMisesComponents];
   int nrcomponents;
 }vonMises_collection_definition;
+typedef struct {
+  long nrbins;
+  double *costable, *sintable;
+}vonMises_template_definition;
+typedef struct {
+  long nrbins, nrharmonics;
+  float *templatespec;
+  double templatepower;
+  void *plan_forward, *plan_backward;
+}templatealign_definition;
+typedef struct {
+  long nrbinsx, nrbinsy;
+  double dx, dy, min_x, min_y;
+  double inv_dx, inv_dy, offsetx, offsety;
+  long binzerox, binzeroy;
+  int truncate;
+  long *counts;
+  long nrsamples, nroutside;
+}histogram_definition;
+typedef struct {
+  int k;
+  int nrlevels;
+  double *levels[maxNrQuantileSketchLevels];
+  long levelsize[maxNrQuantileSketchLevels];
+  long n;
+  double min, max;
+  unsigned long seed;
+}quantile_sketch_definition;
+typedef struct {
+  long n;
+  double *data;
+  double *cumweight;
+  double totalweight, effective_n;
+}ks_reference_definition;
+typedef struct {
+  unsigned long long seed;
+  unsigned long long stream;
+}randomstream_definition;
+typedef struct {
+  float *cmap;
+  long nrx, nry;
+  int nrlevels;
+  long levelnrx[maxNrMapPyramidLevels], levelnry[maxNrMapPyramidLevels];
+  long binx[maxNrMapPyramidLevels], biny[maxNrMapPyramidLevels];
+  float *min[maxNrMapPyramidLevels], *max[maxNrMapPyramidLevels], *mean[maxNrMapPyramidLevels];
+  unsigned long long fingerprint;
+}map_pyramid_definition;
+typedef struct {
+  long NrSubints, NrPols, NrFreqChan, NrBins;
+  float *min, *max;
+  double *sum, *sumsq;
+  long *nrnan;
+  unsigned long long fingerprint;
+}statsindex_definition;
+typedef struct {
+  char filename[MaxFilenameLength];
+  unsigned char *key;
+  long long keysize;
+}preprocesscache_definition;
+typedef struct {
+  long NrSubints, NrBins, NrPols, NrFreqChan;
+  int NrBits;
+  int searchmode, paswing;
+  double period, centrefreq, bandwidth, dm, rm;
+  double width, p2, p3, snr, polfrac, alpha, beta;
+  unsigned long long seed;
+}synthetic_definition;
 typedef struct {
   char plotDevice[MaxPgplotDeviceLength];
   int windowwidth, windowheight;
@@ -80,6 +157,15 @@ typedef struct {
   char *hostname;
   void *nextEntry;
 }datafile_history_entry_definition;
+typedef struct {
+  long nrchunks, chunksize;
+  long long *offsets;
+  int writing;
+  float *cache[maxNrPSRSALSAChunksCached];
+  long cachechunk[maxNrPSRSALSAChunksCached], cacheage[maxNrPSRSALSAChunksCached], age;
+  unsigned char *compressed, *scratch;
+  long writechunk;
+}psrsalsa_chunks_definition;
 typedef struct
 {
   FILE *fptr, *fptr_hdr;
@@ -126,8 +212,26 @@ typedef struct
   float *data;
   float *offpulse_rms;
   float *scales, *offsets, *weights;
-  long long datastart;
+  float *fits_rowbuffer;
+  char *fits_rowbuffer_profiles;
+  long fits_rowbuffer_subint, fits_rowbuffer_filled;
+  psrsalsa_chunks_definition *salsachunks;
+  int packedbits;
+  void *packeddata;
+  float *packedscale, *packedoffset, *packedrow;
+  void *concat;
+  void *mappedbase;
+  size_t mappedsize;
+  int deferred;
+  long long datastart, headeralign;
 }datafile_definition;
+typedef struct {
+  int nrfiles, format, nropen;
+  char **filenames;
+  long *firstsubint;
+  datafile_definition *files;
+  long *lastused, age;
+}psrsalsa_concat_definition;
 typedef struct {
   char progname[MaxFilenameLength], *genusage;
   int switch_verbose, switch_debug, switch_nocounters;
@@ -147,6 +251,7 @@ typedef struct {
   int switch_circshift, docircshift;
   int switch_rot, switch_rotdeg, doshiftphase; float shiftPhase_cmdline, shiftPhase;
   int switch_filelist, filelist;
+  int switch_concat, doconcat;
   int switch_device; char pgplotdevice[MaxPgplotDeviceLength];
   int switch_tscr; long dotscr;
   int switch_tscr_complete; int tscr_complete;
@@ -187,6 +292,12 @@ typedef struct {
   int switch_shuffle, doshuffle;
   int switch_rotateStokes; int nr_rotateStokes, rotateStokes1[maxNrRotateStokes], rotateStokes2[maxNrRotateStokes]; float rotateStokesAngle[maxNrRotateStokes];
   int switch_libversions;
+  int switch_timing, dotiming; char timingjson[MaxFilenameLength]; timing_definition timing;
+  int switch_statsindex, dostatsindex;
+  int switch_jobs, nrjobs; long long jobmemlimit;
+  int switch_cache; char cachedir[MaxFilenameLength]; long long cachesize;
+  int switch_memlimit; long long memlimit;
+  int switch_numa;
   int doautot;
   int switch_forceUniformFreqLabelling;
   int *fzapMask;
@@ -100,6 +100,8 @@ int boxcarFindpeak(float *pulse, int nrBins, pulselongitude_regions_definition *
   float baseline, rms;
   int w, w1, w2, dw, width, NrWidths, firsttime, *allowedWidths, b, b2;
   pulselongitude_regions_definition onpulse_search;
+  double t0;
+  t0 = timingStart(verbose);
   if(initPulselongitudeRegion(&onpulse_search, verbose) == 0) {
     printerror(verbose.debug, "ERROR boxcarFindpeak: Initialising onpulse region failed.");
     return 0;
@@ -194,5 +196,6 @@ int boxcarFindpeak(float *pulse, int nrBins, pulselongitude_regions_definition *
   }
   freePulselongitudeRegion(&onpulse_search);
   free(allowedWidths);
+  timingStop(verbose, "boxcarFindpeak", t0);
   return 1;
 }
@@ -0,0 +1,169 @@
+/*
+Copyright (c) 2015, Patrick Weltevrede
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_sort.h>
+#include "psrsalsa.h"
+int init_quantile_sketch(quantile_sketch_definition *sketch, int k, verbose_definition verbose)
+{
+  int i;
+  if(k < 8) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR init_quantile_sketch: Sketch size k=%d is too small (should be >= 8).", k);
+    return 0;
+  }
+  sketch->k = k;
+  sketch->nrlevels = 0;
+  sketch->n = 0;
+  sketch->min = sketch->max = 0;
+  sketch->seed = 12345;
+  for(i = 0; i < maxNrQuantileSketchLevels; i++) {
+    sketch->levels[i] = NULL;
+    sketch->levelsize[i] = 0;
+  }
+  sketch->levels[0] = (double *)malloc((2*k+2)*sizeof(double));
+  if(sketch->levels[0] == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR init_quantile_sketch: Memory allocation error.");
+    return 0;
+  }
+  sketch->nrlevels = 1;
+  return 1;
+}
+void free_quantile_sketch(quantile_sketch_definition *sketch)
+{
+  int i;
+  for(i = 0; i < sketch->nrlevels; i++) {
+    free(sketch->levels[i]);
+    sketch->levels[i] = NULL;
+  }
+  sketch->nrlevels = 0;
+}
+double quantile_sketch_rank_error(int k)
+{
+  return 2.296/pow(k, 0.9723);
+}
+long internal_quantile_sketch_capacity(quantile_sketch_definition *sketch, int level)
+{
+  long capacity;
+  capacity = ceil(sketch->k*pow(2.0/3.0, sketch->nrlevels-1-level));
+  if(capacity < 8)
+    capacity = 8;
+  return capacity;
+}
+int internal_quantile_sketch_compress(quantile_sketch_definition *sketch, verbose_definition verbose)
+{
+  int h, odd, offset;
+  long i;
+  double *src, *dst;
+  for(h = 0; h < sketch->nrlevels; h++) {
+    if(sketch->levelsize[h] < internal_quantile_sketch_capacity(sketch, h))
+      continue;
+    if(h+1 == sketch->nrlevels) {
+      if(sketch->nrlevels == maxNrQuantileSketchLevels) {
+ fflush(stdout);
+ printerror(verbose.debug, "ERROR internal_quantile_sketch_compress: Maximum number of levels reached.");
+ return 0;
+      }
+      sketch->levels[h+1] = (double *)malloc((2*sketch->k+2)*sizeof(double));
+      if(sketch->levels[h+1] == NULL) {
+ fflush(stdout);
+ printerror(verbose.debug, "ERROR internal_quantile_sketch_compress: Memory allocation error.");
+ return 0;
+      }
+      sketch->levelsize[h+1] = 0;
+      sketch->nrlevels++;
+    }
+    src = sketch->levels[h];
+    dst = sketch->levels[h+1];
+    gsl_sort(src, 1, sketch->levelsize[h]);
+    sketch->seed = sketch->seed*6364136223846793005UL + 1442695040888963407UL;
+    offset = (sketch->seed >> 63) & 1;
+    odd = sketch->levelsize[h] % 2;
+    for(i = odd+offset; i < sketch->levelsize[h]; i += 2)
+      dst[sketch->levelsize[h+1]++] = src[i];
+    sketch->levelsize[h] = odd;
+  }
+  return 1;
+}
+int add_quantile_sketch(quantile_sketch_definition *sketch, double value, verbose_definition verbose)
+{
+  if(sketch->n == 0 || value < sketch->min)
+    sketch->min = value;
+  if(sketch->n == 0 || value > sketch->max)
+    sketch->max = value;
+  sketch->n++;
+  sketch->levels[0][sketch->levelsize[0]++] = value;
+  if(sketch->levelsize[0] >= internal_quantile_sketch_capacity(sketch, 0))
+    return internal_quantile_sketch_compress(sketch, verbose);
+  return 1;
+}
+int query_quantile_sketch(quantile_sketch_definition *sketch, double fraction, double *value, verbose_definition verbose)
+{
+  long i, j, nritems;
+  int h;
+  double *items, *weights, cumulative, target;
+  size_t *order;
+  if(sketch->n == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR query_quantile_sketch: The sketch is empty.");
+    return 0;
+  }
+  if(fraction <= 0) {
+    *value = sketch->min;
+    return 1;
+  }
+  if(fraction >= 1) {
+    *value = sketch->max;
+    return 1;
+  }
+  nritems = 0;
+  for(h = 0; h < sketch->nrlevels; h++)
+    nritems += sketch->levelsize[h];
+  items = (double *)malloc(nritems*sizeof(double));
+  weights = (double *)malloc(nritems*sizeof(double));
+  order = (size_t *)malloc(nritems*sizeof(size_t));
+  if(items == NULL || weights == NULL || order == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR query_quantile_sketch: Memory allocation error.");
+    return 0;
+  }
+  j = 0;
+  for(h = 0; h < sketch->nrlevels; h++) {
+    for(i = 0; i < sketch->levelsize[h]; i++) {
+      items[j] = sketch->levels[h][i];
+      weights[j] = ldexp(1.0, h);
+      j++;
+    }
+  }
+  gsl_sort_index(order, items, 1, nritems);
+  target = fraction*sketch->n;
+  cumulative = 0;
+  *value = sketch->max;
+  for(i = 0; i < nritems; i++) {
+    cumulative += weights[order[i]];
+    if(cumulative >= target) {
+      *value = items[order[i]];
+      break;
+    }
+  }
+  free(items);
+  free(weights);
+  free(order);
+  return 1;
+}
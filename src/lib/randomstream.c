@@ -0,0 +1,140 @@
+/*
+Copyright (c) 2015, Patrick Weltevrede
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "psrsalsa.h"
+#define RANDOMSTREAM_PARALLEL_MIN_SAMPLES 10000
+void randomstream_init(randomstream_definition *rs, unsigned long long seed, unsigned long long stream)
+{
+  rs->seed = seed;
+  rs->stream = stream;
+}
+void internal_randomstream_philox(unsigned int *ctr, unsigned int *key, unsigned int *out)
+{
+  int round;
+  unsigned long long prod0, prod1;
+  unsigned int c0, c1, c2, c3, k0, k1;
+  c0 = ctr[0];
+  c1 = ctr[1];
+  c2 = ctr[2];
+  c3 = ctr[3];
+  k0 = key[0];
+  k1 = key[1];
+  for(round = 0; round < 10; round++) {
+    prod0 = (unsigned long long)0xD2511F53U*c0;
+    prod1 = (unsigned long long)0xCD9E8D57U*c2;
+    c0 = (unsigned int)(prod1 >> 32) ^ c1 ^ k0;
+    c2 = (unsigned int)(prod0 >> 32) ^ c3 ^ k1;
+    c1 = (unsigned int)prod1;
+    c3 = (unsigned int)prod0;
+    k0 += 0x9E3779B9U;
+    k1 += 0xBB67AE85U;
+  }
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+void randomstream_block(randomstream_definition *rs, unsigned long long index, unsigned int draw, unsigned int *out)
+{
+  unsigned int ctr[4], key[2];
+  ctr[0] = (unsigned int)index;
+  ctr[1] = ((unsigned int)(index >> 32) & 0xFFFFU) | (draw << 16);
+  ctr[2] = (unsigned int)rs->stream;
+  ctr[3] = (unsigned int)(rs->stream >> 32);
+  key[0] = (unsigned int)rs->seed;
+  key[1] = (unsigned int)(rs->seed >> 32);
+  internal_randomstream_philox(ctr, key, out);
+}
+double internal_randomstream_todouble(unsigned int hi, unsigned int lo)
+{
+  return ((double)(((unsigned long long)hi << 21) ^ (lo >> 11)) + 0.5)*(1.0/9007199254740992.0);
+}
+double randomstream_uniform_at(randomstream_definition *rs, unsigned long long index, unsigned int draw)
+{
+  unsigned int out[4];
+  randomstream_block(rs, index, draw, out);
+  return internal_randomstream_todouble(out[0], out[1]);
+}
+double internal_randomstream_gaussian_block(unsigned int *out)
+{
+  double u1, u2;
+  u1 = internal_randomstream_todouble(out[0], out[1]);
+  u2 = internal_randomstream_todouble(out[2], out[3]);
+  return sqrt(-2.0*log(u1))*cos(2.0*M_PI*u2);
+}
+double randomstream_gaussian_at(randomstream_definition *rs, unsigned long long index, unsigned int draw)
+{
+  unsigned int out[4];
+  randomstream_block(rs, index, draw, out);
+  return internal_randomstream_gaussian_block(out);
+}
+double randomstream_gamma_at(randomstream_definition *rs, unsigned long long index, double k)
+{
+  unsigned int out[4], draw;
+  double d, c, x, v, u, boost;
+  boost = 1;
+  if(k < 1) {
+    boost = pow(randomstream_uniform_at(rs, index, 0), 1.0/k);
+    k += 1;
+  }
+  d = k - 1.0/3.0;
+  c = 1.0/sqrt(9.0*d);
+  for(draw = 1; draw < 0x8000U; draw++) {
+    randomstream_block(rs, index, draw, out);
+    x = internal_randomstream_gaussian_block(out);
+    v = 1.0 + c*x;
+    if(v <= 0)
+      continue;
+    v = v*v*v;
+    randomstream_block(rs, index, draw+0x8000U, out);
+    u = internal_randomstream_todouble(out[0], out[1]);
+    if(u < 1.0 - 0.0331*x*x*x*x)
+      break;
+    if(log(u) < 0.5*x*x + d*(1.0 - v + log(v)))
+      break;
+  }
+  return boost*d*v;
+}
+void randomstream_uniform(randomstream_definition *rs, unsigned long long offset, long n, double min, double max, double *data)
+{
+  long i;
+#pragma omp parallel for if(n >= RANDOMSTREAM_PARALLEL_MIN_SAMPLES)
+  for(i = 0; i < n; i++)
+    data[i] = min + (max-min)*randomstream_uniform_at(rs, offset+i, 0);
+}
+void randomstream_gaussian(randomstream_definition *rs, unsigned long long offset, long n, double mu, double sigma, double *data)
+{
+  long i;
+#pragma omp parallel for if(n >= RANDOMSTREAM_PARALLEL_MIN_SAMPLES)
+  for(i = 0; i < n; i++)
+    data[i] = mu + sigma*randomstream_gaussian_at(rs, offset+i, 0);
+}
+void randomstream_gaussian_float(randomstream_definition *rs, unsigned long long offset, long n, float sigma, float *data)
+{
+  long i;
+#pragma omp parallel for if(n >= RANDOMSTREAM_PARALLEL_MIN_SAMPLES)
+  for(i = 0; i < n; i++)
+    data[i] += sigma*randomstream_gaussian_at(rs, offset+i, 0);
+}
+void randomstream_gamma(randomstream_definition *rs, unsigned long long offset, long n, double k, double theta, double *data)
+{
+  long i;
+#pragma omp parallel for schedule(dynamic,1024) if(n >= RANDOMSTREAM_PARALLEL_MIN_SAMPLES)
+  for(i = 0; i < n; i++)
+    data[i] = theta*randomstream_gamma_at(rs, offset+i, k);
+}
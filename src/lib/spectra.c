@@ -37,6 +37,8 @@ int calc2DFS(float *data, long nry, long nrx, unsigned long fft_size, float *two
   #else
     float ***inputdata, **speq;
   #endif
+  double t0;
+  t0 = timingStart(verbose);
   ok = 0;
   pwr = 0;
   junk_float = log(fft_size)/log(2);
@@ -103,6 +105,7 @@ int calc2DFS(float *data, long nry, long nrx, unsigned long fft_size, float *two
       return 0;
     }
     plan = fftwf_plan_dft_r2c_2d(nrx2, fft_size, inputdata, fftdata, FFTW_ESTIMATE);
+    timingCount(verbose, TIMING_FFTPLANS, 1);
   #else
     inputdata = f3tensor(1,1,1,nrx2,1,fft_size);
     speq = matrix(1,1,1,2*nrx2);
@@ -152,6 +155,7 @@ int calc2DFS(float *data, long nry, long nrx, unsigned long fft_size, float *two
     }
 #ifdef USEFFTW3
     fftwf_execute(plan);
+    timingCount(verbose, TIMING_FFTEXECS, 1);
     for(nb = 0; nb < nrx2; nb++) {
       nb2 = nb+nrx2/2;
       if(nb2 >= nrx2)
@@ -188,6 +192,7 @@ int calc2DFS(float *data, long nry, long nrx, unsigned long fft_size, float *two
       }
 #ifdef USEFFTW3
     fftwf_execute(plan);
+    timingCount(verbose, TIMING_FFTEXECS, 1);
     for(nb = 0; nb < nrx2; nb++) {
       nb2 = nb+nrx2/2;
       if(nb2 >= nrx2)
@@ -227,6 +232,7 @@ int calc2DFS(float *data, long nry, long nrx, unsigned long fft_size, float *two
   free_matrix(speq, 1,1,1,2*nrx2);
   free_f3tensor(inputdata,1,1,1,nrx2,1,fft_size);
 #endif
+  timingStop(verbose, "calc2DFS", t0);
   return 1;
 }
 int calcLRFS(float *data, long nry, long nrx, unsigned long fft_size, float *lrfs, int subtractDC, float *phase_track, float *phase_track_phases, int calcPhaseTrack, float freq_min, float freq_max, int track_only_first_region, float *subpulseAmplitude, int calcsubpulseAmplitude, int mask_freqs, int inverseFFT, pulselongitude_regions_definition *regions, float *var_rms, int argc, char **argv, verbose_definition verbose)
@@ -243,6 +249,8 @@ int calcLRFS(float *data, long nry, long nrx, unsigned long fft_size, float *lrf
   fftwf_plan plan1;
   fftwf_plan plan2;
 #endif
+  double t0;
+  t0 = timingStart(verbose);
   if(regions != NULL) {
     *var_rms = 0;
     var_mean = 0;
@@ -268,6 +276,7 @@ int calcLRFS(float *data, long nry, long nrx, unsigned long fft_size, float *lrf
 #ifdef USEFFTW3
   plan1 = fftwf_plan_dft_r2c_1d(fft_size, data1, (fftwf_complex *)data1, FFTW_ESTIMATE);
   plan2 = fftwf_plan_dft_c2r_1d(fft_size, (fftwf_complex *)data1, data1, FFTW_ESTIMATE);
+  timingCount(verbose, TIMING_FFTPLANS, 2);
   if(fft_size > 2147483640) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR calcLRFS: requested fft too long.");
@@ -321,6 +330,7 @@ int calcLRFS(float *data, long nry, long nrx, unsigned long fft_size, float *lrf
       }
 #ifdef USEFFTW3
       fftwf_execute(plan1);
+      timingCount(verbose, TIMING_FFTEXECS, 1);
 #else
       realft(data1-1, fft_size, 1);
       data1[2*(fft_size/2)] = data1[1];
@@ -527,6 +537,7 @@ int calcLRFS(float *data, long nry, long nrx, unsigned long fft_size, float *lrf
   fftwf_destroy_plan(plan1);
   fftwf_destroy_plan(plan2);
 #endif
+  timingStop(verbose, "calcLRFS", t0);
   return 1;
 }
 void calcModindex(float *lrfs, float *profile, long nrx, unsigned long fft_size, unsigned long nrpulses, float *sigma, float *rms_sigma, float *modind, float *rms_modind, pulselongitude_regions_definition *regions, float var_rms, verbose_definition verbose)
@@ -16,9 +16,15 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <time.h>
 #include <sys/time.h>
 #include <math.h>
+#include <string.h>
 #include <gsl/gsl_sort.h>
+#include <gsl/gsl_sort_float.h>
 #include <gsl/gsl_cdf.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "psrsalsa.h"
+#define PARALLEL_SORT_MIN_SAMPLES 100000
 long randomUnsignedInt()
 {
   time_t seconds;
@@ -249,6 +255,165 @@ int set_binning_histogram(double min_x_data, double max_x_data, int rangex_set,
   }while(reset == 1);
   return 0;
 }
+double internal_select_kth_smallest_double(double *data, long left, long right, long k)
+{
+  long i, j, mid;
+  int depth_limit;
+  double pivot, tmp;
+  depth_limit = 2;
+  for(i = right-left+1; i > 1; i /= 2)
+    depth_limit += 2;
+  while(right > left) {
+    if(depth_limit-- == 0) {
+      gsl_sort(&data[left], 1, right-left+1);
+      return data[k];
+    }
+    mid = left + (right-left)/2;
+    if(data[mid] < data[left]) {
+      tmp = data[mid]; data[mid] = data[left]; data[left] = tmp;
+    }
+    if(data[right] < data[left]) {
+      tmp = data[right]; data[right] = data[left]; data[left] = tmp;
+    }
+    if(data[right] < data[mid]) {
+      tmp = data[right]; data[right] = data[mid]; data[mid] = tmp;
+    }
+    pivot = data[mid];
+    i = left;
+    j = right;
+    while(i <= j) {
+      while(data[i] < pivot)
+ i++;
+      while(data[j] > pivot)
+ j--;
+      if(i <= j) {
+ tmp = data[i]; data[i] = data[j]; data[j] = tmp;
+ i++;
+ j--;
+      }
+    }
+    if(k <= j)
+      right = j;
+    else if(k >= i)
+      left = i;
+    else
+      return data[k];
+  }
+  return data[k];
+}
+double select_kth_smallest_double(double *data, long n, long k)
+{
+  if(n < 1 || k < 0 || k >= n)
+    return NAN;
+  return internal_select_kth_smallest_double(data, 0, n-1, k);
+}
+double quantile_select_double(double *data, long n, double fraction)
+{
+  long lhs, i;
+  double index, delta, lower, upper;
+  if(n < 1)
+    return NAN;
+  if(n == 1 || fraction <= 0)
+    return select_kth_smallest_double(data, n, 0);
+  if(fraction >= 1)
+    return select_kth_smallest_double(data, n, n-1);
+  index = fraction*(n-1);
+  lhs = (long)index;
+  delta = index - lhs;
+  lower = select_kth_smallest_double(data, n, lhs);
+  if(delta == 0 || lhs == n-1)
+    return lower;
+  upper = data[lhs+1];
+  for(i = lhs+2; i < n; i++) {
+    if(data[i] < upper)
+      upper = data[i];
+  }
+  return (1-delta)*lower + delta*upper;
+}
+double median_select_double(double *data, long n)
+{
+  return quantile_select_double(data, n, 0.5);
+}
+float internal_select_kth_smallest_float(float *data, long left, long right, long k)
+{
+  long i, j, mid;
+  int depth_limit;
+  float pivot, tmp;
+  depth_limit = 2;
+  for(i = right-left+1; i > 1; i /= 2)
+    depth_limit += 2;
+  while(right > left) {
+    if(depth_limit-- == 0) {
+      gsl_sort_float(&data[left], 1, right-left+1);
+      return data[k];
+    }
+    mid = left + (right-left)/2;
+    if(data[mid] < data[left]) {
+      tmp = data[mid]; data[mid] = data[left]; data[left] = tmp;
+    }
+    if(data[right] < data[left]) {
+      tmp = data[right]; data[right] = data[left]; data[left] = tmp;
+    }
+    if(data[right] < data[mid]) {
+      tmp = data[right]; data[right] = data[mid]; data[mid] = tmp;
+    }
+    pivot = data[mid];
+    i = left;
+    j = right;
+    while(i <= j) {
+      while(data[i] < pivot)
+ i++;
+      while(data[j] > pivot)
+ j--;
+      if(i <= j) {
+ tmp = data[i]; data[i] = data[j]; data[j] = tmp;
+ i++;
+ j--;
+      }
+    }
+    if(k <= j)
+      right = j;
+    else if(k >= i)
+      left = i;
+    else
+      return data[k];
+  }
+  return data[k];
+}
+float select_kth_smallest_float(float *data, long n, long k)
+{
+  if(n < 1 || k < 0 || k >= n)
+    return NAN;
+  return internal_select_kth_smallest_float(data, 0, n-1, k);
+}
+float quantile_select_float(float *data, long n, double fraction)
+{
+  long lhs, i;
+  double index, delta;
+  float lower, upper;
+  if(n < 1)
+    return NAN;
+  if(n == 1 || fraction <= 0)
+    return select_kth_smallest_float(data, n, 0);
+  if(fraction >= 1)
+    return select_kth_smallest_float(data, n, n-1);
+  index = fraction*(n-1);
+  lhs = (long)index;
+  delta = index - lhs;
+  lower = select_kth_smallest_float(data, n, lhs);
+  if(delta == 0 || lhs == n-1)
+    return lower;
+  upper = data[lhs+1];
+  for(i = lhs+2; i < n; i++) {
+    if(data[i] < upper)
+      upper = data[i];
+  }
+  return (1-delta)*lower + delta*upper;
+}
+float median_select_float(float *data, long n)
+{
+  return quantile_select_float(data, n, 0.5);
+}
 double kstest_cdf_flat(double x, double min_x, double max_x)
 {
   if(x <= min_x)
@@ -265,32 +430,253 @@ double kstest_cdf_sin(double x)
     return 1;
   return 1-cos(x*M_PI/180.0);
 }
-void kstest(double *data1, long n1, double *data2, long n2, int cdf_type, double (*cdf)(double), double *max_diff, double *prob, verbose_definition verbose)
+void internal_merge_sorted_double(double *src, long left, long mid, long right, double *dst)
+{
+  long i, j, k;
+  i = left;
+  j = mid;
+  k = left;
+  while(i < mid && j < right) {
+    if(src[j] < src[i])
+      dst[k++] = src[j++];
+    else
+      dst[k++] = src[i++];
+  }
+  while(i < mid)
+    dst[k++] = src[i++];
+  while(j < right)
+    dst[k++] = src[j++];
+}
+int parallel_sort_double(double *data, long n, verbose_definition verbose)
+{
+  int nrchunks, chunk, width;
+  long *boundaries;
+  double *buffer, *src, *dst, *tmp;
+  nrchunks = 1;
+#ifdef _OPENMP
+  if(n >= PARALLEL_SORT_MIN_SAMPLES)
+    nrchunks = omp_get_max_threads();
+#endif
+  if(nrchunks <= 1) {
+    gsl_sort(data, 1, n);
+    return 1;
+  }
+  boundaries = (long *)malloc((nrchunks+1)*sizeof(long));
+  buffer = (double *)malloc(n*sizeof(double));
+  if(boundaries == NULL || buffer == NULL) {
+    if(verbose.debug)
+      printf("parallel_sort_double: Cannot allocate merge buffer, sorting single threaded.\n");
+    if(boundaries != NULL)
+      free(boundaries);
+    if(buffer != NULL)
+      free(buffer);
+    gsl_sort(data, 1, n);
+    return 1;
+  }
+  for(chunk = 0; chunk <= nrchunks; chunk++)
+    boundaries[chunk] = (n*(long long)chunk)/nrchunks;
+#pragma omp parallel for schedule(dynamic,1)
+  for(chunk = 0; chunk < nrchunks; chunk++)
+    gsl_sort(&data[boundaries[chunk]], 1, boundaries[chunk+1]-boundaries[chunk]);
+  src = data;
+  dst = buffer;
+  for(width = 1; width < nrchunks; width *= 2) {
+#pragma omp parallel for schedule(dynamic,1)
+    for(chunk = 0; chunk < nrchunks; chunk += 2*width) {
+      int mid, right;
+      mid = chunk+width < nrchunks ? chunk+width : nrchunks;
+      right = chunk+2*width < nrchunks ? chunk+2*width : nrchunks;
+      internal_merge_sorted_double(src, boundaries[chunk], boundaries[mid], boundaries[right], dst);
+    }
+    tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+  if(src != data)
+    memcpy(data, src, n*sizeof(double));
+  free(buffer);
+  free(boundaries);
+  return 1;
+}
+int ks_reference_init(ks_reference_definition *ref, double *data, double *weights, long n, verbose_definition verbose)
+{
+  long i;
+  size_t *order;
+  double sumw2;
+  ref->n = n;
+  ref->cumweight = NULL;
+  ref->data = (double *)malloc(n*sizeof(double));
+  if(ref->data == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR ks_reference_init: Memory allocation error.");
+    return 0;
+  }
+  if(weights == NULL) {
+    memcpy(ref->data, data, n*sizeof(double));
+    parallel_sort_double(ref->data, n, verbose);
+    ref->totalweight = n;
+    ref->effective_n = n;
+    return 1;
+  }
+  ref->cumweight = (double *)malloc(n*sizeof(double));
+  order = (size_t *)malloc(n*sizeof(size_t));
+  if(ref->cumweight == NULL || order == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR ks_reference_init: Memory allocation error.");
+    if(order != NULL)
+      free(order);
+    ks_reference_free(ref);
+    return 0;
+  }
+  gsl_sort_index(order, data, 1, n);
+  ref->totalweight = 0;
+  sumw2 = 0;
+  for(i = 0; i < n; i++) {
+    if(weights[order[i]] < 0) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR ks_reference_init: Weights cannot be negative.");
+      free(order);
+      ks_reference_free(ref);
+      return 0;
+    }
+    ref->data[i] = data[order[i]];
+    ref->totalweight += weights[order[i]];
+    ref->cumweight[i] = ref->totalweight;
+    sumw2 += weights[order[i]]*weights[order[i]];
+  }
+  free(order);
+  if(ref->totalweight <= 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR ks_reference_init: Sum of the weights should be positive.");
+    ks_reference_free(ref);
+    return 0;
+  }
+  ref->effective_n = ref->totalweight*ref->totalweight/sumw2;
+  return 1;
+}
+void ks_reference_free(ks_reference_definition *ref)
+{
+  if(ref->data != NULL)
+    free(ref->data);
+  if(ref->cumweight != NULL)
+    free(ref->cumweight);
+  ref->data = NULL;
+  ref->cumweight = NULL;
+}
+double internal_ks_reference_cdf(ks_reference_definition *ref, long i)
+{
+  if(i == 0)
+    return 0;
+  if(ref->cumweight == NULL)
+    return i/(double)ref->n;
+  return ref->cumweight[i-1]/ref->totalweight;
+}
+double internal_ks_merge_walk(ks_reference_definition *ref1, ks_reference_definition *ref2)
 {
   long i1, i2;
-  double effective_n, ks_statistic, sign, cur_term, last_term, coeff;
+  double x, diff, max_diff;
+  i1 = 0;
+  i2 = 0;
+  max_diff = 0;
+  while(i1 < ref1->n && i2 < ref2->n) {
+    x = ref1->data[i1] < ref2->data[i2] ? ref1->data[i1] : ref2->data[i2];
+    while(i1 < ref1->n && ref1->data[i1] <= x)
+      i1++;
+    while(i2 < ref2->n && ref2->data[i2] <= x)
+      i2++;
+    diff = fabs(internal_ks_reference_cdf(ref1, i1) - internal_ks_reference_cdf(ref2, i2));
+    if(diff > max_diff)
+      max_diff = diff;
+  }
+  return max_diff;
+}
+double kstest_probability(double max_diff, double effective_n, verbose_definition verbose)
+{
+  double ks_statistic, sign, cur_term, last_term, coeff, prob;
   int converged;
-  gsl_sort(data1, 1, n1);
+  long i;
+  if(effective_n < 4) {
+    printwarning(verbose.debug, "WARNING kstest: Number of data-points is too low to make use of approximations used in this implementation of the KS-test.");
+  }
+  effective_n=sqrt(effective_n);
+  ks_statistic = max_diff*(effective_n+0.12+0.11/effective_n);
+  coeff = -2.0*ks_statistic*ks_statistic;
+  prob = 0;
+  sign = 1;
+  last_term = 0;
+  converged = 0;
+  for(i = 1; i <= 100; i++) {
+    cur_term = sign*2.0*exp(coeff*i*i);
+    prob += cur_term;
+    if(fabs(cur_term) <= 1e-5*fabs(last_term) || fabs(cur_term) <= 1e-10*prob) {
+      converged = 1;
+      break;
+    }
+    last_term = cur_term;
+    sign = -sign;
+  }
+  if(!converged)
+    prob = 1;
+  return prob;
+}
+int kstest_reference(ks_reference_definition *ref, double *data, double *weights, long n, int presorted, double *max_diff, double *prob, verbose_definition verbose)
+{
+  ks_reference_definition trial;
+  if(weights != NULL) {
+    if(ks_reference_init(&trial, data, weights, n, verbose) == 0)
+      return 0;
+  }else {
+    if(presorted == 0)
+      parallel_sort_double(data, n, verbose);
+    trial.n = n;
+    trial.data = data;
+    trial.cumweight = NULL;
+    trial.totalweight = n;
+    trial.effective_n = n;
+  }
+  *max_diff = internal_ks_merge_walk(ref, &trial);
+  *prob = kstest_probability(*max_diff, ref->effective_n*trial.effective_n/(ref->effective_n+trial.effective_n), verbose);
+  if(weights != NULL)
+    ks_reference_free(&trial);
+  return 1;
+}
+int kstest_reference_multi(ks_reference_definition *ref, double **data, long *n, int nrsets, double *max_diff, double *prob, verbose_definition verbose)
+{
+  int set;
+  verbose_definition noverbose;
+  copyVerboseState(verbose, &noverbose);
+  noverbose.verbose = 0;
+#pragma omp parallel for schedule(dynamic,1)
+  for(set = 0; set < nrsets; set++) {
+    ks_reference_definition trial;
+    gsl_sort(data[set], 1, n[set]);
+    trial.n = n[set];
+    trial.data = data[set];
+    trial.cumweight = NULL;
+    trial.totalweight = n[set];
+    trial.effective_n = n[set];
+    max_diff[set] = internal_ks_merge_walk(ref, &trial);
+    prob[set] = kstest_probability(max_diff[set], ref->effective_n*trial.effective_n/(ref->effective_n+trial.effective_n), noverbose);
+  }
+  return 1;
+}
+void kstest(double *data1, long n1, double *data2, long n2, int cdf_type, double (*cdf)(double), double *max_diff, double *prob, verbose_definition verbose)
+{
+  long i1;
+  double effective_n;
+  parallel_sort_double(data1, n1, verbose);
   if(n2 > 0 && data2 != NULL)
-    gsl_sort(data2, 1, n2);
+    parallel_sort_double(data2, n2, verbose);
   *max_diff = 0;
   if(n2 > 0 && data2 != NULL) {
-    i1 = 0;
-    i2 = 0;
-    while(i1 < n1 && i2 < n2) {
-      double diff;
-      if(data1[i1] == data2[i2]) {
- i1++;
- i2++;
-      }else if(data1[i1] < data2[i2]) {
- i1++;
-      }else {
- i2++;
-      }
-      diff = fabs(i1/(double)n1 - i2/(double)n2);
-      if(diff > *max_diff)
- *max_diff = diff;
-    }
+    ks_reference_definition ref1, ref2;
+    ref1.n = n1;
+    ref1.data = data1;
+    ref1.cumweight = NULL;
+    ref2.n = n2;
+    ref2.data = data2;
+    ref2.cumweight = NULL;
+    *max_diff = internal_ks_merge_walk(&ref1, &ref2);
     effective_n=n1*n2/(double)(n1+n2);
   }else {
     double cdf_right, cdf_left, cdf_model;
@@ -319,28 +705,7 @@ void kstest(double *data1, long n1, double *data2, long n2, int cdf_type, double
     }
     effective_n=n1;
   }
-  if(effective_n < 4) {
-    printwarning(verbose.debug, "WARNING kstest: Number of data-points is too low to make use of approximations used in this implementation of the KS-test.");
-  }
-  effective_n=sqrt(effective_n);
-  ks_statistic = (*max_diff)*(effective_n+0.12+0.11/effective_n);
-  coeff = -2.0*ks_statistic*ks_statistic;
-  *prob = 0;
-  sign = 1;
-  last_term = 0;
-  converged = 0;
-  for(i1 = 1; i1 <= 100; i1++) {
-    cur_term = sign*2.0*exp(coeff*i1*i1);
-    *prob += cur_term;
-    if(fabs(cur_term) <= 1e-5*fabs(last_term) || fabs(cur_term) <= 1e-10*(*prob)) {
-      converged = 1;
-      break;
-    }
-    last_term = cur_term;
-    sign = -sign;
-  }
-  if(!converged)
-    *prob = 1;
+  *prob = kstest_probability(*max_diff, effective_n, verbose);
   if(verbose.verbose) {
     printf("KS-test statistic max_diff: %lf = %e\n", *max_diff, *max_diff);
     printf("KS-test probability:        %lf = %e\nA small probability means the two sets of points are drawn from a different distribution.\n", *prob, *prob);
@@ -0,0 +1,396 @@
+/*
+Copyright (c) 2015, Patrick Weltevrede
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "psrsalsa.h"
+#define STATS_INDEX_MAGIC "PSRSALSASTATIDX"
+#define STATS_INDEX_VERSION 2
+#define STATS_INDEX_CHECKSUM_BYTES 65536
+void internal_preprocesscache_hash(unsigned long long *hash, void *ptr, size_t nrbytes);
+void internal_statsindex_clear(statsindex_definition *index)
+{
+  index->NrSubints = index->NrPols = index->NrFreqChan = index->NrBins = 0;
+  index->min = index->max = NULL;
+  index->sum = index->sumsq = NULL;
+  index->nrnan = NULL;
+  index->fingerprint = 0;
+}
+int internal_statsindex_allocate(statsindex_definition *index, long NrSubints, long NrPols, long NrFreqChan, long NrBins, verbose_definition verbose)
+{
+  long n;
+  index->NrSubints = NrSubints;
+  index->NrPols = NrPols;
+  index->NrFreqChan = NrFreqChan;
+  index->NrBins = NrBins;
+  n = NrSubints*NrPols*NrFreqChan;
+  index->min = (float *)malloc(n*sizeof(float));
+  index->max = (float *)malloc(n*sizeof(float));
+  index->sum = (double *)malloc(n*sizeof(double));
+  index->sumsq = (double *)malloc(n*sizeof(double));
+  index->nrnan = (long *)malloc(n*sizeof(long));
+  if(index->min == NULL || index->max == NULL || index->sum == NULL || index->sumsq == NULL || index->nrnan == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR initStatsIndex: Memory allocation error.");
+    freeStatsIndex(index);
+    return 0;
+  }
+  return 1;
+}
+unsigned long long internal_statsindex_fingerprint(datafile_definition *datafile)
+{
+  long long n;
+  unsigned long long fingerprint;
+  if(datafile->format != MEMORY_format || datafile->data == NULL)
+    return 0;
+  n = datafile->NrSubints*datafile->NrPols*datafile->NrFreqChan*datafile->NrBins;
+  if(n <= 0)
+    return 0;
+  fingerprint = 14695981039346656037ULL;
+  internal_preprocesscache_hash(&fingerprint, datafile->data, n*sizeof(float));
+  return fingerprint;
+}
+int internal_statsindex_filekey(char *filename, long long *size, long long *mtime, unsigned long long *checksum)
+{
+  struct stat filestat;
+  FILE *fin;
+  unsigned char *buffer;
+  long i, n, part;
+  if(filename == NULL)
+    return 0;
+  if(stat(filename, &filestat) != 0)
+    return 0;
+  *size = filestat.st_size;
+  *mtime = filestat.st_mtime;
+  fin = fopen(filename, "rb");
+  if(fin == NULL)
+    return 0;
+  buffer = (unsigned char *)malloc(STATS_INDEX_CHECKSUM_BYTES);
+  if(buffer == NULL) {
+    fclose(fin);
+    return 0;
+  }
+  *checksum = 14695981039346656037ULL;
+  internal_preprocesscache_hash(checksum, &(filestat.st_dev), sizeof(filestat.st_dev));
+  internal_preprocesscache_hash(checksum, &(filestat.st_ino), sizeof(filestat.st_ino));
+  internal_preprocesscache_hash(checksum, &(filestat.st_mtim), sizeof(filestat.st_mtim));
+  internal_preprocesscache_hash(checksum, &(filestat.st_ctim), sizeof(filestat.st_ctim));
+  for(part = 0; part < 2; part++) {
+    if(part == 1) {
+      if(*size <= STATS_INDEX_CHECKSUM_BYTES)
+ break;
+      fseeko(fin, -STATS_INDEX_CHECKSUM_BYTES, SEEK_END);
+    }
+    n = fread(buffer, 1, STATS_INDEX_CHECKSUM_BYTES, fin);
+    internal_preprocesscache_hash(checksum, buffer, n);
+  }
+  free(buffer);
+  fclose(fin);
+  return 1;
+}
+void internal_statsindex_profile(float *profile, long nrbins, float *min, float *max, double *sum, double *sumsq, long *nrnan)
+{
+  long b;
+  int first;
+  float value;
+  double s, ss;
+  first = 1;
+  *min = *max = 0;
+  *nrnan = 0;
+  s = ss = 0;
+  for(b = 0; b < nrbins; b++) {
+    value = profile[b];
+    if(isnan(value)) {
+      (*nrnan)++;
+      continue;
+    }
+    if(first || value < *min)
+      *min = value;
+    if(first || value > *max)
+      *max = value;
+    first = 0;
+    s += value;
+    ss += value*(double)value;
+  }
+  *sum = s;
+  *sumsq = ss;
+}
+int initStatsIndex(statsindex_definition *index, datafile_definition *datafile, verbose_definition verbose)
+{
+  long n, p, f, i;
+  int ok;
+  float *profile;
+  internal_statsindex_clear(index);
+  if(internal_statsindex_allocate(index, datafile->NrSubints, datafile->NrPols, datafile->NrFreqChan, datafile->NrBins, verbose) == 0)
+    return 0;
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("Building statistics index for %ld subints, %ld polarizations and %ld frequency channels\n", datafile->NrSubints, datafile->NrPols, datafile->NrFreqChan);
+  }
+  if(datafile->format == MEMORY_format && datafile->isTransposed == 0) {
+#pragma omp parallel for
+    for(i = 0; i < datafile->NrSubints*datafile->NrPols*datafile->NrFreqChan; i++) {
+      internal_statsindex_profile(&(datafile->data[i*datafile->NrBins]), datafile->NrBins, &(index->min[i]), &(index->max[i]), &(index->sum[i]), &(index->sumsq[i]), &(index->nrnan[i]));
+    }
+  }else {
+    profile = (float *)malloc(datafile->NrBins*sizeof(float));
+    if(profile == NULL) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR initStatsIndex: Memory allocation error.");
+      freeStatsIndex(index);
+      return 0;
+    }
+    ok = 1;
+    for(n = 0; n < datafile->NrSubints && ok; n++) {
+      for(f = 0; f < datafile->NrFreqChan && ok; f++) {
+ for(p = 0; p < datafile->NrPols; p++) {
+   if(readPulsePSRData(datafile, n, p, f, 0, datafile->NrBins, profile, verbose) != 1) {
+     ok = 0;
+     break;
+   }
+   i = p+datafile->NrPols*(f+n*datafile->NrFreqChan);
+   internal_statsindex_profile(profile, datafile->NrBins, &(index->min[i]), &(index->max[i]), &(index->sum[i]), &(index->sumsq[i]), &(index->nrnan[i]));
+ }
+      }
+      if(verbose.verbose && verbose.nocounters == 0)
+ printf("  Progress building statistics index (%.1f%%)\r", 100.0*(n+1)/(float)datafile->NrSubints);
+    }
+    free(profile);
+    if(ok == 0) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR initStatsIndex: Cannot read data.");
+      freeStatsIndex(index);
+      return 0;
+    }
+  }
+  index->fingerprint = internal_statsindex_fingerprint(datafile);
+  return 1;
+}
+void freeStatsIndex(statsindex_definition *index)
+{
+  if(index->min != NULL)
+    free(index->min);
+  if(index->max != NULL)
+    free(index->max);
+  if(index->sum != NULL)
+    free(index->sum);
+  if(index->sumsq != NULL)
+    free(index->sumsq);
+  if(index->nrnan != NULL)
+    free(index->nrnan);
+  internal_statsindex_clear(index);
+}
+int writeStatsIndex(statsindex_definition *index, datafile_definition *datafile, char *filename, verbose_definition verbose)
+{
+  FILE *fout;
+  int i, ok, version;
+  long n;
+  long long size, mtime;
+  unsigned long long checksum;
+  if(internal_statsindex_filekey(datafile->filename, &size, &mtime, &checksum) == 0) {
+    if(verbose.debug)
+      printf("writeStatsIndex: %s cannot be identified on disk, statistics index is not stored.\n", datafile->filename);
+    return 0;
+  }
+  fout = fopen(filename, "wb");
+  if(fout == NULL) {
+    fflush(stdout);
+    printwarning(verbose.debug, "WARNING writeStatsIndex: Cannot open %s, statistics index is not stored.", filename);
+    return 0;
+  }
+  ok = 1;
+  version = STATS_INDEX_VERSION;
+  n = index->NrSubints*index->NrPols*index->NrFreqChan;
+  if(fwrite(STATS_INDEX_MAGIC, 1, strlen(STATS_INDEX_MAGIC)+1, fout) != strlen(STATS_INDEX_MAGIC)+1 || fwrite(&version, sizeof(int), 1, fout) != 1)
+    ok = 0;
+  if(fwrite(&size, sizeof(long long), 1, fout) != 1 || fwrite(&mtime, sizeof(long long), 1, fout) != 1 || fwrite(&checksum, sizeof(unsigned long long), 1, fout) != 1)
+    ok = 0;
+  if(fwrite(&(index->fingerprint), sizeof(unsigned long long), 1, fout) != 1)
+    ok = 0;
+  if(fwrite(&(index->NrSubints), sizeof(long), 1, fout) != 1 || fwrite(&(index->NrPols), sizeof(long), 1, fout) != 1 || fwrite(&(index->NrFreqChan), sizeof(long), 1, fout) != 1 || fwrite(&(index->NrBins), sizeof(long), 1, fout) != 1)
+    ok = 0;
+  if(ok) {
+    if(fwrite(index->min, sizeof(float), n, fout) != n || fwrite(index->max, sizeof(float), n, fout) != n)
+      ok = 0;
+    if(fwrite(index->sum, sizeof(double), n, fout) != n || fwrite(index->sumsq, sizeof(double), n, fout) != n)
+      ok = 0;
+    if(fwrite(index->nrnan, sizeof(long), n, fout) != n)
+      ok = 0;
+  }
+  fclose(fout);
+  if(ok == 0) {
+    fflush(stdout);
+    printwarning(verbose.debug, "WARNING writeStatsIndex: Writing %s failed.", filename);
+    remove(filename);
+    return 0;
+  }
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("Statistics index stored in %s\n", filename);
+  }
+  return 1;
+}
+int readStatsIndex(statsindex_definition *index, datafile_definition *datafile, char *filename, verbose_definition verbose)
+{
+  FILE *fin;
+  char magic[100];
+  int i, version;
+  long n, NrSubints, NrPols, NrFreqChan, NrBins;
+  long long size, mtime, filesize, filemtime;
+  unsigned long long checksum, filechecksum, fingerprint;
+  internal_statsindex_clear(index);
+  fin = fopen(filename, "rb");
+  if(fin == NULL)
+    return 0;
+  n = strlen(STATS_INDEX_MAGIC)+1;
+  if(fread(magic, 1, n, fin) != n || strcmp(magic, STATS_INDEX_MAGIC) != 0 || fread(&version, sizeof(int), 1, fin) != 1 || version != STATS_INDEX_VERSION) {
+    if(verbose.debug)
+      printf("readStatsIndex: %s is not a (supported) statistics index, ignoring it.\n", filename);
+    fclose(fin);
+    return 0;
+  }
+  if(fread(&filesize, sizeof(long long), 1, fin) != 1 || fread(&filemtime, sizeof(long long), 1, fin) != 1 || fread(&filechecksum, sizeof(unsigned long long), 1, fin) != 1 || fread(&fingerprint, sizeof(unsigned long long), 1, fin) != 1) {
+    fclose(fin);
+    return 0;
+  }
+  if(fread(&NrSubints, sizeof(long), 1, fin) != 1 || fread(&NrPols, sizeof(long), 1, fin) != 1 || fread(&NrFreqChan, sizeof(long), 1, fin) != 1 || fread(&NrBins, sizeof(long), 1, fin) != 1) {
+    fclose(fin);
+    return 0;
+  }
+  if(internal_statsindex_filekey(datafile->filename, &size, &mtime, &checksum) == 0 || size != filesize || mtime != filemtime || checksum != filechecksum
+     || NrSubints != datafile->NrSubints || NrPols != datafile->NrPols || NrFreqChan != datafile->NrFreqChan || NrBins != datafile->NrBins
+     || fingerprint != internal_statsindex_fingerprint(datafile)) {
+    if(verbose.debug)
+      printf("readStatsIndex: %s does not match the data, ignoring it.\n", filename);
+    fclose(fin);
+    return 0;
+  }
+  if(internal_statsindex_allocate(index, NrSubints, NrPols, NrFreqChan, NrBins, verbose) == 0) {
+    fclose(fin);
+    return 0;
+  }
+  index->fingerprint = fingerprint;
+  n = NrSubints*NrPols*NrFreqChan;
+  if(fread(index->min, sizeof(float), n, fin) != n || fread(index->max, sizeof(float), n, fin) != n || fread(index->sum, sizeof(double), n, fin) != n || fread(index->sumsq, sizeof(double), n, fin) != n || fread(index->nrnan, sizeof(long), n, fin) != n) {
+    fclose(fin);
+    freeStatsIndex(index);
+    return 0;
+  }
+  fclose(fin);
+  if(verbose.verbose) {
+    for(i = 0; i < verbose.indent; i++)
+      printf(" ");
+    printf("Statistics index loaded from %s\n", filename);
+  }
+  return 1;
+}
+int getStatsIndex(statsindex_definition *index, datafile_definition *datafile, int sidecar, verbose_definition verbose)
+{
+  char *filename;
+  filename = NULL;
+  if(sidecar && datafile->filename != NULL) {
+    filename = malloc(strlen(datafile->filename)+7);
+    if(filename != NULL)
+      sprintf(filename, "%s.stats", datafile->filename);
+  }
+  if(filename != NULL && readStatsIndex(index, datafile, filename, verbose)) {
+    free(filename);
+    return 1;
+  }
+  if(initStatsIndex(index, datafile, verbose) == 0) {
+    if(filename != NULL)
+      free(filename);
+    return 0;
+  }
+  if(filename != NULL) {
+    writeStatsIndex(index, datafile, filename, verbose);
+    free(filename);
+  }
+  return 1;
+}
+int statsIndexProfile(statsindex_definition *index, long subint, long pol, long freq, float *min, float *max, double *mean, double *rms, long *nrnan)
+{
+  long i, nrvalid;
+  double avrg;
+  if(subint < 0 || subint >= index->NrSubints || pol < 0 || pol >= index->NrPols || freq < 0 || freq >= index->NrFreqChan)
+    return 0;
+  i = pol+index->NrPols*(freq+subint*index->NrFreqChan);
+  nrvalid = index->NrBins - index->nrnan[i];
+  avrg = 0;
+  if(nrvalid > 0)
+    avrg = index->sum[i]/(double)nrvalid;
+  if(min != NULL)
+    *min = index->min[i];
+  if(max != NULL)
+    *max = index->max[i];
+  if(mean != NULL)
+    *mean = avrg;
+  if(rms != NULL) {
+    *rms = 0;
+    if(nrvalid > 0 && index->sumsq[i]/(double)nrvalid > avrg*avrg)
+      *rms = sqrt(index->sumsq[i]/(double)nrvalid - avrg*avrg);
+  }
+  if(nrnan != NULL)
+    *nrnan = index->nrnan[i];
+  return 1;
+}
+int statsIndexRange(statsindex_definition *index, long pol, long freq, float *min, float *max)
+{
+  long n, p, f, i;
+  int first;
+  first = 1;
+  *min = *max = 0;
+  for(n = 0; n < index->NrSubints; n++) {
+    for(f = 0; f < index->NrFreqChan; f++) {
+      if(freq >= 0 && f != freq)
+ continue;
+      for(p = 0; p < index->NrPols; p++) {
+ if(pol >= 0 && p != pol)
+   continue;
+ i = p+index->NrPols*(f+n*index->NrFreqChan);
+ if(index->nrnan[i] == index->NrBins)
+   continue;
+ if(first || index->min[i] < *min)
+   *min = index->min[i];
+ if(first || index->max[i] > *max)
+   *max = index->max[i];
+ first = 0;
+      }
+    }
+  }
+  if(first)
+    return 0;
+  return 1;
+}
+int statsIndexBaselineSubtracted(statsindex_definition *index)
+{
+  long n, f, i;
+  if(index->NrPols < 1)
+    return 1;
+  for(f = 0; f < index->NrFreqChan; f++) {
+    for(n = 0; n < index->NrSubints; n++) {
+      i = index->NrPols*(f+n*index->NrFreqChan);
+      if(index->max[i] < 0 || index->min[i] > 0)
+ return 0;
+    }
+  }
+  return 1;
+}
@@ -0,0 +1,235 @@
+/*
+Copyright (c) 2015, Patrick Weltevrede
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "psrsalsa.h"
+void initSyntheticParams(synthetic_definition *params)
+{
+  params->NrSubints = 256;
+  params->NrBins = 1024;
+  params->NrPols = 1;
+  params->NrFreqChan = 1;
+  params->NrBits = 8;
+  params->searchmode = 0;
+  params->paswing = 0;
+  params->period = 1.0;
+  params->centrefreq = 1400.0;
+  params->bandwidth = 100.0;
+  params->dm = 10.0;
+  params->rm = 50.0;
+  params->width = 0.02;
+  params->p2 = 10.0;
+  params->p3 = 8.0;
+  params->snr = 10.0;
+  params->polfrac = 0.5;
+  params->alpha = 45.0;
+  params->beta = 5.0;
+  params->seed = 0;
+}
+double internal_synthetic_pa(synthetic_definition params, double longitude)
+{
+  double alpha, zeta, dphi;
+  alpha = params.alpha*M_PI/180.0;
+  zeta = (params.alpha+params.beta)*M_PI/180.0;
+  dphi = longitude*M_PI/180.0;
+  return atan2(sin(alpha)*sin(dphi), sin(zeta)*cos(alpha)-cos(zeta)*sin(alpha)*cos(dphi));
+}
+int fillSyntheticData(synthetic_definition params, float *data, verbose_definition verbose)
+{
+  long n, b, nrprofiles;
+  randomstream_definition rs;
+  if(params.NrPols != 1 && params.NrPols != 4) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR fillSyntheticData: Only 1 or 4 polarization channels are supported.");
+    return 0;
+  }
+  nrprofiles = params.NrSubints*params.NrFreqChan;
+#pragma omp parallel for private(n, b) if(nrprofiles*params.NrBins >= 65536)
+  for(n = 0; n < nrprofiles; n++) {
+    long subint, chan;
+    double freq, delay, rmangle, phase, longitude, envelope, modulation, intensity, pa;
+    float *profile;
+    subint = n / params.NrFreqChan;
+    chan = n % params.NrFreqChan;
+    freq = params.centrefreq + params.bandwidth*((chan+0.5)/(double)params.NrFreqChan - 0.5);
+    delay = calcDMDelay(freq, params.centrefreq, 0, params.dm)/params.period;
+    rmangle = calcRMAngle(freq, params.centrefreq, 0, params.rm);
+    profile = &data[params.NrBins*params.NrPols*n];
+    for(b = 0; b < params.NrBins; b++) {
+      phase = (b+0.5)/(double)params.NrBins - delay;
+      phase -= floor(phase);
+      longitude = 360.0*(phase-0.5);
+      envelope = exp(-0.5*(phase-0.5)*(phase-0.5)/(params.width*params.width));
+      modulation = 0.5*(1.0+cos(2.0*M_PI*(longitude/params.p2 - subint/params.p3)));
+      intensity = params.snr*envelope*modulation;
+      profile[b] = intensity;
+      if(params.NrPols == 4) {
+ pa = internal_synthetic_pa(params, longitude) + rmangle;
+ profile[params.NrBins+b] = params.polfrac*intensity*cos(2.0*pa);
+ profile[2*params.NrBins+b] = params.polfrac*intensity*sin(2.0*pa);
+ profile[3*params.NrBins+b] = 0.1*intensity;
+      }
+    }
+  }
+  randomstream_init(&rs, params.seed, 0);
+  randomstream_gaussian_float(&rs, 0, params.NrSubints*params.NrFreqChan*params.NrPols*params.NrBins, 1.0, data);
+  return 1;
+}
+int fillSyntheticPAswing(synthetic_definition params, float *data, double *longitudes, float *offpulse_rms, verbose_definition verbose)
+{
+  long b;
+  double longitude, envelope, intensity;
+  randomstream_definition rs;
+  randomstream_init(&rs, params.seed, 1);
+  for(b = 0; b < params.NrBins; b++) {
+    longitude = 360.0*((b+0.5)/(double)params.NrBins-0.5);
+    envelope = exp(-0.5*longitude*longitude/(360.0*360.0*params.width*params.width));
+    intensity = params.snr*envelope;
+    longitudes[b] = longitude;
+    data[b] = intensity + randomstream_gaussian_at(&rs, b, 0);
+    data[params.NrBins+b] = params.polfrac*intensity;
+    data[2*params.NrBins+b] = 0.1*intensity + randomstream_gaussian_at(&rs, b, 1);
+    if(params.polfrac*intensity > 3.0) {
+      data[4*params.NrBins+b] = 0.5*180.0/(M_PI*params.polfrac*intensity);
+      data[3*params.NrBins+b] = internal_synthetic_pa(params, longitude)*180.0/M_PI + data[4*params.NrBins+b]*randomstream_gaussian_at(&rs, b, 2);
+    }else {
+      data[3*params.NrBins+b] = 0;
+      data[4*params.NrBins+b] = -1;
+    }
+  }
+  for(b = 0; b < 5; b++)
+    offpulse_rms[b] = 1;
+  return 1;
+}
+int setSyntheticHeader(datafile_definition *datafile, synthetic_definition params, verbose_definition verbose)
+{
+  datafile->NrSubints = params.NrSubints;
+  datafile->NrBins = params.NrBins;
+  datafile->NrPols = params.NrPols;
+  datafile->NrFreqChan = params.NrFreqChan;
+  datafile->NrBits = params.NrBits;
+  if(set_psrname_PSRData(datafile, "J0000+0000", verbose) == 0 || set_observatory_PSRData(datafile, "WSRT", verbose) == 0 || set_instrument_PSRData(datafile, "psynth", verbose) == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR setSyntheticHeader: Setting header strings failed.");
+    return 0;
+  }
+  datafile->mjd_start = 55000.0;
+  datafile->ra = 0.5;
+  datafile->dec = 0.5;
+  datafile->dm = params.dm;
+  datafile->rm = params.rm;
+  datafile->isDeDisp = 0;
+  datafile->isDeFarad = 0;
+  datafile->isDePar = 0;
+  datafile->isDebase = 0;
+  datafile->freq_ref = params.centrefreq;
+  datafile->freqMode = FREQMODE_UNIFORM;
+  set_centre_frequency(datafile, params.centrefreq, verbose);
+  set_bandwidth(datafile, params.bandwidth, verbose);
+  datafile->tsampMode = TSAMPMODE_FIXEDTSAMP;
+  datafile->fixedtsamp = params.period/(double)params.NrBins;
+  datafile->tsubMode = TSUBMODE_FIXEDTSUB;
+  datafile->tsub_list[0] = params.period;
+  if(params.searchmode) {
+    datafile->gentype = GENTYPE_SEARCHMODE;
+    datafile->isFolded = 0;
+    datafile->foldMode = FOLDMODE_UNKNOWN;
+  }else {
+    datafile->gentype = GENTYPE_PULSESTACK;
+    datafile->isFolded = 1;
+    datafile->foldMode = FOLDMODE_FIXEDPERIOD;
+    datafile->fixedPeriod = params.period;
+  }
+  if(params.NrPols == 4)
+    datafile->poltype = POLTYPE_STOKES;
+  else
+    datafile->poltype = POLTYPE_UNKNOWN;
+  return 1;
+}
+int writeSyntheticPSRData(char *filename, int format, synthetic_definition params, int argc, char **argv, verbose_definition verbose)
+{
+  datafile_definition datafile;
+  float *data;
+  long nrsamples;
+  cleanPSRData(&datafile, verbose);
+  if(params.paswing) {
+    params.NrSubints = 1;
+    params.NrFreqChan = 1;
+    params.NrPols = 5;
+    params.searchmode = 0;
+    format = PPOL_format;
+  }
+  if(openPSRData(&datafile, filename, format, 1, 0, 0, verbose) == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writeSyntheticPSRData: Cannot open %s", filename);
+    return 0;
+  }
+  if(setSyntheticHeader(&datafile, params, verbose) == 0) {
+    closePSRData(&datafile, 0, verbose);
+    return 0;
+  }
+  nrsamples = params.NrSubints*params.NrFreqChan*params.NrPols*params.NrBins;
+  data = (float *)calloc(nrsamples, sizeof(float));
+  if(data == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writeSyntheticPSRData: Cannot allocate memory (%ld samples)", nrsamples);
+    closePSRData(&datafile, 0, verbose);
+    return 0;
+  }
+  if(params.paswing) {
+    datafile.poltype = POLTYPE_ILVPAdPA;
+    datafile.tsampMode = TSAMPMODE_LONGITUDELIST;
+    datafile.tsamp_list = (double *)malloc(params.NrBins*sizeof(double));
+    datafile.offpulse_rms = (float *)malloc(5*sizeof(float));
+    if(datafile.tsamp_list == NULL || datafile.offpulse_rms == NULL) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR writeSyntheticPSRData: Memory allocation error");
+      free(data);
+      closePSRData(&datafile, 0, verbose);
+      return 0;
+    }
+    if(fillSyntheticPAswing(params, data, datafile.tsamp_list, datafile.offpulse_rms, verbose) == 0) {
+      fflush(stdout);
+      printerror(verbose.debug, "ERROR writeSyntheticPSRData: Cannot generate PA-swing");
+      free(data);
+      closePSRData(&datafile, 0, verbose);
+      return 0;
+    }
+  }else if(fillSyntheticData(params, data, verbose) == 0) {
+    free(data);
+    closePSRData(&datafile, 0, verbose);
+    return 0;
+  }
+  if(writeHeaderPSRData(&datafile, argc, argv, 0, verbose) == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writeSyntheticPSRData: Cannot write header to %s", filename);
+    free(data);
+    closePSRData(&datafile, 0, verbose);
+    return 0;
+  }
+  if(writePSRData(&datafile, data, verbose) == 0) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writeSyntheticPSRData: Cannot write data to %s", filename);
+    free(data);
+    closePSRData(&datafile, 0, verbose);
+    return 0;
+  }
+  free(data);
+  closePSRData(&datafile, 0, verbose);
+  return 1;
+}
@@ -0,0 +1,127 @@
+/*
+Copyright (c) 2015, Patrick Weltevrede
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "psrsalsa.h"
+char *internal_timing_countername[TIMING_NRCOUNTERS] = {"bytes_read", "bytes_written", "fft_plans", "fft_executions", "allocations", "allocated_bytes", "profiles"};
+double internal_timing_clock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+void initTiming(timing_definition *timing)
+{
+  int i;
+  timing->nrstages = 0;
+  for(i = 0; i < TIMING_NRCOUNTERS; i++)
+    timing->counters[i] = 0;
+  timing->starttime = internal_timing_clock();
+}
+double timingStart(verbose_definition verbose)
+{
+  if(verbose.timing == NULL)
+    return 0;
+  return internal_timing_clock();
+}
+void timingStop(verbose_definition verbose, char *stage, double start)
+{
+  int i, nrstages;
+  double dt;
+  timing_definition *timing;
+  timing = verbose.timing;
+  if(timing == NULL)
+    return;
+  dt = internal_timing_clock() - start;
+#pragma omp atomic read
+  nrstages = timing->nrstages;
+#pragma omp flush
+  for(i = 0; i < nrstages; i++) {
+    if(timing->stagekey[i] == stage)
+      break;
+  }
+  if(i == nrstages) {
+#pragma omp critical (psrsalsa_timing)
+    {
+      for(i = 0; i < timing->nrstages; i++) {
+ if(timing->stagekey[i] == stage || strcmp(timing->stagename[i], stage) == 0)
+   break;
+      }
+      if(i == timing->nrstages && i < MaxNrTimingStages) {
+ strncpy(timing->stagename[i], stage, MaxTimingStageNameLength-1);
+ timing->stagename[i][MaxTimingStageNameLength-1] = 0;
+ timing->stagekey[i] = stage;
+ timing->stagetime[i] = 0;
+ timing->stagecalls[i] = 0;
+#pragma omp flush
+#pragma omp atomic write
+ timing->nrstages = i+1;
+      }
+    }
+  }
+  if(i < MaxNrTimingStages) {
+#pragma omp atomic
+    timing->stagetime[i] += dt;
+#pragma omp atomic
+    timing->stagecalls[i]++;
+  }
+}
+void timingCount(verbose_definition verbose, int counter, long long amount)
+{
+  if(verbose.timing == NULL)
+    return;
+#pragma omp atomic
+  verbose.timing->counters[counter] += amount;
+}
+void printTiming(FILE *stream, timing_definition *timing)
+{
+  int i;
+  double total;
+  total = internal_timing_clock() - timing->starttime;
+  fprintf(stream, "\nTiming breakdown (stages are inclusive of the stages they call):\n");
+  fprintf(stream, "  %-32s %10s %12s %7s\n", "Stage", "Calls", "Time (s)", "%");
+  for(i = 0; i < timing->nrstages; i++) {
+    fprintf(stream, "  %-32s %10ld %12.6f %6.1f%%\n", timing->stagename[i], timing->stagecalls[i], timing->stagetime[i], total > 0 ? 100.0*timing->stagetime[i]/total : 0.0);
+  }
+  fprintf(stream, "  %-32s %10s %12.6f\n", "Total wall clock", "", total);
+  fprintf(stream, "Counters:\n");
+  for(i = 0; i < TIMING_NRCOUNTERS; i++) {
+    fprintf(stream, "  %-32s %lld\n", internal_timing_countername[i], timing->counters[i]);
+  }
+}
+int writeTimingJSON(char *filename, char *progname, timing_definition *timing, verbose_definition verbose)
+{
+  int i;
+  FILE *fout;
+  fout = fopen(filename, "w");
+  if(fout == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR writeTimingJSON: Cannot open %s", filename);
+    return 0;
+  }
+  fprintf(fout, "{\n  \"program\": \"%s\",\n  \"wallclock\": %.9f,\n  \"stages\": [\n", progname, internal_timing_clock() - timing->starttime);
+  for(i = 0; i < timing->nrstages; i++) {
+    fprintf(fout, "    {\"name\": \"%s\", \"calls\": %ld, \"seconds\": %.9f}%s\n", timing->stagename[i], timing->stagecalls[i], timing->stagetime[i], i < timing->nrstages-1 ? "," : "");
+  }
+  fprintf(fout, "  ],\n  \"counters\": {\n");
+  for(i = 0; i < TIMING_NRCOUNTERS; i++) {
+    fprintf(fout, "    \"%s\": %lld%s\n", internal_timing_countername[i], timing->counters[i], i < TIMING_NRCOUNTERS-1 ? "," : "");
+  }
+  fprintf(fout, "  }\n}\n");
+  fclose(fout);
+  return 1;
+}
@@ -63,13 +63,78 @@ double calcVonMisesFunction(vonMises_collection_definition *components, double p
   }
   return y;
 }
+int initVonMisesTemplate(vonMises_template_definition *tmpl, long nrbins, verbose_definition verbose)
+{
+  long i;
+  tmpl->nrbins = nrbins;
+  tmpl->costable = (double *)malloc(nrbins*sizeof(double));
+  tmpl->sintable = (double *)malloc(nrbins*sizeof(double));
+  if(tmpl->costable == NULL || tmpl->sintable == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR initVonMisesTemplate: Memory allocation error.");
+    return 0;
+  }
+  for(i = 0; i < nrbins; i++) {
+    tmpl->costable[i] = cos(2.0*M_PI*i/(double)nrbins);
+    tmpl->sintable[i] = sin(2.0*M_PI*i/(double)nrbins);
+  }
+  return 1;
+}
+void freeVonMisesTemplate(vonMises_template_definition *tmpl)
+{
+  if(tmpl->costable != NULL)
+    free(tmpl->costable);
+  if(tmpl->sintable != NULL)
+    free(tmpl->sintable);
+  tmpl->costable = NULL;
+  tmpl->sintable = NULL;
+}
+void calcVonMisesTemplate(vonMises_template_definition *tmpl, vonMises_collection_definition *components, double shift, int normalize, float *profile)
+{
+  int n;
+  long i, nrbins;
+  double cosc, sinc, kappa, height, *costable, *sintable;
+  float Imax;
+  nrbins = tmpl->nrbins;
+  costable = tmpl->costable;
+  sintable = tmpl->sintable;
+  for(i = 0; i < nrbins; i++) {
+    profile[i] = 0;
+  }
+  for(n = 0; n < components->nrcomponents; n++) {
+    cosc = cos(2.0*M_PI*(components->centre[n]+shift));
+    sinc = sin(2.0*M_PI*(components->centre[n]+shift));
+    kappa = components->concentration[n];
+    height = components->height[n];
+#pragma omp simd
+    for(i = 0; i < nrbins; i++) {
+      profile[i] += height*exp((costable[i]*cosc + sintable[i]*sinc - 1.0)*kappa);
+    }
+  }
+  if(normalize) {
+    Imax = -1;
+    for(i = 0; i < nrbins; i++) {
+      if(profile[i] > Imax)
+ Imax = profile[i];
+    }
+    for(i = 0; i < nrbins; i++) {
+      profile[i] /= Imax;
+    }
+  }
+}
 void calcVonMisesProfile(vonMises_collection_definition *components, int nrbins, float *profile, double shift, int normalize)
 {
   int i;
   double x, Imax = -1;
-  for(i = 0; i < nrbins; i++) {
-    profile[i] = 0;
+  vonMises_template_definition tmpl;
+  verbose_definition noverbose;
+  cleanVerboseState(&noverbose);
+  if(initVonMisesTemplate(&tmpl, nrbins, noverbose)) {
+    calcVonMisesTemplate(&tmpl, components, shift, normalize, profile);
+    freeVonMisesTemplate(&tmpl);
+    return;
   }
+  freeVonMisesTemplate(&tmpl);
   for(i = 0; i < nrbins; i++) {
     x = i/(double)nrbins;
     profile[i] = calcVonMisesFunction(components, x, shift);
@@ -89,6 +154,7 @@ float correlateVonMisesFunction(vonMises_collection_definition *components, int
   float correl_max, *profile2;
   int i;
   int ishift;
+  vonMises_template_definition tmpl;
   if(verbose.verbose) {
     for(i = 0; i < verbose.indent; i++)
       printf(" ");
@@ -96,12 +162,17 @@ float correlateVonMisesFunction(vonMises_collection_definition *components, int
     verbose.indent += 2;
   }
   profile2 = (float *)malloc(nrbins*sizeof(float));
-  if(profile2 == NULL) {
+  if(profile2 == NULL || initVonMisesTemplate(&tmpl, nrbins, verbose) == 0) {
     fflush(stdout);
     printerror(verbose.debug, "ERROR correlateVonMisesFunction: Memory allocation error.");
+    if(profile2 != NULL) {
+      freeVonMisesTemplate(&tmpl);
+      free(profile2);
+    }
     return 0;
   }
-  calcVonMisesProfile(components, nrbins, profile2, 0, 0);
+  calcVonMisesTemplate(&tmpl, components, 0, 0, profile2);
+  freeVonMisesTemplate(&tmpl);
   find_peak_correlation(profile, profile2, nrbins, 0, 1, 1, &ishift, &correl_max, verbose);
   if(verbose.verbose) {
     for(i = 0; i < verbose.indent; i++)
@@ -114,3 +185,86 @@ float correlateVonMisesFunction(vonMises_collection_definition *components, int
   free(profile2);
   return ishift/(float)nrbins;
 }
+void internal_vonMises_besselscaled(double kappa, long nmax, double *result)
+{
+  long n, i, nstart;
+  double inext, icur, iprev, sum;
+  for(n = 0; n <= nmax; n++)
+    result[n] = 0;
+  if(kappa <= 0) {
+    result[0] = 1;
+    return;
+  }
+  nstart = nmax + 30 + (long)(10.0*sqrt(kappa));
+  inext = 0;
+  icur = 1e-300;
+  sum = 0;
+  for(n = nstart; n > 0; n--) {
+    iprev = inext + 2.0*n*icur/kappa;
+    inext = icur;
+    icur = iprev;
+    if(n-1 <= nmax)
+      result[n-1] = icur;
+    sum += 2.0*inext;
+    if(icur > 1e250) {
+      icur *= 1e-250;
+      inext *= 1e-250;
+      sum *= 1e-250;
+      for(i = n-1; i <= nmax; i++)
+ result[i] *= 1e-250;
+    }
+  }
+  sum += icur;
+  for(n = 0; n <= nmax; n++)
+    result[n] /= sum;
+}
+int calcVonMisesSpectrum(vonMises_collection_definition *components, long nrbins, long nrharmonics, double shift, float *spectrum, verbose_definition verbose)
+{
+  int n, alias;
+  long k, m, nmax, nmaxcomp;
+  double *bessel, theta, stepre, stepim, basere, baseim, tmp, re, im, aliasre[5], aliasim[5], amp;
+  nmax = nrharmonics + 2*nrbins;
+  bessel = (double *)malloc((nmax+1)*sizeof(double));
+  if(bessel == NULL) {
+    fflush(stdout);
+    printerror(verbose.debug, "ERROR calcVonMisesSpectrum: Memory allocation error.");
+    return 0;
+  }
+  for(k = 0; k <= nrharmonics; k++) {
+    spectrum[2*k] = 0;
+    spectrum[2*k+1] = 0;
+  }
+  for(n = 0; n < components->nrcomponents; n++) {
+    nmaxcomp = 40 + (long)(15.0*sqrt(fabs(components->concentration[n])));
+    if(nmaxcomp > nmax)
+      nmaxcomp = nmax;
+    internal_vonMises_besselscaled(components->concentration[n], nmaxcomp, bessel);
+    theta = -2.0*M_PI*(components->centre[n]+shift);
+    stepre = cos(theta);
+    stepim = sin(theta);
+    for(alias = -2; alias <= 2; alias++) {
+      aliasre[alias+2] = cos(theta*alias*nrbins);
+      aliasim[alias+2] = sin(theta*alias*nrbins);
+    }
+    amp = nrbins*components->height[n];
+    basere = 1;
+    baseim = 0;
+    for(k = 0; k <= nrharmonics; k++) {
+      re = im = 0;
+      for(alias = -2; alias <= 2; alias++) {
+ m = labs(k + alias*nrbins);
+ if(m > nmaxcomp)
+   continue;
+ re += bessel[m]*(basere*aliasre[alias+2] - baseim*aliasim[alias+2]);
+ im += bessel[m]*(basere*aliasim[alias+2] + baseim*aliasre[alias+2]);
+      }
+      spectrum[2*k] += amp*re;
+      spectrum[2*k+1] += amp*im;
+      tmp = basere*stepre - baseim*stepim;
+      baseim = basere*stepim + baseim*stepre;
+      basere = tmp;
+    }
+  }
+  free(bessel);
+  return 1;
+}
@@ -16,9 +16,74 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
-#include "gsl/gsl_rng.h"
-#include "gsl/gsl_randist.h"
 #include "psrsalsa.h"
+#define FAKEDIST_NORM     1
+#define FAKEDIST_LOGNORM  2
+#define FAKEDIST_PWRLAW   3
+#define FAKEDIST_FLAT     4
+#define FAKEDIST_GAMMA    5
+#define FAKEDIST_SIN      6
+#define FAKEDIST_RAYLEIGH 7
+#define FAKEDIST_MAXNRCOMPONENTS 100
+#define FAKEDIST_NRSTREAMS (2*FAKEDIST_MAXNRCOMPONENTS+4)
+struct {
+  int nrcomponents[2];
+  int type[2][FAKEDIST_MAXNRCOMPONENTS];
+  double param[2][FAKEDIST_MAXNRCOMPONENTS][4];
+  unsigned long long seed;
+}fakeDist_info;
+double fakeDist_draw(int type, double *param, unsigned long long streamnr, unsigned long long pointnr)
+{
+  randomstream_definition rs;
+  double angle, nmin, nmax, n;
+  unsigned int draw;
+  randomstream_init(&rs, fakeDist_info.seed, streamnr);
+  if(type == FAKEDIST_NORM) {
+    return param[0] + param[1]*randomstream_gaussian_at(&rs, pointnr, 0);
+  }else if(type == FAKEDIST_LOGNORM) {
+    return exp(param[0] + param[1]*randomstream_gaussian_at(&rs, pointnr, 0));
+  }else if(type == FAKEDIST_PWRLAW) {
+    return param[1]*pow(randomstream_uniform_at(&rs, pointnr, 0), -1.0/param[0]);
+  }else if(type == FAKEDIST_FLAT) {
+    return param[0] + (param[1]-param[0])*randomstream_uniform_at(&rs, pointnr, 0);
+  }else if(type == FAKEDIST_GAMMA) {
+    return param[1]*randomstream_gamma_at(&rs, pointnr, param[0]);
+  }else if(type == FAKEDIST_SIN) {
+    nmin = floor((param[2] + param[1]/param[0])*param[0]/180.0 - 1);
+    nmax = floor((param[3] + param[1]/param[0])*param[0]/180.0 + 1);
+    draw = 0;
+    do {
+      angle = acos((2.0*randomstream_uniform_at(&rs, pointnr, draw++)-1.0))*180.0/M_PI;
+      angle -= param[1];
+      angle /= param[0];
+      n = floor(randomstream_uniform_at(&rs, pointnr, draw++)*(nmax+1-nmin))+nmin;
+      angle += n*180.0/param[0];
+    }while(angle <= param[2] || angle >= param[3]);
+    return angle;
+  }else if(type == FAKEDIST_RAYLEIGH) {
+    return param[0]*sqrt(-2.0*log(randomstream_uniform_at(&rs, pointnr, 0)));
+  }
+  return 0;
+}
+double fakeDist_noise(double noisesigma, double *data_noise, long n_noisedata, unsigned long long streamnr, unsigned long long pointnr)
+{
+  randomstream_definition rs;
+  double sample;
+  sample = 0;
+  if(noisesigma > 0) {
+    randomstream_init(&rs, fakeDist_info.seed, streamnr);
+    sample += noisesigma*randomstream_gaussian_at(&rs, pointnr, 0);
+  }
+  if(data_noise != NULL) {
+    long n;
+    randomstream_init(&rs, fakeDist_info.seed, streamnr+1);
+    n = randomstream_uniform_at(&rs, pointnr, 0)*n_noisedata;
+    if(n >= n_noisedata)
+      n = n_noisedata-1;
+    sample += data_noise[n];
+  }
+  return sample;
+}
 int main(int argc, char **argv)
 {
   psrsalsaApplication application;
@@ -26,7 +91,6 @@ int main(int argc, char **argv)
   int noisefile_id, randomize_seed, quiet;
   long NumberPoints, NumberPoints2, i, j, loopnr, nrloops, pointnr, n_noisedata, idnum;
   double noisesigma, average_value, *data_noise;
-  long double total;
   initApplication(&application, "fakeDist", "[options]");
   application.switch_verbose = 1;
   application.switch_debug = 1;
@@ -199,19 +263,103 @@ int main(int argc, char **argv)
       return 0;
     }
   }
-  gsl_rng *rand_num_gen;
-  const gsl_rng_type *rand_num_gen_type;
-  gsl_rng_env_setup();
-  rand_num_gen_type = gsl_rng_default;
-  rand_num_gen = gsl_rng_alloc(rand_num_gen_type);
   if(application.fixseed)
     idnum = 1;
   else if(randomize_seed)
     randomize_idnum(&idnum);
-  gsl_rng_set(rand_num_gen, idnum);
+  fakeDist_info.seed = (unsigned long long)idnum;
+  if(noisefile_id == 0)
+    data_noise = NULL;
   int distr_number;
+  for(distr_number = 0; distr_number < 2; distr_number++) {
+    int cmd_line_start, type, nrparams;
+    fakeDist_info.nrcomponents[distr_number] = 0;
+    if(distr_number == 1 && NumberPoints2 <= 0)
+      break;
+    cmd_line_start = 1;
+    if(distr_number == 1) {
+      cmd_line_start = cmd_line_end_first_distr;
+    }
+    for(i = cmd_line_start; i < argc; i++) {
+      double *param;
+      type = 0;
+      param = fakeDist_info.param[distr_number][fakeDist_info.nrcomponents[distr_number]];
+      if(strcmp(argv[i], "-norm") == 0) {
+ type = FAKEDIST_NORM;
+ nrparams = 2;
+      }else if(strcmp(argv[i], "-lognorm") == 0) {
+ type = FAKEDIST_LOGNORM;
+ nrparams = 2;
+      }else if(strcmp(argv[i], "-pwrlaw") == 0) {
+ type = FAKEDIST_PWRLAW;
+ nrparams = 2;
+      }else if(strcmp(argv[i], "-flat") == 0) {
+ type = FAKEDIST_FLAT;
+ nrparams = 2;
+      }else if(strcmp(argv[i], "-gamma") == 0) {
+ type = FAKEDIST_GAMMA;
+ nrparams = 2;
+      }else if(strcmp(argv[i], "-sin") == 0) {
+ type = FAKEDIST_SIN;
+ nrparams = 4;
+      }else if(strcasecmp(argv[i], "-Rayleigh") == 0) {
+ type = FAKEDIST_RAYLEIGH;
+ nrparams = 1;
+      }
+      if(type != 0) {
+ if(fakeDist_info.nrcomponents[distr_number] == FAKEDIST_MAXNRCOMPONENTS) {
+   printerror(application.verbose_state.debug, "ERROR fakeDist: Too many distribution functions specified.\n");
+   return 0;
+ }
+ j = sscanf(argv[i+1], "%lf %lf %lf %lf", &param[0], &param[1], &param[2], &param[3]);
+ if(j < nrparams) {
+   printerror(application.verbose_state.debug, "ERROR fakeDist: Cannot parse '%s' option.", argv[i]);
+   return 0;
+ }
+ i++;
+ if(type == FAKEDIST_PWRLAW) {
+   param[0] = -param[0] - 1.0;
+ }
+ if(application.verbose_state.verbose) {
+   if(type == FAKEDIST_NORM) {
+     fprintf(stderr, "Using distribution: exp(-(x-%f)^2/(2*%f^2))/(sqrt(2*pi)*%f)\n", param[0], param[1], param[1]);
+   }else if(type == FAKEDIST_LOGNORM) {
+     fprintf(stderr, "Using distribution: exp(-(log(x)-%f)^2/(2*%f^2))/(%f*x*sqrt(2*pi))\n", param[0], param[1], param[1]);
+   }else if(type == FAKEDIST_PWRLAW) {
+     fprintf(stderr, "Using distribution: %f*x^%f for x >= %f\n", param[0]*pow(param[1], param[0]), -param[0]-1.0, param[1]);
+   }else if(type == FAKEDIST_FLAT) {
+     fprintf(stderr, "Using distribution: 1/(%f-%f)\n", param[1], param[0]);
+   }else if(type == FAKEDIST_GAMMA) {
+     fprintf(stderr, "Using distribution: %f*x^%f*exp(-x/%f)\n", 1.0/(tgamma(param[0])*pow(param[1], param[0])), param[0]-1.0, param[1]);
+   }else if(type == FAKEDIST_SIN) {
+     fprintf(stderr, "Using distribution: |sin(%f*x+%f)| with %f <= x <= %f\n", param[0], param[1], param[2], param[3]);
+   }else if(type == FAKEDIST_RAYLEIGH) {
+     fprintf(stderr, "Using distribution: x*exp(-x^2/(2*%f^2))/(%f^2)\n", param[0], param[0]);
+   }
+ }
+ fakeDist_info.type[distr_number][fakeDist_info.nrcomponents[distr_number]] = type;
+ fakeDist_info.nrcomponents[distr_number]++;
+      }
+      if(distr_number == 0) {
+ if(NumberPoints2 > 0) {
+   if(i == cmd_line_end_first_distr)
+     break;
+ }
+      }
+    }
+  }
+  int error;
+  error = 0;
+#pragma omp parallel for schedule(dynamic,1) private(i, j, pointnr) if(outputfile && nrloops > 1)
   for(loopnr = 0; loopnr < nrloops; loopnr++) {
     FILE *fout;
+    double *samples;
+    long double total;
+    long nrsamples;
+    unsigned long long streamnr;
+    if(error)
+      continue;
+    streamnr = loopnr*(unsigned long long)FAKEDIST_NRSTREAMS;
     if(!outputfile) {
       fout = stdout;
     }else {
@@ -219,7 +367,8 @@ int main(int argc, char **argv)
       tmpstr = malloc(strlen(argv[outputfile])+9+2);
       if(tmpstr == NULL) {
  printerror(application.verbose_state.debug, "ERROR fakeDist: fakeDist: Cannot allocate memory.\n");
- return 0;
+ error = 1;
+ continue;
       }
       if(nrloops == 1) {
  strcpy(tmpstr, argv[outputfile]);
@@ -229,120 +378,42 @@ int main(int argc, char **argv)
       fout = fopen(tmpstr, "w");
       if(fout == NULL) {
  printerror(application.verbose_state.debug, "ERROR fakeDist: Cannot open '%s'\n", tmpstr);
- return 0;
+ free(tmpstr);
+ error = 1;
+ continue;
       }
       if(application.verbose_state.verbose) {
  fprintf(stderr, "file %s opened for output.\n", tmpstr);
       }
       free(tmpstr);
     }
-    total = 0;
-    for(distr_number = 0; distr_number < 2; distr_number++) {
+    nrsamples = NumberPoints+NumberPoints2;
+    samples = malloc(nrsamples*sizeof(double));
+    if(samples == NULL) {
+      printerror(application.verbose_state.debug, "ERROR fakeDist: fakeDist: Cannot allocate memory.\n");
+      if(outputfile)
+ fclose(fout);
+      error = 1;
+      continue;
+    }
+#pragma omp parallel for
+    for(pointnr = 0; pointnr < nrsamples; pointnr++) {
+      int distr, component;
       double sample;
-      long max_pointnr;
-      if(distr_number == 0)
- max_pointnr = NumberPoints;
-      else
- max_pointnr = NumberPoints2;
-      for(pointnr = 0; pointnr < max_pointnr; pointnr++) {
- sample = 0;
- int cmd_line_start;
- cmd_line_start = 1;
- if(distr_number == 1) {
-   cmd_line_start = cmd_line_end_first_distr;
- }
- for(i = cmd_line_start; i < argc; i++) {
-   if(strcmp(argv[i], "-norm") == 0) {
-     double mu, sigma;
-     j = sscanf(argv[i+1], "%lf %lf", &mu, &sigma);
-     i++;
-     if(pointnr == 0 && application.verbose_state.verbose) {
-       fprintf(stderr, "Using distribution: exp(-(x-%f)^2/(2*%f^2))/(sqrt(2*pi)*%f)\n", mu, sigma, sigma);
-     }
-     sample += mu + gsl_ran_gaussian(rand_num_gen, sigma);
-   }else if(strcmp(argv[i], "-lognorm") == 0) {
-     double mu, sigma;
-     j = sscanf(argv[i+1], "%lf %lf", &mu, &sigma);
-     i++;
-     if(pointnr == 0 && application.verbose_state.verbose) {
-       fprintf(stderr, "Using distribution: exp(-(log(x)-%f)^2/(2*%f^2))/(%f*x*sqrt(2*pi))\n", mu, sigma, sigma);
-     }
-     sample += gsl_ran_lognormal(rand_num_gen, mu, sigma);
-   }else if(strcmp(argv[i], "-pwrlaw") == 0) {
-     double a, b, pareto_A, pareto_B;
-     j = sscanf(argv[i+1], "%lf %lf", &a, &b);
-     i++;
-     pareto_A = -a -1.0;
-     pareto_B = b;
-     if(pointnr == 0 && application.verbose_state.verbose) {
-       fprintf(stderr, "Using distribution: %f*x^%f for x >= %f\n", pareto_A*pow(pareto_B, pareto_A), a, b);
-     }
-     sample += gsl_ran_pareto(rand_num_gen, pareto_A, pareto_B);
-   }else if(strcmp(argv[i], "-flat") == 0) {
-     double min, max;
-     j = sscanf(argv[i+1], "%lf %lf", &min, &max);
-     i++;
-     if(pointnr == 0 && application.verbose_state.verbose) {
-       fprintf(stderr, "Using distribution: 1/(%f-%f)\n", max, min);
-     }
-     sample += gsl_ran_flat(rand_num_gen, min, max);
-   }else if(strcmp(argv[i], "-gamma") == 0) {
-     double k, theta;
-     j = sscanf(argv[i+1], "%lf %lf", &k, &theta);
-     i++;
-     if(pointnr == 0 && application.verbose_state.verbose) {
-       fprintf(stderr, "Using distribution: %f*x^%f*exp(-x/%f)\n", 1.0/(tgamma(k)*pow(theta, k)), k-1.0, theta);
-     }
-     sample += gsl_ran_gamma(rand_num_gen, k, theta);
-   }else if(strcmp(argv[i], "-sin") == 0) {
-     double a, b, min, max, angle;
-     j = sscanf(argv[i+1], "%lf %lf %lf %lf", &a, &b, &min, &max);
-     i++;
-     if(pointnr == 0 && application.verbose_state.verbose) {
-       fprintf(stderr, "Using distribution: |sin(%f*x+%f)| with %f <= x <= %f\n", a, b, min, max);
-     }
-     do {
-       angle = acos((2.0*gsl_rng_uniform(rand_num_gen)-1.0))*180.0/M_PI;
-       angle -= b;
-       angle /= a;
-       double nmin, nmax, n;
-       nmin = (min + b/a)*a/180.0;
-       nmax = (max + b/a)*a/180.0;
-       nmin -= 1;
-       nmax += 1;
-       nmin = floor(nmin);
-       nmax = floor(nmax);
-       n = gsl_rng_uniform_int(rand_num_gen, nmax+1-nmin)+nmin;
-       angle += n*180.0/a;
-     }while(angle <= min || angle >= max);
-     sample += angle;
-   }else if(strcasecmp(argv[i], "-Rayleigh") == 0) {
-     double sigma;
-     j = sscanf(argv[i+1], "%lf", &sigma);
-     i++;
-     if(pointnr == 0 && application.verbose_state.verbose) {
-       fprintf(stderr, "Using distribution: x*exp(-x^2/(2*%f^2))/(%f^2)\n", sigma, sigma);
-     }
-     sample += gsl_ran_rayleigh(rand_num_gen, sigma);
-   }
-   if(distr_number == 0) {
-     if(NumberPoints2 > 0) {
-       if(i == cmd_line_end_first_distr)
-  break;
-     }
-   }
- }
- if(noisesigma > 0) {
-   sample += gsl_ran_gaussian(rand_num_gen, noisesigma);
- }
- if(noisefile_id != 0) {
-   long n;
-   n = gsl_rng_uniform_int(rand_num_gen, n_noisedata);
-   sample += data_noise[n];
- }
- total += sample;
- fprintf(fout, "%e\n", sample);
+      distr = 0;
+      if(pointnr >= NumberPoints)
+ distr = 1;
+      sample = 0;
+      for(component = 0; component < fakeDist_info.nrcomponents[distr]; component++) {
+ sample += fakeDist_draw(fakeDist_info.type[distr][component], fakeDist_info.param[distr][component], streamnr+distr*FAKEDIST_MAXNRCOMPONENTS+component, pointnr);
       }
+      sample += fakeDist_noise(noisesigma, data_noise, n_noisedata, streamnr+2*FAKEDIST_MAXNRCOMPONENTS, pointnr);
+      samples[pointnr] = sample;
+    }
+    total = 0;
+    for(pointnr = 0; pointnr < nrsamples; pointnr++) {
+      total += samples[pointnr];
+      fprintf(fout, "%e\n", samples[pointnr]);
     }
     total /= (long double)(NumberPoints+NumberPoints2);
     if(application.verbose_state.verbose) {
@@ -361,15 +432,7 @@ int main(int argc, char **argv)
    fprintf(stderr, "Adding %ld nulls to distribution\n", nrNulls);
  total *= NumberPoints+NumberPoints2;
  for(j = 0; j < nrNulls; j++) {
-   sample = 0;
-   if(noisesigma > 0) {
-     sample += gsl_ran_gaussian(rand_num_gen, noisesigma);
-   }
-   if(noisefile_id != 0) {
-     long n;
-     n = gsl_rng_uniform_int(rand_num_gen, n_noisedata);
-     sample += data_noise[n];
-   }
+   sample = fakeDist_noise(noisesigma, data_noise, n_noisedata, streamnr+2*FAKEDIST_MAXNRCOMPONENTS+2, j);
    total += sample;
    fprintf(fout, "%e\n", sample);
  }
@@ -383,10 +446,12 @@ int main(int argc, char **argv)
  }
       }
     }
+    free(samples);
     if(outputfile)
       fclose(fout);
   }
-  gsl_rng_free(rand_num_gen);
+  if(error)
+    return 0;
   if(noisefile_id != 0) {
     free(data_noise);
   }
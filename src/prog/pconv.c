@@ -24,7 +24,7 @@ void print_help();
 int main(int argc, char **argv)
 {
   datafile_definition fin, fout;
-  int read_wholefile, indx;
+  int read_wholefile, memoryplan, indx;
   long i, n, p, f, n1, n2;
   float *pulseData, sample;
   char outputname[MaxFilenameLength], *dummy_ptr;
@@ -63,6 +63,8 @@ int main(int argc, char **argv)
   application.switch_stokes = 1;
   application.switch_deparang = 1;
   application.switch_history_cmd_only = 1;
+  application.switch_jobs = 1;
+  application.switch_memlimit = 1;
   read_wholefile = 1;
   if(argc <= 1) {
     printApplicationHelp(&application);
@@ -107,20 +109,30 @@ int main(int argc, char **argv)
     closePSRData(&fout, 0, application.verbose_state);
     return 0;
   }
-  if(!openPSRData(&fin, dummy_ptr, application.iformat, 0, read_wholefile, 0, application.verbose_state))
+  if(!openPSRData(&fin, dummy_ptr, application.iformat, 0, 0, 0, application.verbose_state))
     return 0;
-  if(read_wholefile == 0) {
+  if(!readHeaderPSRData(&fin, 0, 0, application.verbose_state))
+    return 0;
+  memoryplan = MEMORYPLAN_STREAM;
+  if(read_wholefile) {
+    memoryplan = memoryPlanApplication(&application, &fin, 0, 1, application.verbose_state);
+    if(memoryplan == 0)
+      return 0;
+    if(memoryplan == MEMORYPLAN_INMEMORY) {
+      if(readInMemoryPSRData(&fin, application.verbose_state) == 0)
+ return 0;
+    }
+  }
+  if(memoryplan == MEMORYPLAN_STREAM) {
     if(application.fchan_select != -1) {
       printerror(application.verbose_state.debug, "ERROR pconv: -fchan option doesn't work with -memsave option.");
       return 0;
     }
-    if(!readHeaderPSRData(&fin, 0, 0, application.verbose_state))
-      return 0;
   }
   if(PSRDataHeader_parse_commandline(&fin, argc, argv, application.verbose_state) == 0)
     return 0;
   region_frac_to_int(&(application.onpulse), fin.NrBins, 0);
-  if(read_wholefile != 0) {
+  if(memoryplan == MEMORYPLAN_INMEMORY) {
     for(i = 1; i < argc; i++) {
       if(strcmp(argv[i], "-header") == 0) {
  printwarning(application.verbose_state.debug, "WARNING pconv: If using the -header option, be aware it applied BEFORE the preprocessing.");
@@ -162,7 +174,7 @@ int main(int argc, char **argv)
     return 0;
   if(!writeHeaderPSRData(&fout, argc, argv, application.history_cmd_only, application.verbose_state))
     return 0;
-  if(read_wholefile == 1) {
+  if(memoryplan == MEMORYPLAN_INMEMORY) {
     if(writePSRData(&fout, fin.data, application.verbose_state) == 0) {
       printerror(application.verbose_state.debug, "ERROR pconv: Cannot write data");
       return 0;
@@ -22,8 +22,8 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include "psrsalsa.h"
 int main(int argc, char **argv)
 {
-  int read_log, centered_at_zero, file_column1, file_column2, colspecified, polspecified, filename, truncate, cdf, select;
-  long ndata, i, j, k, nrbins, nrbinsy, *distr;
+  int read_log, centered_at_zero, file_column1, file_column2, colspecified, polspecified, filename, truncate, cdf, cdf_binned, select, stream;
+  long ndata, i, j, nrbins, nrbinsy, *distr, chunksize;
   float *cmap, *distr_float;
   double *data_x, *data_y, min_x_data, max_x_data, min_y_data, max_y_data;
   double min_x, max_x, min_y, max_y, dx, dy, x, y, s, rangex_min, rangex_max, rangey_min, rangey_max, extra_phase, select1, select2;
@@ -33,6 +33,7 @@ int main(int argc, char **argv)
   double min, max;
   psrsalsaApplication application;
   datafile_definition datain;
+  histogram_definition hist;
   pgplot_options_definition pgplot_options;
   pgplot_clear_options(&pgplot_options);
   initApplication(&application, "pdist", "[options] inputfile(s)");
@@ -43,6 +44,7 @@ int main(int argc, char **argv)
   application.switch_device = 1;
   application.switch_cmap = 1;
   application.switch_cmaplist = 1;
+  application.switch_jobs = 1;
   nrbins_specified = 0;
   nrbins_specifiedy = 0;
   dx_specified = 0;
@@ -69,7 +71,10 @@ int main(int argc, char **argv)
   filename = 0;
   truncate = 0;
   cdf = 0;
+  cdf_binned = 0;
   select = 0;
+  stream = 0;
+  chunksize = 1048576;
   if(argc < 2) {
     printf("Program to generate or plot a histogram by binning data. Also a cummulative\n");
     printf("distribution can be generated. Usage:\n\n");
@@ -87,13 +92,19 @@ int main(int argc, char **argv)
     printf("                 from zero, are used (all bins, freqs and subints). The default\n");
     printf("                 default is \"0 1\", or the integrated onpulse pulse energy for\n");
     printf("                 penergy output files in mode 1.\n");
+    printf("-stream          Do not load all data in memory, but bin the input in chunks.\n");
+    printf("                 Cannot be used in combination with -select or with -cdf without\n");
+    printf("                 -n or -dx. Without -rangex (and -rangey) the data is read twice.\n");
+    printf("-chunk n         Number of values processed at once with -stream (def=%ld).\n", chunksize);
     printf("\nOutput options:\n");
     printf("-ext             Specify suffix, default is '%s'\n", output_suffix);
     printf("-output filename Write output to this file [def=.%s extension].\n", output_suffix);
     printf("-frac            Output fraction of counts per bin rather than counts.\n");
     printf("-sigma           Generate extra column with the sqrt of the nr of counts.\n");
     printf("\nDistribution options:\n");
-    printf("-cdf             The cummulative distribution is generated. Use no -dx or -n.\n");
+    printf("-cdf             The cummulative distribution is generated. Without -dx or -n\n");
+    printf("                 every input value is reported. With -dx or -n the cummulative\n");
+    printf("                 counts are reported at the right edge of each bin.\n");
     printf("-dx value        Specify bin width (can also use -n).\n");
     printf("-dy value        Specify bin width used for the second column if -2 is used.\n");
     printf("-log             The base-10 log of the input values is used.\n");
@@ -257,6 +268,18 @@ int main(int argc, char **argv)
  output_fraction = 1;
       }else if(strcmp(argv[i], "-cdf") == 0) {
  cdf = 1;
+      }else if(strcmp(argv[i], "-stream") == 0) {
+ stream = 1;
+      }else if(strcmp(argv[i], "-chunk") == 0) {
+ if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%ld", &chunksize, NULL) == 0) {
+   printerror(application.verbose_state.debug, "ERROR pdist: Cannot parse '%s' option.", argv[i]);
+   return 0;
+ }
+ if(chunksize < 1) {
+   printerror(application.verbose_state.debug, "ERROR pdist: The -chunk option requires a positive integer.");
+   return 0;
+ }
+ i++;
       }else {
  if(argv[i][0] == '-') {
    printerror(application.verbose_state.debug, "pdist: Unknown option: %s\n\nRun pdist without command line arguments to show help", argv[i]);
@@ -276,6 +299,10 @@ int main(int argc, char **argv)
     printerror(application.verbose_state.debug, "ERROR pdist: No files specified");
     return 0;
   }
+  if(application.nrjobs > 1 && showGraphics) {
+    printerror(application.verbose_state.debug, "ERROR pdist: No plots can be generated when using -jobs.\n");
+    return 0;
+  }
   if(select) {
     if(twoDmode) {
       printerror(application.verbose_state.debug, "ERROR pdist: The -2 option cannot be used with -select.\n");
@@ -298,11 +325,29 @@ int main(int argc, char **argv)
       return 0;
     }
   }
-  if(cdf) {
-    if(nrbins_specified || dx_specified) {
-      printerror(application.verbose_state.debug, "ERROR pdist: For a cdf -n and -dx should not be used.\n");
+  if(cdf && (nrbins_specified || dx_specified)) {
+    cdf_binned = 1;
+    cdf = 0;
+    if(twoDmode) {
+      printerror(application.verbose_state.debug, "ERROR pdist: For a cdf only one input column is expected.\n");
       return 0;
     }
+    if(output_sigma) {
+      printerror(application.verbose_state.debug, "ERROR pdist: For a cdf -sigma is not supported.\n");
+      return 0;
+    }
+  }
+  if(stream) {
+    if(select) {
+      printerror(application.verbose_state.debug, "ERROR pdist: The -stream option cannot be used with -select.\n");
+      return 0;
+    }
+    if(cdf) {
+      printerror(application.verbose_state.debug, "ERROR pdist: The -stream option requires -n or -dx to be used with -cdf.\n");
+      return 0;
+    }
+  }
+  if(cdf) {
     if(twoDmode) {
       printerror(application.verbose_state.debug, "ERROR pdist: For a cdf only one input column is expected.\n");
       return 0;
@@ -350,10 +395,16 @@ int main(int argc, char **argv)
  if(verbose.debug == 0)
    verbose.verbose = 0;
       }
-      i = openPSRData(&datain, filename_ptr, application.iformat, 0, 1, 1, verbose);
+      i = openPSRData(&datain, filename_ptr, application.iformat, 0, !stream, 1, verbose);
       if(i == 0) {
  printerror(application.verbose_state.debug, "ERROR pdist: Error opening data");
  return 0;
+      }
+      if(stream) {
+ if(readHeaderPSRData(&datain, 0, 1, verbose) == 0) {
+   printerror(application.verbose_state.debug, "ERROR pdist: Error reading header");
+   return 0;
+ }
       }
       if(polspecified == 0) {
  file_column1 = 0;
@@ -367,87 +418,130 @@ int main(int argc, char **argv)
    file_column1 = 2;
  }
       }
-      if(application.verbose_state.verbose)
- printf("Loading %ld points", datain.NrSubints*datain.NrFreqChan*datain.NrBins);
-      if(twoDmode)
- printf(" times two input polarizations");
-      printf("\n");
-      data_x = malloc(datain.NrSubints*datain.NrFreqChan*datain.NrBins*sizeof(double));
-      data_y = malloc(datain.NrSubints*datain.NrFreqChan*datain.NrBins*sizeof(double));
-      if(data_x == NULL || data_y == NULL) {
- printerror(application.verbose_state.debug, "ERROR pdist: Memory allocation error.\n");
- return 0;
-      }
-      long subintnr, freqnr, binnr;
-      long double total_x, total_y;
-      ndata = 0;
-      total_x = 0;
-      total_y = 0;
-      min_x_data = max_x_data = 0;
-      for(subintnr = 0; subintnr < datain.NrSubints; subintnr++) {
- for(freqnr = 0; freqnr < datain.NrFreqChan; freqnr++) {
-   for(binnr = 0; binnr < datain.NrBins; binnr++) {
-     float dummy_float;
-     if(readPulsePSRData(&datain, subintnr, file_column1, freqnr, binnr, 1, &dummy_float, application.verbose_state) == 0) {
+      if(stream) {
+ if(application.verbose_state.verbose)
+   printf("Streaming %ld points from file\n", datain.NrSubints*datain.NrFreqChan*datain.NrBins);
+ ndata = datain.NrSubints*datain.NrFreqChan*datain.NrBins;
+ data_x = NULL;
+ data_y = NULL;
+ if(rangex_set == 0 || (twoDmode && rangey_set == 0)) {
+   if(streamHistogramRange(&datain, NULL, 0, '#', file_column1, file_column2, twoDmode, read_log, chunksize, &ndata, &min_x_data, &max_x_data, &min_y_data, &max_y_data, application.verbose_state) == 0) {
+     printerror(application.verbose_state.debug, "ERROR pdist: Cannot determine range of values.\n");
+     return 0;
+   }
+ }else {
+   min_x_data = rangex_min;
+   max_x_data = rangex_max;
+   min_y_data = rangey_min;
+   max_y_data = rangey_max;
+ }
+      }else {
+ if(application.verbose_state.verbose)
+   printf("Loading %ld points", datain.NrSubints*datain.NrFreqChan*datain.NrBins);
+ if(twoDmode)
+   printf(" times two input polarizations");
+ printf("\n");
+ data_x = malloc(datain.NrSubints*datain.NrFreqChan*datain.NrBins*sizeof(double));
+ data_y = malloc(datain.NrSubints*datain.NrFreqChan*datain.NrBins*sizeof(double));
+ distr_float = malloc(datain.NrBins*sizeof(float));
+ if(data_x == NULL || data_y == NULL || distr_float == NULL) {
+   printerror(application.verbose_state.debug, "ERROR pdist: Memory allocation error.\n");
+   return 0;
+ }
+ long subintnr, freqnr, binnr;
+ long double total_x, total_y;
+ ndata = 0;
+ total_x = 0;
+ total_y = 0;
+ min_x_data = max_x_data = 0;
+ for(subintnr = 0; subintnr < datain.NrSubints; subintnr++) {
+   for(freqnr = 0; freqnr < datain.NrFreqChan; freqnr++) {
+     if(readPulsePSRData(&datain, subintnr, file_column1, freqnr, 0, datain.NrBins, distr_float, application.verbose_state) == 0) {
        printerror(application.verbose_state.debug, "ERROR pdist: Read error, shouldn't happen.\n");
        return 0;
      }
-     data_x[ndata] = dummy_float;
-     if(read_log) {
-       if(data_x[ndata] <= 0) {
-  printerror(application.verbose_state.debug, "ERROR pdist: Cannot take logarithm of a value <= 0.\n");
-  return 0;
-       }
-       data_x[ndata] = log10(data_x[ndata]);
-     }
-     if(data_x[ndata] > max_x_data || ndata == 0) {
-       max_x_data = data_x[ndata];
-     }
-     if(data_x[ndata] < min_x_data || ndata == 0) {
-       min_x_data = data_x[ndata];
-     }
-     total_x += data_x[ndata];
-     if(twoDmode) {
-       if(readPulsePSRData(&datain, subintnr, file_column2, freqnr, binnr, 1, &dummy_float, application.verbose_state) == 0) {
-  printerror(application.verbose_state.debug, "ERROR pdist: Read error, shouldn't happen.\n");
-  return 0;
-       }
-       data_y[ndata] = dummy_float;
+     for(binnr = 0; binnr < datain.NrBins; binnr++) {
+       data_x[ndata+binnr] = distr_float[binnr];
        if(read_log) {
-  if(data_y[ndata] <= 0) {
+  if(data_x[ndata+binnr] <= 0) {
     printerror(application.verbose_state.debug, "ERROR pdist: Cannot take logarithm of a value <= 0.\n");
     return 0;
   }
-  data_y[ndata] = log10(data_y[ndata]);
+  data_x[ndata+binnr] = log10(data_x[ndata+binnr]);
        }
-       if(ndata == 0) {
-  max_y_data = data_y[ndata];
-  min_y_data = data_y[ndata];
+       if(data_x[ndata+binnr] > max_x_data || ndata+binnr == 0) {
+  max_x_data = data_x[ndata+binnr];
        }
-       if(data_y[ndata] > max_y_data) {
-  max_y_data = data_y[ndata];
+       if(data_x[ndata+binnr] < min_x_data || ndata+binnr == 0) {
+  min_x_data = data_x[ndata+binnr];
        }
-       if(data_y[ndata] < min_y_data) {
-  min_y_data = data_y[ndata];
+       total_x += data_x[ndata+binnr];
+     }
+     if(twoDmode) {
+       if(readPulsePSRData(&datain, subintnr, file_column2, freqnr, 0, datain.NrBins, distr_float, application.verbose_state) == 0) {
+  printerror(application.verbose_state.debug, "ERROR pdist: Read error, shouldn't happen.\n");
+  return 0;
+       }
+       for(binnr = 0; binnr < datain.NrBins; binnr++) {
+  data_y[ndata+binnr] = distr_float[binnr];
+  if(read_log) {
+    if(data_y[ndata+binnr] <= 0) {
+      printerror(application.verbose_state.debug, "ERROR pdist: Cannot take logarithm of a value <= 0.\n");
+      return 0;
+    }
+    data_y[ndata+binnr] = log10(data_y[ndata+binnr]);
+  }
+  if(ndata+binnr == 0) {
+    max_y_data = data_y[ndata+binnr];
+    min_y_data = data_y[ndata+binnr];
+  }
+  if(data_y[ndata+binnr] > max_y_data) {
+    max_y_data = data_y[ndata+binnr];
+  }
+  if(data_y[ndata+binnr] < min_y_data) {
+    min_y_data = data_y[ndata+binnr];
+  }
+  total_y += data_y[ndata+binnr];
        }
-       total_y += data_y[ndata];
      }
-     ndata++;
+     ndata += datain.NrBins;
    }
  }
-      }
-      if(application.verbose_state.verbose) {
- printf("xrange = %e ... %e\n", min_x_data, max_x_data);
- printf("average = %Le\n", total_x/(long double)ndata);
- if(twoDmode) {
-   printf("yrange = %e ... %e\n", min_y_data, max_y_data);
-   printf("average = %Le\n", total_y/(long double)ndata);
+ free(distr_float);
+ if(application.verbose_state.verbose) {
+   printf("xrange = %e ... %e\n", min_x_data, max_x_data);
+   printf("average = %Le\n", total_x/(long double)ndata);
+   if(twoDmode) {
+     printf("yrange = %e ... %e\n", min_y_data, max_y_data);
+     printf("average = %Le\n", total_y/(long double)ndata);
+   }
  }
+ closePSRData(&datain, 0, application.verbose_state);
       }
-      closePSRData(&datain, 0, application.verbose_state);
     }else {
       int skiplines = 0;
-      if(twoDmode) {
+      if(twoDmode && file_column2_defined == 0) {
+ printerror(application.verbose_state.debug, "In 2D mode, two input columns should be specified with the -col option.\n");
+ return 0;
+      }
+      if(stream) {
+ data_x = NULL;
+ data_y = NULL;
+ ndata = 0;
+ if(rangex_set == 0 || (twoDmode && rangey_set == 0)) {
+   if(application.verbose_state.verbose)
+     fprintf(stdout, "Determining range of values in ascii file\n");
+   if(streamHistogramRange(NULL, filename_ptr, skiplines, '#', file_column1, file_column2, twoDmode, read_log, chunksize, &ndata, &min_x_data, &max_x_data, &min_y_data, &max_y_data, application.verbose_state) == 0) {
+     printerror(application.verbose_state.debug, "ERROR pdist: cannot load file.\n");
+     return 0;
+   }
+ }else {
+   min_x_data = rangex_min;
+   max_x_data = rangex_max;
+   min_y_data = rangey_min;
+   max_y_data = rangey_max;
+ }
+      }else if(twoDmode) {
  if(application.verbose_state.verbose)
    fprintf(stdout, "Loading x values from ascii file\n");
  if(read_ascii_column_double(filename_ptr, skiplines, '#', -1, 1, &ndata, file_column1, 1.0, read_log, &data_x, &min_x_data, &max_x_data, NULL, application.verbose_state, 1) == 0) {
@@ -480,7 +574,7 @@ int main(int argc, char **argv)
    }
    return 0;
  }
- data_y = malloc(datain.NrSubints*datain.NrFreqChan*datain.NrBins*sizeof(double));
+ data_y = malloc(ndata*sizeof(double));
  if(data_y == NULL) {
    printerror(application.verbose_state.debug, "ERROR pdist: Memory allocation error.\n");
    return 0;
@@ -525,26 +619,6 @@ int main(int argc, char **argv)
      printerror(application.verbose_state.debug, "ERROR pdist: Values are outside specified -rangey option. You may want to use -trunc?\n");
      return 0;
    }
- }
-      }
-    }
-    if(cdf == 0) {
-      if(truncate) {
- if(rangex_set) {
-   for(i = 0; i < ndata; i++) {
-     if(data_x[i] < min_x)
-       data_x[i] = min_x;
-     if(data_x[i] > max_x)
-       data_x[i] = max_x;
-   }
- }
- if(rangey_set) {
-   for(i = 0; i < ndata; i++) {
-     if(data_y[i] < min_y)
-       data_y[i] = min_y;
-     if(data_y[i] > max_y)
-       data_y[i] = max_y;
-   }
  }
       }
     }
@@ -560,13 +634,39 @@ int main(int argc, char **argv)
     }else {
       nrbinsy = 1;
     }
-    distr = (long *)malloc(nrbins*nrbinsy*sizeof(long));
-    if(distr == NULL) {
-      printerror(application.verbose_state.debug, "ERROR pdist: Cannot allocate memory.\n");
-      return 0;
+    if(cdf == 0 && select == 0) {
+      if(initHistogram(&hist, nrbins, dx, min_x, nrbinsy, twoDmode ? dy : 0, twoDmode ? min_y : 0, centered_at_zero, extra_phase, truncate, application.verbose_state) == 0) {
+ printerror(application.verbose_state.debug, "ERROR pdist: Cannot allocate memory.\n");
+ return 0;
+      }
+      if(stream) {
+ if(streamHistogramFill(application.iformat > 0 ? &datain : NULL, filename_ptr, 0, '#', file_column1, file_column2, twoDmode, read_log, chunksize, &hist, application.verbose_state) == 0) {
+   printerror(application.verbose_state.debug, "ERROR pdist: Binning of the data failed.\n");
+   return 0;
+ }
+ if(application.iformat > 0)
+   closePSRData(&datain, 0, application.verbose_state);
+      }else {
+ if(fillHistogram(&hist, data_x, twoDmode ? data_y : NULL, ndata, application.verbose_state) == 0) {
+   printerror(application.verbose_state.debug, "ERROR pdist: Binning of the data failed.\n");
+   return 0;
+ }
+      }
+      if(hist.nroutside > 0) {
+ printerror(application.verbose_state.debug, "ERROR pdist: %ld values are outside the specified range. You may want to use -trunc?\n", hist.nroutside);
+ return 0;
+      }
+      ndata = hist.nrsamples;
+      if(cdf_binned)
+ cumulativeHistogram(&hist);
+      distr = hist.counts;
+    }else {
+      distr = (long *)calloc(nrbins*nrbinsy, sizeof(long));
+      if(distr == NULL) {
+ printerror(application.verbose_state.debug, "ERROR pdist: Cannot allocate memory.\n");
+ return 0;
+      }
     }
-    for(i = 0; i < nrbins*nrbinsy; i++)
-      distr[i] = 0;
     if(showGraphics) {
       pgplot_options.box.drawtitle = 1;
       strcpy(pgplot_options.box.title, title);
@@ -624,19 +724,6 @@ int main(int argc, char **argv)
       }
     }
     if(twoDmode) {
-      for(i = 0; i < ndata; i++) {
- j = calculate_bin_number(data_x[i], dx, min_x, centered_at_zero, extra_phase);
- k = calculate_bin_number(data_y[i], dy, min_y, centered_at_zero, extra_phase);
- if(j < 0 || j >= nrbins) {
-   printerror(application.verbose_state.debug, "BUG!\n");
-   return 0;
- }
- if(k < 0 || k >= nrbinsy) {
-   printerror(application.verbose_state.debug, "BUG!\n");
-   return 0;
- }
- distr[k*nrbins+j] += 1;
-      }
       for(i = 0; i < nrbins; i++) {
  for(j = 0; j < nrbinsy; j++) {
    x = calculate_bin_location(i, dx, min_x, centered_at_zero, extra_phase);
@@ -729,16 +816,7 @@ int main(int argc, char **argv)
    }
  }
       }else {
- if(cdf == 0) {
-   for(i = 0; i < ndata; i++) {
-     j = calculate_bin_number(data_x[i], dx, min_x, centered_at_zero, extra_phase);
-     if(j < 0 || j >= nrbins) {
-       printerror(application.verbose_state.debug, "BUG! bin number %ld outside range.\n", j);
-       exit(0);
-     }
-     distr[j] += 1;
-   }
- }else {
+ if(cdf) {
    gsl_sort(data_x, 1, ndata);
    for(i = 0; i < ndata; i++) {
      data_y[i] = (i+1)/(double)(ndata);
@@ -750,7 +828,7 @@ int main(int argc, char **argv)
    x = i*dx;
      if(cdf == 0) {
        if(select == 0) {
-  fprintf(ofile, "%e", calculate_bin_location(i, dx, min_x, centered_at_zero, extra_phase));
+  fprintf(ofile, "%e", calculate_bin_location(i, dx, min_x, centered_at_zero, extra_phase) + 0.5*cdf_binned*dx);
        }else {
   fprintf(ofile, "%ld", distr[i]);
        }
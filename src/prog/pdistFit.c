@@ -25,6 +25,8 @@ struct {
   int debug, fixseed, colspecified, file_column1, nocounters;
   int method, nrfunctions, frac_paramnr, null_distr_specified;
   double dx, sigma;
+  ks_reference_definition ks_reference;
+  verbose_definition verbose;
 }fitter_info;
 int make_fakeDist_cmd(double *x, char *filename)
 {
@@ -124,64 +126,17 @@ int make_pdist_cmd(char *filename, char *output_filename, int trial)
   strcat(fitter_info.cmdline, filename);
   return 1;
 }
-double funk(double *x)
+double pstat_teststat(int rebinning)
 {
   FILE *fin;
-  static long trial_nr = 0;
   double teststat;
-  static double lastteststat = 0;
-  int ret, found, rebinning;
-  found = 0;
-  rebinning = 0;
-  if(access("model_trial_tmp.dist", F_OK) == 0) {
-    printerror(fitter_info.debug, "ERROR pdistFit: File model_trial_tmp.dist already exist. Remove or move this file first, as it will be overwritten otherwise.");
-    found = 1;
-  }
-  if(make_pdist_cmd("model_trial_tmp.dist", NULL, 1) == 1) {
-    rebinning = 1;
-    if(access("model_trial_tmp.dist.hist", F_OK) == 0) {
-      printerror(fitter_info.debug, "ERROR pdistFit: File model_trial_tmp.dist.hist already exist. Remove or move this file first, as it will be overwritten otherwise.");
-      found = 1;
-    }
-  }
+  int ret;
   if(access("teststat_trial_tmp.txt", F_OK) == 0) {
     printerror(fitter_info.debug, "ERROR pdistFit: File teststat_trial_tmp.txt already exist. Remove or move this file first, as it will be overwritten otherwise.");
-    found = 1;
-  }
-  if(found) {
     exit(0);
   }
-  if(fitter_info.debug) {
-    printf("This is trial %ld\n", trial_nr+1);
-  }
-  if(make_fakeDist_cmd(x, "model_trial_tmp.dist") == 0) {
-    if(trial_nr == 0) {
-      printf("  Rejecting input parameters.\n");
-      return 1e10;
-    }else {
-      printf("  Rejecting input parameters.\n");
-      return 1e10*lastteststat;
-    }
-  }
-  if(fitter_info.debug) {
-    printf("  Executing: %s\n", fitter_info.cmdline);
-  }
-  fflush(stdout);
-  system(fitter_info.cmdline);
-  trial_nr++;
-  if(make_pdist_cmd("model_trial_tmp.dist", NULL, 1) == 1) {
-    if(fitter_info.debug == 0)
-      strcat(fitter_info.cmdline, " > /dev/null");
-    if(fitter_info.debug) {
-      printf("  Executing: %s\n", fitter_info.cmdline);
-    }
-    fflush(stdout);
-    system(fitter_info.cmdline);
-  }
   if(fitter_info.method == 0) {
     sprintf(fitter_info.cmdline, "pstat -chi2cdf ");
-  }else if(fitter_info.method == 1) {
-    sprintf(fitter_info.cmdline, "pstat -ks -v ");
   }else if(fitter_info.method == 2) {
     sprintf(fitter_info.cmdline, "pstat -chi2hist ");
     if(fitter_info.threshold_values == NULL) {
@@ -204,10 +159,6 @@ double funk(double *x)
     sprintf(fitter_info.txt, "-col2 1 %s model_trial_tmp.dist ", fitter_info.measurement_file);
   }
   strcat(fitter_info.cmdline, fitter_info.txt);
-  if(fitter_info.method == 1) {
-    sprintf(fitter_info.txt, "| grep 'KS-test statistic max_diff' ");
-    strcat(fitter_info.cmdline, fitter_info.txt);
-  }
   sprintf(fitter_info.txt, "> teststat_trial_tmp.txt");
   strcat(fitter_info.cmdline, fitter_info.txt);
   if(fitter_info.debug) {
@@ -262,33 +213,6 @@ double funk(double *x)
       printerror(fitter_info.debug, "ERROR pdistFit: Cannot interpret the file teststat_trial_tmp.txt, so something is going wrong.");
       exit(0);
     }
-  }else if(fitter_info.method == 1) {
-    fscanf(fin, "%s", fitter_info.txt);
-    if(strcmp(fitter_info.txt, "KS-test") != 0) {
-      printerror(fitter_info.debug, "ERROR pdistFit: Cannot interpret the file teststat_trial_tmp.txt, so something is going wrong.");
-      exit(0);
-    }
-    fscanf(fin, "%s", fitter_info.txt);
-    if(strcmp(fitter_info.txt, "statistic") != 0) {
-      printerror(fitter_info.debug, "ERROR pdistFit: Cannot interpret the file teststat_trial_tmp.txt, so something is going wrong.");
-      exit(0);
-    }
-    fscanf(fin, "%s", fitter_info.txt);
-    if(strcmp(fitter_info.txt, "max_diff:") != 0) {
-      printerror(fitter_info.debug, "ERROR pdistFit: Cannot interpret the file teststat_trial_tmp.txt, so something is going wrong.");
-      exit(0);
-    }
-    fscanf(fin, "%s", fitter_info.txt);
-    fscanf(fin, "%s", fitter_info.txt);
-    if(strcmp(fitter_info.txt, "=") != 0) {
-      printerror(fitter_info.debug, "ERROR pdistFit: Cannot interpret the file teststat_trial_tmp.txt, so something is going wrong.");
-      exit(0);
-    }
-    ret = fscanf(fin, "%lf", &teststat);
-    if(ret != 1) {
-      printerror(fitter_info.debug, "ERROR pdistFit: Cannot interpret the file teststat_trial_tmp.txt, so something is going wrong.");
-      exit(0);
-    }
   }else if(fitter_info.method == 2) {
     fscanf(fin, "%s", fitter_info.txt);
     if(strcmp(fitter_info.txt, "Reduced") != 0) {
@@ -320,10 +244,78 @@ double funk(double *x)
     printerror(fitter_info.debug, "ERROR pdistFit: Bug.");
     exit(0);
   }
+  fclose(fin);
+  system("rm teststat_trial_tmp.txt");
+  return teststat;
+}
+double funk(double *x)
+{
+  static long trial_nr = 0;
+  double teststat;
+  static double lastteststat = 0;
+  int found, rebinning;
+  found = 0;
+  rebinning = 0;
+  if(access("model_trial_tmp.dist", F_OK) == 0) {
+    printerror(fitter_info.debug, "ERROR pdistFit: File model_trial_tmp.dist already exist. Remove or move this file first, as it will be overwritten otherwise.");
+    found = 1;
+  }
+  if(make_pdist_cmd("model_trial_tmp.dist", NULL, 1) == 1) {
+    rebinning = 1;
+    if(access("model_trial_tmp.dist.hist", F_OK) == 0) {
+      printerror(fitter_info.debug, "ERROR pdistFit: File model_trial_tmp.dist.hist already exist. Remove or move this file first, as it will be overwritten otherwise.");
+      found = 1;
+    }
+  }
+  if(found) {
+    exit(0);
+  }
+  if(fitter_info.debug) {
+    printf("This is trial %ld\n", trial_nr+1);
+  }
+  if(make_fakeDist_cmd(x, "model_trial_tmp.dist") == 0) {
+    if(trial_nr == 0) {
+      printf("  Rejecting input parameters.\n");
+      return 1e10;
+    }else {
+      printf("  Rejecting input parameters.\n");
+      return 1e10*lastteststat;
+    }
+  }
+  if(fitter_info.debug) {
+    printf("  Executing: %s\n", fitter_info.cmdline);
+  }
+  fflush(stdout);
+  system(fitter_info.cmdline);
+  trial_nr++;
+  if(make_pdist_cmd("model_trial_tmp.dist", NULL, 1) == 1) {
+    if(fitter_info.debug == 0)
+      strcat(fitter_info.cmdline, " > /dev/null");
+    if(fitter_info.debug) {
+      printf("  Executing: %s\n", fitter_info.cmdline);
+    }
+    fflush(stdout);
+    system(fitter_info.cmdline);
+  }
+  if(fitter_info.method == 1) {
+    double *trial_data, prob;
+    long nrtrial;
+    if(read_ascii_column_double("model_trial_tmp.dist", 0, '#', -1, 1, &nrtrial, 1, 1.0, 0, &trial_data, NULL, NULL, NULL, fitter_info.verbose, 1) == 0) {
+      printerror(fitter_info.debug, "ERROR pdistFit: Cannot read model_trial_tmp.dist, so something is going wrong.");
+      exit(0);
+    }
+    kstest_reference(&fitter_info.ks_reference, trial_data, NULL, nrtrial, 0, &teststat, &prob, fitter_info.verbose);
+    free(trial_data);
+    if(fitter_info.debug) {
+      printf("    KS-test statistic max_diff: %lf = %e\n", teststat, teststat);
+    }
+  }else {
+    teststat = pstat_teststat(rebinning);
+  }
   if(fitter_info.debug) {
     printf("  Test statistic: %e\n", teststat);
   }
-  sprintf(fitter_info.cmdline, "rm model_trial_tmp.dist teststat_trial_tmp.txt");
+  sprintf(fitter_info.cmdline, "rm model_trial_tmp.dist");
   if(rebinning) {
     strcat(fitter_info.cmdline, " model_trial_tmp.dist.hist");
   }
@@ -784,6 +776,22 @@ int main(int argc, char **argv)
     system(fitter_info.cmdline);
     printf("\n");
   }
+  if(fitter_info.method == 1) {
+    double *measurement_data;
+    long nrmeasurements;
+    cleanVerboseState(&fitter_info.verbose);
+    copyVerboseState(application.verbose_state, &fitter_info.verbose);
+    fitter_info.verbose.verbose = 0;
+    if(read_ascii_column_double(fitter_info.measurement_file, 0, '#', -1, 1, &nrmeasurements, fitter_info.file_column1, 1.0, 0, &measurement_data, NULL, NULL, NULL, application.verbose_state, 1) == 0) {
+      printerror(application.verbose_state.debug, "ERROR pdistFit: Cannot read %s.", fitter_info.measurement_file);
+      return 0;
+    }
+    if(ks_reference_init(&fitter_info.ks_reference, measurement_data, NULL, nrmeasurements, application.verbose_state) == 0) {
+      printerror(application.verbose_state.debug, "ERROR pdistFit: Cannot initialise KS-test.");
+      return 0;
+    }
+    free(measurement_data);
+  }
   if(application.verbose_state.verbose) {
     printf("Fitting process started\n");
     fflush(stdout);
@@ -838,6 +846,9 @@ int main(int argc, char **argv)
   if(fitter_info.nrfunctions == 2) {
     printf("The second distribution has a fraction of occurance of %e\n", xfit[fitter_info.frac_paramnr]);
   }
+  if(fitter_info.method == 1) {
+    ks_reference_free(&fitter_info.ks_reference);
+  }
   if(fitter_info.method == 2) {
     fflush(stdout);
     system("rm measurement_tmp.hist");
@@ -65,6 +65,8 @@ int main(int argc, char **argv)
   application.switch_noweights = 1;
   application.switch_useweights = 1;
   application.switch_uniformweights = 1;
+  application.switch_jobs = 1;
+  application.switch_cache = 1;
   snrTresh = 1;
   output2file = 1;
   individual_bin_mode = 0;
@@ -196,6 +198,10 @@ int main(int argc, char **argv)
     printerror(application.verbose_state.debug, "ERROR penergy: No input file(s) specified");
     return 0;
   }
+  if(application.nrjobs > 1 && application.onpulse.nrRegions == 0) {
+    printerror(application.verbose_state.debug, "ERROR penergy: The on-pulse region cannot be selected graphically when using -jobs. Use the -onpulse option.");
+    return 0;
+  }
   init_nrRegions = application.onpulse.nrRegions;
   guessing_format = 0;
   while((filename_ptr = getNextFilenameFromList(&application, argv, application.verbose_state)) != NULL) {
@@ -51,6 +51,9 @@ int main(int argc, char **argv)
   application.switch_conshift= 1;
   application.switch_circshift= 1;
   application.switch_libversions = 1;
+  application.switch_statsindex = 1;
+  application.switch_concat = 1;
+  application.switch_cache = 1;
   application.switch_history_cmd_only = 1;
   write_flag = 0;
   zoom_flag = 0;
@@ -209,8 +212,13 @@ int main(int argc, char **argv)
     return 0;
   }
   closePSRData(&fin[0], 0, application.verbose_state);
-  if(!openPSRData(&fin[0], argv[argc-1], application.iformat, 0, 1, 0, application.verbose_state))
-    return 0;
+  if(application.doconcat) {
+    if(!openApplicationConcatData(&application, argv, &fin[0], 1, application.verbose_state))
+      return 0;
+  }else {
+    if(!openPSRData(&fin[0], argv[argc-1], application.iformat, 0, 1, 0, application.verbose_state))
+      return 0;
+  }
   if(PSRDataHeader_parse_commandline(&fin[0], argc, argv, application.verbose_state) == 0)
     return 0;
   for(i = 1; i < argc; i++) {
@@ -242,7 +250,19 @@ int main(int argc, char **argv)
   }else if(fin[0].isDebase != 1) {
     printwarning(application.verbose_state.debug, "WARNING pfold:  It is not known if baseline is already subtracted. Use pmod -debase first.\n");
   }
-  if(check_baseline_subtracted(fin[0], application.verbose_state) == 0) {
+  int baseline_subtracted;
+  if(application.dostatsindex) {
+    statsindex_definition statsindex;
+    if(getStatsIndex(&statsindex, &fin[0], 1, application.verbose_state)) {
+      baseline_subtracted = statsIndexBaselineSubtracted(&statsindex);
+      freeStatsIndex(&statsindex);
+    }else {
+      baseline_subtracted = check_baseline_subtracted(fin[0], application.verbose_state);
+    }
+  }else {
+    baseline_subtracted = check_baseline_subtracted(fin[0], application.verbose_state);
+  }
+  if(baseline_subtracted == 0) {
     printwarning(application.verbose_state.debug, "WARNING pfold: Baseline does not appear to be subtracted. Use pmod -debase first.\n");
   }
   region_frac_to_int(&(application.onpulse), fin[0].NrBins, 0);
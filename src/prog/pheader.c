@@ -29,7 +29,8 @@ int main(int argc, char **argv)
   int index, c_index, nrwords, iformat_initial_value, didhistory, didweights, didfreqlist, nohead, noweights, show_linenumber;
   int maxfilenamelength, maxobservatorylength, maxgentypelength, maxscanidlength, maxinstrumentlength, maxfileformatlength, j;
   int showfootnotes, footnote_length, footnote_length2, footnote_search, footnote_parang, precision;
-  long i;
+  int nrthreads, perfileoutput, needdeferred;
+  long i, nrfiles;
   char *filename_ptr, cmd[5000];
   datafile_definition *datain;
   initApplication(&application, "pheader", "[options] inputfile(s)");
@@ -48,6 +49,9 @@ int main(int argc, char **argv)
   footnote_parang = 0;
   show_linenumber = 0;
   precision = 0;
+  nrthreads = 1;
+  perfileoutput = 0;
+  needdeferred = 0;
   if(argc < 2) {
     printf("Program to show the header information of pulsar data. Usage:\n\n");
     printApplicationHelp(&application);
@@ -58,6 +62,7 @@ int main(int argc, char **argv)
     printf("-nohead       Do not print a header at the top of the table\n");
     printf("-nofootnotes  Do not print at the bottom of the table\n");
     printf("-precision d  Add d decimal places to floating point numbers\n");
+    printf("-threads n    Read the headers of n files in parallel (default is 1)\n");
     printf("\n");
     printCitationInfo();
     return 0;
@@ -70,6 +75,16 @@ int main(int argc, char **argv)
  nohead = 1;
       }else if(strcmp(argv[i], "-nofootnotes") == 0) {
  showfootnotes = 0;
+      }else if(strcmp(argv[i], "-threads") == 0) {
+ if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%d", &nrthreads, NULL) == 0) {
+   printerror(application.verbose_state.debug, "ERROR pheader: Cannot parse '%s' option.", argv[i]);
+   return 0;
+ }
+ if(nrthreads < 1) {
+   printerror(application.verbose_state.debug, "ERROR pheader: The number of threads should be at least 1.");
+   return 0;
+ }
+ i++;
       }else if(strcmp(argv[i], "-precision") == 0) {
  if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%d", &precision, NULL) == 0) {
    printerror(application.verbose_state.debug, "ERROR pheader: Cannot parse '%s' option.", argv[i]);
@@ -142,8 +157,12 @@ int main(int argc, char **argv)
       sscanf(pickWordFromString(argv[c_index], i+1, &nrwords, 0, ' ', application.verbose_state), "%s", cmd);
       if(strcasecmp(cmd, "p0") == 0 || strcasecmp(cmd, "period") == 0) {
       }else if(strcasecmp(cmd, "freq") == 0) {
+ needdeferred = 1;
       }else if(strcasecmp(cmd, "freqlist") == 0) {
+ perfileoutput = 1;
+ needdeferred = 1;
       }else if(strcasecmp(cmd, "reffreq") == 0) {
+ needdeferred = 1;
       }else if(strcasecmp(cmd, "npulses") == 0 || strcasecmp(cmd, "nsub") == 0 || strcasecmp(cmd, "nsubint") == 0) {
       }else if(strcasecmp(cmd, "nbin") == 0 || strcasecmp(cmd, "nbins") == 0) {
       }else if(strcasecmp(cmd, "npol") == 0) {
@@ -153,9 +172,12 @@ int main(int argc, char **argv)
       }else if(strcasecmp(cmd, "length") == 0 || strcasecmp(cmd, "dur") == 0 || strcasecmp(cmd, "tobs") == 0) {
       }else if(strcasecmp(cmd, "length2") == 0) {
       }else if(strcasecmp(cmd, "tsub") == 0 || strcasecmp(cmd, "tsubint") == 0 || strcasecmp(cmd, "t_sub") == 0) {
+ perfileoutput = 1;
       }else if(strcasecmp(cmd, "name") == 0) {
       }else if(strcasecmp(cmd, "bw") == 0) {
+ needdeferred = 1;
       }else if(strcasecmp(cmd, "chbw") == 0 || strcasecmp(cmd, "chanbw") == 0) {
+ needdeferred = 1;
       }else if(strcasecmp(cmd, "dm") == 0) {
       }else if(strcasecmp(cmd, "rm") == 0) {
       }else if(strcasecmp(cmd, "ra") == 0) {
@@ -163,8 +185,12 @@ int main(int argc, char **argv)
       }else if(strcasecmp(cmd, "mjd") == 0) {
       }else if(strcasecmp(cmd, "format") == 0) {
       }else if(strcasecmp(cmd, "hist") == 0) {
+ perfileoutput = 1;
+ needdeferred = 1;
       }else if(strcasecmp(cmd, "weights") == 0) {
  noweights = 0;
+ perfileoutput = 1;
+ needdeferred = 1;
       }else if(strcasecmp(cmd, "observatory") == 0) {
       }else if(strcasecmp(cmd, "gentype") == 0) {
       }else if(strcasecmp(cmd, "long") == 0) {
@@ -188,86 +214,173 @@ int main(int argc, char **argv)
     return 0;
   }
   iformat_initial_value = application.iformat;
-  i = 0;
-  while((filename_ptr = getNextFilenameFromList(&application, argv, application.verbose_state)) != NULL) {
-    application.iformat = iformat_initial_value;
-    if(application.iformat <= 0)
-      application.iformat = guessPSRData_format(filename_ptr, 0, application.verbose_state);
-    if(isValidPSRDATA_format(application.iformat) == 0) {
-      printerror(application.verbose_state.verbose, "ERROR pheader: Please specify a valid input format with the -iformat option.\n");
+  nrfiles = numberInApplicationFilenameList(&application, argv, application.verbose_state);
+  if(c_index != 0)
+    psrfits_set_headeronly(1);
+  if(nrthreads > 1 && perfileoutput == 0 && c_index != 0) {
+    char **filenames, *fileread;
+    int error;
+    if(fits_is_reentrant() == 0) {
+      printwarning(application.verbose_state.debug, "WARNING pheader: The cfitsio library is not compiled to be thread safe, headers are read sequentially.");
+      nrthreads = 1;
+    }
+    filenames = malloc(nrfiles*sizeof(char *));
+    if(filenames == NULL) {
+      printerror(application.verbose_state.verbose, "pheader: Cannot allocate memory");
       return 0;
     }
-    if(openPSRData(&datain[i], filename_ptr, application.iformat, 0, 0, 0, application.verbose_state) == 0) {
-      printerror(application.verbose_state.verbose, "pheader: Error opening data");
+    for(i = 0; i < nrfiles; i++) {
+      filename_ptr = getNextFilenameFromList(&application, argv, application.verbose_state);
+      if(filename_ptr == NULL) {
+ printerror(application.verbose_state.verbose, "pheader: Cannot obtain filename %ld", i+1);
+ return 0;
+      }
+      filenames[i] = malloc(strlen(filename_ptr)+1);
+      if(filenames[i] == NULL) {
+ printerror(application.verbose_state.verbose, "pheader: Cannot allocate memory");
+ return 0;
+      }
+      strcpy(filenames[i], filename_ptr);
+    }
+    fileread = calloc(nrfiles, sizeof(char));
+    if(fileread == NULL) {
+      printerror(application.verbose_state.verbose, "pheader: Cannot allocate memory");
       return 0;
     }
-    verbose_definition verbose2;
-    copyVerboseState(application.verbose_state, &verbose2);
-    if(c_index == 0)
-      verbose2.verbose = 1;
-    if(readHeaderPSRData(&datain[i], noweights, 0, verbose2) == 0) {
-      printerror(application.verbose_state.verbose, "pheader: Error reading header");
+    error = 0;
+#pragma omp parallel for schedule(dynamic) num_threads(nrthreads)
+    for(i = 0; i < nrfiles; i++) {
+      int iformat, stop;
+#pragma omp atomic read
+      stop = error;
+      if(stop)
+ continue;
+      iformat = iformat_initial_value;
+      if(iformat <= 0)
+ iformat = guessPSRData_format(filenames[i], 0, application.verbose_state);
+      if(isValidPSRDATA_format(iformat) == 0) {
+ printerror(application.verbose_state.verbose, "ERROR pheader: Please specify a valid input format with the -iformat option.\n");
+#pragma omp atomic write
+ error = 1;
+      }else if(openPSRData(&datain[i], filenames[i], iformat, 0, 0, 0, application.verbose_state) == 0) {
+ printerror(application.verbose_state.verbose, "pheader: Error opening data");
+#pragma omp atomic write
+ error = 1;
+      }else if(readHeaderPSRData(&datain[i], noweights, 0, application.verbose_state) == 0) {
+ printerror(application.verbose_state.verbose, "pheader: Error reading header");
+ closePSRData(&datain[i], 0, application.verbose_state);
+#pragma omp atomic write
+ error = 1;
+      }else {
+ closePSRData(&datain[i], 1, application.verbose_state);
+ fileread[i] = 1;
+      }
+    }
+    for(i = 0; i < nrfiles; i++)
+      free(filenames[i]);
+    free(filenames);
+    if(error) {
+      for(i = 0; i < nrfiles; i++) {
+ if(fileread[i])
+   closePSRData(&datain[i], 0, application.verbose_state);
+      }
+      free(fileread);
+      free(datain);
       return 0;
     }
-    if(c_index) {
-      verbose_definition noverbose;
-      cleanVerboseState(&noverbose);
-      didhistory = 0;
-      pickWordFromString(argv[c_index], 1, &nrwords, 0, ' ', application.verbose_state);
-      for(j = 0; j < nrwords; j++) {
- sscanf(pickWordFromString(argv[c_index], j+1, &nrwords, 0, ' ', application.verbose_state), "%s", cmd);
- if(strcasecmp(cmd, "hist") == 0) {
-   printf("History for %s\n", filename_ptr);
-   showHistory(datain[i], noverbose);
-   didhistory = 1;
+    free(fileread);
+    didhistory = 0;
+    didweights = 0;
+    didfreqlist = 0;
+    i = nrfiles;
+  }else {
+    i = 0;
+    while((filename_ptr = getNextFilenameFromList(&application, argv, application.verbose_state)) != NULL) {
+      application.iformat = iformat_initial_value;
+      if(application.iformat <= 0)
+ application.iformat = guessPSRData_format(filename_ptr, 0, application.verbose_state);
+      if(isValidPSRDATA_format(application.iformat) == 0) {
+ printerror(application.verbose_state.verbose, "ERROR pheader: Please specify a valid input format with the -iformat option.\n");
+ return 0;
+      }
+      if(openPSRData(&datain[i], filename_ptr, application.iformat, 0, 0, 0, application.verbose_state) == 0) {
+ printerror(application.verbose_state.verbose, "pheader: Error opening data");
+ return 0;
+      }
+      verbose_definition verbose2;
+      copyVerboseState(application.verbose_state, &verbose2);
+      if(c_index == 0)
+ verbose2.verbose = 1;
+      if(readHeaderPSRData(&datain[i], noweights, 0, verbose2) == 0) {
+ printerror(application.verbose_state.verbose, "pheader: Error reading header");
+ return 0;
+      }
+      if(needdeferred) {
+ if(loadDeferredHeaderPSRData(&datain[i], application.verbose_state) == 0) {
+   printerror(application.verbose_state.verbose, "pheader: Error reading header");
+   return 0;
  }
       }
-      didweights = 0;
-      didfreqlist = 0;
-      pickWordFromString(argv[c_index], 1, &nrwords, 0, ' ', application.verbose_state);
-      for(j = 0; j < nrwords; j++) {
- sscanf(pickWordFromString(argv[c_index], j+1, &nrwords, 0, ' ', application.verbose_state), "%s", cmd);
- if(strcasecmp(cmd, "weights") == 0) {
-   printf("Weights for %s\n", filename_ptr);
-   if(datain[i].weights == NULL) {
-     printf("  no weights defined in file\n");
-   }else {
+      if(c_index) {
+ verbose_definition noverbose;
+ cleanVerboseState(&noverbose);
+ didhistory = 0;
+ pickWordFromString(argv[c_index], 1, &nrwords, 0, ' ', application.verbose_state);
+ for(j = 0; j < nrwords; j++) {
+   sscanf(pickWordFromString(argv[c_index], j+1, &nrwords, 0, ' ', application.verbose_state), "%s", cmd);
+   if(strcasecmp(cmd, "hist") == 0) {
+     printf("History for %s\n", filename_ptr);
+     showHistory(datain[i], noverbose);
+     didhistory = 1;
+   }
+ }
+ didweights = 0;
+ didfreqlist = 0;
+ pickWordFromString(argv[c_index], 1, &nrwords, 0, ' ', application.verbose_state);
+ for(j = 0; j < nrwords; j++) {
+   sscanf(pickWordFromString(argv[c_index], j+1, &nrwords, 0, ' ', application.verbose_state), "%s", cmd);
+   if(strcasecmp(cmd, "weights") == 0) {
+     printf("Weights for %s\n", filename_ptr);
+     if(datain[i].weights == NULL) {
+       printf("  no weights defined in file\n");
+     }else {
+       long nsub, nfreq;
+       for(nsub = 0; nsub < datain[i].NrSubints; nsub++) {
+         for(nfreq = 0; nfreq < datain[i].NrFreqChan; nfreq++) {
+    printf("  subint %04ld channel %04ld = %lf MHz: %f\n", nsub, nfreq, get_weighted_channel_freq(datain[i], nsub, nfreq, application.verbose_state), datain[i].weights[nsub*datain[i].NrFreqChan+nfreq]);
+         }
+       }
+     }
+     didweights = 1;
+   }else if(strcasecmp(cmd, "freqlist") == 0) {
+     printf("Frequencies for %s\n", filename_ptr);
      long nsub, nfreq;
      for(nsub = 0; nsub < datain[i].NrSubints; nsub++) {
        for(nfreq = 0; nfreq < datain[i].NrFreqChan; nfreq++) {
-  printf("  subint %04ld channel %04ld = %lf MHz: %f\n", nsub, nfreq, get_weighted_channel_freq(datain[i], nsub, nfreq, application.verbose_state), datain[i].weights[nsub*datain[i].NrFreqChan+nfreq]);
+         printf("  subint %04ld channel %04ld = %lf MHz\n", nsub, nfreq, get_weighted_channel_freq(datain[i], nsub, nfreq, application.verbose_state));
        }
      }
+     didfreqlist = 1;
    }
-   didweights = 1;
- }else if(strcasecmp(cmd, "freqlist") == 0) {
-   printf("Frequencies for %s\n", filename_ptr);
-   long nsub, nfreq;
-   for(nsub = 0; nsub < datain[i].NrSubints; nsub++) {
-     for(nfreq = 0; nfreq < datain[i].NrFreqChan; nfreq++) {
-       printf("  subint %04ld channel %04ld = %lf MHz\n", nsub, nfreq, get_weighted_channel_freq(datain[i], nsub, nfreq, application.verbose_state));
-     }
-   }
-   didfreqlist = 1;
  }
-      }
-      pickWordFromString(argv[c_index], 1, &nrwords, 0, ' ', application.verbose_state);
-      for(j = 0; j < nrwords; j++) {
- sscanf(pickWordFromString(argv[c_index], j+1, &nrwords, 0, ' ', application.verbose_state), "%s", cmd);
- if(strcasecmp(cmd, "tsub") == 0 || strcasecmp(cmd, "tsubint") == 0 || strcasecmp(cmd, "t_sub") == 0) {
-   printf("tsub for %s: ", filename_ptr);
-   long nsub;
-   for(nsub = 0; nsub < datain[i].NrSubints; nsub++) {
-     if(nsub != 0)
-       printf(",");
-     printf("%.*lf", 1+precision, get_tsub(datain[i], nsub, application.verbose_state));
+ pickWordFromString(argv[c_index], 1, &nrwords, 0, ' ', application.verbose_state);
+ for(j = 0; j < nrwords; j++) {
+   sscanf(pickWordFromString(argv[c_index], j+1, &nrwords, 0, ' ', application.verbose_state), "%s", cmd);
+   if(strcasecmp(cmd, "tsub") == 0 || strcasecmp(cmd, "tsubint") == 0 || strcasecmp(cmd, "t_sub") == 0) {
+     printf("tsub for %s: ", filename_ptr);
+     long nsub;
+     for(nsub = 0; nsub < datain[i].NrSubints; nsub++) {
+       if(nsub != 0)
+         printf(",");
+       printf("%.*lf", 1+precision, get_tsub(datain[i], nsub, application.verbose_state));
+     }
+     printf(" sec\n");
    }
-   printf(" sec\n");
  }
       }
+      closePSRData(&datain[i], 1, application.verbose_state);
+      i++;
     }
-    closePSRData(&datain[i], 1, application.verbose_state);
-    i++;
   }
   if(c_index == 0) {
     for(i = 0; i < numberInApplicationFilenameList(&application, argv, application.verbose_state); i++) {
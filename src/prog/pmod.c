@@ -28,7 +28,7 @@ int readZapFile(char *zaplistname, int *zapMask, int zapSkipLines, int nrZapCols
 void make_blocks(long baseline_length, long blockSize, long nrPulses, long *nrOutputBlocks, int *zapMask, verbose_definition verbose);
 int main(int argc, char **argv)
 {
-  int debase_flag, debase_offset_flag, index, deviceOpened, read_whole_file;
+  int debase_flag, debase_offset_flag, index, deviceOpened, read_whole_file, memquant, memoryplan;
   int zapoption, inverseZap, fzapoption, finverseZap, zapColumn, zapColumn2, nrZapCols, zapSkipLines;
   int blockMode, remove_pulses_flag, prange_set;
   int nrPol, nrBins, NrFreqChan, addnoise_flag, removeOnPulse_flag;
@@ -91,9 +91,12 @@ int main(int argc, char **argv)
   application.switch_shuffle = 1;
   application.switch_rotateStokes = 1;
   application.switch_libversions = 1;
+  application.switch_jobs = 1;
+  application.switch_memlimit = 1;
   debase_flag = 0;
   debase_offset_flag = 0;
   read_whole_file = 1;
+  memquant = 0;
   zapoption = 0;
   inverseZap = -1;
   finverseZap = -1;
@@ -158,6 +161,9 @@ int main(int argc, char **argv)
     printf("-output filename  Write output to filename rather than changing the extension\n");
     printf("                  to '%s'.\n", output_suffix);
     printf("-memsave          Don't read the file in as a whole at the start of the program\n");
+    printf("-memquant bits    Keep the data in memory as 8 or 16 bit integers with a scale\n");
+    printf("                  and offset per profile, reducing the memory footprint.\n");
+    printf("                  NaN, +Inf and -Inf samples are kept as reserved codes.\n");
     printf("\n");
     printCitationInfo();
    terminateApplication(&application);
@@ -286,6 +292,16 @@ int main(int argc, char **argv)
  selectMoreOnpulseRegions = 1;
       }else if(strcmp(argv[i], "-memsave") == 0) {
  read_whole_file = 0;
+      }else if(strcmp(argv[i], "-memquant") == 0) {
+ if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%d", &memquant, NULL) == 0) {
+   printerror(application.verbose_state.debug, "ERROR pmod: Cannot parse '%s' option.", argv[i]);
+   return 0;
+ }
+ if(memquant != 8 && memquant != 16) {
+   printerror(application.verbose_state.debug, "ERROR pmod: The '%s' option only accepts 8 or 16 bits.", argv[i]);
+   return 0;
+ }
+ i++;
       }else {
  if(argv[i][0] == '-') {
    printerror(application.verbose_state.debug, "pmod: Unknown option: %s\n\nRun pmod without command line arguments to show help", argv[i]);
@@ -298,6 +314,10 @@ int main(int argc, char **argv)
       }
     }
   }
+  if(application.nrjobs > 1 && selectMoreOnpulseRegions) {
+    printerror(application.verbose_state.debug, "ERROR pmod: The -onpulsegr option cannot be used with -jobs.");
+    return 0;
+  }
   if(inverseZap == -1)
     inverseZap = 0;
   if(finverseZap == -1)
@@ -345,14 +365,29 @@ int main(int argc, char **argv)
       terminateApplication(&application);
       return 0;
     }
-    i = openPSRData(&datain, filename_ptr, application.iformat, 0, read_whole_file, 0, application.verbose_state);
+    i = openPSRData(&datain, filename_ptr, application.iformat, 0, 0, 0, application.verbose_state);
     if(i == 0) {
       printerror(application.verbose_state.debug, "ERROR pmod: Error opening data");
       return 0;
     }
-    if(!read_whole_file) {
-      if(readHeaderPSRData(&datain, 0, 0, application.verbose_state) == 0) {
- printerror(application.verbose_state.debug, "pmod: Error reading header");
+    if(readHeaderPSRData(&datain, 0, 0, application.verbose_state) == 0) {
+      printerror(application.verbose_state.debug, "pmod: Error reading header");
+      return 0;
+    }
+    memoryplan = MEMORYPLAN_STREAM;
+    if(read_whole_file) {
+      memoryplan = memoryPlanApplication(&application, &datain, 0, 1, application.verbose_state);
+      if(memoryplan == 0)
+ return 0;
+    }
+    if(memoryplan == MEMORYPLAN_INMEMORY && memquant) {
+      if(readPackedPSRData(&datain, memquant, application.verbose_state) == 0) {
+ printerror(application.verbose_state.debug, "pmod: Error reading data");
+ return 0;
+      }
+    }else if(memoryplan == MEMORYPLAN_INMEMORY) {
+      if(readInMemoryPSRData(&datain, application.verbose_state) == 0) {
+ printerror(application.verbose_state.debug, "pmod: Error reading data");
  return 0;
       }
     }
@@ -72,7 +72,7 @@ int main(int argc, char **argv)
   int yUnitsMHz;
   int fixverticalscale_flag;
   int current_polnr;
-  int interactive_flag;
+  int interactive_flag, pyramid_mode, pyramid_file;
   int *zappedVectors, *zappedSubints;
   char *inputfilename;
   int viewportOptionsSet;
@@ -159,9 +159,12 @@ int main(int argc, char **argv)
   application.switch_templatedata = 1;
   application.switch_template = 1;
   application.switch_libversions = 1;
+  application.switch_cache = 1;
   application.cmap = PPGPLOT_INVERTED_HEAT;
   strcpy(application.pgplotdevice, "/xs");
   interactive_flag = 0;
+  pyramid_mode = -1;
+  pyramid_file = 0;
   dxshift_start = 0;
   dyshift = 0;
   xUnitsSwitch = XUNIT_BINS;
@@ -264,6 +267,11 @@ int main(int argc, char **argv)
     printf("-showtop      Show a panel at top of the map (use with -map).\n");
     printf("-showright    Show a panel at right of the map (use with -map).\n");
     printf("-showtwice    Plot the map twice above each other (use with -map).\n");
+    printf("-pyramid      Draw maps from a precomputed min/max/mean downsampled pyramid,\n");
+    printf("              matched to the device resolution. Default in interactive mode.\n");
+    printf("-nopyramid    Always draw maps at full resolution.\n");
+    printf("-pyramidfile  Store the pyramid next to the input file (extension .pyr) and\n");
+    printf("              reuse it next time if it matches the data. Implies -pyramid.\n");
     printf("-textkeywords Lists of keywords you can use with");
     printf(" -title.\n");
     printf("-dx           Set viewport x-range (start) to this value (default is %.2f).\n", viewport_startx);
@@ -388,6 +396,13 @@ int main(int argc, char **argv)
  disable_y_numbers = 1;
       }else if(strcmp(argv[i], "-showtwice") == 0) {
  showTwice_flag = 1;
+      }else if(strcmp(argv[i], "-pyramid") == 0) {
+ pyramid_mode = 1;
+      }else if(strcmp(argv[i], "-nopyramid") == 0) {
+ pyramid_mode = 0;
+      }else if(strcmp(argv[i], "-pyramidfile") == 0) {
+ pyramid_mode = 1;
+ pyramid_file = 1;
       }else if(strcmp(argv[i], "-labels") == 0) {
  if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%f %d %d %f %d %d %f %d %d %f %d %d", &heading_font.characterheight, &heading_font.linewidth, &heading_font.font, &title_font.characterheight, &title_font.linewidth, &title_font.font, &label_font.characterheight, &label_font.linewidth, &label_font.font, &box_font.characterheight, &box_font.linewidth, &box_font.font, NULL) == 0) {
    printerror(application.verbose_state.debug, "ERROR pplot: Cannot parse '%s' option.", argv[i]);
@@ -551,8 +566,11 @@ int main(int argc, char **argv)
   int maxy_allocated;
   maxy_allocated = 0;
   while((inputfilename = getNextFilenameFromList(&application, argv, application.verbose_state)) != NULL) {
-    int data_read;
+    int data_read, pyramid_valid, pyramid_built;
+    map_pyramid_definition pyramid;
     data_read = 0;
+    pyramid_valid = 0;
+    pyramid_built = 0;
     int nrpolarizations;
     nrpolarizations = 0;
     int didtranspose_orig_nrbin;
@@ -938,6 +956,7 @@ int main(int argc, char **argv)
        return 0;
    }
  }
+ pyramid_valid = 0;
       }
       if(setBaselineParams(fin, &baseline, &dxshift, &xUnitsSwitch, application.verbose_state) == 0)
  return 0;
@@ -1083,10 +1102,37 @@ int main(int argc, char **argv)
    min = scalerange_min;
    max = scalerange_max;
  }
+ if(pyramid_mode == 1 || (pyramid_mode == -1 && interactive_flag)) {
+   if(pyramid_valid == 0) {
+     char *pyramidfilename;
+     if(pyramid_built)
+       freeMapPyramid(&pyramid);
+     pyramid_built = 0;
+     pyramidfilename = NULL;
+     if(pyramid_file) {
+       pyramidfilename = malloc(strlen(inputfilename)+5);
+       if(pyramidfilename != NULL)
+  sprintf(pyramidfilename, "%s.pyr", inputfilename);
+     }
+     if(pyramidfilename != NULL && readMapPyramid(&pyramid, fin.data, fin.NrBins, fin.NrSubints, pyramidfilename, application.verbose_state)) {
+       pyramid_built = 1;
+     }else if(initMapPyramid(&pyramid, fin.data, fin.NrBins, fin.NrSubints, application.verbose_state)) {
+       pyramid_built = 1;
+       if(pyramidfilename != NULL)
+  writeMapPyramid(&pyramid, pyramidfilename, application.verbose_state);
+     }
+     if(pyramidfilename != NULL)
+       free(pyramidfilename);
+     pyramid_valid = 1;
+   }
+   if(pyramid_built)
+     pgplotMapPyramid(&pyramid);
+ }
  if(pgplotMap(&pgplot_options, fin.data, fin.NrBins, fin.NrSubints, xleft2, xright2, xleft, xright, dummyf1, dummyf2, dummyf3, dummyf4, application.cmap, application.itf, 0, 0, NULL, 1, 0, 1, levelset, min, max, 1, 2, dummyi, 0, showtop, 0, plotlw, showwedge, !application.do_noplotsubset, showTwice_flag, application.verbose_state) == 0) {
    printerror(application.verbose_state.debug, "ERROR pplot: Cannot plot data.");
    return 0;
  }
+ pgplotMapPyramid(NULL);
       }else {
  printf("Plotting vectors (vertical axis): %ld - %ld\n", stack_state[current_stack_pos-1].subint_start, stack_state[current_stack_pos-1].subint_end);
  ppgbbuf();
@@ -1861,6 +1907,7 @@ int main(int argc, char **argv)
   printf("Got key: %d\n", ch);
        }
      }while(ch == 65);
+     pyramid_valid = 0;
      redraw = 1;
      current_stack_pos++;
      break;
@@ -2134,6 +2181,8 @@ int main(int argc, char **argv)
       free(maxy);
       maxy_allocated = 0;
     }
+    if(pyramid_built)
+      freeMapPyramid(&pyramid);
     closePSRData(&fin, 0, application.verbose_state);
     printf("Finished plotting of: %s\n", inputfilename);
   }
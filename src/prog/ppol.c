@@ -66,6 +66,7 @@ int main(int argc, char **argv)
   application.switch_history_cmd_only = 1;
   application.switch_nskip = 1;
   application.switch_nread = 1;
+  application.switch_cache = 1;
   application.oformat = PPOL_format;
   nokeypresses = 0;
   extendedPol = 0;
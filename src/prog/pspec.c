@@ -57,6 +57,10 @@ int main(int argc, char **argv)
   application.switch_circshift= 1;
   application.switch_shuffle = 1;
   application.switch_libversions = 1;
+  application.switch_statsindex = 1;
+  application.switch_concat = 1;
+  application.switch_cache = 1;
+  application.switch_memlimit = 1;
   fft_size = 512;
   powertwo = 0;
   lrfs_flag = 0;
@@ -274,12 +278,19 @@ int main(int argc, char **argv)
    return 0;
  }
  i++;
+      }else if(argv[i][0] != '-' && application.doconcat) {
+ if(applicationAddFilename(i, application.verbose_state) == 0)
+   return 0;
       }else {
         printerror(application.verbose_state.debug, "Unknown option: %s", argv[i]);
  terminateApplication(&application);
  return 0;
       }
     }
+    if(application.doconcat) {
+      if(applicationAddFilename(argc-1, application.verbose_state) == 0)
+ return 0;
+    }
   }
   junk_float = log(fft_size)/log(2);
   junk_int = junk_float;
@@ -297,7 +308,18 @@ int main(int argc, char **argv)
     return 0;
   }
   closePSRData(&fin[0], 0, application.verbose_state);
-  if(!openPSRData(&fin[0], argv[argc-1], application.iformat, 0, 1, 0, application.verbose_state))
+  if(application.doconcat) {
+    if(!openApplicationConcatData(&application, argv, &fin[0], 0, application.verbose_state))
+      return 0;
+  }else {
+    if(!openPSRData(&fin[0], argv[argc-1], application.iformat, 0, 0, 0, application.verbose_state))
+      return 0;
+    if(!readHeaderPSRData(&fin[0], 0, 0, application.verbose_state))
+      return 0;
+  }
+  if(memoryPlanApplication(&application, &fin[0], 1, 0, application.verbose_state) == 0)
+    return 0;
+  if(readInMemoryPSRData(&fin[0], application.verbose_state) == 0)
     return 0;
   if(PSRDataHeader_parse_commandline(&fin[0], argc, argv, application.verbose_state) == 0)
     return 0;
@@ -330,7 +352,19 @@ int main(int argc, char **argv)
   }else if(fin[0].isDebase != 1) {
     printwarning(application.verbose_state.debug, "WARNING pspec:  It is not known if baseline is already subtracted. Use pmod -debase first.\n");
   }
-  if(check_baseline_subtracted(fin[0], application.verbose_state) == 0) {
+  int baseline_subtracted;
+  if(application.dostatsindex) {
+    statsindex_definition statsindex;
+    if(getStatsIndex(&statsindex, &fin[0], 1, application.verbose_state)) {
+      baseline_subtracted = statsIndexBaselineSubtracted(&statsindex);
+      freeStatsIndex(&statsindex);
+    }else {
+      baseline_subtracted = check_baseline_subtracted(fin[0], application.verbose_state);
+    }
+  }else {
+    baseline_subtracted = check_baseline_subtracted(fin[0], application.verbose_state);
+  }
+  if(baseline_subtracted == 0) {
     printwarning(application.verbose_state.debug, "WARNING pspec: Baseline does not appear to be subtracted. Use pmod -debase first.\n");
   }
   region_frac_to_int(&(application.onpulse), fin[0].NrBins, 0);
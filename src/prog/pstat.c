@@ -26,14 +26,16 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #define PEARSON 21
 #define MOMENTS 30
 #define MEDIAN 31
+#define PERCENTILE 32
+#define MaxNrPercentiles 100
 #define CHI2TEST_HIST 50
 #define CHI2TEST_CDF 51
 int main(int argc, char **argv)
 {
   psrsalsaApplication application;
   long i, j;
-  int file1_column1, file1_column2, file1_column3, file2_column1, file2_column2, file2_column3, typetest, read_log, output_idx;
-  double threshold1, threshold2, threshold3;
+  int file1_column1, file1_column2, file1_column3, file2_column1, file2_column2, file2_column3, typetest, read_log, output_idx, stream, sketch_k, nrpercentiles;
+  double threshold1, threshold2, threshold3, percentiles[MaxNrPercentiles];
   initApplication(&application, "pstat", "[options] inputfile(s)");
   application.switch_libversions = 1;
   application.switch_verbose = 1;
@@ -50,6 +52,9 @@ int main(int argc, char **argv)
   threshold2 = 0;
   threshold3 = 0;
   output_idx = 0;
+  stream = 0;
+  sketch_k = 200;
+  nrpercentiles = 0;
   if(argc < 2) {
     printf("Program to perform various statistical tests on input data. One or two input\n");
     printf("files are required depending on the statistical test to be performed. The input\n");
@@ -64,6 +69,13 @@ int main(int argc, char **argv)
     printf("-col2            Like -col1, but for second input file.\n");
     printf("-log             The base 10 log of the input values is used.\n");
     printf("-output          Specify output filename to use rather than the stdout.\n");
+    printf("-stream          Do not load the input in memory, but use a bounded-memory\n");
+    printf("                 quantile sketch (KLL). Only for -median and -percentile. The\n");
+    printf("                 result is approximate, see -sketchk.\n");
+    printf("-sketchk k       Size parameter of the sketch used by -stream (def=%d). The\n", sketch_k);
+    printf("                 error in the rank of the reported value is smaller than\n");
+    printf("                 %.2f%% with 99%% confidence for the default, and scales as\n", 100.0*quantile_sketch_rank_error(sketch_k));
+    printf("                 roughly 1/k. Memory use is about 3*k values.\n");
     printf("\nStatistical tests:\n");
     printf("-chi2hist \"t1 t2 t3\" Input should be two files, each being a histogram and\n");
     printf("                     having two (or three, see below) columns: bin location and\n");
@@ -109,6 +121,10 @@ int main(int argc, char **argv)
     printf("                 Example:  pstat -kssin -col 1 file1\n");
     printf("-median          Compute the median of the distribution.\n");
     printf("                 Example:  pstat -median -col 1 file1\n");
+    printf("-percentile \"p1 p2 ...\" Compute the specified percentiles (between 0 and 100)\n");
+    printf("                 of the distribution. The values are interpolated between the\n");
+    printf("                 samples in the same way as for -median.\n");
+    printf("                 Example:  pstat -percentile \"5 50 95\" -col 1 file1\n");
     printf("-moments         Compute different moments of the distribution (mean, variance\n");
     printf("                 etc.)\n");
     printf("                 Example:  pstat -moments -col 1 file1\n");
@@ -191,6 +207,41 @@ int main(int argc, char **argv)
    return 0;
  }
  typetest = MEDIAN;
+      }else if(strcmp(argv[i], "-percentile") == 0) {
+ if(typetest != 0) {
+   printerror(application.verbose_state.debug, "pstat: Cannot specify more than one type of statistical test at the time");
+   return 0;
+ }
+ typetest = PERCENTILE;
+ if(i+1 >= argc) {
+   printerror(application.verbose_state.debug, "ERROR pstat: Cannot parse '%s' option, need at least one value.", argv[i]);
+   return 0;
+ }
+ {
+   int nrwords;
+   char *word_ptr;
+   pickWordFromString(argv[i+1], 1, &nrwords, 1, ' ', application.verbose_state);
+   if(nrwords < 1 || nrwords > MaxNrPercentiles) {
+     printerror(application.verbose_state.debug, "ERROR pstat: Cannot parse '%s' option, need between 1 and %d values.", argv[i], MaxNrPercentiles);
+     return 0;
+   }
+   for(nrpercentiles = 0; nrpercentiles < nrwords; nrpercentiles++) {
+     word_ptr = pickWordFromString(argv[i+1], nrpercentiles+1, &nrwords, 1, ' ', application.verbose_state);
+     if(sscanf(word_ptr, "%lf", &percentiles[nrpercentiles]) != 1 || percentiles[nrpercentiles] < 0 || percentiles[nrpercentiles] > 100) {
+       printerror(application.verbose_state.debug, "ERROR pstat: Cannot parse '%s' option, values should be between 0 and 100.", argv[i]);
+       return 0;
+     }
+   }
+ }
+ i++;
+      }else if(strcmp(argv[i], "-stream") == 0) {
+ stream = 1;
+      }else if(strcmp(argv[i], "-sketchk") == 0) {
+ if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%d", &sketch_k, NULL) == 0) {
+   printerror(application.verbose_state.debug, "ERROR pstat: Cannot parse '%s' option.", argv[i]);
+   return 0;
+ }
+ i++;
       }else if(strcmp(argv[i], "-kssin") == 0) {
  if(typetest != 0) {
    printerror(application.verbose_state.debug, "pstat: Cannot specify more than one type of statistical test at the time");
@@ -315,6 +366,11 @@ int main(int argc, char **argv)
     }else if(typetest == MEDIAN) {
       if(nrInputColumns != 1) {
  printerror(application.verbose_state.debug, "ERROR pstat: Computation of the median of a distribution requires one columns of data to be read in. Example: pstat -median -col 1 file1");
+ return 0;
+      }
+    }else if(typetest == PERCENTILE) {
+      if(nrInputColumns != 1) {
+ printerror(application.verbose_state.debug, "ERROR pstat: Computation of percentiles of a distribution requires one columns of data to be read in. Example: pstat -percentile 50 -col 1 file1");
  return 0;
       }
     }else if(typetest == KSFLAT) {
@@ -341,6 +397,10 @@ int main(int argc, char **argv)
       printerror(application.verbose_state.debug, "ERROR pstat: No statistical test has been specified, nothing to do.");
       return 0;
     }
+    if(stream && typetest != MEDIAN && typetest != PERCENTILE) {
+      printerror(application.verbose_state.debug, "ERROR pstat: The -stream option is only supported for -median and -percentile.");
+      return 0;
+    }
   }
   char *filename_ptr;
   double *input_array[6];
@@ -353,7 +413,7 @@ int main(int argc, char **argv)
     printerror(application.verbose_state.debug, "ERROR pstat: Bug!");
     return 0;
   }
-  if(file1_column1) {
+  if(file1_column1 && stream == 0) {
     double min_x, max_x, avrg;
     if(read_ascii_column_double(filename_ptr, 0, '#', -1, 1, &number_values[number_input_arrays], file1_column1, 1.0, read_log, &input_array[number_input_arrays], &min_x, &max_x, &avrg, application.verbose_state, 0) == 0) {
       printerror(application.verbose_state.debug, "ERROR pstat: cannot load file.\n");
@@ -466,15 +526,51 @@ int main(int argc, char **argv)
     fprintf(fout, "Skewness           = %e\n", skew);
     kurt = gsl_stats_kurtosis(input_array[0], 1, number_values[0]);
     fprintf(fout, "Kurtosis           = %e\n", kurt);
+  }else if((typetest == MEDIAN || typetest == PERCENTILE) && stream) {
+    quantile_sketch_definition sketch;
+    double value;
+    if(init_quantile_sketch(&sketch, sketch_k, application.verbose_state) == 0) {
+      printerror(application.verbose_state.debug, "ERROR pstat: Cannot initialise quantile sketch.");
+      return 0;
+    }
+    if(read_ascii_column_sketch(filename_ptr, 0, '#', file1_column1, 1.0, read_log, &sketch, application.verbose_state, 0) == 0) {
+      printerror(application.verbose_state.debug, "ERROR pstat: cannot load file.\n");
+      return 0;
+    }
+    if(typetest == MEDIAN) {
+      nrpercentiles = 1;
+      percentiles[0] = 50;
+    }
+    for(i = 0; i < nrpercentiles; i++) {
+      if(query_quantile_sketch(&sketch, 0.01*percentiles[i], &value, application.verbose_state) == 0) {
+ printerror(application.verbose_state.debug, "ERROR pstat: Cannot query quantile sketch.");
+ return 0;
+      }
+      if(typetest == MEDIAN)
+ fprintf(fout, "Median = %e\n", value);
+      else
+ fprintf(fout, "Percentile %g = %e\n", percentiles[i], value);
+    }
+    if(application.verbose_state.verbose) {
+      printf("Approximation based on %ld points: the rank error is < %.2f%% with 99%% confidence.\n", sketch.n, 100.0*quantile_sketch_rank_error(sketch_k));
+    }
+    free_quantile_sketch(&sketch);
   }else if(typetest == MEDIAN) {
     double median;
     if(number_input_arrays != 1) {
       printerror(application.verbose_state.debug, "ERROR pstat: Computation of the moments of a distribution requires one columns of data to be read in.");
       return 0;
     }
-    gsl_sort(input_array[0], 1, number_values[0]);
-    median = gsl_stats_median_from_sorted_data(input_array[0], 1, number_values[0]);
+    median = median_select_double(input_array[0], number_values[0]);
     fprintf(fout, "Median = %e\n", median);
+  }else if(typetest == PERCENTILE) {
+    if(number_input_arrays != 1) {
+      printerror(application.verbose_state.debug, "ERROR pstat: Computation of percentiles of a distribution requires one columns of data to be read in.");
+      return 0;
+    }
+    for(i = 0; i < nrpercentiles; i++) {
+      fprintf(fout, "Percentile %g = %e\n", percentiles[i], quantile_select_double(input_array[0], number_values[0], 0.01*percentiles[i]));
+    }
   }else if(typetest == PEARSON) {
     double cc;
     if(number_input_arrays != 2) {
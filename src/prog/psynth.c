@@ -0,0 +1,197 @@
+/*
+Copyright (c) 2015, Patrick Weltevrede
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "psrsalsa.h"
+int main(int argc, char **argv)
+{
+  psrsalsaApplication application;
+  synthetic_definition params;
+  long i;
+  initApplication(&application, "psynth", "[options]");
+  application.switch_verbose = 1;
+  application.switch_debug = 1;
+  application.switch_oformat = 1;
+  application.switch_formatlist = 1;
+  application.switch_output = 1;
+  sprintf(application.outputname, "synthetic.gg");
+  application.oformat = PSRSALSA_BINARY_format;
+  initSyntheticParams(&params);
+  if(argc < 2) {
+    printf("Program to generate synthetic pulsar data of a known size. The data consist of a\n");
+    printf("Gaussian profile with drifting subpulses, dispersion, Faraday rotation, a\n");
+    printf("rotating vector model position angle swing and white noise. The same seed always\n");
+    printf("produces the same data. Usage:\n\n");
+    printApplicationHelp(&application);
+    printf("Synthetic data options:\n");
+    printf("  -nsub n       Number of subints (pulses) [def=%ld]\n", params.NrSubints);
+    printf("  -nbin n       Number of phase bins (samples per subint) [def=%ld]\n", params.NrBins);
+    printf("  -nchan n      Number of frequency channels [def=%ld]\n", params.NrFreqChan);
+    printf("  -npol n       Number of polarization channels, 1 or 4 (Stokes) [def=%ld]\n", params.NrPols);
+    printf("  -nbits n      Number of bits per sample, if supported by format [def=%d]\n", params.NrBits);
+    printf("  -search       Generate search mode data rather than a pulse stack\n");
+    printf("  -paswing      Generate a position angle swing (ppol output) instead\n");
+    printf("  -period p     Pulse period in seconds [def=%.1f]\n", params.period);
+    printf("  -freq f       Centre frequency in MHz [def=%.1f]\n", params.centrefreq);
+    printf("  -bw bw        Bandwidth in MHz [def=%.1f]\n", params.bandwidth);
+    printf("  -dm dm        Dispersion measure [def=%.1f]\n", params.dm);
+    printf("  -rm rm        Rotation measure [def=%.1f]\n", params.rm);
+    printf("  -width w      Gaussian width of the profile (fraction of period) [def=%.3f]\n", params.width);
+    printf("  -p2 P2        Subpulse separation in degrees [def=%.1f]\n", params.p2);
+    printf("  -p3 P3        Drift band separation in pulse periods [def=%.1f]\n", params.p3);
+    printf("  -snr s        Peak amplitude in units of the noise rms [def=%.1f]\n", params.snr);
+    printf("  -rvm \"a b\"    Magnetic inclination and impact parameter in deg [def=\"%.1f %.1f\"]\n", params.alpha, params.beta);
+    printf("  -seed s       Seed of the random number generator [def=%llu]\n", params.seed);
+    printf("\n");
+    printf("Example: psynth -nsub 1024 -nbin 512 -nchan 64 -npol 4 -oformat PSRFITS -output test.rf\n");
+    printf("\n");
+    printCitationInfo();
+    terminateApplication(&application);
+    return 0;
+  }
+  for(i = 1; i < argc; i++) {
+    int index;
+    index = i;
+    if(processCommandLine(&application, argc, argv, &index)) {
+      i = index;
+    }else if(strcmp(argv[i], "-nsub") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%ld", &params.NrSubints, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-nbin") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%ld", &params.NrBins, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-nchan") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%ld", &params.NrFreqChan, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-npol") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%ld", &params.NrPols, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-nbits") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%d", &params.NrBits, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-search") == 0) {
+      params.searchmode = 1;
+    }else if(strcmp(argv[i], "-paswing") == 0) {
+      params.paswing = 1;
+    }else if(strcmp(argv[i], "-period") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%lf", &params.period, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-freq") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%lf", &params.centrefreq, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-bw") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%lf", &params.bandwidth, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-dm") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%lf", &params.dm, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-rm") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%lf", &params.rm, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-width") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%lf", &params.width, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-p2") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%lf", &params.p2, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-p3") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%lf", &params.p3, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-snr") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%lf", &params.snr, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-rvm") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%lf %lf", &params.alpha, &params.beta, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else if(strcmp(argv[i], "-seed") == 0) {
+      if(parse_command_string(application.verbose_state, argc, argv, i+1, 0, -1, "%llu", &params.seed, NULL) == 0) {
+ printerror(application.verbose_state.debug, "ERROR psynth: Cannot parse '%s' option.", argv[i]);
+ return 0;
+      }
+      i++;
+    }else {
+      printerror(application.verbose_state.debug, "ERROR psynth: Unknown option: %s\n\nRun psynth without command line arguments to show help", argv[i]);
+      terminateApplication(&application);
+      return 0;
+    }
+  }
+  if(params.NrSubints < 1 || params.NrBins < 1 || params.NrFreqChan < 1 || (params.NrPols != 1 && params.NrPols != 4)) {
+    printerror(application.verbose_state.debug, "ERROR psynth: Invalid data dimensions (nsub=%ld nbin=%ld nchan=%ld npol=%ld).", params.NrSubints, params.NrBins, params.NrFreqChan, params.NrPols);
+    terminateApplication(&application);
+    return 0;
+  }
+  if(isValidPSRDATA_format(application.oformat) == 0) {
+    printerror(application.verbose_state.debug, "ERROR psynth: Please specify a valid output format with the -oformat option.");
+    terminateApplication(&application);
+    return 0;
+  }
+  if(application.verbose_state.verbose) {
+    printf("Writing %ld subints, %ld bins, %ld channels and %ld polarizations to %s\n", params.NrSubints, params.NrBins, params.NrFreqChan, params.NrPols, application.outputname);
+  }
+  if(writeSyntheticPSRData(application.outputname, application.oformat, params, argc, argv, application.verbose_state) == 0) {
+    printerror(application.verbose_state.debug, "ERROR psynth: Cannot generate %s", application.outputname);
+    terminateApplication(&application);
+    return 0;
+  }
+  terminateApplication(&application);
+  return 0;
+}